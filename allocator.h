@@ -0,0 +1,376 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace math3d {
+
+/*
+* Aligned Allocation
+* Arena and Pool hand out memory aligned to at least CacheLine bytes (or more when
+* asked), so arrays of Vec and Matrix can be read with aligned SIMD loads, and two
+* arrays never share a cache line. Neither is thread safe: use one per thread, e.g.
+* one arena per worker per frame.
+*
+* Arena is a bump allocator for short lived arrays. Memory is released all at once
+* by reset, which is O(1) and keeps the blocks for the next frame, so after the
+* first few frames it never calls the heap. reset does not run destructors, so
+* only trivially destructible types can be created in an arena.
+*
+* Pool hands out fixed size blocks, with O(1) allocate and deallocate through a free
+* list, and an O(1) reset that forgets every block at once.
+*
+* ArenaAllocator, PoolAllocator and AlignedAllocator adapt them (and the aligned
+* global heap) to the standard allocator interface, for std::vector and friends.
+*/
+inline constexpr size_t CacheLine = 64;
+
+namespace allocation {
+	inline std::byte* allocate(size_t bytes, size_t alignment) {
+		return static_cast<std::byte*>(::operator new(bytes, std::align_val_t{ alignment }));
+	}
+
+	inline void deallocate(void* p, size_t alignment) {
+		::operator delete(p, std::align_val_t{ alignment });
+	}
+
+	struct Delete {
+		size_t alignment;
+
+		void operator()(std::byte* p) const {
+			deallocate(p, alignment);
+		}
+	};
+
+	using Block = std::unique_ptr<std::byte[], Delete>;
+
+	constexpr bool isPowerOfTwo(size_t n) {
+		return n != 0 && (n & (n - 1)) == 0;
+	}
+
+	constexpr size_t alignUp(size_t n, size_t alignment) {
+		return (n + alignment - 1) & ~(alignment - 1);
+	}
+
+	inline void checkAlignment(size_t alignment) {
+		if (!isPowerOfTwo(alignment)) {
+			throw std::invalid_argument("math3d: alignment must be a power of two");
+		}
+	}
+}
+
+class Arena {
+public:
+	static constexpr size_t DefaultBlockSize = 1 << 20;
+
+	explicit Arena(size_t blockSize = DefaultBlockSize)
+		: blockSize(std::max(blockSize, CacheLine)) {
+	}
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	/*
+	* bytes of memory aligned to alignment, a power of two. Requests larger than the
+	* block size get a block of their own
+	*/
+	void* allocate(size_t bytes, size_t alignment = CacheLine) {
+		allocation::checkAlignment(alignment);
+		alignment = std::max(alignment, CacheLine);
+		if (current < blocks.size()) {
+			const size_t offset = alignedOffset(blocks[current].data.get(), used, alignment);
+			if (offset <= blocks[current].size && bytes <= blocks[current].size - offset) {
+				used = offset + bytes;
+				return blocks[current].data.get() + offset;
+			}
+		}
+		return allocateInNextBlock(bytes, alignment);
+	}
+
+	//n value initialized T, aligned to at least a cache line
+	template<class T>
+	std::span<T> allocateArray(size_t n, size_t alignment = CacheLine) {
+		static_assert(std::is_trivially_destructible_v<T>, "reset does not run destructors");
+		if (n > std::numeric_limits<size_t>::max() / sizeof(T)) {
+			throw std::bad_alloc();
+		}
+		T* p = static_cast<T*>(allocate(n * sizeof(T), std::max(alignment, alignof(T))));
+		std::uninitialized_value_construct_n(p, n);
+		return { p, n };
+	}
+
+	//Frees everything allocated so far, keeping the blocks
+	void reset() {
+		current = 0;
+		used = 0;
+	}
+
+	//Frees everything and returns the blocks to the heap
+	void release() {
+		blocks.clear();
+		reset();
+	}
+
+	//Bytes of all blocks, used or not
+	size_t capacity() const {
+		size_t total = 0;
+		for (const Chunk& b : blocks) {
+			total += b.size;
+		}
+		return total;
+	}
+
+private:
+	struct Chunk {
+		allocation::Block data;
+		size_t size;
+	};
+
+	std::vector<Chunk> blocks;
+	size_t blockSize;
+	size_t current = 0;
+	size_t used = 0;
+
+	static size_t alignedOffset(const std::byte* base, size_t offset, size_t alignment) {
+		const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(base);
+		return allocation::alignUp(address + offset, alignment) - address;
+	}
+
+	void* allocateInNextBlock(size_t bytes, size_t alignment) {
+		//blocks start cache line aligned, larger alignments may need padding
+		const size_t needed = bytes + (alignment - CacheLine);
+		if (needed < bytes) {
+			throw std::bad_alloc();
+		}
+		//the first kept block after the current one that fits, or a new one
+		const size_t first = blocks.empty() ? 0 : current + 1;
+		size_t next = first;
+		while (next < blocks.size() && blocks[next].size < needed) {
+			++next;
+		}
+		if (next == blocks.size()) {
+			const size_t size = std::max(blockSize, allocation::alignUp(needed, CacheLine));
+			blocks.push_back({ allocation::Block(allocation::allocate(size, CacheLine), { CacheLine }), size });
+		}
+		//blocks stay in the order they are used in, so after reset they fill up again in turn
+		std::swap(blocks[next], blocks[first]);
+		current = first;
+		const size_t offset = alignedOffset(blocks[current].data.get(), 0, alignment);
+		used = offset + bytes;
+		return blocks[current].data.get() + offset;
+	}
+};
+
+class Pool {
+public:
+	/*
+	* Blocks of blockSize bytes aligned to alignment (at least a cache line), carved
+	* blocksPerChunk at a time from the heap
+	*/
+	explicit Pool(size_t blockSize, size_t alignment = CacheLine, size_t blocksPerChunk = 64)
+		: alignment((allocation::checkAlignment(alignment), std::max(alignment, CacheLine))),
+		stride(allocation::alignUp(std::max(blockSize, sizeof(void*)), this->alignment)),
+		size(blockSize), blocksPerChunk(std::max<size_t>(blocksPerChunk, 1)) {
+	}
+
+	Pool(const Pool&) = delete;
+	Pool& operator=(const Pool&) = delete;
+
+	void* allocate() {
+		if (freeList) {
+			void* p = freeList;
+			freeList = *static_cast<void**>(freeList);
+			return p;
+		}
+		//carve the next block, moving on to the next kept chunk or a new one
+		if (current < chunks.size() && carved == blocksPerChunk) {
+			++current;
+			carved = 0;
+		}
+		if (current == chunks.size()) {
+			chunks.push_back(allocation::Block(allocation::allocate(stride * blocksPerChunk, alignment), { alignment }));
+		}
+		return chunks[current].get() + stride * carved++;
+	}
+
+	//p must come from this pool
+	void deallocate(void* p) {
+		*static_cast<void**>(p) = freeList;
+		freeList = p;
+	}
+
+	//Frees every block at once, keeping the chunks
+	void reset() {
+		freeList = nullptr;
+		current = 0;
+		carved = 0;
+	}
+
+	size_t blockSize() const {
+		return size;
+	}
+
+	size_t blockAlignment() const {
+		return alignment;
+	}
+
+private:
+	std::vector<allocation::Block> chunks;
+	void* freeList = nullptr;
+	size_t alignment;
+	size_t stride;
+	size_t size;
+	size_t blocksPerChunk;
+	size_t current = 0;
+	size_t carved = 0;
+};
+
+/*
+* Standard allocator adapters
+* Copies and rebinds share the arena or pool. ArenaAllocator never frees, the memory
+* returns with the next reset, so a std::vector that grows leaves its old buffers in
+* the arena until then (reserve up front where the size is known).
+* PoolAllocator serves single element requests that fit the pool's blocks, as made
+* by node based containers (std::list, std::map), from the pool, and anything else
+* from the aligned heap.
+*/
+template<class T, size_t Alignment = CacheLine>
+class ArenaAllocator {
+public:
+	static_assert(allocation::isPowerOfTwo(Alignment));
+	using value_type = T;
+
+	template<class U>
+	struct rebind {
+		using other = ArenaAllocator<U, Alignment>;
+	};
+
+	explicit ArenaAllocator(Arena& arena) noexcept
+		: arena(&arena) {
+	}
+
+	template<class U>
+	ArenaAllocator(const ArenaAllocator<U, Alignment>& other) noexcept
+		: arena(other.arena) {
+	}
+
+	T* allocate(size_t n) {
+		if (n > std::numeric_limits<size_t>::max() / sizeof(T)) {
+			throw std::bad_alloc();
+		}
+		return static_cast<T*>(arena->allocate(n * sizeof(T), std::max(Alignment, alignof(T))));
+	}
+
+	void deallocate(T*, size_t) noexcept {
+	}
+
+	template<class U>
+	bool operator==(const ArenaAllocator<U, Alignment>& other) const noexcept {
+		return arena == other.arena;
+	}
+
+private:
+	template<class U, size_t A>
+	friend class ArenaAllocator;
+
+	Arena* arena;
+};
+
+template<class T>
+class PoolAllocator {
+public:
+	using value_type = T;
+
+	explicit PoolAllocator(Pool& pool) noexcept
+		: pool(&pool) {
+	}
+
+	template<class U>
+	PoolAllocator(const PoolAllocator<U>& other) noexcept
+		: pool(other.pool) {
+	}
+
+	T* allocate(size_t n) {
+		if (fromPool(n)) {
+			return static_cast<T*>(pool->allocate());
+		}
+		if (n > std::numeric_limits<size_t>::max() / sizeof(T)) {
+			throw std::bad_alloc();
+		}
+		return reinterpret_cast<T*>(allocation::allocate(n * sizeof(T), heapAlignment()));
+	}
+
+	void deallocate(T* p, size_t n) noexcept {
+		if (fromPool(n)) {
+			pool->deallocate(p);
+		}
+		else {
+			allocation::deallocate(p, heapAlignment());
+		}
+	}
+
+	template<class U>
+	bool operator==(const PoolAllocator<U>& other) const noexcept {
+		return pool == other.pool;
+	}
+
+private:
+	template<class U>
+	friend class PoolAllocator;
+
+	Pool* pool;
+
+	bool fromPool(size_t n) const {
+		return n == 1 && sizeof(T) <= pool->blockSize() && alignof(T) <= pool->blockAlignment();
+	}
+
+	static constexpr size_t heapAlignment() {
+		return std::max(CacheLine, alignof(T));
+	}
+};
+
+//The global heap, with every allocation aligned to Alignment bytes
+template<class T, size_t Alignment = CacheLine>
+class AlignedAllocator {
+public:
+	static_assert(allocation::isPowerOfTwo(Alignment) && Alignment >= alignof(T));
+	using value_type = T;
+
+	template<class U>
+	struct rebind {
+		using other = AlignedAllocator<U, Alignment>;
+	};
+
+	AlignedAllocator() noexcept = default;
+
+	template<class U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {
+	}
+
+	T* allocate(size_t n) {
+		if (n > std::numeric_limits<size_t>::max() / sizeof(T)) {
+			throw std::bad_alloc();
+		}
+		return reinterpret_cast<T*>(allocation::allocate(n * sizeof(T), Alignment));
+	}
+
+	void deallocate(T* p, size_t) noexcept {
+		allocation::deallocate(p, Alignment);
+	}
+
+	template<class U>
+	bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept {
+		return true;
+	}
+};
+
+}
@@ -0,0 +1,522 @@
+#pragma once
+
+#include "math3d.h"
+#include "storage.h"
+#include "vecArray.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace math3d {
+
+/*
+* Binary Array Files
+* A container of named arrays of Matrix<Rows, Cols, T> (so also Vec<Dim, T> and plain
+* T, which is 1x1), stored exactly as they are in memory so that a reader can map the
+* file and use the arrays in place:
+*	header: magic, version, byte order, alignment, where the directory is
+*	data: every array starts on a boundary of the recorded alignment, a multiple of
+*		Alignment (64 bytes, a cache line), which is what the writer records
+*	directory: one ArrayFileEntry per array, with its name, element type, Rows,
+*		Cols, layout and position
+* AoS arrays are count matrices one after another. SoA arrays, written from a
+* VecArray, are Rows streams of stride elements each, every stream aligned like
+* the VecArray ones.
+*
+* ArrayFileWriter streams the arrays to disk as they are added. MappedArrayFile maps
+* the whole file read only and returns spans into the mapping, so opening a file is
+* independent of its size: pages are read when the arrays are first touched.
+* Malformed files, and requests for an array with another type or shape than the one
+* stored, throw std::runtime_error. Operating system errors throw std::system_error.
+*/
+enum class ElementType : uint32_t {
+	Float32 = 1,
+	Float64 = 2,
+	Int8 = 3,
+	Uint8 = 4,
+	Int16 = 5,
+	Uint16 = 6,
+	Int32 = 7,
+	Uint32 = 8,
+	Int64 = 9,
+	Uint64 = 10,
+	Half = 11,
+	Snorm16 = 12,
+	Unorm16 = 13
+};
+
+enum class ArrayLayout : uint32_t {
+	AoS = 1,
+	SoA = 2
+};
+
+namespace arrayFile {
+	inline constexpr char Magic[8] = { 'm', 'a', 't', 'h', '3', 'd', 'A', 'F' };
+	inline constexpr uint32_t Version = 1;
+	inline constexpr uint32_t ByteOrderMark = 0x01020304;
+	inline constexpr uint64_t Alignment = 64;
+	inline constexpr size_t MaxNameLength = 63;
+
+	template<class T>
+	constexpr ElementType elementTypeOf() {
+		if constexpr (std::is_same_v<T, float>) return ElementType::Float32;
+		else if constexpr (std::is_same_v<T, double>) return ElementType::Float64;
+		else if constexpr (std::is_same_v<T, int8_t>) return ElementType::Int8;
+		else if constexpr (std::is_same_v<T, uint8_t>) return ElementType::Uint8;
+		else if constexpr (std::is_same_v<T, int16_t>) return ElementType::Int16;
+		else if constexpr (std::is_same_v<T, uint16_t>) return ElementType::Uint16;
+		else if constexpr (std::is_same_v<T, int32_t>) return ElementType::Int32;
+		else if constexpr (std::is_same_v<T, uint32_t>) return ElementType::Uint32;
+		else if constexpr (std::is_same_v<T, int64_t>) return ElementType::Int64;
+		else if constexpr (std::is_same_v<T, uint64_t>) return ElementType::Uint64;
+		else if constexpr (std::is_same_v<T, half>) return ElementType::Half;
+		else if constexpr (std::is_same_v<T, snorm16>) return ElementType::Snorm16;
+		else if constexpr (std::is_same_v<T, unorm16>) return ElementType::Unorm16;
+		else static_assert(!sizeof(T), "no ElementType for this element type");
+	}
+
+	constexpr uint64_t elementSize(ElementType type) {
+		switch (type) {
+		case ElementType::Int8: case ElementType::Uint8: return 1;
+		case ElementType::Int16: case ElementType::Uint16: case ElementType::Half:
+		case ElementType::Snorm16: case ElementType::Unorm16: return 2;
+		case ElementType::Float32: case ElementType::Int32: case ElementType::Uint32: return 4;
+		case ElementType::Float64: case ElementType::Int64: case ElementType::Uint64: return 8;
+		}
+		return 0;
+	}
+
+	//Rows, Cols and element type of Matrix<Rows, Cols, T>, a plain T is 1x1
+	template<class M>
+	struct Shape {
+		using Element = M;
+		static constexpr uint32_t Rows = 1;
+		static constexpr uint32_t Cols = 1;
+	};
+
+	template<size_t R, size_t C, class T>
+	struct Shape<Matrix<R, C, T>> {
+		using Element = T;
+		static constexpr uint32_t Rows = R;
+		static constexpr uint32_t Cols = C;
+	};
+
+	constexpr uint64_t alignUp(uint64_t n, uint64_t alignment) {
+		return (n + alignment - 1) / alignment * alignment;
+	}
+}
+
+struct ArrayFileHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint64_t entryCount;
+	uint64_t directoryOffset;
+	//of every array offset, a multiple of Alignment
+	uint64_t alignment;
+	uint64_t reserved[3];
+};
+
+struct ArrayFileEntry {
+	char name[arrayFile::MaxNameLength + 1];
+	ElementType elementType;
+	ArrayLayout layout;
+	uint32_t rows;
+	uint32_t cols;
+	//number of matrices
+	uint64_t count;
+	//elements from the start of one SoA stream to the next, count for AoS
+	uint64_t stride;
+	//from the start of the file, a multiple of the header's alignment
+	uint64_t offset;
+	uint64_t bytes;
+
+	std::string_view nameView() const {
+		return { name, static_cast<size_t>(std::find(name, name + sizeof(name), '\0') - name) };
+	}
+};
+
+static_assert(sizeof(ArrayFileHeader) == 64 && std::is_trivially_copyable_v<ArrayFileHeader>);
+static_assert(sizeof(ArrayFileEntry) == 112 && std::is_trivially_copyable_v<ArrayFileEntry>);
+
+/*
+* Writer
+* add copies each array to the file straight away, close writes the directory and
+* must be called for the file to be readable: without it the header is left blank
+* and readers reject the file. Names are 1 to 63 bytes and unique.
+*/
+class ArrayFileWriter {
+public:
+	explicit ArrayFileWriter(const std::filesystem::path& path)
+		: path(path), out(path, std::ios::binary | std::ios::trunc) {
+		check("cannot create");
+		ArrayFileHeader header{};
+		write(&header, sizeof(header));
+	}
+
+	ArrayFileWriter(const ArrayFileWriter&) = delete;
+	ArrayFileWriter& operator=(const ArrayFileWriter&) = delete;
+
+	template<size_t Rows, size_t Cols, class T>
+	void add(std::string_view name, std::span<const Matrix<Rows, Cols, T>> matrices) {
+		static_assert(sizeof(Matrix<Rows, Cols, T>) == Rows * Cols * sizeof(T), "only matrices without padding can be mapped");
+		ArrayFileEntry& entry = begin<Matrix<Rows, Cols, T>>(name, ArrayLayout::AoS, matrices.size());
+		entry.stride = matrices.size();
+		entry.bytes = matrices.size_bytes();
+		write(matrices.data(), matrices.size_bytes());
+	}
+
+	template<class T> requires (!IsMatrix<T>)
+	void add(std::string_view name, std::span<const T> values) {
+		ArrayFileEntry& entry = begin<T>(name, ArrayLayout::AoS, values.size());
+		entry.stride = values.size();
+		entry.bytes = values.size_bytes();
+		write(values.data(), values.size_bytes());
+	}
+
+	template<size_t Dim, class T>
+	void add(std::string_view name, const VecArray<Dim, T>& vecs) {
+		ArrayFileEntry& entry = begin<Vec<Dim, T>>(name, ArrayLayout::SoA, vecs.size());
+		entry.stride = arrayFile::alignUp(vecs.size() * sizeof(T), arrayFile::Alignment) / sizeof(T);
+		entry.bytes = Dim * entry.stride * sizeof(T);
+		for (size_t c = 0; c < Dim; ++c) {
+			write(vecs.component(c), vecs.size() * sizeof(T));
+			pad(entry.stride * sizeof(T) - vecs.size() * sizeof(T));
+		}
+	}
+
+	void close() {
+		if (closed) {
+			return;
+		}
+		pad(arrayFile::alignUp(position, arrayFile::Alignment) - position);
+		const uint64_t directoryOffset = position;
+		write(entries.data(), entries.size() * sizeof(ArrayFileEntry));
+		ArrayFileHeader header{};
+		std::memcpy(header.magic, arrayFile::Magic, sizeof(header.magic));
+		header.version = arrayFile::Version;
+		header.byteOrder = arrayFile::ByteOrderMark;
+		header.entryCount = entries.size();
+		header.directoryOffset = directoryOffset;
+		header.alignment = arrayFile::Alignment;
+		out.seekp(0);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.close();
+		check("cannot write");
+		closed = true;
+	}
+
+private:
+	std::filesystem::path path;
+	std::ofstream out;
+	std::vector<ArrayFileEntry> entries;
+	uint64_t position = 0;
+	bool closed = false;
+
+	void check(const char* what) {
+		if (!out) {
+			throw std::runtime_error(std::string("math3d array file: ") + what + " " + path.string());
+		}
+	}
+
+	void write(const void* data, uint64_t bytes) {
+		out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+		check("cannot write");
+		position += bytes;
+	}
+
+	void pad(uint64_t bytes) {
+		static constexpr char zeros[arrayFile::Alignment] = {};
+		while (bytes > 0) {
+			uint64_t n = std::min<uint64_t>(bytes, sizeof(zeros));
+			write(zeros, n);
+			bytes -= n;
+		}
+	}
+
+	template<class M>
+	ArrayFileEntry& begin(std::string_view name, ArrayLayout layout, size_t count) {
+		using Shape = arrayFile::Shape<M>;
+		if (closed) {
+			throw std::runtime_error("math3d array file: add after close " + path.string());
+		}
+		if (name.empty() || name.size() > arrayFile::MaxNameLength) {
+			throw std::runtime_error("math3d array file: array names must be 1 to 63 bytes");
+		}
+		for (const ArrayFileEntry& e : entries) {
+			if (e.nameView() == name) {
+				throw std::runtime_error("math3d array file: duplicate array " + std::string(name));
+			}
+		}
+		pad(arrayFile::alignUp(position, arrayFile::Alignment) - position);
+		ArrayFileEntry entry{};
+		std::memcpy(entry.name, name.data(), name.size());
+		entry.elementType = arrayFile::elementTypeOf<typename Shape::Element>();
+		entry.layout = layout;
+		entry.rows = Shape::Rows;
+		entry.cols = Shape::Cols;
+		entry.count = count;
+		entry.offset = position;
+		return entries.emplace_back(entry);
+	}
+};
+
+/*
+* Reader
+* The spans point into the mapping and are valid for the lifetime of the
+* MappedArrayFile, which unmaps the file on destruction.
+*/
+class MappedArrayFile {
+public:
+	explicit MappedArrayFile(const std::filesystem::path& path) {
+		map(path);
+		try {
+			validate(path);
+		}
+		catch (...) {
+			unmap();
+			throw;
+		}
+	}
+
+	MappedArrayFile(const MappedArrayFile&) = delete;
+	MappedArrayFile& operator=(const MappedArrayFile&) = delete;
+
+	MappedArrayFile(MappedArrayFile&& other) noexcept
+		: data(std::exchange(other.data, nullptr)), bytes(std::exchange(other.bytes, 0)), directory(std::exchange(other.directory, {})) {
+#ifdef _WIN32
+		mapping = std::exchange(other.mapping, nullptr);
+#endif
+	}
+
+	MappedArrayFile& operator=(MappedArrayFile&& other) noexcept {
+		if (this != &other) {
+			unmap();
+			data = std::exchange(other.data, nullptr);
+			bytes = std::exchange(other.bytes, 0);
+			directory = std::exchange(other.directory, {});
+#ifdef _WIN32
+			mapping = std::exchange(other.mapping, nullptr);
+#endif
+		}
+		return *this;
+	}
+
+	~MappedArrayFile() {
+		unmap();
+	}
+
+	std::span<const ArrayFileEntry> entries() const {
+		return directory;
+	}
+
+	//nullptr if there is no array with this name
+	const ArrayFileEntry* find(std::string_view name) const {
+		for (const ArrayFileEntry& e : directory) {
+			if (e.nameView() == name) {
+				return &e;
+			}
+		}
+		return nullptr;
+	}
+
+	//An AoS array of M, which is a Matrix<Rows, Cols, T>, a Vec<Dim, T> or a plain T
+	template<class M>
+	std::span<const M> get(std::string_view name) const {
+		static_assert(sizeof(M) == arrayFile::Shape<M>::Rows * arrayFile::Shape<M>::Cols * sizeof(typename arrayFile::Shape<M>::Element),
+			"only matrices without padding can be mapped");
+		const ArrayFileEntry& e = entry<M>(name, ArrayLayout::AoS);
+		return { reinterpret_cast<const M*>(data + e.offset), static_cast<size_t>(e.count) };
+	}
+
+	//The Dim component streams of a SoA array written from a VecArray<Dim, T>
+	template<size_t Dim, class T>
+	std::array<std::span<const T>, Dim> components(std::string_view name) const {
+		const ArrayFileEntry& e = entry<Vec<Dim, T>>(name, ArrayLayout::SoA);
+		std::array<std::span<const T>, Dim> streams;
+		for (size_t c = 0; c < Dim; ++c) {
+			streams[c] = { reinterpret_cast<const T*>(data + e.offset) + c * e.stride, static_cast<size_t>(e.count) };
+		}
+		return streams;
+	}
+
+	//Copies a SoA array into a VecArray
+	template<size_t Dim, class T>
+	void load(std::string_view name, VecArray<Dim, T>& out) const {
+		const auto streams = components<Dim, T>(name);
+		out.resize(streams[0].size());
+		for (size_t c = 0; c < Dim; ++c) {
+			std::copy(streams[c].begin(), streams[c].end(), out.component(c));
+		}
+	}
+
+private:
+	const unsigned char* data = nullptr;
+	uint64_t bytes = 0;
+	std::span<const ArrayFileEntry> directory;
+#ifdef _WIN32
+	HANDLE mapping = nullptr;
+#endif
+
+	[[noreturn]] static void fail(const std::filesystem::path& path, const char* what) {
+		throw std::runtime_error(std::string("math3d array file: ") + what + " " + path.string());
+	}
+
+	template<class M>
+	const ArrayFileEntry& entry(std::string_view name, ArrayLayout layout) const {
+		using Shape = arrayFile::Shape<M>;
+		const ArrayFileEntry* e = find(name);
+		if (!e) {
+			throw std::runtime_error("math3d array file: no array named " + std::string(name));
+		}
+		if (e->layout != layout || e->elementType != arrayFile::elementTypeOf<typename Shape::Element>()
+			|| e->rows != Shape::Rows || e->cols != Shape::Cols) {
+			throw std::runtime_error("math3d array file: array " + std::string(name) + " has another type, shape or layout");
+		}
+		return *e;
+	}
+
+	void validate(const std::filesystem::path& path) {
+		ArrayFileHeader header;
+		if (bytes < sizeof(header)) {
+			fail(path, "too short");
+		}
+		std::memcpy(&header, data, sizeof(header));
+		if (std::memcmp(header.magic, arrayFile::Magic, sizeof(header.magic)) != 0) {
+			fail(path, "not an array file (or not closed)");
+		}
+		if (header.version != arrayFile::Version) {
+			fail(path, "unsupported version");
+		}
+		if (header.byteOrder != arrayFile::ByteOrderMark) {
+			fail(path, "written with another byte order");
+		}
+		if (header.alignment == 0 || header.alignment % arrayFile::Alignment != 0) {
+			fail(path, "invalid alignment");
+		}
+		if (header.directoryOffset % alignof(ArrayFileEntry) != 0 || header.directoryOffset > bytes
+			|| header.entryCount > (bytes - header.directoryOffset) / sizeof(ArrayFileEntry)) {
+			fail(path, "directory out of bounds");
+		}
+		directory = { reinterpret_cast<const ArrayFileEntry*>(data + header.directoryOffset), static_cast<size_t>(header.entryCount) };
+		for (const ArrayFileEntry& e : directory) {
+			//type, shape and layout first, the sizes below divide by them
+			const uint64_t size = arrayFile::elementSize(e.elementType);
+			if (e.name[arrayFile::MaxNameLength] != '\0' || size == 0 || e.rows == 0 || e.cols == 0
+				|| e.cols > std::numeric_limits<uint64_t>::max() / (size * e.rows)
+				|| (e.layout != ArrayLayout::AoS && e.layout != ArrayLayout::SoA)) {
+				fail(path, "invalid directory entry");
+			}
+			const uint64_t matrixSize = size * e.rows * e.cols;
+			const bool layoutValid = e.layout == ArrayLayout::AoS
+				? e.stride == e.count && e.bytes / matrixSize == e.count && e.bytes % matrixSize == 0
+				: e.cols == 1 && e.stride >= e.count && e.bytes / size / e.rows == e.stride && e.bytes % (size * e.rows) == 0;
+			if (!layoutValid || e.offset % header.alignment != 0 || e.offset > header.directoryOffset || e.bytes > header.directoryOffset - e.offset) {
+				fail(path, "invalid directory entry");
+			}
+		}
+	}
+
+#ifdef _WIN32
+	void map(const std::filesystem::path& path) {
+		HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "math3d array file: cannot open " + path.string());
+		}
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+			CloseHandle(file);
+			fail(path, "too short");
+		}
+		mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(file);
+		if (!mapping) {
+			throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "math3d array file: cannot map " + path.string());
+		}
+		data = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		if (!data) {
+			const int error = static_cast<int>(GetLastError());
+			CloseHandle(std::exchange(mapping, nullptr));
+			throw std::system_error(error, std::system_category(), "math3d array file: cannot map " + path.string());
+		}
+		bytes = static_cast<uint64_t>(size.QuadPart);
+	}
+
+	void unmap() {
+		if (data) {
+			UnmapViewOfFile(data);
+			CloseHandle(mapping);
+		}
+		data = nullptr;
+		mapping = nullptr;
+		bytes = 0;
+		directory = {};
+	}
+#else
+	void map(const std::filesystem::path& path) {
+		const int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw std::system_error(errno, std::generic_category(), "math3d array file: cannot open " + path.string());
+		}
+		struct stat info;
+		if (::fstat(fd, &info) != 0) {
+			const int error = errno;
+			::close(fd);
+			throw std::system_error(error, std::generic_category(), "math3d array file: cannot stat " + path.string());
+		}
+		if (info.st_size == 0) {
+			::close(fd);
+			fail(path, "too short");
+		}
+		void* p = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+		const int error = errno;
+		//the mapping keeps the file open
+		::close(fd);
+		if (p == MAP_FAILED) {
+			throw std::system_error(error, std::generic_category(), "math3d array file: cannot map " + path.string());
+		}
+		data = static_cast<const unsigned char*>(p);
+		bytes = static_cast<uint64_t>(info.st_size);
+	}
+
+	void unmap() {
+		if (data) {
+			::munmap(const_cast<unsigned char*>(data), static_cast<size_t>(bytes));
+		}
+		data = nullptr;
+		bytes = 0;
+		directory = {};
+	}
+#endif
+};
+
+}
@@ -0,0 +1,259 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+* Microbenchmark Harness
+* Times a callable that processes a known number of items. Each case is calibrated
+* until one sample takes at least Options::minSampleSeconds, warmed up, and then
+* sampled Options::repetitions times. Results are reported per item, as the minimum,
+* median, mean, 10th/90th percentiles and maximum over the samples, as a table on
+* stdout and optionally as JSON.
+*
+*	bench::Suite suite(argc, argv);
+*	suite.run({ "dotProduct", "single", 3, "float" }, n, [&] { ... one pass over n items ... });
+*	return suite.finish();
+*
+* Command line: --filter <substring> --repetitions <n> --warmup <n> --min-time <seconds>
+* --json <file, or - for stdout>
+*/
+namespace bench {
+
+//Keeps the compiler from discarding a value that is computed but never read
+template<class T>
+inline void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	static volatile const void* sink;
+	sink = &value;
+#endif
+}
+
+struct Case {
+	std::string operation;
+	//how the operation is applied, e.g. single Vecs in a loop or a batched kernel
+	std::string variant;
+	size_t dim = 0;
+	std::string type;
+
+	std::string name() const {
+		std::string n = operation + "/" + variant;
+		if (dim != 0) {
+			n += "/" + std::to_string(dim);
+		}
+		if (!type.empty()) {
+			n += "/" + type;
+		}
+		return n;
+	}
+};
+
+struct Statistics {
+	double min = 0;
+	double p10 = 0;
+	double median = 0;
+	double mean = 0;
+	double p90 = 0;
+	double max = 0;
+};
+
+struct Result {
+	Case benchCase;
+	size_t items = 0;
+	size_t iterations = 0;
+	//nanoseconds per item
+	std::vector<double> samples;
+	Statistics stats;
+};
+
+struct Options {
+	std::string filter;
+	size_t repetitions = 15;
+	size_t warmup = 3;
+	double minSampleSeconds = 0.005;
+	std::string json;
+};
+
+//Linear interpolation between the closest ranks of sorted samples
+inline double percentile(const std::vector<double>& sorted, double p) {
+	if (sorted.empty()) {
+		return 0;
+	}
+	double rank = p * static_cast<double>(sorted.size() - 1);
+	size_t below = static_cast<size_t>(rank);
+	size_t above = std::min(below + 1, sorted.size() - 1);
+	double fraction = rank - static_cast<double>(below);
+	return sorted[below] + (sorted[above] - sorted[below]) * fraction;
+}
+
+inline Statistics summarize(std::vector<double> samples) {
+	Statistics s;
+	if (samples.empty()) {
+		return s;
+	}
+	std::sort(samples.begin(), samples.end());
+	s.min = samples.front();
+	s.max = samples.back();
+	s.p10 = percentile(samples, 0.1);
+	s.median = percentile(samples, 0.5);
+	s.p90 = percentile(samples, 0.9);
+	double sum = 0;
+	for (double sample : samples) {
+		sum += sample;
+	}
+	s.mean = sum / static_cast<double>(samples.size());
+	return s;
+}
+
+class Suite {
+public:
+	Suite(int argc, char** argv) {
+		for (int i = 1; i < argc; ++i) {
+			auto value = [&]() -> const char* {
+				if (i + 1 >= argc) {
+					std::fprintf(stderr, "missing value for %s\n", argv[i]);
+					std::exit(2);
+				}
+				return argv[++i];
+			};
+			if (std::strcmp(argv[i], "--filter") == 0) {
+				options.filter = value();
+			}
+			else if (std::strcmp(argv[i], "--repetitions") == 0) {
+				options.repetitions = std::max<size_t>(1, std::strtoul(value(), nullptr, 10));
+			}
+			else if (std::strcmp(argv[i], "--warmup") == 0) {
+				options.warmup = std::strtoul(value(), nullptr, 10);
+			}
+			else if (std::strcmp(argv[i], "--min-time") == 0) {
+				options.minSampleSeconds = std::strtod(value(), nullptr);
+			}
+			else if (std::strcmp(argv[i], "--json") == 0) {
+				options.json = value();
+			}
+			else {
+				std::fprintf(stderr, "usage: %s [--filter s] [--repetitions n] [--warmup n] [--min-time seconds] [--json file|-]\n", argv[0]);
+				std::exit(2);
+			}
+		}
+		//with JSON on stdout the table goes to stderr
+		table = options.json == "-" ? stderr : stdout;
+		std::fprintf(table, "%-44s %12s %12s %12s %12s\n", "benchmark (ns per item)", "min", "median", "p90", "max");
+	}
+
+	const Options& settings() const {
+		return options;
+	}
+
+	//pass() processes items items, its result is kept alive with doNotOptimize
+	template<class Pass>
+	void run(const Case& benchCase, size_t items, Pass&& pass) {
+		std::string name = benchCase.name();
+		if (!options.filter.empty() && name.find(options.filter) == std::string::npos) {
+			return;
+		}
+		Result result;
+		result.benchCase = benchCase;
+		result.items = items;
+		result.iterations = calibrate(pass);
+		for (size_t i = 0; i < options.warmup; ++i) {
+			sample(pass, result.iterations);
+		}
+		for (size_t i = 0; i < options.repetitions; ++i) {
+			double seconds = sample(pass, result.iterations);
+			result.samples.push_back(seconds * 1e9 / static_cast<double>(result.iterations * std::max<size_t>(items, 1)));
+		}
+		result.stats = summarize(result.samples);
+		std::fprintf(table, "%-44s %12.3f %12.3f %12.3f %12.3f\n", name.c_str(), result.stats.min, result.stats.median, result.stats.p90, result.stats.max);
+		results.push_back(std::move(result));
+	}
+
+	//Writes the JSON report if requested, returns the exit code for main
+	int finish() const {
+		if (options.json.empty()) {
+			return 0;
+		}
+		FILE* out = options.json == "-" ? stdout : std::fopen(options.json.c_str(), "w");
+		if (!out) {
+			std::fprintf(stderr, "cannot write %s\n", options.json.c_str());
+			return 1;
+		}
+		writeJson(out);
+		if (out != stdout) {
+			std::fclose(out);
+		}
+		return 0;
+	}
+
+	//Free-form key/value pairs written to the "context" object of the JSON report
+	void context(std::string key, std::string value) {
+		contextValues.emplace_back(std::move(key), std::move(value));
+	}
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	template<class Pass>
+	static double sample(Pass& pass, size_t iterations) {
+		auto start = Clock::now();
+		for (size_t i = 0; i < iterations; ++i) {
+			pass();
+		}
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	//Doubles the iterations per sample until a sample takes minSampleSeconds
+	template<class Pass>
+	size_t calibrate(Pass& pass) const {
+		size_t iterations = 1;
+		while (sample(pass, iterations) < options.minSampleSeconds && iterations < (size_t{ 1 } << 30)) {
+			iterations *= 2;
+		}
+		return iterations;
+	}
+
+	static std::string quoted(const std::string& s) {
+		std::string q = "\"";
+		for (char c : s) {
+			if (c == '"' || c == '\\') {
+				q += '\\';
+			}
+			q += c;
+		}
+		return q + "\"";
+	}
+
+	void writeJson(FILE* out) const {
+		std::fprintf(out, "{\n  \"context\": {");
+		for (size_t i = 0; i < contextValues.size(); ++i) {
+			std::fprintf(out, "%s\n    %s: %s", i ? "," : "", quoted(contextValues[i].first).c_str(), quoted(contextValues[i].second).c_str());
+		}
+		std::fprintf(out, "\n  },\n  \"unit\": \"ns per item\",\n  \"benchmarks\": [");
+		for (size_t i = 0; i < results.size(); ++i) {
+			const Result& r = results[i];
+			const Statistics& s = r.stats;
+			std::fprintf(out, "%s\n    {\"name\": %s, \"operation\": %s, \"variant\": %s, \"dim\": %zu, \"type\": %s, ",
+				i ? "," : "", quoted(r.benchCase.name()).c_str(), quoted(r.benchCase.operation).c_str(),
+				quoted(r.benchCase.variant).c_str(), r.benchCase.dim, quoted(r.benchCase.type).c_str());
+			std::fprintf(out, "\"items\": %zu, \"iterations\": %zu, \"repetitions\": %zu, ", r.items, r.iterations, r.samples.size());
+			std::fprintf(out, "\"min\": %.6g, \"p10\": %.6g, \"median\": %.6g, \"mean\": %.6g, \"p90\": %.6g, \"max\": %.6g}",
+				s.min, s.p10, s.median, s.mean, s.p90, s.max);
+		}
+		std::fprintf(out, "\n  ]\n}\n");
+	}
+
+	Options options;
+	FILE* table = stdout;
+	std::vector<Result> results;
+	std::vector<std::pair<std::string, std::string>> contextValues;
+};
+
+}
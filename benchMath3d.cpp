@@ -0,0 +1,860 @@
+#include "allocator.h"
+#include "bench.h"
+#include "bvh.h"
+#include "kdtree.h"
+#include "linearAlgebra.h"
+#include "morton.h"
+#include "expression.h"
+#include "frustum.h"
+#include "hierarchy.h"
+#include "intersect.h"
+#include "math3d.h"
+#include "octahedral.h"
+#include "parallel.h"
+#include "quat.h"
+#include "reduce.h"
+#include "storage.h"
+#include "transform.h"
+#include "vecArray.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <numeric>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/*
+* math3d Benchmarks
+* "single" calls the single Vec (or Matrix, Quat) function in a loop over an array,
+* "batched" runs the VecArray or span kernel over the same values, so the two can
+* be compared directly. Every case processes Items elements per pass, which keeps
+* all of its data in L2, except the parallel ones, which compare one thread with
+* the global pool on arrays far larger than the caches.
+*/
+
+constexpr size_t Items = 4096;
+
+template<class T>
+constexpr const char* typeName = "";
+template<>
+constexpr const char* typeName<float> = "float";
+template<>
+constexpr const char* typeName<double> = "double";
+template<>
+constexpr const char* typeName<int> = "int";
+template<>
+constexpr const char* typeName<short> = "short";
+
+//small positive components, so no vector is zero and short products can't overflow
+template<size_t Dim, class T>
+std::vector<math3d::Vec<Dim, T>> makeVecs(size_t n, size_t seed) {
+	math3d::VecArray<Dim, T> soa(n);
+	for (size_t c = 0; c < Dim; ++c) {
+		for (size_t i = 0; i < n; ++i) {
+			soa.component(c)[i] = static_cast<T>((i * 7 + c * 13 + seed) % 9 + 1);
+		}
+	}
+	std::vector<math3d::Vec<Dim, T>> vecs(n);
+	soa.toAoS(vecs);
+	return vecs;
+}
+
+//Times f(a[i], b[i]) over the arrays, storing into an array of its result type
+template<class T, class F>
+void single(bench::Suite& suite, const bench::Case& benchCase, const std::vector<T>& a, const std::vector<T>& b, F f) {
+	std::vector<decltype(f(a[0], b[0]))> out(a.size());
+	suite.run(benchCase, a.size(), [&] {
+		for (size_t i = 0; i < a.size(); ++i) {
+			out[i] = f(a[i], b[i]);
+		}
+		bench::doNotOptimize(out.data());
+	});
+}
+
+template<size_t Dim, class T>
+void vecBenchmarks(bench::Suite& suite) {
+	using Vec = math3d::Vec<Dim, T>;
+	using Root = RootType<T>;
+	const char* type = typeName<T>;
+	const auto a = makeVecs<Dim, T>(Items, 0);
+	const auto b = makeVecs<Dim, T>(Items, 5);
+	const math3d::VecArray<Dim, T> sa{ std::span<const Vec>(a) };
+	const math3d::VecArray<Dim, T> sb{ std::span<const Vec>(b) };
+	auto singleCase = [&](const char* operation, auto f) {
+		single(suite, { operation, "single", Dim, type }, a, b, f);
+	};
+	auto batchedCase = [&](const char* operation, auto pass) {
+		suite.run({ operation, "batched", Dim, type }, Items, pass);
+	};
+
+	singleCase("add", [](const Vec& x, const Vec& y) { return x + y; });
+	batchedCase("add", [&] { bench::doNotOptimize(sa + sb); });
+
+	singleCase("scalarMultiply", [](const Vec& x, const Vec&) { return x * T{ 3 }; });
+	batchedCase("scalarMultiply", [&] { bench::doNotOptimize(sa * T{ 3 }); });
+
+	singleCase("componentwiseProduct", [](const Vec& x, const Vec& y) { return componentwiseProduct(x, y); });
+
+	singleCase("dotProduct", [](const Vec& x, const Vec& y) { return dotProduct(x, y); });
+	std::vector<decltype(T{} *T{})> dots(Items);
+	batchedCase("dotProduct", [&] {
+		dotProduct(sa, sb, std::span(dots));
+		bench::doNotOptimize(dots.data());
+	});
+
+	singleCase("length", [](const Vec& x, const Vec&) { return length(x); });
+	std::vector<Root> lengths(Items);
+	batchedCase("length", [&] {
+		length(sa, std::span(lengths));
+		bench::doNotOptimize(lengths.data());
+	});
+
+	if constexpr (Dim == 2 || Dim == 3) {
+		singleCase("crossProduct", [](const Vec& x, const Vec& y) { return crossProduct(x, y); });
+	}
+	if constexpr (Dim == 3) {
+		math3d::VecArray<3, decltype(T{} *T{})> crosses;
+		batchedCase("crossProduct", [&] {
+			crossProduct(sa, sb, crosses);
+			bench::doNotOptimize(crosses.x());
+		});
+	}
+
+	if constexpr (std::is_floating_point_v<T>) {
+		singleCase("unit", [](const Vec& x, const Vec&) { return unit(x); });
+		singleCase("unitFast", [](const Vec& x, const Vec&) { return unitFast(x); });
+		if constexpr (Dim == 2 || Dim == 3) {
+			singleCase("angle", [](const Vec& x, const Vec& y) { return angle(x, y); });
+		}
+		math3d::VecArray<Dim, Root> units;
+		batchedCase("unit", [&] {
+			unit(sa, units);
+			bench::doNotOptimize(units.x());
+		});
+		batchedCase("unitFast", [&] {
+			unitFast(sa, units);
+			bench::doNotOptimize(units.x());
+		});
+
+		//a + b * s - c / t, eager temporaries against one fused pass
+		math3d::VecArray<Dim, T> fused;
+		suite.run({ "expression", "batched", Dim, type }, Items, [&] { bench::doNotOptimize(sa + sb * T{ 3 } - sa / T{ 2 }); });
+		suite.run({ "expression", "lazy", Dim, type }, Items, [&] {
+			using math3d::expr::lazy;
+			math3d::expr::assign(fused, lazy(sa) + lazy(sb) * T{ 3 } - lazy(sa) / T{ 2 });
+			bench::doNotOptimize(fused.x());
+		});
+		math3d::VecArray<Dim, T> updated = sb;
+		suite.run({ "axpy in place", "batched", Dim, type }, Items, [&] {
+			axpy(T{ 1 } / 1024, sa, updated);
+			bench::doNotOptimize(updated.x());
+		});
+	}
+}
+
+template<class T>
+void vecBenchmarks(bench::Suite& suite) {
+	vecBenchmarks<2, T>(suite);
+	vecBenchmarks<3, T>(suite);
+	vecBenchmarks<4, T>(suite);
+}
+
+template<math3d::Precision P>
+void precisionBenchmarks(bench::Suite& suite, const char* tier) {
+	using Vec3f = math3d::Vec<3, float>;
+	const auto a = makeVecs<3, float>(Items, 0);
+	const math3d::VecArray<3, float> sa{ std::span<const Vec3f>(a) };
+	single(suite, { std::string("unitFast") + tier, "single", 3, "float" }, a, a, [](const Vec3f& x, const Vec3f&) { return unitFast<P>(x); });
+	math3d::VecArray<3, float> units;
+	suite.run({ std::string("unitFast") + tier, "batched", 3, "float" }, Items, [&] {
+		unitFast<P>(sa, units);
+		bench::doNotOptimize(units.x());
+	});
+
+	const auto b = makeVecs<3, float>(Items, 1);
+	const math3d::VecArray<3, float> sb{ std::span<const Vec3f>(b) };
+	single(suite, { std::string("angleFast") + tier, "single", 3, "float" }, a, b, [](const Vec3f& x, const Vec3f& y) { return angleFast<P>(x, y); });
+	std::vector<float> angles(Items);
+	suite.run({ std::string("angleFast") + tier, "batched", 3, "float" }, Items, [&] {
+		angleFast<P>(sa, sb, std::span<float>(angles));
+		bench::doNotOptimize(angles.data());
+	});
+}
+
+template<class T>
+void matrixBenchmarks(bench::Suite& suite) {
+	using Mat4 = math3d::Matrix<4, 4, T>;
+	const char* type = typeName<T>;
+	std::vector<Mat4> m(Items);
+	for (size_t i = 0; i < Items; ++i) {
+		T f = static_cast<T>(i % 17);
+		m[i] = { { 2, f, 0, 1 }, { 0, 1, 3, f }, { f, 0, 4, 2 }, { 0, 0, 0, 1 } };
+	}
+	single(suite, { "multiply", "single", 4, type }, m, m, [](const Mat4& x, const Mat4& y) { return x * y; });
+	single(suite, { "transpose", "single", 4, type }, m, m, [](const Mat4& x, const Mat4&) { return transpose(x); });
+	single(suite, { "determinant", "single", 4, type }, m, m, [](const Mat4& x, const Mat4&) { return determinant(x); });
+	single(suite, { "inverse", "single", 4, type }, m, m, [](const Mat4& x, const Mat4&) { return inverse(x); });
+	single(suite, { "affineInverse", "single", 4, type }, m, m, [](const Mat4& x, const Mat4&) { return affineInverse(x); });
+	single(suite, { "rigidInverse", "single", 4, type }, m, m, [](const Mat4& x, const Mat4&) { return rigidInverse(x); });
+	std::vector<Mat4> out(Items);
+	suite.run({ "inverse", "batched", 4, type }, Items, [&] {
+		inverse(std::span<const Mat4>(m), std::span<Mat4>(out));
+		bench::doNotOptimize(out.data());
+	});
+	suite.run({ "affineInverse", "batched", 4, type }, Items, [&] {
+		affineInverse(std::span<const Mat4>(m), std::span<Mat4>(out));
+		bench::doNotOptimize(out.data());
+	});
+}
+
+//Covariance like symmetric matrices and diagonally dominant systems
+template<class T>
+void linearAlgebraBenchmarks(bench::Suite& suite) {
+	using Mat3 = math3d::Matrix<3, 3, T>;
+	using Vec3 = math3d::Vec<3, T>;
+	const char* type = typeName<T>;
+	const auto v = makeVecs<3, T>(Items, 0);
+	std::vector<Mat3> m(Items);
+	for (size_t i = 0; i < Items; ++i) {
+		m[i] = outerProduct(v[i], v[i]);
+		m[i].x.x += 1;
+		m[i].y.y += 2;
+		m[i].z.z += 3;
+	}
+	single(suite, { "eigenSymmetric", "single", 3, type }, m, m, [](const Mat3& x, const Mat3&) { return eigenSymmetric(x); });
+	std::vector<Vec3> x(Items);
+	suite.run({ "solve", "single", 3, type }, Items, [&] {
+		for (size_t i = 0; i < Items; ++i) {
+			solve(m[i], v[i], x[i]);
+		}
+		bench::doNotOptimize(x.data());
+	});
+	std::vector<math3d::SymmetricEigen<T>> eigen(Items);
+	suite.run({ "eigenSymmetric", "batched", 3, type }, Items, [&] {
+		eigenSymmetric(std::span<const Mat3>(m), std::span<math3d::SymmetricEigen<T>>(eigen));
+		bench::doNotOptimize(eigen.data());
+	});
+	suite.run({ "solve", "batched", 3, type }, Items, [&] {
+		bench::doNotOptimize(solve(std::span<const Mat3>(m), std::span<const Vec3>(v), std::span<Vec3>(x)));
+	});
+}
+
+template<class T>
+void transformBenchmarks(bench::Suite& suite) {
+	using Vec3 = math3d::Vec<3, T>;
+	const char* type = typeName<T>;
+	const math3d::Matrix<4, 4, T> m{ { 0.36f, 0.48f, -0.8f, 10 }, { -0.8f, 0.6f, 0, -20 }, { 0.48f, 0.64f, 0.6f, 30.5f }, { 0, 0, 0, 1 } };
+	const auto points = makeVecs<3, T>(Items, 0);
+	single(suite, { "transformPoint", "single", 3, type }, points, points, [&](const Vec3& p, const Vec3&) { return transformPoint(m, p); });
+	std::vector<Vec3> out(Items);
+	suite.run({ "transformPoint", "batched", 3, type }, Items, [&] {
+		transformPoints(m, std::span<const Vec3>(points), std::span<Vec3>(out), math3d::StoreMode::Cached);
+		bench::doNotOptimize(out.data());
+	});
+	const math3d::VecArray<3, T> soa{ std::span<const Vec3>(points) };
+	math3d::VecArray<3, T> soaOut;
+	suite.run({ "transformPoint", "soa", 3, type }, Items, [&] {
+		transformPoints(m, soa, soaOut, math3d::StoreMode::Cached);
+		bench::doNotOptimize(soaOut.x());
+	});
+}
+
+template<class T>
+void quatBenchmarks(bench::Suite& suite) {
+	using Quat = math3d::Quat<T>;
+	using Vec3 = math3d::Vec<3, T>;
+	const char* type = typeName<T>;
+	std::vector<Quat> a(Items);
+	std::vector<Quat> b(Items);
+	for (size_t i = 0; i < Items; ++i) {
+		T f = static_cast<T>(i);
+		a[i] = Quat::axisAngle(unit(Vec3{ 1, f, 2 }), f * T(0.01));
+		b[i] = Quat::axisAngle(unit(Vec3{ f, 1, -2 }), f * T(0.02));
+	}
+	single(suite, { "quatMultiply", "single", 4, type }, a, b, [](const Quat& x, const Quat& y) { return x * y; });
+	single(suite, { "nlerp", "single", 4, type }, a, b, [](const Quat& x, const Quat& y) { return nlerp(x, y, T(0.3)); });
+	single(suite, { "slerp", "single", 4, type }, a, b, [](const Quat& x, const Quat& y) { return slerp(x, y, T(0.3)); });
+	std::vector<Quat> out(Items);
+	suite.run({ "nlerp", "batched", 4, type }, Items, [&] {
+		nlerp(std::span<const Quat>(a), std::span<const Quat>(b), T(0.3), std::span<Quat>(out));
+		bench::doNotOptimize(out.data());
+	});
+	suite.run({ "slerp", "batched", 4, type }, Items, [&] {
+		slerp(std::span<const Quat>(a), std::span<const Quat>(b), T(0.3), std::span<Quat>(out));
+		bench::doNotOptimize(out.data());
+	});
+
+	const auto vecs = makeVecs<3, T>(Items, 0);
+	const Quat q = a[1];
+	single(suite, { "rotate", "single", 3, type }, vecs, vecs, [&](const Vec3& v, const Vec3&) { return rotate(q, v); });
+	std::vector<Vec3> rotated(Items);
+	suite.run({ "rotate", "batched", 3, type }, Items, [&] {
+		rotate(q, std::span<const Vec3>(vecs), std::span<Vec3>(rotated), math3d::StoreMode::Cached);
+		bench::doNotOptimize(rotated.data());
+	});
+}
+
+template<class T>
+void storageBenchmarks(bench::Suite& suite, const char* type) {
+	using Vec3 = math3d::Vec<3, float>;
+	using Packed = math3d::Vec<3, T>;
+	const auto vecs = makeVecs<3, float>(Items, 0);
+	std::vector<Vec3> normals(Items);
+	for (size_t i = 0; i < Items; ++i) {
+		normals[i] = unit(vecs[i]);
+	}
+	std::vector<Packed> packed(Items);
+	std::vector<Vec3> unpacked(Items);
+	suite.run({ "pack", "single", 3, type }, Items, [&] {
+		for (size_t i = 0; i < Items; ++i) {
+			packed[i] = static_cast<Packed>(normals[i]);
+		}
+		bench::doNotOptimize(packed.data());
+	});
+	suite.run({ "pack", "batched", 3, type }, Items, [&] {
+		pack(std::span<const Vec3>(normals), std::span<Packed>(packed));
+		bench::doNotOptimize(packed.data());
+	});
+	suite.run({ "unpack", "single", 3, type }, Items, [&] {
+		for (size_t i = 0; i < Items; ++i) {
+			unpacked[i] = static_cast<Vec3>(packed[i]);
+		}
+		bench::doNotOptimize(unpacked.data());
+	});
+	suite.run({ "unpack", "batched", 3, type }, Items, [&] {
+		unpack(std::span<const Packed>(packed), std::span<Vec3>(unpacked));
+		bench::doNotOptimize(unpacked.data());
+	});
+}
+
+template<class Oct>
+void octahedralBenchmarks(bench::Suite& suite, const char* type) {
+	using Vec3 = math3d::Vec<3, float>;
+	const auto vecs = makeVecs<3, float>(Items, 0);
+	std::vector<Vec3> normals(Items);
+	for (size_t i = 0; i < Items; ++i) {
+		normals[i] = unit(vecs[i]);
+	}
+	std::vector<Oct> packed(Items);
+	std::vector<Vec3> unpacked(Items);
+	suite.run({ "pack", "single", 3, type }, Items, [&] {
+		for (size_t i = 0; i < Items; ++i) {
+			packed[i] = Oct(normals[i]);
+		}
+		bench::doNotOptimize(packed.data());
+	});
+	suite.run({ "pack", "batched", 3, type }, Items, [&] {
+		pack(std::span<const Vec3>(normals), std::span<Oct>(packed));
+		bench::doNotOptimize(packed.data());
+	});
+	suite.run({ "unpack", "single", 3, type }, Items, [&] {
+		for (size_t i = 0; i < Items; ++i) {
+			unpacked[i] = static_cast<Vec3>(packed[i]);
+		}
+		bench::doNotOptimize(unpacked.data());
+	});
+	suite.run({ "unpack", "batched", 3, type }, Items, [&] {
+		unpack(std::span<const Oct>(packed), std::span<Vec3>(unpacked));
+		bench::doNotOptimize(unpacked.data());
+	});
+}
+
+//Short lived arrays, as made every frame, from the heap and from an arena
+//Bounds, centroid and covariance of a point set, as a scalar loop over Vec and batched
+void reductionBenchmarks(bench::Suite& suite) {
+	using Vec3 = math3d::Vec<3, float>;
+	const auto points = makeVecs<3, float>(Items, 0);
+	const std::span<const Vec3> view(points);
+	const math3d::VecArray<3, float> soa{ view };
+	suite.run({ "bounds", "single", 3, "float" }, Items, [&] {
+		Vec3 lower = points[0];
+		Vec3 upper = points[0];
+		for (const Vec3& p : points) {
+			for (size_t k = 0; k < 3; ++k) {
+				lower[k] = std::min(lower[k], p[k]);
+				upper[k] = std::max(upper[k], p[k]);
+			}
+		}
+		bench::doNotOptimize(lower);
+		bench::doNotOptimize(upper);
+	});
+	suite.run({ "bounds", "batched", 3, "float" }, Items, [&] { bench::doNotOptimize(bounds(view)); });
+	suite.run({ "bounds soa", "batched", 3, "float" }, Items, [&] { bench::doNotOptimize(bounds(soa)); });
+	suite.run({ "covariance", "single", 3, "float" }, Items, [&] {
+		Vec3 mean;
+		for (const Vec3& p : points) {
+			mean = mean + p;
+		}
+		mean = mean / static_cast<float>(points.size());
+		math3d::Matrix<3, 3, float> c;
+		for (const Vec3& p : points) {
+			const Vec3 d = p - mean;
+			for (size_t r = 0; r < 3; ++r) {
+				for (size_t k = 0; k < 3; ++k) {
+					c[r][k] += d[r] * d[k];
+				}
+			}
+		}
+		bench::doNotOptimize(c / static_cast<float>(points.size()));
+	});
+	suite.run({ "covariance", "batched", 3, "float" }, Items, [&] { bench::doNotOptimize(covariance(view)); });
+	suite.run({ "covariance soa", "batched", 3, "float" }, Items, [&] { bench::doNotOptimize(covariance(soa)); });
+	suite.run({ "statistics", "batched", 3, "float" }, Items, [&] { bench::doNotOptimize(statistics(view)); });
+	suite.run({ "outerProducts", "single", 3, "float" }, Items, [&] {
+		math3d::Matrix<3, 3, double> m;
+		for (const Vec3& p : points) {
+			m = m + outerProduct(p, p);
+		}
+		bench::doNotOptimize(m);
+	});
+	suite.run({ "outerProducts", "batched", 3, "float" }, Items, [&] {
+		math3d::Matrix<3, 3, double> m;
+		addOuterProducts(view, view, m);
+		bench::doNotOptimize(m);
+	});
+	suite.run({ "outerProducts soa", "batched", 3, "float" }, Items, [&] {
+		math3d::Matrix<3, 3, double> m;
+		addOuterProducts(soa, soa, m);
+		bench::doNotOptimize(m);
+	});
+}
+
+//One ray against every triangle (or box), keeping the closest hit
+void intersectionBenchmarks(bench::Suite& suite) {
+	using Vec3 = math3d::Vec<3, float>;
+	const auto a = makeVecs<3, float>(Items, 0);
+	const auto b = makeVecs<3, float>(Items, 4);
+	const auto c = makeVecs<3, float>(Items, 7);
+	std::vector<Vec3> corners;
+	std::vector<math3d::Aabb<float>> boxes(Items);
+	for (size_t i = 0; i < Items; ++i) {
+		corners.insert(corners.end(), { a[i], b[i], c[i] });
+		boxes[i].grow(a[i]).grow(b[i]);
+	}
+	std::vector<math3d::TrianglePacket> triangles(math3d::packetCount(Items));
+	std::vector<math3d::BoxPacket> boxPackets(math3d::packetCount(Items));
+	packTriangles(std::span<const Vec3>(corners), std::span<math3d::TrianglePacket>(triangles));
+	packBoxes(std::span<const math3d::Aabb<float>>(boxes), std::span<math3d::BoxPacket>(boxPackets));
+	const math3d::Ray<float> ray{ { 4.5f, 5.5f, -10 }, { 0.01f, -0.02f, 1 } };
+
+	suite.run({ "ray triangle", "single", 3, "float" }, Items, [&] {
+		math3d::Ray<float> shortened = ray;
+		math3d::TriangleHit<float> closest;
+		math3d::TriangleHit<float> hit;
+		for (size_t i = 0; i < Items; ++i) {
+			if (intersect(shortened, a[i], b[i], c[i], hit)) {
+				shortened.tMax = hit.t;
+				closest = hit;
+				closest.triangle = i;
+			}
+		}
+		bench::doNotOptimize(closest);
+	});
+	suite.run({ "ray triangle", "batched", 3, "float" }, Items, [&] {
+		math3d::TriangleHit<float> closest;
+		bench::doNotOptimize(closestHit(ray, std::span<const math3d::TrianglePacket>(triangles), closest));
+		bench::doNotOptimize(closest);
+	});
+	suite.run({ "ray box", "single", 3, "float" }, Items, [&] {
+		int hits = 0;
+		float entry;
+		for (size_t i = 0; i < Items; ++i) {
+			hits += intersect(ray, boxes[i], entry);
+		}
+		bench::doNotOptimize(hits);
+	});
+	suite.run({ "ray box", "batched", 3, "float" }, Items, [&] {
+		int hits = 0;
+		float entry[math3d::PacketLanes];
+		for (const math3d::BoxPacket& packet : boxPackets) {
+			hits += std::popcount(static_cast<unsigned>(intersect(ray, packet, entry)));
+		}
+		bench::doNotOptimize(hits);
+	});
+}
+
+//Queries into a soup of small triangles, scanning every packet or through a TriangleBvh, per query
+void bvhBenchmarks(bench::Suite& suite) {
+	using Vec3 = math3d::Vec<3, float>;
+	constexpr size_t Triangles = 65536;
+	constexpr size_t Queries = 256;
+	uint32_t state = 1;
+	auto random = [&](float lo, float hi) {
+		state = state * 1664525u + 1013904223u;
+		return lo + (hi - lo) * static_cast<float>(state >> 8) / static_cast<float>(1u << 24);
+	};
+	std::vector<Vec3> corners;
+	for (size_t i = 0; i < Triangles; ++i) {
+		const Vec3 a{ random(-50, 50), random(-50, 50), random(-50, 50) };
+		for (int c = 0; c < 3; ++c) {
+			corners.push_back(a + Vec3{ random(-1, 1), random(-1, 1), random(-1, 1) });
+		}
+	}
+	std::vector<math3d::Ray<float>> rays(Queries);
+	for (auto& ray : rays) {
+		ray = { { random(-50, 50), random(-50, 50), random(-50, 50) }, { random(-1, 1), random(-1, 1), random(-1, 1) } };
+	}
+	const std::span<const Vec3> view(corners);
+	std::vector<math3d::TrianglePacket> packets(math3d::packetCount(Triangles));
+	packTriangles(view, std::span<math3d::TrianglePacket>(packets));
+	const math3d::TriangleBvh bvh(view);
+
+	suite.run({ "closest hit", "scan", 3, "float" }, Queries, [&] {
+		math3d::TriangleHit<float> hit;
+		for (const auto& ray : rays) {
+			bench::doNotOptimize(closestHit(ray, std::span<const math3d::TrianglePacket>(packets), hit));
+		}
+	});
+	suite.run({ "closest hit", "bvh", 3, "float" }, Queries, [&] {
+		math3d::TriangleHit<float> hit;
+		for (const auto& ray : rays) {
+			bench::doNotOptimize(bvh.closestHit(ray, hit));
+		}
+	});
+	suite.run({ "closest point", "bvh", 3, "float" }, Queries, [&] {
+		math3d::ClosestPoint<float> closest;
+		for (const auto& ray : rays) {
+			bench::doNotOptimize(bvh.closestPoint(ray.origin, closest));
+		}
+	});
+	suite.run({ "bvh build", "sah", 3, "float" }, Triangles, [&] { bench::doNotOptimize(math3d::TriangleBvh(view).hierarchy().nodes().data()); });
+}
+
+//Nearest neighbors of random query points among random points, per query
+void kdTreeBenchmarks(bench::Suite& suite) {
+	using Vec3 = math3d::Vec<3, float>;
+	constexpr size_t Points = 262144;
+	constexpr size_t Queries = 4096;
+	constexpr size_t K = 8;
+	uint32_t state = 1;
+	auto random = [&]() {
+		state = state * 1664525u + 1013904223u;
+		return Vec3{ static_cast<float>(state >> 8 & 1023), static_cast<float>(state >> 18 & 1023), static_cast<float>(state & 255) * 4 };
+	};
+	std::vector<Vec3> points(Points);
+	for (auto& p : points) {
+		p = random();
+	}
+	std::vector<Vec3> queries(Queries);
+	for (auto& q : queries) {
+		q = random() + Vec3{ 0.5f, 0.5f, 0.5f };
+	}
+	const math3d::KdTree tree{ std::span<const Vec3>(points) };
+	std::vector<math3d::Neighbor> out(Queries * K);
+
+	suite.run({ "nearest neighbor", "brute force", 3, "float" }, 16, [&] {
+		for (size_t q = 0; q < 16; ++q) {
+			float best = std::numeric_limits<float>::infinity();
+			for (const auto& p : points) {
+				best = std::min(best, lengthSquared(queries[q] - p));
+			}
+			bench::doNotOptimize(best);
+		}
+	});
+	suite.run({ "nearest neighbor", "single", 3, "float" }, Queries, [&] {
+		for (const auto& q : queries) {
+			bench::doNotOptimize(tree.nearest(q));
+		}
+	});
+	suite.run({ "nearest 8", "single", 3, "float" }, Queries, [&] {
+		for (size_t q = 0; q < Queries; ++q) {
+			tree.nearest(queries[q], std::span<math3d::Neighbor>(out).subspan(q * K, K));
+		}
+		bench::doNotOptimize(out.data());
+	});
+	suite.run({ "nearest 8", "batched", 3, "float" }, Queries, [&] {
+		tree.nearest(queries, K, out);
+		bench::doNotOptimize(out.data());
+	});
+	suite.run({ "kd tree build", "median", 3, "float" }, Points, [&] { bench::doNotOptimize(math3d::KdTree(std::span<const Vec3>(points)).points().data()); });
+}
+
+//Morton codes, sorting them with their indices, and reordering points, per point
+void mortonBenchmarks(bench::Suite& suite) {
+	using Vec3 = math3d::Vec<3, float>;
+	constexpr size_t Points = 1 << 20;
+	uint32_t state = 1;
+	auto random = [&]() {
+		state = state * 1664525u + 1013904223u;
+		return static_cast<float>(state >> 8) / static_cast<float>(1 << 24);
+	};
+	std::vector<Vec3> points(Points);
+	for (auto& p : points) {
+		p = { random(), random(), random() };
+	}
+	const std::span<const Vec3> view(points);
+	const math3d::Aabb<float> box = bounds(view);
+	std::vector<uint32_t> codes30(Points);
+	std::vector<uint64_t> codes63(Points);
+	std::vector<uint64_t> keys(Points);
+	std::vector<uint32_t> order(Points);
+	std::vector<std::pair<uint64_t, uint32_t>> pairs(Points);
+
+	suite.run({ "morton code", "30 bit", 3, "float" }, Points, [&] {
+		morton30(view, box, std::span<uint32_t>(codes30));
+		bench::doNotOptimize(codes30.data());
+	});
+	suite.run({ "morton code", "63 bit", 3, "float" }, Points, [&] {
+		morton63(view, box, std::span<uint64_t>(codes63));
+		bench::doNotOptimize(codes63.data());
+	});
+	suite.run({ "sort by key", "std::sort", 1, "uint64" }, Points, [&] {
+		for (size_t i = 0; i < Points; ++i) {
+			pairs[i] = { codes63[i], static_cast<uint32_t>(i) };
+		}
+		std::sort(pairs.begin(), pairs.end());
+		bench::doNotOptimize(pairs.data());
+	});
+	suite.run({ "sort by key", "radix", 1, "uint64" }, Points, [&] {
+		std::copy(codes63.begin(), codes63.end(), keys.begin());
+		std::iota(order.begin(), order.end(), uint32_t(0));
+		radixSort(std::span<uint64_t>(keys), std::span<uint32_t>(order));
+		bench::doNotOptimize(keys.data());
+	});
+	std::vector<Vec3> reordered(Points);
+	suite.run({ "permute", "gather", 3, "float" }, Points, [&] {
+		permute(std::span<const uint32_t>(order), view, std::span<Vec3>(reordered));
+		bench::doNotOptimize(reordered.data());
+	});
+
+	//the same nearest neighbor queries, in scan order and in Morton order
+	const math3d::KdTree tree(view);
+	constexpr size_t Queries = 65536;
+	const std::span<const Vec3> queries = view.first(Queries);
+	const std::vector<uint32_t> queryOrder = mortonOrder(queries);
+	std::vector<Vec3> sortedQueries(Queries);
+	permute(std::span<const uint32_t>(queryOrder), queries, std::span<Vec3>(sortedQueries));
+	suite.run({ "nearest neighbor", "scan order", 3, "float" }, Queries, [&] {
+		for (const auto& q : queries) {
+			bench::doNotOptimize(tree.nearest(q));
+		}
+	});
+	suite.run({ "nearest neighbor", "morton order", 3, "float" }, Queries, [&] {
+		for (const auto& q : sortedQueries) {
+			bench::doNotOptimize(tree.nearest(q));
+		}
+	});
+}
+
+//A camera among objects scattered around it, about one in eight inside its frustum
+void cullingBenchmarks(bench::Suite& suite) {
+	using Vec3 = math3d::Vec<3, float>;
+	using Vec4 = math3d::Vec<4, float>;
+	constexpr size_t Objects = 1 << 18;
+	const math3d::Matrix<4, 4, float> viewProjection{ { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, -1.02f, -2.02f }, { 0, 0, -1, 0 } };
+	const std::array<Vec4, 6> planes = math3d::frustumPlanes(viewProjection);
+	const std::span<const Vec4> view(planes);
+	uint32_t state = 1;
+	auto random = [&]() {
+		state = state * 1664525u + 1013904223u;
+		return static_cast<float>(state >> 8) / static_cast<float>(1 << 24) * 200.0f - 100.0f;
+	};
+	std::vector<Vec3> scaled(Objects), lower(Objects), upper(Objects);
+	std::vector<float> radii(Objects);
+	for (size_t i = 0; i < Objects; ++i) {
+		scaled[i] = { random(), random(), random() };
+		radii[i] = 1.0f + static_cast<float>(i % 7) * 0.25f;
+		lower[i] = scaled[i] - Vec3{ radii[i], radii[i], radii[i] };
+		upper[i] = scaled[i] + Vec3{ radii[i], radii[i], radii[i] };
+	}
+	const math3d::VecArray<3, float> soaCenters{ std::span<const Vec3>(scaled) };
+	const math3d::VecArray<3, float> soaLower{ std::span<const Vec3>(lower) };
+	const math3d::VecArray<3, float> soaUpper{ std::span<const Vec3>(upper) };
+	std::vector<uint32_t> visible(Objects);
+	std::vector<uint64_t> mask((Objects + 63) / 64);
+
+	suite.run({ "cull spheres", "single", 3, "float" }, Objects, [&] {
+		size_t count = 0;
+		for (size_t i = 0; i < Objects; ++i) {
+			if (isVisible(view, scaled[i], radii[i])) {
+				visible[count++] = static_cast<uint32_t>(i);
+			}
+		}
+		bench::doNotOptimize(count);
+	});
+	suite.run({ "cull spheres", "indices", 3, "float" }, Objects, [&] {
+		bench::doNotOptimize(cullSpheres(view, soaCenters, std::span<const float>(radii), std::span<uint32_t>(visible)));
+	});
+	suite.run({ "cull spheres", "mask", 3, "float" }, Objects, [&] {
+		bench::doNotOptimize(cullSpheresMask(view, soaCenters, std::span<const float>(radii), std::span<uint64_t>(mask)));
+	});
+	suite.run({ "cull spheres", "indices pool", 3, "float" }, Objects, [&] {
+		bench::doNotOptimize(cullSpheres(math3d::ThreadPool::global(), view, soaCenters, std::span<const float>(radii), std::span<uint32_t>(visible)));
+	});
+	suite.run({ "cull boxes", "single", 3, "float" }, Objects, [&] {
+		size_t count = 0;
+		for (size_t i = 0; i < Objects; ++i) {
+			if (isVisible(view, math3d::Aabb<float>{ lower[i], upper[i] })) {
+				visible[count++] = static_cast<uint32_t>(i);
+			}
+		}
+		bench::doNotOptimize(count);
+	});
+	suite.run({ "cull boxes", "indices", 3, "float" }, Objects, [&] {
+		bench::doNotOptimize(cullBoxes(view, soaLower, soaUpper, std::span<uint32_t>(visible)));
+	});
+	suite.run({ "cull boxes", "mask", 3, "float" }, Objects, [&] {
+		bench::doNotOptimize(cullBoxesMask(view, soaLower, soaUpper, std::span<uint64_t>(mask)));
+	});
+}
+
+//A scene graph of mostly static nodes, a few of them moved every frame
+void hierarchyBenchmarks(bench::Suite& suite) {
+	using Mat4 = math3d::Matrix<4, 4, float>;
+	constexpr size_t Nodes = 1 << 16;
+	constexpr size_t Moved = Nodes / 64;
+	uint32_t state = 1;
+	auto random = [&]() {
+		state = state * 1664525u + 1013904223u;
+		return state >> 8;
+	};
+	std::vector<uint32_t> parents(Nodes, math3d::TransformHierarchy<float>::NoParent);
+	std::vector<Mat4> locals(Nodes);
+	for (size_t i = 0; i < Nodes; ++i) {
+		if (i >= 64) {
+			parents[i] = static_cast<uint32_t>(random() % (i / 2) + i / 4);
+		}
+		const float t = static_cast<float>(i % 17);
+		locals[i] = { { 0.6f, -0.8f, 0, t }, { 0.8f, 0.6f, 0, -t }, { 0, 0, 1, 1 }, { 0, 0, 0, 1 } };
+	}
+	std::vector<uint32_t> moved(Moved);
+	for (auto& m : moved) {
+		m = static_cast<uint32_t>(random() % Nodes);
+	}
+	math3d::TransformHierarchy<float> hierarchy{ std::span<const uint32_t>(parents), std::span<const Mat4>(locals) };
+	std::vector<Mat4> worlds(Nodes);
+
+	//every frame from scratch, each node multiplied up the chain of its parents
+	suite.run({ "world transforms", "chain", 4, "float" }, Nodes, [&] {
+		for (size_t i = 0; i < Nodes; ++i) {
+			Mat4 world = locals[i];
+			for (uint32_t p = parents[i]; p != math3d::TransformHierarchy<float>::NoParent; p = parents[p]) {
+				world = locals[p] * world;
+			}
+			worlds[i] = world;
+		}
+		bench::doNotOptimize(worlds.data());
+	});
+	suite.run({ "world transforms", "all dirty", 4, "float" }, Nodes, [&] {
+		hierarchy.setLocal(0, locals[0]);
+		for (uint32_t root = 1; root < 64; ++root) {
+			hierarchy.setLocal(root, locals[root]);
+		}
+		bench::doNotOptimize(hierarchy.update());
+	});
+	suite.run({ "world transforms", "1/64 moved", 4, "float" }, Nodes, [&] {
+		for (uint32_t m : moved) {
+			hierarchy.setLocal(m, locals[m]);
+		}
+		bench::doNotOptimize(hierarchy.update());
+	});
+	suite.run({ "world transforms", "1/64 moved pool", 4, "float" }, Nodes, [&] {
+		for (uint32_t m : moved) {
+			hierarchy.setLocal(m, locals[m]);
+		}
+		bench::doNotOptimize(hierarchy.update(math3d::ThreadPool::global()));
+	});
+}
+
+void allocationBenchmarks(bench::Suite& suite) {
+	using Vec3 = math3d::Vec<3, float>;
+	constexpr size_t Arrays = 256;
+	constexpr size_t Length = 64;
+	suite.run({ "allocate", "heap", 3, "float" }, Arrays, [&] {
+		for (size_t i = 0; i < Arrays; ++i) {
+			std::vector<Vec3> v(Length);
+			bench::doNotOptimize(v.data());
+		}
+	});
+	math3d::Arena arena;
+	suite.run({ "allocate", "arena", 3, "float" }, Arrays, [&] {
+		arena.reset();
+		for (size_t i = 0; i < Arrays; ++i) {
+			bench::doNotOptimize(arena.allocateArray<Vec3>(Length).data());
+		}
+	});
+}
+
+//Large arrays, run on one thread and on every thread of the global pool
+void parallelBenchmarks(bench::Suite& suite) {
+	using Vec3 = math3d::Vec<3, float>;
+	constexpr size_t Large = size_t{ 1 } << 22;
+	math3d::ThreadPool single(1);
+	math3d::ThreadPool& all = math3d::ThreadPool::global();
+	const math3d::Matrix<4, 4, float> m{ { 0.36f, 0.48f, -0.8f, 10 }, { -0.8f, 0.6f, 0, -20 }, { 0.48f, 0.64f, 0.6f, 30.5f }, { 0, 0, 0, 1 } };
+	const auto points = makeVecs<3, float>(Large, 0);
+	const math3d::VecArray<3, float> soa{ std::span<const Vec3>(points) };
+	std::vector<Vec3> out(Large);
+	math3d::VecArray<3, float> soaOut(Large);
+	std::vector<float> dots(Large);
+	for (auto [pool, variant] : { std::pair{ &single, "1 thread" }, std::pair{ &all, "pool" } }) {
+		suite.run({ "transformPoint", variant, 3, "float" }, Large, [&] {
+			transformPoints(*pool, m, std::span<const Vec3>(points), std::span<Vec3>(out));
+			bench::doNotOptimize(out.data());
+		});
+		suite.run({ "transformPoint soa", variant, 3, "float" }, Large, [&] {
+			transformPoints(*pool, m, soa, soaOut);
+			bench::doNotOptimize(soaOut.x());
+		});
+		suite.run({ "dotProduct", variant, 3, "float" }, Large, [&] {
+			dotProduct(*pool, soa, soa, std::span<float>(dots));
+			bench::doNotOptimize(dots.data());
+		});
+		suite.run({ "unit", variant, 3, "float" }, Large, [&] {
+			unit(*pool, soa, soaOut);
+			bench::doNotOptimize(soaOut.x());
+		});
+		suite.run({ "statistics", variant, 3, "float" }, Large, [&] {
+			bench::doNotOptimize(statistics(*pool, std::span<const Vec3>(points)));
+		});
+	}
+}
+
+int main(int argc, char** argv) {
+	bench::Suite suite(argc, argv);
+#if defined(__VERSION__)
+	suite.context("compiler", __VERSION__);
+#endif
+	suite.context("simd", MATH3D_AVX ? "avx" : MATH3D_SSE ? "sse" : "scalar");
+	suite.context("fma", MATH3D_FMA ? "yes" : "no");
+	suite.context("f16c", MATH3D_F16C ? "yes" : "no");
+	suite.context("items", std::to_string(Items));
+	suite.context("threads", std::to_string(math3d::ThreadPool::global().concurrency()));
+
+	vecBenchmarks<float>(suite);
+	vecBenchmarks<double>(suite);
+	vecBenchmarks<int>(suite);
+	vecBenchmarks<short>(suite);
+
+	precisionBenchmarks<math3d::Precision::Estimate>(suite, "Estimate");
+	precisionBenchmarks<math3d::Precision::Refined>(suite, "Refined");
+	precisionBenchmarks<math3d::Precision::Full>(suite, "Full");
+
+	matrixBenchmarks<float>(suite);
+	matrixBenchmarks<double>(suite);
+	linearAlgebraBenchmarks<float>(suite);
+	linearAlgebraBenchmarks<double>(suite);
+	transformBenchmarks<float>(suite);
+	transformBenchmarks<double>(suite);
+	quatBenchmarks<float>(suite);
+	quatBenchmarks<double>(suite);
+	storageBenchmarks<math3d::half>(suite, "half");
+	storageBenchmarks<math3d::snorm16>(suite, "snorm16");
+	storageBenchmarks<math3d::unorm16>(suite, "unorm16");
+	octahedralBenchmarks<math3d::oct32>(suite, "oct32");
+	octahedralBenchmarks<math3d::oct16>(suite, "oct16");
+	reductionBenchmarks(suite);
+	intersectionBenchmarks(suite);
+	bvhBenchmarks(suite);
+	kdTreeBenchmarks(suite);
+	mortonBenchmarks(suite);
+	cullingBenchmarks(suite);
+	hierarchyBenchmarks(suite);
+	allocationBenchmarks(suite);
+	parallelBenchmarks(suite);
+
+	return suite.finish();
+}
@@ -0,0 +1,739 @@
+#pragma once
+
+#include "intersect.h"
+#include "math3d.h"
+#include "parallel.h"
+#include "reduce.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace math3d {
+
+/*
+* Bounding Volume Hierarchy Nodes
+* The tree is flattened into one array in depth first order: the first child of an
+* inner node is the node after it, index is the second child. A leaf holds the items
+* [index, index + count) of the item array. Nodes are 32 bytes, two to a cache line,
+* and a query walks both arrays mostly front to back.
+*/
+struct BvhNode {
+	Aabb<float> bounds;
+	uint32_t index = 0;
+	uint32_t count = 0;
+
+	bool leaf() const {
+		return count != 0;
+	}
+};
+
+static_assert(sizeof(BvhNode) == 32);
+
+namespace bvhKernels {
+	/*
+	* Binned SAH Build
+	* Items are split by their box centers. Every range is binned into Bins slabs along
+	* each axis (fewer for ranges of fewer items), and split between the two bins where
+	* the surface area heuristic
+	*	TraversalCost + (area(left) cost(left) + area(right) cost(right)) / area(range)
+	* is lowest, or made a leaf when it holds at most maxLeafSize items and testing
+	* them is cheaper. cost(n) counts the blocks of a leaf, blocks of one item, or of
+	* 8 items for the packet leaves of TriangleBvh.
+	*
+	* Ranges of more than TaskItems are binned on every thread of the pool and their
+	* two halves built as separate tasks, smaller ones are built by one thread. The
+	* tree only depends on the boxes, not on the number of threads. Below MaxDepth
+	* ranges are split at the median, which bounds the depth, and so the traversal
+	* stacks, for any input.
+	*/
+	inline constexpr size_t Bins = 16;
+	inline constexpr size_t TaskItems = 16384;
+	inline constexpr size_t MaxDepth = 64;
+	inline constexpr size_t StackSize = MaxDepth + 40;
+	inline constexpr float TraversalCost = 1;
+
+	inline constexpr uint32_t NoItem = std::numeric_limits<uint32_t>::max();
+
+	struct Range {
+		size_t begin = 0;
+		size_t end = 0;
+		Aabb<float> bounds;
+		Aabb<float> centers;
+	};
+
+	struct Bin {
+		Aabb<float> bounds;
+		size_t count = 0;
+	};
+
+	struct Binning {
+		Bin bins[3][Bins];
+
+		Binning& merge(const Binning& other) {
+			for (size_t k = 0; k < 3; ++k) {
+				for (size_t b = 0; b < Bins; ++b) {
+					bins[k][b].bounds.grow(other.bins[k][b].bounds);
+					bins[k][b].count += other.bins[k][b].count;
+				}
+			}
+			return *this;
+		}
+	};
+
+	//An item and its box, kept together so that the ranges being split are contiguous in memory
+	struct Reference {
+		Aabb<float> box;
+		uint32_t item;
+	};
+
+	//Nodes of the ranges split on several threads, with the subtrees below them
+	struct Subtree {
+		std::vector<BvhNode> nodes;
+		std::unique_ptr<Subtree> left;
+		std::unique_ptr<Subtree> right;
+	};
+
+	class Builder {
+	public:
+		Builder(ThreadPool* pool, std::span<const Aabb<float>> boxes, size_t maxLeafSize, size_t block)
+			: pool(pool), boxes(boxes), maxLeafSize(std::max<size_t>(maxLeafSize, 1)), block(block) {
+			if (boxes.size() >= NoItem) {
+				throw std::invalid_argument("math3d: a Bvh holds fewer than 2^32 - 1 items");
+			}
+		}
+
+		//Builds the tree into nodes, and the items of its leaves, each leaf padded with NoItem to a multiple of block
+		void build(std::vector<BvhNode>& nodes, std::vector<uint32_t>& items) {
+			nodes.clear();
+			items.clear();
+			//empty boxes are left out
+			order.clear();
+			for (size_t i = 0; i < boxes.size(); ++i) {
+				if (!boxes[i].empty()) {
+					order.push_back({ boxes[i], static_cast<uint32_t>(i) });
+				}
+			}
+			if (order.empty()) {
+				return;
+			}
+			Subtree root;
+			buildSubtree(measure(0, order.size()), 0, root);
+			flatten(root, nodes);
+
+			for (BvhNode& node : nodes) {
+				if (node.leaf()) {
+					const size_t first = items.size();
+					for (size_t i = node.index; i < node.index + node.count; ++i) {
+						items.push_back(order[i].item);
+					}
+					items.resize(first + (node.count + block - 1) / block * block, NoItem);
+					node.index = static_cast<uint32_t>(first);
+				}
+			}
+		}
+
+	private:
+		template<class R, class Map, class Combine>
+		R reduceRange(size_t count, Map&& map, Combine&& combine) {
+			return reduceKernels::reduce<R>(count > TaskItems ? pool : nullptr, count, TaskItems, map, combine);
+		}
+
+		float cost(size_t items) const {
+			return static_cast<float>(block == 1 ? items : (items + block - 1) / block);
+		}
+
+		Range measure(size_t begin, size_t end) {
+			Range range = reduceRange<Range>(end - begin,
+				[&](size_t b, size_t e) {
+					Range r;
+					for (size_t i = begin + b; i < begin + e; ++i) {
+						r.bounds.grow(order[i].box);
+						r.centers.grow(order[i].box.center());
+					}
+					return r;
+				},
+				[](Range a, const Range& b) {
+					a.bounds.grow(b.bounds);
+					a.centers.grow(b.centers);
+					return a;
+				});
+			range.begin = begin;
+			range.end = end;
+			return range;
+		}
+
+		//Splits range into left and right, or returns false to make it a leaf
+		bool split(const Range& range, size_t depth, Range& left, Range& right) {
+			const size_t count = range.end - range.begin;
+			if (count == 1) {
+				return false;
+			}
+			//small ranges use fewer bins
+			const size_t bins = std::min(count, Bins);
+			float scale[3];
+			bool spread = false;
+			for (size_t k = 0; k < 3; ++k) {
+				scale[k] = bins / (range.centers.upper[k] - range.centers.lower[k]);
+				scale[k] = std::isfinite(scale[k]) ? scale[k] : 0;
+				spread |= scale[k] != 0;
+			}
+			if (!spread || depth >= MaxDepth) {
+				return count > maxLeafSize && splitMedian(range, left, right);
+			}
+			auto binOf = [&](const Vec<3, float>& c, size_t k) {
+				return std::min(static_cast<size_t>(static_cast<int>((c[k] - range.centers.lower[k]) * scale[k])), bins - 1);
+			};
+			auto fill = [&](Binning& r, size_t b, size_t e) {
+				for (size_t i = range.begin + b; i < range.begin + e; ++i) {
+					const Vec<3, float> c = order[i].box.center();
+					for (size_t k = 0; k < 3; ++k) {
+						Bin& bin = r.bins[k][binOf(c, k)];
+						bin.bounds.grow(order[i].box);
+						++bin.count;
+					}
+				}
+			};
+			//most ranges are small, they skip the copies of the reduction
+			Binning binning;
+			if (count <= TaskItems) {
+				fill(binning, 0, count);
+			}
+			else {
+				binning = reduceRange<Binning>(count,
+					[&](size_t b, size_t e) {
+						Binning r;
+						fill(r, b, e);
+						return r;
+					},
+					[](Binning a, const Binning& b) { return a.merge(b); });
+			}
+
+			//sweeps from the right, then from the left, the first of equally good splits wins
+			float best = std::numeric_limits<float>::infinity();
+			size_t bestAxis = 0;
+			size_t bestBin = 0;
+			for (size_t k = 0; k < 3; ++k) {
+				if (scale[k] == 0) {
+					continue;
+				}
+				float rightCost[Bins];
+				Bin side;
+				for (size_t b = bins - 1; b > 0; --b) {
+					side.bounds.grow(binning.bins[k][b].bounds);
+					side.count += binning.bins[k][b].count;
+					rightCost[b] = side.count == 0 ? -1 : side.bounds.area() * cost(side.count);
+				}
+				side = {};
+				for (size_t b = 1; b < bins; ++b) {
+					side.bounds.grow(binning.bins[k][b - 1].bounds);
+					side.count += binning.bins[k][b - 1].count;
+					if (side.count == 0 || rightCost[b] < 0) {
+						continue;
+					}
+					const float c = side.bounds.area() * cost(side.count) + rightCost[b];
+					if (c < best) {
+						best = c;
+						bestAxis = k;
+						bestBin = b;
+					}
+				}
+			}
+			const float area = range.bounds.area();
+			if (count <= maxLeafSize && (area == 0 || cost(count) <= TraversalCost + best / area)) {
+				return false;
+			}
+
+			//partitions, measuring the centers of both sides on the way
+			size_t middle = range.begin;
+			size_t end = range.end;
+			left = {};
+			right = {};
+			while (middle < end) {
+				const Vec<3, float> c = order[middle].box.center();
+				if (binOf(c, bestAxis) < bestBin) {
+					left.centers.grow(c);
+					++middle;
+				}
+				else {
+					right.centers.grow(c);
+					std::swap(order[middle], order[--end]);
+				}
+			}
+			left.begin = range.begin;
+			left.end = right.begin = middle;
+			right.end = range.end;
+			for (size_t b = 0; b < bins; ++b) {
+				(b < bestBin ? left : right).bounds.grow(binning.bins[bestAxis][b].bounds);
+			}
+			return true;
+		}
+
+		//Halves along the axis where the centers spread most, ties broken by item
+		bool splitMedian(const Range& range, Range& left, Range& right) {
+			const Vec<3, float> spread = range.centers.extent();
+			const size_t axis = spread.x >= spread.y && spread.x >= spread.z ? 0 : spread.y >= spread.z ? 1 : 2;
+			const size_t middle = range.begin + (range.end - range.begin) / 2;
+			std::nth_element(order.begin() + range.begin, order.begin() + middle, order.begin() + range.end, [&](const Reference& a, const Reference& b) {
+				const float ca = a.box.center()[axis];
+				const float cb = b.box.center()[axis];
+				return ca < cb || (ca == cb && a.item < b.item);
+			});
+			left = measure(range.begin, middle);
+			right = measure(middle, range.end);
+			return true;
+		}
+
+		void buildNodes(const Range& range, size_t depth, std::vector<BvhNode>& nodes) {
+			const size_t self = nodes.size();
+			nodes.push_back({ range.bounds, static_cast<uint32_t>(range.begin), static_cast<uint32_t>(range.end - range.begin) });
+			Range left;
+			Range right;
+			if (split(range, depth, left, right)) {
+				nodes[self].count = 0;
+				buildNodes(left, depth + 1, nodes);
+				nodes[self].index = static_cast<uint32_t>(nodes.size());
+				buildNodes(right, depth + 1, nodes);
+			}
+		}
+
+		void buildSubtree(const Range& range, size_t depth, Subtree& tree) {
+			Range left;
+			Range right;
+			if (!pool || range.end - range.begin <= TaskItems || !split(range, depth, left, right)) {
+				buildNodes(range, depth, tree.nodes);
+				return;
+			}
+			tree.nodes.push_back({ range.bounds, 0, 0 });
+			tree.left = std::make_unique<Subtree>();
+			tree.right = std::make_unique<Subtree>();
+			auto half = [&](size_t i) {
+				if (i == 0) {
+					buildSubtree(left, depth + 1, *tree.left);
+				}
+				else {
+					buildSubtree(right, depth + 1, *tree.right);
+				}
+			};
+			pool->run(2, half);
+		}
+
+		//Subtree indices are relative to their own nodes, flatten moves them to their place in nodes
+		static void flatten(Subtree& tree, std::vector<BvhNode>& nodes) {
+			const size_t base = nodes.size();
+			if (!tree.left) {
+				for (BvhNode node : tree.nodes) {
+					node.index += node.leaf() ? 0 : static_cast<uint32_t>(base);
+					nodes.push_back(node);
+				}
+				return;
+			}
+			nodes.push_back(tree.nodes[0]);
+			flatten(*tree.left, nodes);
+			nodes[base].index = static_cast<uint32_t>(nodes.size());
+			flatten(*tree.right, nodes);
+		}
+
+		ThreadPool* pool;
+		std::span<const Aabb<float>> boxes;
+		size_t maxLeafSize;
+		size_t block;
+		std::vector<Reference> order;
+	};
+
+	/*
+	* Traversal
+	* Every query walks the tree with a fixed stack, and calls leaf(node, ...) for the
+	* leaves it reaches. Ray casts visit the nearer child first and skip nodes entered
+	* beyond the current ray.tMax, which leaf may shorten, or return true to stop.
+	* Their box test accepts boxes missed by a few ulp, so rounding never loses a hit
+	* in a face of a box. Nearest point queries visit the child with the nearer box
+	* first and skip boxes farther than the best distance found so far.
+	*/
+	inline constexpr float BoxSlack = 1 + 8 * std::numeric_limits<float>::epsilon();
+
+	struct RayBoxTest {
+		float origin[3];
+		float inverse[3];
+
+		explicit RayBoxTest(const Ray<float>& ray)
+			: origin{ ray.origin.x, ray.origin.y, ray.origin.z }, inverse{ 1 / ray.direction.x, 1 / ray.direction.y, 1 / ray.direction.z } {}
+
+		bool operator()(const Aabb<float>& box, const Ray<float>& ray, float& entry) const {
+			float near = ray.tMin;
+			float far = ray.tMax < std::numeric_limits<float>::max() ? ray.tMax : std::numeric_limits<float>::max();
+			for (size_t k = 0; k < 3; ++k) {
+				const bool negative = std::copysign(1.0f, inverse[k]) < 0;
+				const float tNear = ((negative ? box.upper[k] : box.lower[k]) - origin[k]) * inverse[k];
+				const float tFar = ((negative ? box.lower[k] : box.upper[k]) - origin[k]) * inverse[k];
+				near = tNear > near ? tNear : near;
+				far = tFar < far ? tFar : far;
+			}
+			entry = near;
+			return near <= far + std::abs(far) * (BoxSlack - 1);
+		}
+	};
+
+	template<class Leaf>
+	void raycast(std::span<const BvhNode> nodes, Ray<float>& ray, Leaf&& leaf) {
+		struct Entry {
+			uint32_t node;
+			float t;
+		};
+		const RayBoxTest test(ray);
+		Entry stack[StackSize];
+		size_t top = 0;
+		float t;
+		if (nodes.empty() || !test(nodes[0].bounds, ray, t)) {
+			return;
+		}
+		stack[top++] = { 0, t };
+		while (top != 0) {
+			const Entry entry = stack[--top];
+			if (entry.t > ray.tMax * BoxSlack) {
+				continue;
+			}
+			const BvhNode& node = nodes[entry.node];
+			if (node.leaf()) {
+				if (leaf(node, ray)) {
+					return;
+				}
+				continue;
+			}
+			Entry near = { entry.node + 1, 0 };
+			Entry far = { node.index, 0 };
+			const bool hitNear = test(nodes[near.node].bounds, ray, near.t);
+			const bool hitFar = test(nodes[far.node].bounds, ray, far.t);
+			if (hitNear && hitFar) {
+				if (far.t < near.t) {
+					std::swap(near, far);
+				}
+				stack[top++] = far;
+				stack[top++] = near;
+			}
+			else if (hitNear || hitFar) {
+				stack[top++] = hitNear ? near : far;
+			}
+		}
+	}
+
+	template<class Leaf>
+	void overlapping(std::span<const BvhNode> nodes, const Aabb<float>& box, Leaf&& leaf) {
+		uint32_t stack[StackSize];
+		size_t top = 0;
+		if (nodes.empty() || !nodes[0].bounds.overlaps(box)) {
+			return;
+		}
+		stack[top++] = 0;
+		while (top != 0) {
+			const uint32_t i = stack[--top];
+			const BvhNode& node = nodes[i];
+			if (node.leaf()) {
+				leaf(node);
+				continue;
+			}
+			if (nodes[node.index].bounds.overlaps(box)) {
+				stack[top++] = node.index;
+			}
+			if (nodes[i + 1].bounds.overlaps(box)) {
+				stack[top++] = i + 1;
+			}
+		}
+	}
+
+	//leaf(node, best) lowers best, the squared distance of the nearest item found so far
+	template<class Leaf>
+	void nearest(std::span<const BvhNode> nodes, const Vec<3, float>& point, float& best, Leaf&& leaf) {
+		struct Entry {
+			uint32_t node;
+			float distance;
+		};
+		Entry stack[StackSize];
+		size_t top = 0;
+		if (nodes.empty()) {
+			return;
+		}
+		stack[top++] = { 0, nodes[0].bounds.distanceSquared(point) };
+		while (top != 0) {
+			const Entry entry = stack[--top];
+			if (entry.distance > best) {
+				continue;
+			}
+			const BvhNode& node = nodes[entry.node];
+			if (node.leaf()) {
+				leaf(node, best);
+				continue;
+			}
+			Entry near = { entry.node + 1, nodes[entry.node + 1].bounds.distanceSquared(point) };
+			Entry far = { node.index, nodes[node.index].bounds.distanceSquared(point) };
+			if (far.distance < near.distance) {
+				std::swap(near, far);
+			}
+			if (far.distance <= best) {
+				stack[top++] = far;
+			}
+			if (near.distance <= best) {
+				stack[top++] = near;
+			}
+		}
+	}
+}
+
+/*
+* Bounding Volume Hierarchy
+* A tree over items given by their bounding boxes, built with binned SAH. Items with
+* empty boxes are left out. The queries find the candidate items, f tests the item
+* itself:
+*	overlapping calls f(item) for the items in the leaves that overlap box.
+*	raycast calls f(item, ray) for the items in the leaves the ray enters before
+*		ray.tMax. For the closest hit f lowers ray.tMax to the hits it finds, f
+*		returns true to stop, e.g. for any hit.
+*	nearest calls distanceSquared(item) for the items that may be nearer to point
+*		than best, and returns the nearest one, or NoItem, with best lowered to its
+*		squared distance.
+* Building with a pool gives the same tree as building without.
+*/
+class Bvh {
+public:
+	static constexpr uint32_t NoItem = bvhKernels::NoItem;
+
+	Bvh() = default;
+
+	explicit Bvh(std::span<const Aabb<float>> boxes, size_t maxLeafSize = 4) {
+		bvhKernels::Builder(nullptr, boxes, maxLeafSize, 1).build(treeNodes, leafItems);
+	}
+
+	Bvh(ThreadPool& pool, std::span<const Aabb<float>> boxes, size_t maxLeafSize = 4) {
+		bvhKernels::Builder(&pool, boxes, maxLeafSize, 1).build(treeNodes, leafItems);
+	}
+
+	bool empty() const {
+		return treeNodes.empty();
+	}
+
+	Aabb<float> bounds() const {
+		return empty() ? Aabb<float>{} : treeNodes[0].bounds;
+	}
+
+	std::span<const BvhNode> nodes() const {
+		return treeNodes;
+	}
+
+	std::span<const uint32_t> items() const {
+		return leafItems;
+	}
+
+	template<class F>
+	void overlapping(const Aabb<float>& box, F&& f) const {
+		bvhKernels::overlapping(nodes(), box, [&](const BvhNode& leaf) {
+			for (uint32_t i = leaf.index; i < leaf.index + leaf.count; ++i) {
+				f(leafItems[i]);
+			}
+		});
+	}
+
+	template<class F>
+	void raycast(const Ray<float>& ray, F&& f) const {
+		Ray<float> r = ray;
+		bvhKernels::raycast(nodes(), r, [&](const BvhNode& leaf, Ray<float>& current) {
+			for (uint32_t i = leaf.index; i < leaf.index + leaf.count; ++i) {
+				if (f(leafItems[i], current)) {
+					return true;
+				}
+			}
+			return false;
+		});
+	}
+
+	template<class F>
+	uint32_t nearest(const Vec<3, float>& point, F&& distanceSquared, float& best) const {
+		uint32_t found = NoItem;
+		bvhKernels::nearest(nodes(), point, best, [&](const BvhNode& leaf, float& bestSoFar) {
+			for (uint32_t i = leaf.index; i < leaf.index + leaf.count; ++i) {
+				const float d = distanceSquared(leafItems[i]);
+				if (d < bestSoFar) {
+					bestSoFar = d;
+					found = leafItems[i];
+				}
+			}
+		});
+		return found;
+	}
+
+private:
+	friend class TriangleBvh;
+
+	Bvh(ThreadPool* pool, std::span<const Aabb<float>> boxes, size_t maxLeafSize, size_t block) {
+		bvhKernels::Builder(pool, boxes, maxLeafSize, block).build(treeNodes, leafItems);
+	}
+
+	std::vector<BvhNode> treeNodes;
+	std::vector<uint32_t> leafItems;
+};
+
+//Nearest point of a triangle mesh, triangle is the index of the triangle it is on
+template<class T>
+struct ClosestPoint {
+	Vec<3, T> point;
+	T distanceSquared = std::numeric_limits<T>::infinity();
+	size_t triangle = 0;
+};
+
+/*
+* Triangle BVH
+* A Bvh over triangles, given as 3 corners each or as 3 vertex indices each, whose
+* leaves hold up to 8 triangles in one TrianglePacket, so a leaf is tested with the
+* 8 wide kernels of intersect.h. The SAH counts a leaf as one packet test, so leaves
+* tend to fill their packets.
+*
+* closestHit finds the nearest hit in [ray.tMin, ray.tMax], one of them when several
+* triangles are hit at the same t, and occluded whether there is any. closestPoint
+* finds the nearest point closer than maxDistance. overlapping calls f(triangle) for
+* the triangles whose bounds overlap box.
+*/
+class TriangleBvh {
+public:
+	TriangleBvh() = default;
+
+	explicit TriangleBvh(std::span<const Vec<3, float>> corners) {
+		build(nullptr, corners.size() / 3, [&](size_t t, size_t c) -> const Vec<3, float>& { return corners[3 * t + c]; });
+	}
+
+	TriangleBvh(ThreadPool& pool, std::span<const Vec<3, float>> corners) {
+		build(&pool, corners.size() / 3, [&](size_t t, size_t c) -> const Vec<3, float>& { return corners[3 * t + c]; });
+	}
+
+	TriangleBvh(std::span<const Vec<3, float>> vertices, std::span<const uint32_t> indices) {
+		build(nullptr, indices.size() / 3, [&](size_t t, size_t c) -> const Vec<3, float>& { return vertices[indices[3 * t + c]]; });
+	}
+
+	TriangleBvh(ThreadPool& pool, std::span<const Vec<3, float>> vertices, std::span<const uint32_t> indices) {
+		build(&pool, indices.size() / 3, [&](size_t t, size_t c) -> const Vec<3, float>& { return vertices[indices[3 * t + c]]; });
+	}
+
+	const Bvh& hierarchy() const {
+		return bvh;
+	}
+
+	bool closestHit(const Ray<float>& ray, TriangleHit<float>& hit) const {
+		bool found = false;
+		Ray<float> r = ray;
+		bvhKernels::raycast(bvh.nodes(), r, [&](const BvhNode& leaf, Ray<float>& current) {
+			PacketHits hits;
+			int mask = ::intersect(current, packets[leaf.index / PacketLanes], hits);
+			while (mask != 0) {
+				const int lane = std::countr_zero(static_cast<unsigned>(mask));
+				mask &= mask - 1;
+				if (!found || hits.t[lane] < current.tMax) {
+					found = true;
+					current.tMax = hits.t[lane];
+					hit = { hits.t[lane], hits.u[lane], hits.v[lane], bvh.leafItems[leaf.index + lane] };
+				}
+			}
+			return false;
+		});
+		return found;
+	}
+
+	bool occluded(const Ray<float>& ray) const {
+		bool hit = false;
+		Ray<float> r = ray;
+		bvhKernels::raycast(bvh.nodes(), r, [&](const BvhNode& leaf, Ray<float>& current) {
+			PacketHits hits;
+			hit = ::intersect(current, packets[leaf.index / PacketLanes], hits) != 0;
+			return hit;
+		});
+		return hit;
+	}
+
+	bool closestPoint(const Vec<3, float>& point, ClosestPoint<float>& out, float maxDistance = std::numeric_limits<float>::infinity()) const {
+		float best = maxDistance * maxDistance;
+		bool found = false;
+		bvhKernels::nearest(bvh.nodes(), point, best, [&](const BvhNode& leaf, float& bestSoFar) {
+			const TrianglePacket& packet = packets[leaf.index / PacketLanes];
+			for (uint32_t lane = 0; lane < leaf.count; ++lane) {
+				Vec<3, float> a, ab, ac;
+				corners(packet, lane, a, ab, ac);
+				const Vec<3, float> p = a + intersectKernels::closestPoint(point, a, ab, ac);
+				const float d = lengthSquared(p - point);
+				if (d < bestSoFar) {
+					bestSoFar = d;
+					found = true;
+					out = { p, d, bvh.leafItems[leaf.index + lane] };
+				}
+			}
+		});
+		return found;
+	}
+
+	template<class F>
+	void overlapping(const Aabb<float>& box, F&& f) const {
+		bvhKernels::overlapping(bvh.nodes(), box, [&](const BvhNode& leaf) {
+			const TrianglePacket& packet = packets[leaf.index / PacketLanes];
+			for (uint32_t lane = 0; lane < leaf.count; ++lane) {
+				Vec<3, float> a, ab, ac;
+				corners(packet, lane, a, ab, ac);
+				Aabb<float> bounds;
+				bounds.grow(a).grow(a + ab).grow(a + ac);
+				if (bounds.overlaps(box)) {
+					f(static_cast<size_t>(bvh.leafItems[leaf.index + lane]));
+				}
+			}
+		});
+	}
+
+private:
+	static void corners(const TrianglePacket& packet, size_t lane, Vec<3, float>& a, Vec<3, float>& ab, Vec<3, float>& ac) {
+		for (size_t k = 0; k < 3; ++k) {
+			a[k] = packet.corner[k][lane];
+			ab[k] = packet.edge1[k][lane];
+			ac[k] = packet.edge2[k][lane];
+		}
+	}
+
+	template<class Corner>
+	void build(ThreadPool* pool, size_t count, Corner&& corner) {
+		std::vector<Aabb<float>> boxes(count);
+		auto bound = [&](size_t begin, size_t end) {
+			for (size_t t = begin; t < end; ++t) {
+				boxes[t].grow(corner(t, 0)).grow(corner(t, 1)).grow(corner(t, 2));
+			}
+		};
+		auto pack = [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				const BvhNode& node = bvh.treeNodes[i];
+				for (uint32_t lane = 0; node.leaf() && lane < node.count; ++lane) {
+					const size_t t = bvh.leafItems[node.index + lane];
+					packets[node.index / PacketLanes].set(lane, corner(t, 0), corner(t, 1), corner(t, 2));
+				}
+			}
+		};
+		if (pool) {
+			parallelFor(*pool, count, bvhKernels::TaskItems, bound);
+		}
+		else {
+			bound(0, count);
+		}
+		bvh = Bvh(pool, boxes, PacketLanes, PacketLanes);
+		packets.assign(bvh.leafItems.size() / PacketLanes, TrianglePacket{});
+		if (pool) {
+			parallelFor(*pool, bvh.treeNodes.size(), bvhKernels::TaskItems, pack);
+		}
+		else {
+			pack(0, bvh.treeNodes.size());
+		}
+	}
+
+	Bvh bvh;
+	std::vector<TrianglePacket> packets;
+};
+
+}
@@ -0,0 +1,319 @@
+#pragma once
+
+#include "math3d.h"
+#include "vecArray.h"
+
+#include <type_traits>
+#include <utility>
+
+/*
+* Expression Templates
+* The operators in math3d.h are eager, so a + b * s - c / t builds three temporary
+* Vecs. Wrapping an operand with math3d::expr::lazy makes +, -, unary -, scalar * and
+* scalar / build an expression tree instead, which is evaluated in one pass with one
+* fused expression per component when it is converted to a Matrix (or passed to eval),
+* or when it is assigned into a VecArray with assign.
+*
+*	using math3d::expr::lazy;
+*	Vec3f r = lazy(a) + lazy(b) * s - lazy(c) / t;
+*	math3d::expr::assign(positions, lazy(positions) + lazy(velocities) * dt);
+*
+* Matrices and VecArrays combined with an expression are wrapped automatically.
+* Expressions hold references to their operands, so like any view they must be
+* evaluated before the operands go away. Don't keep them in auto variables past
+* the end of the statement that made them.
+*
+* Element types follow the eager operators: sums have the type of T{} + U{}, and
+* scalar products and quotients keep the element type of the matrix.
+*/
+namespace math3d::expr {
+
+template<class Derived>
+struct Expression;
+
+template<class T>
+inline constexpr bool IsExpression = std::is_base_of_v<Expression<T>, T>;
+
+template<size_t Row, size_t Col, class E>
+constexpr auto elementOf(const E& e, size_t i) {
+	return e.template at<Row, Col>(i);
+}
+
+/*
+* Evaluation
+*/
+template<class T, class E, size_t Row, size_t... Col>
+constexpr Matrix<E::Rows, E::Cols, T>::RowType evalRow(const E& e, std::index_sequence<Col...>) {
+	if constexpr (E::Cols == 1) {
+		return static_cast<T>(elementOf<Row, 0>(e, 0));
+	}
+	else {
+		return { static_cast<T>(elementOf<Row, Col>(e, 0))... };
+	}
+}
+
+template<class T, class E, size_t... Row>
+constexpr Matrix<E::Rows, E::Cols, T> evalRows(const E& e, std::index_sequence<Row...>) {
+	return { evalRow<T, E, Row>(e, std::make_index_sequence<E::Cols>{})... };
+}
+
+/*
+* CRTP base of every expression node
+* Derived provides Rows, Cols, value_type, size() and at<Row, Col>(i), where i is the
+* element index for VecArray operands and ignored by everything else.
+* An expression converts to any Matrix of its shape, casting each element.
+*/
+template<class Derived>
+struct Expression {
+	template<size_t Rows, size_t Cols, class T>
+	constexpr operator Matrix<Rows, Cols, T>() const {
+		static_assert(Rows == Derived::Rows && Cols == Derived::Cols, "expression has a different shape");
+		return evalRows<T>(static_cast<const Derived&>(*this), std::make_index_sequence<Rows>{});
+	}
+};
+
+template<class E>
+constexpr Matrix<E::Rows, E::Cols, typename E::value_type> eval(const Expression<E>& e) {
+	return e;
+}
+
+/*
+* Leaves
+*/
+template<size_t RowCount, size_t ColCount, class T>
+struct MatrixOperand : Expression<MatrixOperand<RowCount, ColCount, T>> {
+	static constexpr size_t Rows = RowCount;
+	static constexpr size_t Cols = ColCount;
+	using value_type = T;
+
+	const Matrix<Rows, Cols, T>& m;
+
+	constexpr explicit MatrixOperand(const Matrix<Rows, Cols, T>& m) : m(m) {
+	}
+
+	constexpr size_t size() const {
+		return 0;
+	}
+
+	template<size_t Row, size_t Col>
+	constexpr T at(size_t) const {
+		return element<Row, Col>(m);
+	}
+};
+
+template<size_t Dim, class T>
+struct ArrayOperand : Expression<ArrayOperand<Dim, T>> {
+	static constexpr size_t Rows = Dim;
+	static constexpr size_t Cols = 1;
+	using value_type = T;
+
+	const VecArray<Dim, T>& array;
+
+	explicit ArrayOperand(const VecArray<Dim, T>& array) : array(array) {
+	}
+
+	size_t size() const {
+		return array.size();
+	}
+
+	template<size_t Row, size_t Col>
+	T at(size_t i) const {
+		return array.component(Row)[i];
+	}
+};
+
+/*
+* Interior nodes
+*/
+struct Add {
+	template<class T, class U>
+	static constexpr auto apply(T t, U u) {
+		return t + u;
+	}
+};
+
+struct Subtract {
+	template<class T, class U>
+	static constexpr auto apply(T t, U u) {
+		return t - u;
+	}
+};
+
+template<class Op, class L, class R>
+struct Binary : Expression<Binary<Op, L, R>> {
+	static_assert(L::Rows == R::Rows && L::Cols == R::Cols, "operands must have the same shape");
+	static constexpr size_t Rows = L::Rows;
+	static constexpr size_t Cols = L::Cols;
+	using value_type = decltype(Op::apply(typename L::value_type{}, typename R::value_type{}));
+
+	L l;
+	R r;
+
+	constexpr Binary(const L& l, const R& r) : l(l), r(r) {
+	}
+
+	constexpr size_t size() const {
+		return l.size() > r.size() ? l.size() : r.size();
+	}
+
+	template<size_t Row, size_t Col>
+	constexpr value_type at(size_t i) const {
+		return Op::apply(l.template at<Row, Col>(i), r.template at<Row, Col>(i));
+	}
+};
+
+struct ScalarMultiply {
+	template<class T, class S>
+	static constexpr T apply(T t, S s) {
+		return static_cast<T>(t * s);
+	}
+};
+
+struct ScalarDivide {
+	template<class T, class S>
+	static constexpr T apply(T t, S s) {
+		return static_cast<T>(t / s);
+	}
+};
+
+template<class Op, class E, class S>
+struct Scaled : Expression<Scaled<Op, E, S>> {
+	static constexpr size_t Rows = E::Rows;
+	static constexpr size_t Cols = E::Cols;
+	using value_type = E::value_type;
+
+	E e;
+	S s;
+
+	constexpr Scaled(const E& e, S s) : e(e), s(s) {
+	}
+
+	constexpr size_t size() const {
+		return e.size();
+	}
+
+	template<size_t Row, size_t Col>
+	constexpr value_type at(size_t i) const {
+		return Op::apply(e.template at<Row, Col>(i), s);
+	}
+};
+
+template<class E>
+struct Negate : Expression<Negate<E>> {
+	static constexpr size_t Rows = E::Rows;
+	static constexpr size_t Cols = E::Cols;
+	using value_type = E::value_type;
+
+	E e;
+
+	constexpr explicit Negate(const E& e) : e(e) {
+	}
+
+	constexpr size_t size() const {
+		return e.size();
+	}
+
+	template<size_t Row, size_t Col>
+	constexpr value_type at(size_t i) const {
+		return static_cast<value_type>(-e.template at<Row, Col>(i));
+	}
+};
+
+/*
+* Wrapping operands
+*/
+template<size_t Rows, size_t Cols, class T>
+constexpr MatrixOperand<Rows, Cols, T> lazy(const Matrix<Rows, Cols, T>& m) {
+	return MatrixOperand<Rows, Cols, T>(m);
+}
+
+template<size_t Dim, class T>
+ArrayOperand<Dim, T> lazy(const VecArray<Dim, T>& a) {
+	return ArrayOperand<Dim, T>(a);
+}
+
+template<class E>
+constexpr const E& lazy(const Expression<E>& e) {
+	return static_cast<const E&>(e);
+}
+
+template<class T>
+inline constexpr bool IsArray = false;
+
+template<size_t Dim, class T>
+inline constexpr bool IsArray<VecArray<Dim, T>> = true;
+
+template<class T>
+inline constexpr bool IsOperand = IsExpression<T> || IsMatrix<T> || IsArray<T>;
+
+template<class T>
+using OperandType = std::remove_cvref_t<decltype(lazy(std::declval<const T&>()))>;
+
+template<class T>
+inline constexpr bool IsScalar = std::is_arithmetic_v<T>;
+
+/*
+* Operators
+* At least one operand must already be an expression, so these never change the
+* meaning of the eager operators on Matrix and VecArray
+*/
+template<class L, class R> requires ((IsExpression<L> || IsExpression<R>) && IsOperand<L> && IsOperand<R>)
+constexpr Binary<Add, OperandType<L>, OperandType<R>> operator+(const L& l, const R& r) {
+	return { lazy(l), lazy(r) };
+}
+
+template<class L, class R> requires ((IsExpression<L> || IsExpression<R>) && IsOperand<L> && IsOperand<R>)
+constexpr Binary<Subtract, OperandType<L>, OperandType<R>> operator-(const L& l, const R& r) {
+	return { lazy(l), lazy(r) };
+}
+
+template<class E, class S> requires (IsExpression<E> && IsScalar<S>)
+constexpr Scaled<ScalarMultiply, E, S> operator*(const E& e, S s) {
+	return { e, s };
+}
+
+template<class E, class S> requires (IsExpression<E> && IsScalar<S>)
+constexpr Scaled<ScalarMultiply, E, S> operator*(S s, const E& e) {
+	return { e, s };
+}
+
+template<class E, class S> requires (IsExpression<E> && IsScalar<S>)
+constexpr Scaled<ScalarDivide, E, S> operator/(const E& e, S s) {
+	return { e, s };
+}
+
+template<class E> requires IsExpression<E>
+constexpr Negate<E> operator-(const E& e) {
+	return Negate<E>(e);
+}
+
+/*
+* Bulk evaluation into a VecArray
+* Every component stream of dst is written by one loop that evaluates the whole
+* expression per element, so no intermediate arrays are built. Matrix operands are
+* broadcast to every element. dst is resized to the size of the VecArray operands,
+* which must all have the same size, and may itself be one of the operands. An
+* expression without VecArray operands is broadcast to all of dst.
+*/
+template<size_t Dim, class T, class E, size_t... C>
+void assignComponents(VecArray<Dim, T>& dst, const E& e, std::index_sequence<C...>) {
+	const size_t n = dst.size();
+	([&] {
+		T* out = dst.component(C);
+		for (size_t i = 0; i < n; ++i) {
+			out[i] = static_cast<T>(e.template at<C, 0>(i));
+		}
+	}(), ...);
+}
+
+template<size_t Dim, class T, class E>
+void assign(VecArray<Dim, T>& dst, const Expression<E>& expression) {
+	const E& e = static_cast<const E&>(expression);
+	static_assert(E::Rows == Dim && E::Cols == 1, "expression must be a Vec<Dim>");
+	if (e.size() != 0 && dst.size() != e.size()) {
+		dst.resize(e.size());
+	}
+	assignComponents(dst, e, std::make_index_sequence<Dim>{});
+}
+
+}
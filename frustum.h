@@ -0,0 +1,366 @@
+#pragma once
+
+#include "math3d.h"
+#include "parallel.h"
+#include "reduce.h"
+#include "simd.h"
+#include "vecArray.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace math3d {
+
+/*
+* Planes and Frustums
+* A plane is a Vec<4, T> (a, b, c, d), the points p with a p.x + b p.y + c p.z + d >= 0
+* are on its inner side. A plane set, e.g. the six planes of a view frustum or the
+* planes of a portal, contains the points on the inner side of all of its planes.
+*
+* frustumPlanes extracts the left, right, bottom, top, near and far planes of the
+* frustum of a view projection matrix m, which maps a world point p to the clip
+* coordinates m * (p, 1), with -w <= x, y <= w, and -w <= z <= w for
+* DepthRange::NegativeOneToOne (OpenGL) or 0 <= z <= w for DepthRange::ZeroToOne
+* (Direct3D, Vulkan, Metal). The planes are normalized, (a, b, c) is a unit vector,
+* so a p.x + b p.y + c p.z + d is the distance of p from the plane.
+*/
+enum class DepthRange {
+	NegativeOneToOne,
+	ZeroToOne
+};
+
+template<class T>
+std::array<Vec<4, T>, 6> frustumPlanes(const Matrix<4, 4, T>& m, DepthRange depth = DepthRange::NegativeOneToOne) {
+	std::array<Vec<4, T>, 6> planes = {
+		m.w + m.x,
+		m.w - m.x,
+		m.w + m.y,
+		m.w - m.y,
+		depth == DepthRange::ZeroToOne ? m.z : m.w + m.z,
+		m.w - m.z
+	};
+	for (Vec<4, T>& p : planes) {
+		p = p / std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+	}
+	return planes;
+}
+
+namespace cullKernels {
+	using namespace simd;
+
+	/*
+	* Culling
+	* A sphere is outside of a plane set when its center is further than its radius
+	* behind one of the planes, which needs normalized planes. A box is outside when all
+	* of its corners are behind one plane, its center c and half extent e are behind by
+	* more than the projection of e onto the plane normal:
+	*	dot(n, c) + d + |n.x| e.x + |n.y| e.y + |n.z| e.z < 0
+	* which holds for planes of any scale. Both tests are conservative, objects near
+	* the edges of a frustum may be kept although they are outside of it, never the
+	* other way around. NaN distances do not cull, so objects with NaN are kept.
+	*
+	* The float kernels test 8 objects per f32x8 from the SoA streams, keeping the
+	* smallest of the distances over the planes, and a negative smallest distance culls.
+	* Distances are summed in the same order as the single object tests, so results
+	* match them unless FMA contraction is enabled.
+	*/
+	inline constexpr size_t Lanes = 8;
+
+	//Keeps the smaller of distance and least, least when distance is NaN
+	template<class T>
+	T least(T distance, T least) {
+		return distance < least ? distance : least;
+	}
+
+	template<class T>
+	T sphereDistance(const Vec<4, T>& plane, const Vec<3, T>& center, T radius) {
+		return plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w + radius;
+	}
+
+	template<class T>
+	T boxDistance(const Vec<4, T>& plane, const Vec<3, T>& center, const Vec<3, T>& half) {
+		return plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w
+			+ (std::abs(plane.x) * half.x + std::abs(plane.y) * half.y + std::abs(plane.z) * half.z);
+	}
+
+	template<class T>
+	Vec<3, T> boxCenter(const Vec<3, T>& lower, const Vec<3, T>& upper) {
+		return { (lower.x + upper.x) * T(0.5), (lower.y + upper.y) * T(0.5), (lower.z + upper.z) * T(0.5) };
+	}
+
+	template<class T>
+	Vec<3, T> boxHalf(const Vec<3, T>& lower, const Vec<3, T>& upper) {
+		return { (upper.x - lower.x) * T(0.5), (upper.y - lower.y) * T(0.5), (upper.z - lower.z) * T(0.5) };
+	}
+
+	template<class T>
+	bool sphereVisible(std::span<const Vec<4, T>> planes, const Vec<3, T>& center, T radius) {
+		T smallest = std::numeric_limits<T>::infinity();
+		for (const Vec<4, T>& plane : planes) {
+			smallest = least(sphereDistance(plane, center, radius), smallest);
+		}
+		return !(smallest < 0);
+	}
+
+	template<class T>
+	bool boxVisible(std::span<const Vec<4, T>> planes, const Vec<3, T>& lower, const Vec<3, T>& upper) {
+		const Vec<3, T> center = boxCenter(lower, upper);
+		const Vec<3, T> half = boxHalf(lower, upper);
+		T smallest = std::numeric_limits<T>::infinity();
+		for (const Vec<4, T>& plane : planes) {
+			smallest = least(boxDistance(plane, center, half), smallest);
+		}
+		return !(smallest < 0);
+	}
+
+	struct Plane8 {
+		f32x8 a, b, c, d;
+		f32x8 absA, absB, absC;
+	};
+
+	inline std::vector<Plane8> splatPlanes(std::span<const Vec<4, float>> planes) {
+		std::vector<Plane8> out(planes.size());
+		for (size_t i = 0; i < planes.size(); ++i) {
+			const Vec<4, float>& p = planes[i];
+			out[i] = { splat8(p.x), splat8(p.y), splat8(p.z), splat8(p.w), splat8(std::abs(p.x)), splat8(std::abs(p.y)), splat8(std::abs(p.z)) };
+		}
+		return out;
+	}
+
+	//8 streams of 8 floats from index i, from a local copy past the end of the shortest stream
+	template<size_t N>
+	void load(const float* const (&streams)[N], size_t i, size_t count, f32x8 (&out)[N]) {
+		if (i + Lanes <= count) {
+			for (size_t s = 0; s < N; ++s) {
+				out[s] = loadu8(streams[s] + i);
+			}
+			return;
+		}
+		for (size_t s = 0; s < N; ++s) {
+			float lanes[Lanes] = {};
+			std::copy(streams[s] + i, streams[s] + count, lanes);
+			out[s] = loadu8(lanes);
+		}
+	}
+
+	//Lanes with a smallest distance of at least 0, -0 + 0 is +0 so that it is kept like by smallest < 0
+	inline unsigned visibleLanes(f32x8 smallest) {
+		return ~static_cast<unsigned>(signMask(add(smallest, splat8(0.0f)))) & 0xff;
+	}
+
+	//The visible lanes of the 8 spheres from i, bit l for sphere i + l
+	inline unsigned spheres8(std::span<const Plane8> planes, const float* const (&streams)[4], size_t i, size_t count) {
+		f32x8 s[4];
+		load(streams, i, count, s);
+		f32x8 smallest = splat8(std::numeric_limits<float>::infinity());
+		for (const Plane8& p : planes) {
+			const f32x8 distance = add(add(madd(s[2], p.c, madd(s[1], p.b, mul(s[0], p.a))), p.d), s[3]);
+			smallest = min(distance, smallest);
+		}
+		return visibleLanes(smallest);
+	}
+
+	inline unsigned boxes8(std::span<const Plane8> planes, const float* const (&streams)[6], size_t i, size_t count) {
+		f32x8 s[6];
+		load(streams, i, count, s);
+		const f32x8 half = splat8(0.5f);
+		const f32x8 cx = mul(add(s[0], s[3]), half);
+		const f32x8 cy = mul(add(s[1], s[4]), half);
+		const f32x8 cz = mul(add(s[2], s[5]), half);
+		const f32x8 ex = mul(sub(s[3], s[0]), half);
+		const f32x8 ey = mul(sub(s[4], s[1]), half);
+		const f32x8 ez = mul(sub(s[5], s[2]), half);
+		f32x8 smallest = splat8(std::numeric_limits<float>::infinity());
+		for (const Plane8& p : planes) {
+			const f32x8 distance = add(madd(cz, p.c, madd(cy, p.b, mul(cx, p.a))), p.d);
+			const f32x8 radius = madd(ez, p.absC, madd(ey, p.absB, mul(ex, p.absA)));
+			smallest = min(add(distance, radius), smallest);
+		}
+		return visibleLanes(smallest);
+	}
+
+	/*
+	* Writes the visibility bits of [begin, end) to out, begin a multiple of 64, and
+	* returns the number of visible objects. visible(i) is the 8 bits of objects i to
+	* i + 7, or the bit of object i alone.
+	*/
+	template<class Visible>
+	size_t mask(size_t begin, size_t end, size_t step, Visible&& visible, uint64_t* out) {
+		size_t count = 0;
+		for (size_t word = begin; word < end; word += 64) {
+			uint64_t bits = 0;
+			for (size_t i = word; i < std::min(word + 64, end); i += step) {
+				bits |= static_cast<uint64_t>(visible(i)) << (i - word);
+			}
+			if (end - word < 64) {
+				bits &= (uint64_t(1) << (end - word)) - 1;
+			}
+			out[(word - begin) / 64] = bits;
+			count += std::popcount(bits);
+		}
+		return count;
+	}
+
+	//The visible objects as indices, 64 objects at a time, or on a pool from a mask and the visible counts of its chunks
+	template<class Visible>
+	size_t indices(ThreadPool* pool, size_t count, size_t step, Visible&& visible, uint32_t* out) {
+		if (!pool) {
+			size_t n = 0;
+			for (size_t word = 0; word < count; word += 64) {
+				uint64_t bits;
+				mask(word, std::min(word + 64, count), step, visible, &bits);
+				for (; bits; bits &= bits - 1) {
+					out[n++] = static_cast<uint32_t>(word + std::countr_zero(bits));
+				}
+			}
+			return n;
+		}
+		const size_t grain = chunkItems(32);
+		std::vector<uint64_t> bits((count + 63) / 64);
+		std::vector<size_t> offsets((count + grain - 1) / grain + 1);
+		parallelFor(*pool, count, grain, [&](size_t begin, size_t end) {
+			offsets[begin / grain + 1] = mask(begin, end, step, visible, bits.data() + begin / 64);
+		});
+		for (size_t c = 1; c < offsets.size(); ++c) {
+			offsets[c] += offsets[c - 1];
+		}
+		parallelFor(*pool, count, grain, [&](size_t begin, size_t end) {
+			uint32_t* next = out + offsets[begin / grain];
+			for (size_t word = begin / 64; word < (end + 63) / 64; ++word) {
+				for (uint64_t b = bits[word]; b; b &= b - 1) {
+					*next++ = static_cast<uint32_t>(word * 64 + std::countr_zero(b));
+				}
+			}
+		});
+		return offsets.back();
+	}
+
+	inline void checkCount(size_t count) {
+		if (count > std::numeric_limits<uint32_t>::max()) {
+			throw std::invalid_argument("math3d: culling indexes at most 2^32 objects");
+		}
+	}
+
+	template<class T, class F>
+	size_t spheres(ThreadPool* pool, std::span<const Vec<4, T>> planes, const VecArray<3, T>& centers, std::span<const T> radii, F&& output) {
+		checkCount(centers.size());
+		if constexpr (std::is_same_v<T, float>) {
+			const std::vector<Plane8> splat = splatPlanes(planes);
+			const float* const streams[4] = { centers.x(), centers.y(), centers.z(), radii.data() };
+			return output(pool, centers.size(), Lanes, [&](size_t i) { return spheres8(splat, streams, i, centers.size()); });
+		}
+		else {
+			return output(pool, centers.size(), 1, [&](size_t i) { return sphereVisible(planes, centers.get(i), radii[i]) ? 1u : 0u; });
+		}
+	}
+
+	template<class T, class F>
+	size_t boxes(ThreadPool* pool, std::span<const Vec<4, T>> planes, const VecArray<3, T>& lower, const VecArray<3, T>& upper, F&& output) {
+		checkCount(lower.size());
+		if constexpr (std::is_same_v<T, float>) {
+			const std::vector<Plane8> splat = splatPlanes(planes);
+			const float* const streams[6] = { lower.x(), lower.y(), lower.z(), upper.x(), upper.y(), upper.z() };
+			return output(pool, lower.size(), Lanes, [&](size_t i) { return boxes8(splat, streams, i, lower.size()); });
+		}
+		else {
+			return output(pool, lower.size(), 1, [&](size_t i) { return boxVisible(planes, lower.get(i), upper.get(i)) ? 1u : 0u; });
+		}
+	}
+
+	struct ToIndices {
+		uint32_t* out;
+
+		template<class Visible>
+		size_t operator()(ThreadPool* pool, size_t count, size_t step, Visible&& visible) const {
+			return indices(pool, count, step, visible, out);
+		}
+	};
+
+	struct ToMask {
+		uint64_t* out;
+
+		template<class Visible>
+		size_t operator()(ThreadPool* pool, size_t count, size_t step, Visible&& visible) const {
+			if (!pool) {
+				return mask(0, count, step, visible, out);
+			}
+			return parallelReduce(*pool, count, chunkItems(32), size_t(0),
+				[&](size_t begin, size_t end) { return mask(begin, end, step, visible, out + begin / 64); },
+				[](size_t a, size_t b) { return a + b; });
+		}
+	};
+}
+
+}
+
+/*
+* Visibility of Spheres and Boxes
+* isVisible tests a single sphere (center, radius) or box against a plane set, see
+* math3d::cullKernels for the tests. The batched functions test SoA arrays of spheres,
+* the centers with the radii in a span of the same size, or of boxes, their lower
+* and upper corners, and write the visible ones
+*	as indices, in ascending order, to visible, which must hold as many indices as
+*		there are objects, e.g. to draw them or gather their data,
+*	or as bits to mask, bit i % 64 of mask[i / 64] for object i, which must hold
+*		(count + 63) / 64 words, the bits past the last object cleared,
+* and return the number of visible objects. Float objects are tested 8 at a time.
+* Spheres need normalized planes, like those of math3d::frustumPlanes.
+*/
+template<class T>
+bool isVisible(std::span<const math3d::Vec<4, T>> planes, const math3d::Vec<3, T>& center, T radius) {
+	return math3d::cullKernels::sphereVisible(planes, center, radius);
+}
+
+template<class T>
+bool isVisible(std::span<const math3d::Vec<4, T>> planes, const math3d::Aabb<T>& box) {
+	return math3d::cullKernels::boxVisible(planes, box.lower, box.upper);
+}
+
+template<class T>
+size_t cullSpheres(std::span<const math3d::Vec<4, T>> planes, const math3d::VecArray<3, T>& centers, std::span<const T> radii, std::span<uint32_t> visible) {
+	return math3d::cullKernels::spheres(nullptr, planes, centers, radii, math3d::cullKernels::ToIndices{ visible.data() });
+}
+
+template<class T>
+size_t cullSpheres(math3d::ThreadPool& pool, std::span<const math3d::Vec<4, T>> planes, const math3d::VecArray<3, T>& centers, std::span<const T> radii, std::span<uint32_t> visible) {
+	return math3d::cullKernels::spheres(&pool, planes, centers, radii, math3d::cullKernels::ToIndices{ visible.data() });
+}
+
+template<class T>
+size_t cullSpheresMask(std::span<const math3d::Vec<4, T>> planes, const math3d::VecArray<3, T>& centers, std::span<const T> radii, std::span<uint64_t> mask) {
+	return math3d::cullKernels::spheres(nullptr, planes, centers, radii, math3d::cullKernels::ToMask{ mask.data() });
+}
+
+template<class T>
+size_t cullSpheresMask(math3d::ThreadPool& pool, std::span<const math3d::Vec<4, T>> planes, const math3d::VecArray<3, T>& centers, std::span<const T> radii, std::span<uint64_t> mask) {
+	return math3d::cullKernels::spheres(&pool, planes, centers, radii, math3d::cullKernels::ToMask{ mask.data() });
+}
+
+template<class T>
+size_t cullBoxes(std::span<const math3d::Vec<4, T>> planes, const math3d::VecArray<3, T>& lower, const math3d::VecArray<3, T>& upper, std::span<uint32_t> visible) {
+	return math3d::cullKernels::boxes(nullptr, planes, lower, upper, math3d::cullKernels::ToIndices{ visible.data() });
+}
+
+template<class T>
+size_t cullBoxes(math3d::ThreadPool& pool, std::span<const math3d::Vec<4, T>> planes, const math3d::VecArray<3, T>& lower, const math3d::VecArray<3, T>& upper, std::span<uint32_t> visible) {
+	return math3d::cullKernels::boxes(&pool, planes, lower, upper, math3d::cullKernels::ToIndices{ visible.data() });
+}
+
+template<class T>
+size_t cullBoxesMask(std::span<const math3d::Vec<4, T>> planes, const math3d::VecArray<3, T>& lower, const math3d::VecArray<3, T>& upper, std::span<uint64_t> mask) {
+	return math3d::cullKernels::boxes(nullptr, planes, lower, upper, math3d::cullKernels::ToMask{ mask.data() });
+}
+
+template<class T>
+size_t cullBoxesMask(math3d::ThreadPool& pool, std::span<const math3d::Vec<4, T>> planes, const math3d::VecArray<3, T>& lower, const math3d::VecArray<3, T>& upper, std::span<uint64_t> mask) {
+	return math3d::cullKernels::boxes(&pool, planes, lower, upper, math3d::cullKernels::ToMask{ mask.data() });
+}
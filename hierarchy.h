@@ -0,0 +1,245 @@
+#pragma once
+
+#include "math3d.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace math3d {
+
+/*
+* Transform Hierarchy
+* A forest of nodes, each with a local transform relative to its parent, and a world
+* transform, parentWorld * local, or local for a root. Nodes are the indices of the
+* parents the hierarchy was built from, parents[i] the parent of node i or NoParent.
+*
+* The nodes are stored breadth first, roots first, then their children, then theirs,
+* each level one after the other, so a parent is always stored before its children.
+* update() recomputes the world transforms in one sweep in that order, from the
+* first node whose local transform was set since the last update: a node is
+* recomputed when its local transform was set or its parent's world transform was
+* recomputed, all other nodes keep theirs and cost one flag test. With a pool the
+* sweep runs level by level, the nodes of large levels on every thread. Either way
+* every world transform is computed by the same products, so the results are the
+* same bits as multiplying down the chain of parents.
+*
+* world() and worlds() are the world transforms as of the last update.
+*/
+template<class T>
+class TransformHierarchy {
+public:
+	static constexpr uint32_t NoParent = std::numeric_limits<uint32_t>::max();
+	using Transform = Matrix<4, 4, T>;
+
+	TransformHierarchy() = default;
+
+	//Throws when parents and locals differ in size, a parent is not a node or the parents form a cycle
+	TransformHierarchy(std::span<const uint32_t> parents, std::span<const Transform> locals) {
+		build(parents, locals);
+		update();
+	}
+
+	TransformHierarchy(ThreadPool& pool, std::span<const uint32_t> parents, std::span<const Transform> locals) {
+		build(parents, locals);
+		update(pool);
+	}
+
+	size_t size() const {
+		return order.size();
+	}
+
+	bool empty() const {
+		return order.empty();
+	}
+
+	//The number of levels, 1 for roots alone
+	size_t levels() const {
+		return levelStarts.empty() ? 0 : levelStarts.size() - 1;
+	}
+
+	uint32_t parent(uint32_t node) const {
+		const uint32_t p = parentSlots[slots[node]];
+		return p == NoParent ? NoParent : order[p];
+	}
+
+	const Transform& local(uint32_t node) const {
+		return locals[slots[node]];
+	}
+
+	const Transform& world(uint32_t node) const {
+		return worldTransforms[slots[node]];
+	}
+
+	//Marks the node, and so its subtree, for the next update
+	void setLocal(uint32_t node, const Transform& local) {
+		const uint32_t s = slots[node];
+		locals[s] = local;
+		dirty[s] = 1;
+		firstDirty = std::min<size_t>(firstDirty, s);
+	}
+
+	bool needsUpdate() const {
+		return firstDirty < size();
+	}
+
+	//The nodes in storage order, breadth first
+	std::span<const uint32_t> nodes() const {
+		return order;
+	}
+
+	//The world transforms in storage order, worlds()[i] of node nodes()[i]
+	std::span<const Transform> worlds() const {
+		return worldTransforms;
+	}
+
+	//Recomputes the world transforms of the changed subtrees, returns how many it recomputed
+	size_t update() {
+		size_t count = 0;
+		for (size_t s = firstDirty; s < size(); ++s) {
+			count += refresh(s);
+		}
+		clean();
+		return count;
+	}
+
+	size_t update(ThreadPool& pool) {
+		constexpr size_t Grain = chunkItems(2 * sizeof(Transform));
+		size_t count = 0;
+		for (size_t level = 0; level < levels(); ++level) {
+			const size_t begin = std::max(levelStarts[level], firstDirty);
+			const size_t end = levelStarts[level + 1];
+			if (begin >= end) {
+				continue;
+			}
+			auto sweep = [&](size_t first, size_t last) {
+				size_t n = 0;
+				for (size_t s = first; s < last; ++s) {
+					n += refresh(s);
+				}
+				return n;
+			};
+			if (end - begin <= Grain) {
+				count += sweep(begin, end);
+			}
+			else {
+				count += parallelReduce(pool, end - begin, Grain, size_t(0),
+					[&](size_t first, size_t last) { return sweep(begin + first, begin + last); },
+					[](size_t a, size_t b) { return a + b; });
+			}
+		}
+		clean();
+		return count;
+	}
+
+private:
+	void build(std::span<const uint32_t> parents, std::span<const Transform> nodeLocals) {
+		const size_t n = parents.size();
+		if (nodeLocals.size() != n) {
+			throw std::invalid_argument("math3d: a TransformHierarchy needs one local transform per node");
+		}
+		if (n >= NoParent) {
+			throw std::invalid_argument("math3d: a TransformHierarchy holds fewer than 2^32 - 1 nodes");
+		}
+		//the children of every node, in node order, as ranges of one array
+		std::vector<uint32_t> firstChild(n + 1, 0);
+		for (uint32_t p : parents) {
+			if (p != NoParent) {
+				if (p >= n) {
+					throw std::invalid_argument("math3d: a TransformHierarchy parent must be a node");
+				}
+				++firstChild[p + 1];
+			}
+		}
+		for (size_t i = 0; i < n; ++i) {
+			firstChild[i + 1] += firstChild[i];
+		}
+		std::vector<uint32_t> children(firstChild[n]);
+		std::vector<uint32_t> next(firstChild.begin(), firstChild.end() - 1);
+		for (size_t i = 0; i < n; ++i) {
+			if (parents[i] != NoParent) {
+				children[next[parents[i]]++] = static_cast<uint32_t>(i);
+			}
+		}
+
+		//breadth first from the roots, nodes on a cycle are never reached
+		order.clear();
+		order.reserve(n);
+		for (size_t i = 0; i < n; ++i) {
+			if (parents[i] == NoParent) {
+				order.push_back(static_cast<uint32_t>(i));
+			}
+		}
+		levelStarts.assign(1, 0);
+		size_t levelEnd = order.size();
+		for (size_t s = 0; s < order.size(); ++s) {
+			if (s == levelEnd) {
+				levelStarts.push_back(s);
+				levelEnd = order.size();
+			}
+			const uint32_t node = order[s];
+			order.insert(order.end(), children.begin() + firstChild[node], children.begin() + firstChild[node + 1]);
+		}
+		if (order.size() != n) {
+			throw std::invalid_argument("math3d: TransformHierarchy parents must not form a cycle");
+		}
+		levelStarts.push_back(n);
+		if (n == 0) {
+			levelStarts.clear();
+		}
+
+		slots.resize(n);
+		parentSlots.resize(n);
+		locals.resize(n);
+		for (size_t s = 0; s < n; ++s) {
+			slots[order[s]] = static_cast<uint32_t>(s);
+			locals[s] = nodeLocals[order[s]];
+		}
+		for (size_t s = 0; s < n; ++s) {
+			const uint32_t p = parents[order[s]];
+			parentSlots[s] = p == NoParent ? NoParent : slots[p];
+		}
+		worldTransforms.assign(n, Transform{});
+		dirty.assign(n, 1);
+		firstDirty = 0;
+	}
+
+	//Recomputes the world transform of slot s if it or its parent changed, and flags it as changed
+	size_t refresh(size_t s) {
+		const uint32_t p = parentSlots[s];
+		if (p == NoParent) {
+			if (dirty[s]) {
+				worldTransforms[s] = locals[s];
+				return 1;
+			}
+			return 0;
+		}
+		if (dirty[s] | dirty[p]) {
+			worldTransforms[s] = worldTransforms[p] * locals[s];
+			dirty[s] = 1;
+			return 1;
+		}
+		return 0;
+	}
+
+	void clean() {
+		std::fill(dirty.begin() + std::min(firstDirty, size()), dirty.end(), uint8_t(0));
+		firstDirty = size();
+	}
+
+	std::vector<uint32_t> order;
+	std::vector<uint32_t> slots;
+	std::vector<uint32_t> parentSlots;
+	std::vector<size_t> levelStarts;
+	std::vector<Transform> locals;
+	std::vector<Transform> worldTransforms;
+	std::vector<uint8_t> dirty;
+	size_t firstDirty = 0;
+};
+
+}
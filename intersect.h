@@ -0,0 +1,425 @@
+#pragma once
+
+#include "math3d.h"
+#include "reduce.h"
+#include "simd.h"
+
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+namespace math3d {
+
+/*
+* Rays
+* The points origin + t direction for t in [tMin, tMax]. direction does not need to
+* be a unit vector, t is then measured in multiples of its length. Closest hit
+* queries move tMax down to the hits they find.
+*/
+template<class T>
+struct Ray {
+	Vec<3, T> origin;
+	Vec<3, T> direction;
+	T tMin = 0;
+	T tMax = std::numeric_limits<T>::infinity();
+};
+
+/*
+* A ray hits a triangle a, b, c at origin + t direction = (1 - u - v) a + u b + v c.
+* triangle is the index of the triangle for the queries over packets
+*/
+template<class T>
+struct TriangleHit {
+	T t = 0;
+	T u = 0;
+	T v = 0;
+	size_t triangle = 0;
+};
+
+inline constexpr size_t PacketLanes = 8;
+
+//Packets needed for n triangles, boxes or rays
+constexpr size_t packetCount(size_t n) {
+	return (n + PacketLanes - 1) / PacketLanes;
+}
+
+/*
+* SoA Packets
+* 8 triangles, boxes or rays with one stream of 8 floats per component, so the
+* intersection kernels load each component of all 8 with one instruction. The
+* streams are 32 byte aligned. Lanes that were never set are never hit: degenerate
+* triangles, empty boxes and rays with an empty [tMin, tMax].
+*
+* Triangles are stored as their first corner and the two edges from it, which is
+* what the Moller-Trumbore test uses. Rays keep the reciprocal of their direction
+* for the slab test.
+*/
+struct TrianglePacket {
+	alignas(32) float corner[3][PacketLanes] = {};
+	alignas(32) float edge1[3][PacketLanes] = {};
+	alignas(32) float edge2[3][PacketLanes] = {};
+
+	void set(size_t lane, const Vec<3, float>& a, const Vec<3, float>& b, const Vec<3, float>& c) {
+		for (size_t k = 0; k < 3; ++k) {
+			corner[k][lane] = a[k];
+			edge1[k][lane] = b[k] - a[k];
+			edge2[k][lane] = c[k] - a[k];
+		}
+	}
+};
+
+struct BoxPacket {
+	alignas(32) float lower[3][PacketLanes];
+	alignas(32) float upper[3][PacketLanes];
+
+	BoxPacket() {
+		for (size_t k = 0; k < 3; ++k) {
+			for (size_t lane = 0; lane < PacketLanes; ++lane) {
+				lower[k][lane] = Aabb<float>::Infinity;
+				upper[k][lane] = -Aabb<float>::Infinity;
+			}
+		}
+	}
+
+	void set(size_t lane, const Aabb<float>& box) {
+		for (size_t k = 0; k < 3; ++k) {
+			lower[k][lane] = box.lower[k];
+			upper[k][lane] = box.upper[k];
+		}
+	}
+};
+
+struct RayPacket {
+	alignas(32) float origin[3][PacketLanes] = {};
+	alignas(32) float direction[3][PacketLanes] = {};
+	alignas(32) float inverse[3][PacketLanes] = {};
+	alignas(32) float tMin[PacketLanes];
+	alignas(32) float tMax[PacketLanes];
+
+	RayPacket() {
+		for (size_t lane = 0; lane < PacketLanes; ++lane) {
+			tMin[lane] = std::numeric_limits<float>::infinity();
+			tMax[lane] = -std::numeric_limits<float>::infinity();
+		}
+	}
+
+	void set(size_t lane, const Ray<float>& ray) {
+		for (size_t k = 0; k < 3; ++k) {
+			origin[k][lane] = ray.origin[k];
+			direction[k][lane] = ray.direction[k];
+			inverse[k][lane] = 1 / ray.direction[k];
+		}
+		tMin[lane] = ray.tMin;
+		tMax[lane] = ray.tMax;
+	}
+};
+
+//Hits of one ray against the 8 triangles of a packet, valid in the lanes of the returned mask
+struct PacketHits {
+	alignas(32) float t[PacketLanes];
+	alignas(32) float u[PacketLanes];
+	alignas(32) float v[PacketLanes];
+};
+
+/*
+* Intersection kernels
+* The scalar tests are the references for the 8 wide ones: they do the same
+* operations in the same order (no FMA), so a lane of a packet gives the same hit,
+* and the same bits of t, u and v, as the scalar test of its triangle or box.
+*
+* Triangles are hit from both sides, a ray in the plane of a triangle (det == 0)
+* never hits it. Hits on an edge may be reported for both triangles sharing it.
+*
+* Boxes use the slab test with the near and far planes picked by the sign of the
+* direction, so empty boxes are never hit. The entry distance is the larger of
+* tMin and the distance to the box. far starts at most at the largest float, so a
+* ray parallel to a slab and outside it (entering at t = inf) misses. Where a
+* direction component is zero and the origin lies exactly on one of the planes of
+* that slab, 0 * inf is NaN and the slab is ignored.
+*/
+namespace intersectKernels {
+	using namespace simd;
+
+	template<class T>
+	bool triangle(const Ray<T>& ray, const T (&corner)[3], const T (&e1)[3], const T (&e2)[3], TriangleHit<T>& hit) {
+		const Vec<3, T>& d = ray.direction;
+		const T px = d.y * e2[2] - d.z * e2[1];
+		const T py = d.z * e2[0] - d.x * e2[2];
+		const T pz = d.x * e2[1] - d.y * e2[0];
+		const T det = (e1[0] * px + e1[1] * py) + e1[2] * pz;
+		const T inverseDet = 1 / det;
+		const T sx = ray.origin.x - corner[0];
+		const T sy = ray.origin.y - corner[1];
+		const T sz = ray.origin.z - corner[2];
+		const T u = ((sx * px + sy * py) + sz * pz) * inverseDet;
+		const T qx = sy * e1[2] - sz * e1[1];
+		const T qy = sz * e1[0] - sx * e1[2];
+		const T qz = sx * e1[1] - sy * e1[0];
+		const T v = ((d.x * qx + d.y * qy) + d.z * qz) * inverseDet;
+		const T t = ((e2[0] * qx + e2[1] * qy) + e2[2] * qz) * inverseDet;
+		if (det != 0 && 0 <= u && 0 <= v && u + v <= 1 && ray.tMin <= t && t <= ray.tMax) {
+			hit.t = t;
+			hit.u = u;
+			hit.v = v;
+			return true;
+		}
+		return false;
+	}
+
+	//near = max(t, near) and far = min(t, far) as the SSE instructions, which keep near and far when t is NaN
+	template<class T>
+	bool box(const T (&origin)[3], const T (&inverse)[3], const T (&lower)[3], const T (&upper)[3], T tMin, T tMax, T& entry) {
+		T near = tMin;
+		T far = tMax < std::numeric_limits<T>::max() ? tMax : std::numeric_limits<T>::max();
+		for (size_t k = 0; k < 3; ++k) {
+			const bool negative = std::copysign(T(1), inverse[k]) < 0;
+			const T tNear = ((negative ? upper[k] : lower[k]) - origin[k]) * inverse[k];
+			const T tFar = ((negative ? lower[k] : upper[k]) - origin[k]) * inverse[k];
+			near = tNear > near ? tNear : near;
+			far = tFar < far ? tFar : far;
+		}
+		entry = near;
+		return near <= far;
+	}
+
+	inline int triangles8(const Ray<float>& ray, const TrianglePacket& p, PacketHits& hits) {
+		const f32x8 dx = splat8(ray.direction.x);
+		const f32x8 dy = splat8(ray.direction.y);
+		const f32x8 dz = splat8(ray.direction.z);
+		const f32x8 e1x = load8(p.edge1[0]);
+		const f32x8 e1y = load8(p.edge1[1]);
+		const f32x8 e1z = load8(p.edge1[2]);
+		const f32x8 e2x = load8(p.edge2[0]);
+		const f32x8 e2y = load8(p.edge2[1]);
+		const f32x8 e2z = load8(p.edge2[2]);
+		const f32x8 px = sub(mul(dy, e2z), mul(dz, e2y));
+		const f32x8 py = sub(mul(dz, e2x), mul(dx, e2z));
+		const f32x8 pz = sub(mul(dx, e2y), mul(dy, e2x));
+		const f32x8 det = add(add(mul(e1x, px), mul(e1y, py)), mul(e1z, pz));
+		const f32x8 zero = splat8(0);
+		const f32x8 inverseDet = div(splat8(1), det);
+		const f32x8 sx = sub(splat8(ray.origin.x), load8(p.corner[0]));
+		const f32x8 sy = sub(splat8(ray.origin.y), load8(p.corner[1]));
+		const f32x8 sz = sub(splat8(ray.origin.z), load8(p.corner[2]));
+		const f32x8 u = mul(add(add(mul(sx, px), mul(sy, py)), mul(sz, pz)), inverseDet);
+		const f32x8 qx = sub(mul(sy, e1z), mul(sz, e1y));
+		const f32x8 qy = sub(mul(sz, e1x), mul(sx, e1z));
+		const f32x8 qz = sub(mul(sx, e1y), mul(sy, e1x));
+		const f32x8 v = mul(add(add(mul(dx, qx), mul(dy, qy)), mul(dz, qz)), inverseDet);
+		const f32x8 t = mul(add(add(mul(e2x, qx), mul(e2y, qy)), mul(e2z, qz)), inverseDet);
+		f32x8 mask = bitAnd(notEqual(det, zero), lessEqual(zero, u));
+		mask = bitAnd(mask, lessEqual(zero, v));
+		mask = bitAnd(mask, lessEqual(add(u, v), splat8(1)));
+		mask = bitAnd(mask, lessEqual(splat8(ray.tMin), t));
+		mask = bitAnd(mask, lessEqual(t, splat8(ray.tMax)));
+		store(hits.t, t);
+		store(hits.u, u);
+		store(hits.v, v);
+		return signMask(mask);
+	}
+
+	inline int boxes8(const Ray<float>& ray, const BoxPacket& p, float (&entry)[PacketLanes]) {
+		f32x8 near = splat8(ray.tMin);
+		f32x8 far = min(splat8(ray.tMax), splat8(std::numeric_limits<float>::max()));
+		for (size_t k = 0; k < 3; ++k) {
+			//one ray, so the near and far planes are the same for every box
+			const float inverse = 1 / ray.direction[k];
+			const bool negative = std::copysign(1.0f, inverse) < 0;
+			const f32x8 o = splat8(ray.origin[k]);
+			const f32x8 i = splat8(inverse);
+			const f32x8 tNear = mul(sub(load8(negative ? p.upper[k] : p.lower[k]), o), i);
+			const f32x8 tFar = mul(sub(load8(negative ? p.lower[k] : p.upper[k]), o), i);
+			near = max(tNear, near);
+			far = min(tFar, far);
+		}
+		store(entry, near);
+		return signMask(lessEqual(near, far));
+	}
+
+	inline int rays8(const RayPacket& rays, const Aabb<float>& box, float (&entry)[PacketLanes]) {
+		f32x8 near = load8(rays.tMin);
+		f32x8 far = min(load8(rays.tMax), splat8(std::numeric_limits<float>::max()));
+		for (size_t k = 0; k < 3; ++k) {
+			const f32x8 i = load8(rays.inverse[k]);
+			const f32x8 o = load8(rays.origin[k]);
+			const f32x8 lower = splat8(box.lower[k]);
+			const f32x8 upper = splat8(box.upper[k]);
+			const f32x8 tNear = mul(sub(selectNegative(i, upper, lower), o), i);
+			const f32x8 tFar = mul(sub(selectNegative(i, lower, upper), o), i);
+			near = max(tNear, near);
+			far = min(tFar, far);
+		}
+		store(entry, near);
+		return signMask(lessEqual(near, far));
+	}
+
+	//Nearest point to ap on the segment from 0 to ab
+	template<class T>
+	Vec<3, T> closestOnSegment(const Vec<3, T>& ap, const Vec<3, T>& ab) {
+		const T length = ::dotProduct(ab, ab);
+		const T s = length > 0 ? ::dotProduct(ap, ab) / length : 0;
+		return ab * (s < 0 ? 0 : s > 1 ? 1 : s);
+	}
+
+	/*
+	* Nearest point of the triangle a, a + ab, a + ac to p, relative to a, by the
+	* Voronoi regions of the corners, edges and face (Ericson, Real-Time Collision
+	* Detection 5.1.5). Degenerate triangles, and triangles so thin that rounding decides
+	* the regions, fall back to the nearest point of the edges.
+	*/
+	template<class T>
+	Vec<3, T> closestPoint(const Vec<3, T>& p, const Vec<3, T>& a, const Vec<3, T>& ab, const Vec<3, T>& ac) {
+		const Vec<3, T> ap = p - a;
+		const T d1 = ::dotProduct(ab, ap);
+		const T d2 = ::dotProduct(ac, ap);
+		if (d1 <= 0 && d2 <= 0) {
+			return {};
+		}
+		const Vec<3, T> bp = ap - ab;
+		const T d3 = ::dotProduct(ab, bp);
+		const T d4 = ::dotProduct(ac, bp);
+		if (d3 >= 0 && d4 <= d3) {
+			return ab;
+		}
+		const Vec<3, T> cp = ap - ac;
+		const T d5 = ::dotProduct(ab, cp);
+		const T d6 = ::dotProduct(ac, cp);
+		if (d6 >= 0 && d5 <= d6) {
+			return ac;
+		}
+		const T vc = d1 * d4 - d3 * d2;
+		const T vb = d5 * d2 - d1 * d6;
+		const T va = d3 * d6 - d5 * d4;
+		//the three are differences of products, within rounding of them the triangle is degenerate
+		const T area = va + vb + vc;
+		const T rounding = std::abs(d1 * d4) + std::abs(d3 * d2) + std::abs(d5 * d2) + std::abs(d1 * d6) + std::abs(d3 * d6) + std::abs(d5 * d4);
+		if (!(area > 8 * std::numeric_limits<T>::epsilon() * rounding)) {
+			const Vec<3, T> candidates[3] = { closestOnSegment(ap, ab), closestOnSegment(ap, ac), ab + closestOnSegment(bp, ac - ab) };
+			Vec<3, T> nearest = candidates[0];
+			for (const Vec<3, T>& candidate : candidates) {
+				nearest = ::lengthSquared(ap - candidate) < ::lengthSquared(ap - nearest) ? candidate : nearest;
+			}
+			return nearest;
+		}
+		if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+			return ab * (d1 / (d1 - d3));
+		}
+		if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+			return ac * (d2 / (d2 - d6));
+		}
+		if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) {
+			return ab + (ac - ab) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+		}
+		return ab * (vb / area) + ac * (vc / area);
+	}
+}
+
+}
+
+/*
+* Single ray tests
+* intersect returns whether the ray hits, and sets hit (or entry) when it does.
+*/
+template<class T>
+bool intersect(const math3d::Ray<T>& ray, const math3d::Vec<3, T>& a, const math3d::Vec<3, T>& b, const math3d::Vec<3, T>& c, math3d::TriangleHit<T>& hit) {
+	const T corner[3] = { a.x, a.y, a.z };
+	const T e1[3] = { b.x - a.x, b.y - a.y, b.z - a.z };
+	const T e2[3] = { c.x - a.x, c.y - a.y, c.z - a.z };
+	return math3d::intersectKernels::triangle(ray, corner, e1, e2, hit);
+}
+
+template<class T>
+bool intersect(const math3d::Ray<T>& ray, const math3d::Aabb<T>& box, T& entry) {
+	const T origin[3] = { ray.origin.x, ray.origin.y, ray.origin.z };
+	const T inverse[3] = { 1 / ray.direction.x, 1 / ray.direction.y, 1 / ray.direction.z };
+	const T lower[3] = { box.lower.x, box.lower.y, box.lower.z };
+	const T upper[3] = { box.upper.x, box.upper.y, box.upper.z };
+	return math3d::intersectKernels::box(origin, inverse, lower, upper, ray.tMin, ray.tMax, entry);
+}
+
+//Nearest point of the triangle a, b, c to p
+template<class T>
+math3d::Vec<3, T> closestPoint(const math3d::Vec<3, T>& p, const math3d::Vec<3, T>& a, const math3d::Vec<3, T>& b, const math3d::Vec<3, T>& c) {
+	return a + math3d::intersectKernels::closestPoint(p, a, b - a, c - a);
+}
+
+/*
+* Packet tests
+* One ray against 8 triangles or 8 boxes, or 8 rays against one box. The result is
+* a bitmask of the lanes that hit, lane 0 in bit 0, and hits or entry hold the hit
+* of every lane in the mask.
+*/
+inline int intersect(const math3d::Ray<float>& ray, const math3d::TrianglePacket& triangles, math3d::PacketHits& hits) {
+	return math3d::intersectKernels::triangles8(ray, triangles, hits);
+}
+
+inline int intersect(const math3d::Ray<float>& ray, const math3d::BoxPacket& boxes, float (&entry)[math3d::PacketLanes]) {
+	return math3d::intersectKernels::boxes8(ray, boxes, entry);
+}
+
+inline int intersect(const math3d::RayPacket& rays, const math3d::Aabb<float>& box, float (&entry)[math3d::PacketLanes]) {
+	return math3d::intersectKernels::rays8(rays, box, entry);
+}
+
+/*
+* Packing
+* corners holds 3 corners per triangle, or indices 3 vertex indices per triangle.
+* out must hold packetCount(triangles) packets, the lanes past the last triangle
+* (or box) are left unset so they are never hit.
+*/
+inline void packTriangles(std::span<const math3d::Vec<3, float>> corners, std::span<math3d::TrianglePacket> out) {
+	for (size_t i = 0; i < corners.size() / 3; ++i) {
+		out[i / math3d::PacketLanes].set(i % math3d::PacketLanes, corners[3 * i], corners[3 * i + 1], corners[3 * i + 2]);
+	}
+}
+
+inline void packTriangles(std::span<const math3d::Vec<3, float>> vertices, std::span<const uint32_t> indices, std::span<math3d::TrianglePacket> out) {
+	for (size_t i = 0; i < indices.size() / 3; ++i) {
+		out[i / math3d::PacketLanes].set(i % math3d::PacketLanes, vertices[indices[3 * i]], vertices[indices[3 * i + 1]], vertices[indices[3 * i + 2]]);
+	}
+}
+
+inline void packBoxes(std::span<const math3d::Aabb<float>> boxes, std::span<math3d::BoxPacket> out) {
+	for (size_t i = 0; i < boxes.size(); ++i) {
+		out[i / math3d::PacketLanes].set(i % math3d::PacketLanes, boxes[i]);
+	}
+}
+
+/*
+* Batched queries over packed triangles
+* closestHit finds the nearest hit in [ray.tMin, ray.tMax], the triangle with the
+* lowest index among equally near ones, as a loop over the triangles with the
+* scalar test would. occluded returns whether anything is hit at all, and stops at
+* the first packet that is.
+*/
+inline bool closestHit(const math3d::Ray<float>& ray, std::span<const math3d::TrianglePacket> triangles, math3d::TriangleHit<float>& hit) {
+	math3d::Ray<float> shortened = ray;
+	bool found = false;
+	math3d::PacketHits hits;
+	for (size_t p = 0; p < triangles.size(); ++p) {
+		int mask = intersect(shortened, triangles[p], hits);
+		while (mask != 0) {
+			const int lane = std::countr_zero(static_cast<unsigned>(mask));
+			mask &= mask - 1;
+			if (!found || hits.t[lane] < shortened.tMax) {
+				found = true;
+				shortened.tMax = hits.t[lane];
+				hit = { hits.t[lane], hits.u[lane], hits.v[lane], p * math3d::PacketLanes + lane };
+			}
+		}
+	}
+	return found;
+}
+
+inline bool occluded(const math3d::Ray<float>& ray, std::span<const math3d::TrianglePacket> triangles) {
+	math3d::PacketHits hits;
+	for (const math3d::TrianglePacket& packet : triangles) {
+		if (intersect(ray, packet, hits) != 0) {
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,379 @@
+#pragma once
+
+#include "math3d.h"
+#include "parallel.h"
+#include "reduce.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace math3d {
+
+//A point of a KdTree with its index in the points the tree was built from
+struct KdPoint {
+	Vec<3, float> point;
+	uint32_t index = 0;
+};
+
+static_assert(sizeof(KdPoint) == 16);
+
+//A point found by a KdTree query, index is the index of the point the tree was built from
+struct Neighbor {
+	uint32_t index = std::numeric_limits<uint32_t>::max();
+	float distanceSquared = std::numeric_limits<float>::infinity();
+};
+
+namespace kdKernels {
+	/*
+	* Implicit k-d Tree
+	* The tree is the point array itself. A range [begin, end) of more than LeafSize
+	* points is split at its middle point m along axes[m], the axis along which the
+	* range's bounds are widest: the points of [begin, m) are at most points[m] along
+	* it, the points of [m + 1, end) at least. Smaller ranges are leaves, scanned in
+	* one go. There are no nodes or pointers, only one byte per point for the axes,
+	* and a query walks the points of a subtree in the order they are stored.
+	*
+	* Points equal along the axis are ordered by index, so the tree only depends on the
+	* points, and ranges of more than TaskPoints points are split on one thread of the
+	* pool while their two halves are built as separate tasks. The tree is balanced, so
+	* the depth, and the query stacks, stay below StackSize for any input.
+	*/
+	inline constexpr size_t LeafSize = 8;
+	inline constexpr size_t TaskPoints = 16384;
+	inline constexpr size_t QueryGrain = 256;
+	inline constexpr size_t StackSize = 64;
+
+	inline size_t middle(size_t begin, size_t end) {
+		return begin + (end - begin) / 2;
+	}
+
+	template<class Body>
+	void forRanges(ThreadPool* pool, size_t count, size_t grain, Body&& body) {
+		if (pool) {
+			parallelFor(*pool, count, grain, body);
+		}
+		else {
+			body(0, count);
+		}
+	}
+
+	inline void build(ThreadPool* pool, std::span<KdPoint> points, std::span<uint8_t> axes, size_t begin, size_t end) {
+		if (end - begin <= LeafSize) {
+			return;
+		}
+		Aabb<float> bounds;
+		for (size_t i = begin; i < end; ++i) {
+			bounds.grow(points[i].point);
+		}
+		const Vec<3, float> extent = bounds.extent();
+		const uint8_t axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+		const size_t m = middle(begin, end);
+		std::nth_element(points.begin() + begin, points.begin() + m, points.begin() + end, [axis](const KdPoint& a, const KdPoint& b) {
+			return a.point[axis] < b.point[axis] || (a.point[axis] == b.point[axis] && a.index < b.index);
+		});
+		axes[m] = axis;
+		if (pool && end - begin > TaskPoints) {
+			auto half = [&](size_t i) {
+				if (i == 0) {
+					build(pool, points, axes, begin, m);
+				}
+				else {
+					build(pool, points, axes, m + 1, end);
+				}
+			};
+			pool->run(2, half);
+		}
+		else {
+			build(nullptr, points, axes, begin, m);
+			build(nullptr, points, axes, m + 1, end);
+		}
+	}
+
+	/*
+	* Calls visit(point, distanceSquared) for the points within bound of q, nearer
+	* subtrees first. A subtree is skipped when the distance of q to its side of the
+	* splitting plane is more than bound, visit may lower bound as it finds points.
+	*/
+	template<class Visit>
+	void search(std::span<const KdPoint> points, std::span<const uint8_t> axes, const Vec<3, float>& q, const float& bound, Visit&& visit) {
+		struct Pending {
+			size_t begin;
+			size_t end;
+			float distance;
+		};
+		Pending stack[StackSize];
+		size_t top = 0;
+		Pending node{ 0, points.size(), 0 };
+		for (;;) {
+			if (node.distance <= bound) {
+				while (node.end - node.begin > LeafSize) {
+					const size_t m = middle(node.begin, node.end);
+					const KdPoint& split = points[m];
+					const uint8_t axis = axes[m];
+					const float offset = q[axis] - split.point[axis];
+					const float d = lengthSquared(q - split.point);
+					if (d <= bound) {
+						visit(split, d);
+					}
+					Pending near{ node.begin, m, node.distance };
+					Pending far{ m + 1, node.end, std::max(node.distance, offset * offset) };
+					if (offset >= 0) {
+						std::swap(near.begin, far.begin);
+						std::swap(near.end, far.end);
+					}
+					if (far.distance <= bound && far.begin < far.end) {
+						stack[top++] = far;
+					}
+					node = near;
+				}
+				for (size_t i = node.begin; i < node.end; ++i) {
+					const float d = lengthSquared(q - points[i].point);
+					if (d <= bound) {
+						visit(points[i], d);
+					}
+				}
+			}
+			if (top == 0) {
+				return;
+			}
+			node = stack[--top];
+		}
+	}
+
+	//The k = best.size() nearest points so far, ordered by distance then index
+	struct Nearest {
+		std::span<Neighbor> best;
+		size_t found = 0;
+		float bound = std::numeric_limits<float>::infinity();
+
+		static bool before(uint32_t index, float d, const Neighbor& n) {
+			return d < n.distanceSquared || (d == n.distanceSquared && index < n.index);
+		}
+
+		void offer(uint32_t index, float d) {
+			const size_t k = best.size();
+			if (found == k && !before(index, d, best[k - 1])) {
+				return;
+			}
+			size_t i = found < k ? found++ : k - 1;
+			for (; i > 0 && before(index, d, best[i - 1]); --i) {
+				best[i] = best[i - 1];
+			}
+			best[i] = { index, d };
+			if (found == k) {
+				bound = best[k - 1].distanceSquared;
+			}
+		}
+	};
+}
+
+/*
+* k-d Tree
+* A balanced implicit k-d tree over a copy of the points, for nearest neighbor and
+* radius queries:
+*	nearest(q, out) finds the out.size() points nearest to q, ordered by squared
+*		distance, points at the same distance by index, and returns how many it found,
+*		fewer when the tree holds fewer points.
+*	withinRadius(q, radius, f) calls f(index, distanceSquared) for every point with
+*		lengthSquared(point - q) <= radius * radius, in tree order.
+* The batched queries answer many query points, in the order of the leaves they fall
+* in, so that queries near each other run one after the other on the same parts of
+* the tree, and with a pool on every thread. Their results are those of the single
+* queries, in the order of the query points. Points must be finite, building with a
+* pool gives the same tree as building without.
+*/
+class KdTree {
+public:
+	static constexpr uint32_t NoPoint = std::numeric_limits<uint32_t>::max();
+
+	KdTree() = default;
+
+	explicit KdTree(std::span<const Vec<3, float>> points) {
+		build(nullptr, points);
+	}
+
+	KdTree(ThreadPool& pool, std::span<const Vec<3, float>> points) {
+		build(&pool, points);
+	}
+
+	size_t size() const {
+		return treePoints.size();
+	}
+
+	bool empty() const {
+		return treePoints.empty();
+	}
+
+	//The points in tree order
+	std::span<const KdPoint> points() const {
+		return treePoints;
+	}
+
+	//The split axes in tree order, splitAxes()[m] is the axis of the range split at m,
+	//the entries of leaf points are unused
+	std::span<const uint8_t> splitAxes() const {
+		return axes;
+	}
+
+	size_t nearest(const Vec<3, float>& q, std::span<Neighbor> out) const {
+		if (out.empty()) {
+			return 0;
+		}
+		kdKernels::Nearest best{ out };
+		kdKernels::search(treePoints, axes, q, best.bound, [&](const KdPoint& p, float d) {
+			best.offer(p.index, d);
+		});
+		std::fill(out.begin() + best.found, out.end(), Neighbor{});
+		return best.found;
+	}
+
+	//The nearest point, with index NoPoint for an empty tree
+	Neighbor nearest(const Vec<3, float>& q) const {
+		Neighbor n;
+		nearest(q, std::span<Neighbor>(&n, 1));
+		return n;
+	}
+
+	template<class F>
+	void withinRadius(const Vec<3, float>& q, float radius, F&& f) const {
+		const float bound = radius * radius;
+		kdKernels::search(treePoints, axes, q, bound, [&](const KdPoint& p, float d) {
+			f(p.index, d);
+		});
+	}
+
+	//Appends the points within radius of q to out
+	void withinRadius(const Vec<3, float>& q, float radius, std::vector<Neighbor>& out) const {
+		withinRadius(q, radius, [&](uint32_t index, float d) {
+			out.push_back({ index, d });
+		});
+	}
+
+	/*
+	* The k nearest points of every query, out[q * k, q * k + k) for query q, out must
+	* hold queries.size() * k neighbors. Past the points found the neighbors are
+	* Neighbor{}, with index NoPoint.
+	*/
+	void nearest(std::span<const Vec<3, float>> queries, size_t k, std::span<Neighbor> out) const {
+		nearest(nullptr, queries, k, out);
+	}
+
+	void nearest(ThreadPool& pool, std::span<const Vec<3, float>> queries, size_t k, std::span<Neighbor> out) const {
+		nearest(&pool, queries, k, out);
+	}
+
+	/*
+	* The points within radius of every query, out[offsets[q], offsets[q + 1]) for
+	* query q, each in tree order. offsets and out are replaced, offsets holds
+	* queries.size() + 1 offsets.
+	*/
+	void withinRadius(std::span<const Vec<3, float>> queries, float radius, std::vector<size_t>& offsets, std::vector<Neighbor>& out) const {
+		withinRadius(nullptr, queries, radius, offsets, out);
+	}
+
+	void withinRadius(ThreadPool& pool, std::span<const Vec<3, float>> queries, float radius, std::vector<size_t>& offsets, std::vector<Neighbor>& out) const {
+		withinRadius(&pool, queries, radius, offsets, out);
+	}
+
+private:
+	void build(ThreadPool* pool, std::span<const Vec<3, float>> points) {
+		if (points.size() >= NoPoint) {
+			throw std::invalid_argument("math3d: a KdTree holds fewer than 2^32 - 1 points");
+		}
+		treePoints.resize(points.size());
+		axes.assign(points.size(), 0);
+		bool finite = true;
+		for (size_t i = 0; i < points.size(); ++i) {
+			treePoints[i] = { points[i], static_cast<uint32_t>(i) };
+			finite = finite && std::isfinite(points[i].x) && std::isfinite(points[i].y) && std::isfinite(points[i].z);
+		}
+		if (!finite) {
+			throw std::invalid_argument("math3d: KdTree points must be finite");
+		}
+		kdKernels::build(pool, treePoints, axes, 0, treePoints.size());
+	}
+
+	//Query indices sorted by the first point of the leaf each query falls in
+	std::vector<uint32_t> queryOrder(ThreadPool* pool, std::span<const Vec<3, float>> queries) const {
+		if (queries.size() >= NoPoint) {
+			throw std::invalid_argument("math3d: a KdTree batch holds fewer than 2^32 - 1 queries");
+		}
+		std::vector<uint64_t> keys(queries.size());
+		kdKernels::forRanges(pool, queries.size(), kdKernels::QueryGrain * 16, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				size_t first = 0;
+				size_t last = treePoints.size();
+				while (last - first > kdKernels::LeafSize) {
+					const size_t m = kdKernels::middle(first, last);
+					const uint8_t axis = axes[m];
+					if (queries[i][axis] < treePoints[m].point[axis]) {
+						last = m;
+					}
+					else {
+						first = m + 1;
+					}
+				}
+				keys[i] = static_cast<uint64_t>(first) << 32 | i;
+			}
+		});
+		std::sort(keys.begin(), keys.end());
+		std::vector<uint32_t> order(queries.size());
+		for (size_t i = 0; i < keys.size(); ++i) {
+			order[i] = static_cast<uint32_t>(keys[i]);
+		}
+		return order;
+	}
+
+	void nearest(ThreadPool* pool, std::span<const Vec<3, float>> queries, size_t k, std::span<Neighbor> out) const {
+		const std::vector<uint32_t> order = queryOrder(pool, queries);
+		kdKernels::forRanges(pool, queries.size(), kdKernels::QueryGrain, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				const size_t q = order[i];
+				nearest(queries[q], out.subspan(q * k, k));
+			}
+		});
+	}
+
+	//Every chunk of queries collects its points in its own buffer, which are then copied to their place in out
+	void withinRadius(ThreadPool* pool, std::span<const Vec<3, float>> queries, float radius, std::vector<size_t>& offsets, std::vector<Neighbor>& out) const {
+		offsets.assign(queries.size() + 1, 0);
+		out.clear();
+		if (queries.empty()) {
+			return;
+		}
+		const std::vector<uint32_t> order = queryOrder(pool, queries);
+		std::vector<std::vector<Neighbor>> found((queries.size() + kdKernels::QueryGrain - 1) / kdKernels::QueryGrain);
+		kdKernels::forRanges(pool, queries.size(), kdKernels::QueryGrain, [&](size_t begin, size_t end) {
+			std::vector<Neighbor>& buffer = found[begin / kdKernels::QueryGrain];
+			for (size_t i = begin; i < end; ++i) {
+				const size_t before = buffer.size();
+				withinRadius(queries[order[i]], radius, buffer);
+				offsets[order[i] + 1] = buffer.size() - before;
+			}
+		});
+		for (size_t q = 0; q < queries.size(); ++q) {
+			offsets[q + 1] += offsets[q];
+		}
+		out.resize(offsets.back());
+		kdKernels::forRanges(pool, queries.size(), kdKernels::QueryGrain, [&](size_t begin, size_t end) {
+			const Neighbor* next = found[begin / kdKernels::QueryGrain].data();
+			for (size_t i = begin; i < end; ++i) {
+				const size_t q = order[i];
+				const size_t count = offsets[q + 1] - offsets[q];
+				std::copy(next, next + count, out.begin() + offsets[q]);
+				next += count;
+			}
+		});
+	}
+
+	std::vector<KdPoint> treePoints;
+	std::vector<uint8_t> axes;
+};
+
+}
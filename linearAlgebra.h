@@ -0,0 +1,451 @@
+#pragma once
+
+#include "math3d.h"
+#include "parallel.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <span>
+#include <type_traits>
+
+namespace math3d {
+
+/*
+* Eigen-decomposition of a symmetric 3x3 matrix m, the eigenvalues in ascending order
+* and the matching unit eigenvectors as the rows of vectors, so that
+*	m == transpose(vectors) * diagonal(values) * vectors
+* up to rounding. vectors is a rotation, vectors.z == crossProduct(vectors.x, vectors.y).
+* For a covariance matrix vectors.x is the direction of least variance, e.g. the normal
+* of a neighborhood of surface points, and vectors.z the direction of most.
+*/
+template<class T>
+struct SymmetricEigen {
+	Vec<3, T> values;
+	Matrix<3, 3, T> vectors;
+};
+
+namespace linearAlgebraKernels {
+	using namespace simd;
+
+	/*
+	* The kernels are written once for lanes of V, a float or double for the single
+	* functions and an f32x8 of eight matrices for the batched float ones. These are the
+	* scalar lanes, with the same semantics as the SIMD functions, so that the single
+	* and the batched functions compute the same bits unless FMA contraction is enabled.
+	*/
+	template<class T> requires std::is_floating_point_v<T>
+	T add(T a, T b) {
+		return a + b;
+	}
+
+	template<class T> requires std::is_floating_point_v<T>
+	T sub(T a, T b) {
+		return a - b;
+	}
+
+	template<class T> requires std::is_floating_point_v<T>
+	T mul(T a, T b) {
+		return a * b;
+	}
+
+	template<class T> requires std::is_floating_point_v<T>
+	T div(T a, T b) {
+		return a / b;
+	}
+
+	template<class T> requires std::is_floating_point_v<T>
+	T sqrt(T a) {
+		return std::sqrt(a);
+	}
+
+	template<class T> requires std::is_floating_point_v<T>
+	T abs(T a) {
+		return std::abs(a);
+	}
+
+	template<class T> requires std::is_floating_point_v<T>
+	T max(T a, T b) {
+		return a > b ? a : b;
+	}
+
+	template<class T> requires std::is_floating_point_v<T>
+	T mulSign(T a, T b) {
+		return std::signbit(b) ? -a : a;
+	}
+
+	template<class T> requires std::is_floating_point_v<T>
+	T selectNegative(T c, T a, T b) {
+		return std::signbit(c) ? a : b;
+	}
+
+	template<class V>
+	V constant(double s) {
+		if constexpr (std::is_same_v<V, f32x8>) {
+			return splat8(static_cast<float>(s));
+		}
+		else {
+			return static_cast<V>(s);
+		}
+	}
+
+	template<class V>
+	struct Scalar {
+		using type = V;
+	};
+
+	template<>
+	struct Scalar<f32x8> {
+		using type = float;
+	};
+
+	template<class V>
+	void cross(const V (&a)[3], const V (&b)[3], V (&out)[3]) {
+		out[0] = sub(mul(a[1], b[2]), mul(a[2], b[1]));
+		out[1] = sub(mul(a[2], b[0]), mul(a[0], b[2]));
+		out[2] = sub(mul(a[0], b[1]), mul(a[1], b[0]));
+	}
+
+	template<class V>
+	V dot(const V (&a)[3], const V (&b)[3]) {
+		return add(add(mul(a[0], b[0]), mul(a[1], b[1])), mul(a[2], b[2]));
+	}
+
+	/*
+	* Cyclic Jacobi
+	* Every sweep rotates the (0, 1), (0, 2) and (1, 2) off diagonal entries to zero,
+	* with the rotation of the smaller angle,
+	*	t = tan(angle) = 2 a_pq sign(d) / (|d| + sqrt(d^2 + 4 a_pq^2)), d = a_qq - a_pp
+	* which converges quadratically once the off diagonal entries are small, and the
+	* rotations accumulate in the eigenvectors. Sweeps of them bring any matrix to within
+	* rounding of diagonal, a fixed count so that eight matrices run in lock step without
+	* branches. The matrix is first scaled by its largest entry, so that the squares
+	* neither overflow nor underflow, and the entries a rotation reads are flushed to zero
+	* below Tiny of that scale, far below rounding, since the converging off diagonal
+	* entries would otherwise end up in slow subnormal arithmetic. Unlike the closed form
+	* trigonometric solution, Jacobi keeps full relative accuracy of the eigenvectors of
+	* (nearly) repeated eigenvalues, e.g. of the covariance of a sphere or a line of
+	* points.
+	*/
+	template<class T>
+	inline constexpr int Sweeps = std::is_same_v<T, float> ? 4 : 6;
+
+	//Squares of entries above Tiny are normal numbers
+	template<class T>
+	inline constexpr T Tiny = std::is_same_v<T, float> ? T(0x1p-60) : T(0x1p-500);
+
+	template<class V>
+	V flush(V a) {
+		using S = typename Scalar<V>::type;
+		return selectNegative(sub(abs(a), constant<V>(Tiny<S>)), constant<V>(0), a);
+	}
+
+	template<class V>
+	void rotate(V (&a)[3][3], V (&v)[3][3], int p, int q) {
+		using S = typename Scalar<V>::type;
+		const int r = 3 - p - q;
+		a[p][p] = flush(a[p][p]);
+		a[q][q] = flush(a[q][q]);
+		const V apq = flush(a[p][q]);
+		const V d = flush(sub(a[q][q], a[p][p]));
+		const V root = sqrt(add(mul(d, d), mul(mul(constant<V>(4), apq), apq)));
+		const V denominator = max(add(abs(d), root), constant<V>(std::numeric_limits<S>::min()));
+		const V t = div(mulSign(mul(constant<V>(2), apq), d), denominator);
+		const V c = div(constant<V>(1), sqrt(add(constant<V>(1), mul(t, t))));
+		const V s = mul(t, c);
+		a[p][p] = sub(a[p][p], mul(t, apq));
+		a[q][q] = add(a[q][q], mul(t, apq));
+		a[p][q] = a[q][p] = constant<V>(0);
+		const V arp = flush(a[r][p]);
+		const V arq = flush(a[r][q]);
+		a[r][p] = a[p][r] = sub(mul(c, arp), mul(s, arq));
+		a[r][q] = a[q][r] = add(mul(s, arp), mul(c, arq));
+		for (int k = 0; k < 3; ++k) {
+			const V vkp = flush(v[k][p]);
+			const V vkq = flush(v[k][q]);
+			v[k][p] = sub(mul(c, vkp), mul(s, vkq));
+			v[k][q] = add(mul(s, vkp), mul(c, vkq));
+		}
+	}
+
+	//Swaps eigenpairs i and j where values[i] > values[j]
+	template<class V>
+	void order(V (&values)[3], V (&v)[3][3], int i, int j) {
+		const V swap = sub(values[j], values[i]);
+		const V low = selectNegative(swap, values[j], values[i]);
+		values[j] = selectNegative(swap, values[i], values[j]);
+		values[i] = low;
+		for (int k = 0; k < 3; ++k) {
+			const V vi = selectNegative(swap, v[k][j], v[k][i]);
+			v[k][j] = selectNegative(swap, v[k][i], v[k][j]);
+			v[k][i] = vi;
+		}
+	}
+
+	//The upper triangle xx, xy, xz, yy, yz, zz of m in, the eigenvalues and the eigenvectors (rows of vectors) out
+	template<class V, class S = typename Scalar<V>::type>
+	void eigen(const V (&m)[6], V (&values)[3], V (&vectors)[3][3]) {
+		V scale = constant<V>(std::numeric_limits<S>::min());
+		for (int i = 0; i < 6; ++i) {
+			scale = max(abs(m[i]), scale);
+		}
+		const V inverse = div(constant<V>(1), scale);
+		V a[3][3];
+		a[0][0] = mul(m[0], inverse);
+		a[0][1] = a[1][0] = mul(m[1], inverse);
+		a[0][2] = a[2][0] = mul(m[2], inverse);
+		a[1][1] = mul(m[3], inverse);
+		a[1][2] = a[2][1] = mul(m[4], inverse);
+		a[2][2] = mul(m[5], inverse);
+		V v[3][3];
+		for (int i = 0; i < 3; ++i) {
+			for (int j = 0; j < 3; ++j) {
+				v[i][j] = constant<V>(i == j ? 1 : 0);
+			}
+		}
+		for (int sweep = 0; sweep < Sweeps<S>; ++sweep) {
+			rotate(a, v, 0, 1);
+			rotate(a, v, 0, 2);
+			rotate(a, v, 1, 2);
+		}
+		for (int i = 0; i < 3; ++i) {
+			values[i] = a[i][i];
+		}
+		order(values, v, 0, 1);
+		order(values, v, 1, 2);
+		order(values, v, 0, 1);
+		for (int i = 0; i < 3; ++i) {
+			values[i] = mul(values[i], scale);
+			for (int k = 0; k < 3; ++k) {
+				vectors[i][k] = v[k][i];
+			}
+		}
+		cross(vectors[0], vectors[1], vectors[2]);
+	}
+
+	/*
+	* Cramer's Rule
+	* x = adjugate(a) b / determinant(a), the adjugate columns are the cross products of
+	* the rows. The system is singular, x = 0, when
+	*	|determinant(a)| <= epsilon |a.x| |a.y| |a.z|
+	* the determinant relative to the largest it can be for rows of those lengths, which
+	* does not depend on the scale of a. Returns a value that is negative in the lanes
+	* of the systems that are not singular.
+	*/
+	template<class V, class S = typename Scalar<V>::type>
+	V solve(const V (&a)[3][3], const V (&b)[3], V (&x)[3]) {
+		V c[3][3];
+		cross(a[1], a[2], c[0]);
+		cross(a[2], a[0], c[1]);
+		cross(a[0], a[1], c[2]);
+		const V det = dot(a[0], c[0]);
+		const V bound = mul(mul(sqrt(dot(a[0], a[0])), sqrt(dot(a[1], a[1]))), mul(sqrt(dot(a[2], a[2])), constant<V>(std::numeric_limits<S>::epsilon())));
+		const V solvable = sub(bound, abs(det));
+		const V inverse = div(constant<V>(1), det);
+		for (int k = 0; k < 3; ++k) {
+			const V sum = add(add(mul(c[0][k], b[0]), mul(c[1][k], b[1])), mul(c[2][k], b[2]));
+			x[k] = selectNegative(solvable, mul(sum, inverse), constant<V>(0));
+		}
+		return solvable;
+	}
+
+	template<class T>
+	void load(const Matrix<3, 3, T>& m, T (&upper)[6]) {
+		upper[0] = m.x.x;
+		upper[1] = m.x.y;
+		upper[2] = m.x.z;
+		upper[3] = m.y.y;
+		upper[4] = m.y.z;
+		upper[5] = m.z.z;
+	}
+
+	template<class T>
+	SymmetricEigen<T> eigen(const Matrix<3, 3, T>& m) {
+		T upper[6];
+		load(m, upper);
+		T values[3];
+		T vectors[3][3];
+		eigen(upper, values, vectors);
+		SymmetricEigen<T> out;
+		for (size_t i = 0; i < 3; ++i) {
+			out.values[i] = values[i];
+			for (size_t k = 0; k < 3; ++k) {
+				out.vectors[i][k] = vectors[i][k];
+			}
+		}
+		return out;
+	}
+
+	template<class T>
+	bool solve(const Matrix<3, 3, T>& m, const Vec<3, T>& v, Vec<3, T>& out) {
+		T a[3][3];
+		T b[3];
+		T x[3];
+		for (size_t i = 0; i < 3; ++i) {
+			b[i] = v[i];
+			for (size_t k = 0; k < 3; ++k) {
+				a[i][k] = m[i][k];
+			}
+		}
+		const bool solvable = std::signbit(solve(a, b, x));
+		out = { x[0], x[1], x[2] };
+		return solvable;
+	}
+
+	/*
+	* Batched float matrices are transposed in groups of 8 to one f32x8 per entry, and
+	* the results transposed back, the lanes past the last matrix hold zero matrices.
+	*/
+	inline constexpr size_t Lanes = 8;
+
+	template<class T>
+	void eigen(std::span<const Matrix<3, 3, T>> m, std::span<SymmetricEigen<T>> out, size_t begin, size_t end) {
+		if constexpr (std::is_same_v<T, float>) {
+			for (size_t base = begin; base < end; base += Lanes) {
+				const size_t n = std::min(Lanes, end - base);
+				float upper[6][Lanes] = {};
+				for (size_t l = 0; l < n; ++l) {
+					float entries[6];
+					load(m[base + l], entries);
+					for (size_t e = 0; e < 6; ++e) {
+						upper[e][l] = entries[e];
+					}
+				}
+				f32x8 in[6];
+				for (size_t e = 0; e < 6; ++e) {
+					in[e] = loadu8(upper[e]);
+				}
+				f32x8 values[3];
+				f32x8 vectors[3][3];
+				eigen(in, values, vectors);
+				float lanes[12][Lanes];
+				for (size_t i = 0; i < 3; ++i) {
+					storeu(lanes[i], values[i]);
+					for (size_t k = 0; k < 3; ++k) {
+						storeu(lanes[3 + 3 * i + k], vectors[i][k]);
+					}
+				}
+				for (size_t l = 0; l < n; ++l) {
+					SymmetricEigen<float>& e = out[base + l];
+					e.values = { lanes[0][l], lanes[1][l], lanes[2][l] };
+					e.vectors.x = { lanes[3][l], lanes[4][l], lanes[5][l] };
+					e.vectors.y = { lanes[6][l], lanes[7][l], lanes[8][l] };
+					e.vectors.z = { lanes[9][l], lanes[10][l], lanes[11][l] };
+				}
+			}
+		}
+		else {
+			for (size_t i = begin; i < end; ++i) {
+				out[i] = eigen(m[i]);
+			}
+		}
+	}
+
+	template<class T>
+	size_t solve(std::span<const Matrix<3, 3, T>> m, std::span<const Vec<3, T>> b, std::span<Vec<3, T>> x, size_t begin, size_t end) {
+		size_t singular = 0;
+		if constexpr (std::is_same_v<T, float>) {
+			for (size_t base = begin; base < end; base += Lanes) {
+				const size_t n = std::min(Lanes, end - base);
+				float entries[12][Lanes] = {};
+				for (size_t l = 0; l < n; ++l) {
+					for (size_t i = 0; i < 3; ++i) {
+						entries[9 + i][l] = b[base + l][i];
+						for (size_t k = 0; k < 3; ++k) {
+							entries[3 * i + k][l] = m[base + l][i][k];
+						}
+					}
+				}
+				f32x8 a[3][3];
+				f32x8 rhs[3];
+				f32x8 solution[3];
+				for (size_t i = 0; i < 3; ++i) {
+					rhs[i] = loadu8(entries[9 + i]);
+					for (size_t k = 0; k < 3; ++k) {
+						a[i][k] = loadu8(entries[3 * i + k]);
+					}
+				}
+				const int solvable = signMask(solve(a, rhs, solution));
+				singular += n - std::popcount(static_cast<unsigned>(solvable) & ((1u << n) - 1));
+				float out[3][Lanes];
+				for (size_t k = 0; k < 3; ++k) {
+					storeu(out[k], solution[k]);
+				}
+				for (size_t l = 0; l < n; ++l) {
+					x[base + l] = { out[0][l], out[1][l], out[2][l] };
+				}
+			}
+		}
+		else {
+			for (size_t i = begin; i < end; ++i) {
+				singular += solve(m[i], b[i], x[i]) ? 0 : 1;
+			}
+		}
+		return singular;
+	}
+
+	template<class T>
+	inline constexpr size_t Chunk = chunkItems(sizeof(Matrix<3, 3, T>) + sizeof(SymmetricEigen<T>));
+}
+
+}
+
+/*
+* Symmetric Eigen-decomposition
+* The eigenvalues, ascending, and eigenvectors of a symmetric 3x3 matrix, see
+* math3d::SymmetricEigen. Only the upper triangle of m is read. The batched functions
+* decompose eight float matrices at a time in SIMD lanes, with the same results as the
+* single function, and out must hold m.size() decompositions. Matrices with infinite
+* or NaN entries give NaN.
+*/
+template<class T>
+math3d::SymmetricEigen<T> eigenSymmetric(const math3d::Matrix<3, 3, T>& m) {
+	static_assert(std::is_floating_point_v<T>, "eigenSymmetric needs a floating point element type");
+	return math3d::linearAlgebraKernels::eigen(m);
+}
+
+template<class T>
+void eigenSymmetric(std::span<const math3d::Matrix<3, 3, T>> m, std::span<math3d::SymmetricEigen<T>> out) {
+	static_assert(std::is_floating_point_v<T>, "eigenSymmetric needs a floating point element type");
+	math3d::linearAlgebraKernels::eigen(m, out, 0, m.size());
+}
+
+template<class T>
+void eigenSymmetric(math3d::ThreadPool& pool, std::span<const math3d::Matrix<3, 3, T>> m, std::span<math3d::SymmetricEigen<T>> out) {
+	static_assert(std::is_floating_point_v<T>, "eigenSymmetric needs a floating point element type");
+	math3d::parallelFor(pool, m.size(), math3d::linearAlgebraKernels::Chunk<T>, [&](size_t begin, size_t end) {
+		math3d::linearAlgebraKernels::eigen(m, out, begin, end);
+	});
+}
+
+/*
+* 3x3 Linear Systems
+* Solves a x = b by Cramer's rule. A singular or nearly singular a, with a determinant
+* below epsilon times the product of its row lengths, gives x = 0 and false. The batched
+* functions solve eight float systems at a time in SIMD lanes, with the same results as
+* the single function, and return the number of singular systems. x must hold a.size()
+* solutions. For ill conditioned systems Cramer's rule is less accurate than a
+* pivoting factorization, the error grows with the condition number of a.
+*/
+template<class T>
+bool solve(const math3d::Matrix<3, 3, T>& a, const math3d::Vec<3, T>& b, math3d::Vec<3, T>& x) {
+	static_assert(std::is_floating_point_v<T>, "solve needs a floating point element type");
+	return math3d::linearAlgebraKernels::solve(a, b, x);
+}
+
+template<class T>
+size_t solve(std::span<const math3d::Matrix<3, 3, T>> a, std::span<const math3d::Vec<3, T>> b, std::span<math3d::Vec<3, T>> x) {
+	static_assert(std::is_floating_point_v<T>, "solve needs a floating point element type");
+	return math3d::linearAlgebraKernels::solve(a, b, x, 0, a.size());
+}
+
+template<class T>
+size_t solve(math3d::ThreadPool& pool, std::span<const math3d::Matrix<3, 3, T>> a, std::span<const math3d::Vec<3, T>> b, std::span<math3d::Vec<3, T>> x) {
+	static_assert(std::is_floating_point_v<T>, "solve needs a floating point element type");
+	return math3d::parallelReduce(pool, a.size(), math3d::linearAlgebraKernels::Chunk<T>, size_t(0),
+		[&](size_t begin, size_t end) { return math3d::linearAlgebraKernels::solve(a, b, x, begin, end); },
+		[](size_t u, size_t v) { return u + v; });
+}
@@ -1,518 +1,1144 @@
-#pragma once
-
-namespace math3d {
-
-template<size_t Rows, size_t Cols, class T>
-struct Matrix {
-	Matrix() = delete;
-};
-
-/*
-* Column or Row Vector?
-* There is NO DISTINCTION here between column vectors and row vectors. All vectors
-* are implemented as 1-Column matrices, which suggests they're "column vectors", but that's
-* not meaningful.
-* In particular:
-*	-Getting the ith column of a matrix returns the same vector orientation as getting a row.
-*	-For matrix multiplication, a vector v on the right in (Mv) is interpreted
-*	 a column vector, a vector on the left in (vM), the v on the left is a row vector
-*   -if you write the dot product of v an w as a matrix multiplication, the vector on the left will
-*	 be interpreted as a row and the vector on the right will be a column.
-*	-In the case that you want the outer product/dyad product of v and w,
-*	 there is a particular function for that. (TODO make that function)
-*	-You cannot explicitly transpose a vector
-*/
-template<size_t Dim, class T>
-using Vec = Matrix<Dim, 1, T>;
-
-}
-
-//forward declarations of crossProduct so that they can be defined in Vec2, Vec3 interface
-//Visual Studio intellisense is sometimes not happy about these cross product
-//functions, but they compile fine
-template<class T, class U, class R = decltype(T{} *U{}) >
-constexpr R crossProduct(const math3d::Vec<2, T>& a, const math3d::Vec<2, U>& b);
-
-template<class T, class U, class R = decltype(T{} *U{}) >
-constexpr math3d::Vec<3, R> crossProduct(const math3d::Vec<3, T>& a, const math3d::Vec<3, U>& b);
-
-namespace math3d {
-
-template<size_t Place, class T>
-struct VecUnpack {
-	
-};
-
-template<class T>
-struct VecUnpack<0, T> {
-	template<size_t Rows, size_t Cols>
-	static constexpr Matrix<Rows, Cols, T>::RowType get(const Matrix<Rows, Cols, T>& v) {
-		static_assert(Rows > 0);
-		return v.x;
-	}
-
-	template<size_t Rows, size_t Cols>
-	static Matrix<Rows, Cols, T>::RowType& get(Matrix<Rows, Cols, T>& v) {
-		static_assert(Rows > 0);
-		return v.x;
-	}
-};
-
-template<class T>
-struct VecUnpack<1, T> {
-	template<size_t Rows, size_t Cols>
-	static constexpr Matrix<Rows, Cols, T>::RowType get(const Matrix<Rows, Cols, T>& v) {
-		static_assert(Rows > 1);
-		return v.y;
-	}
-
-	template<size_t Rows, size_t Cols>
-	static Matrix<Rows, Cols, T>::RowType& get(Matrix<Rows, Cols, T>& v) {
-		static_assert(Rows > 1);
-		return v.y;
-	}
-};
-
-template<class T>
-struct VecUnpack<2, T> {
-	template<size_t Rows, size_t Cols>
-	static constexpr Matrix<Rows, Cols, T>::RowType get(const Matrix<Rows, Cols, T>& v) {
-		static_assert(Rows > 2);
-		return v.z;
-	}
-
-	template<size_t Rows, size_t Cols>
-	static Matrix<Rows, Cols, T>::RowType& get(Matrix<Rows, Cols, T>& v) {
-		static_assert(Rows > 2);
-		return v.z;
-	}
-};
-
-template<class T>
-struct VecUnpack<3, T> {
-	template<size_t Rows, size_t Cols>
-	static constexpr Matrix<Rows, Cols, T>::RowType get(const Matrix<Rows, Cols, T>& v) {
-		static_assert(Rows > 3);
-		return v.w;
-	}
-
-	template<size_t Rows, size_t Cols>
-	static Matrix<Rows, Cols, T>::RowType& get(Matrix<Rows, Cols, T>& v) {
-		static_assert(Rows > 3);
-		return v.w;
-	}
-};
-
-/*
-* 2-Vector
-*/
-template<class T>
-struct Matrix<2, 1, T>{
-	using RowType = T;
-
-	T x = 0;
-	T y = 0;
-
-	template<class U>
-	constexpr explicit operator Vec<2, U>() {
-		return { x, y };
-	}
-
-	T operator[](size_t i) const{
-		return &x[i];
-	}
-
-	template<size_t I>
-	constexpr T get() const{
-		return VecUnpack<I, T>::get(*this);
-	}
-
-	template<class U>
-	constexpr decltype(::crossProduct(Vec<2, T>{}, Vec<2, U>{})) cross(const Vec<2, U>& u) const {
-		return ::crossProduct(*this, u);
-	}
-
-	constexpr Vec<2, T> normal() const{
-		return { -y, x };
-	}
-};
-
-/*
-* 3-Vector
-*/
-template<class T>
-struct Matrix<3, 1, T>{
-	using RowType = T;
-
-	T x = 0;
-	T y = 0;
-	T z = 0;
-
-	template<class U>
-	constexpr explicit operator Vec<3, U>() {
-		return { x, y, z };
-	}
-
-	T operator[](size_t i) const{
-		return &x[i];
-	}
-
-	template<size_t I>
-	constexpr T get() const {
-		return VecUnpack<I, T>::get(*this);
-	}
-
-	template<class U>
-	constexpr decltype(::crossProduct(Vec<3, T>{}, Vec<3, U>{})) cross(const Vec<3, U>& u) const {
-		return ::crossProduct(*this, u);
-	}
-};
-
-/*
-* 4-Vector
-*/
-template<class T>
-struct Matrix<4, 1, T>{
-	using RowType = T;
-
-	T x = 0;
-	T y = 0;
-	T z = 0;
-	T w = 0;
-
-	template<class U>
-	constexpr explicit operator Vec<4, U>() {
-		return { x, y, z, w };
-	}
-
-	T operator[](size_t i) const{
-		return &x[i];
-	}
-
-	template<size_t I>
-	constexpr T get() const {
-		return VecUnpack<I, T>::get(*this);
-	}
-};
-
-template<size_t Cols, class T>
-struct Matrix<2, Cols, T> {
-	using RowType = Vec<Cols, T>;
-
-	RowType x = {};
-	RowType y = {};
-
-	template<size_t I>
-	constexpr RowType get() const {
-		return VecUnpack<I, T>::get(*this);
-	}
-};
-
-template<size_t Cols, class T>
-struct Matrix<3, Cols, T> {
-	using RowType = Vec<Cols, T>;
-
-	RowType x = {};
-	RowType y = {};
-	RowType z = {};
-
-	template<size_t I>
-	constexpr RowType get() const {
-		return VecUnpack<I, T>::get(*this);
-	}
-};
-
-template<size_t Cols, class T>
-struct Matrix<4, Cols, T> {
-	using RowType = Vec<Cols, T>;
-
-	RowType x = {};
-	RowType y = {};
-	RowType z = {};
-	RowType w = {};
-
-	template<size_t I>
-	constexpr RowType get() const {
-		return VecUnpack<I, T>::get(*this);
-	}
-};
-
-namespace componentwise {
-	template<size_t Rows, size_t Cols, class T, class U, class R = decltype(T{} *U{}) >
-	constexpr Matrix < Rows, Cols, R> operator*(const Matrix<Rows, Cols, T>& a, const Matrix<Rows, Cols, U>& b) {
-		using Mult = MatrixArithmetic<Rows, Cols, T, U>::Multiply;
-		return ComponentwiseOp<Rows - 1, Mult>::mmop(a, b);
-	}
-}
-
-using componentwise::operator*;
-
-//For scalar-matrix operations, parameter T is used for the matrix element type
-//and parameter U is used for the scalar type
-template<size_t Rows, size_t Cols, class T, class U>
-struct MatrixArithmetic {
-	using Mat_t = Matrix<Rows, Cols, T>;
-	using Mat_u = Matrix<Rows, Cols, U>;
-	using R_t = Mat_t::RowType;
-	using R_u = Mat_u::RowType;
-
-
-	struct Add {
-		static constexpr decltype(R_t{} + R_u{}) value(const R_t &tRow, const R_u &uRow) {
-			return tRow + uRow;
-		}
-	};
-
-	struct Subtract {
-		static constexpr decltype(R_t{} - R_u{}) value(const R_t &tRow, const R_u &uRow) {
-			return tRow - uRow;
-		}
-	};
-
-	struct Multiply {
-		static constexpr decltype(R_t{} *R_u{}) value(const R_t &a, const R_u &b) {
-			return a * b;
-		}
-	};
-
-	struct ScalarMultiply {
-		static constexpr R_t value(R_t vec, U scalar) {
-			return static_cast<R_t>(vec * scalar);
-		}
-	};
-
-	struct ScalarDivide {
-		//here, parameter a will the vector component, b will be the scalar
-		static constexpr R_t value(R_t vec, U scalar) {
-			return static_cast<R_t>(vec / scalar);
-		}
-	};
-};
-
-/*
-* When applied to a Matrix<Rows, Cols, T>, the starting case should be called with Place = Rows - 1
-* When applied to a Vec<Dim, T>, the starting case should be called with Place = Dim - 1
-*/
-template<size_t Place, class Op>
-struct ComponentwiseOp {
-	using Succ = ComponentwiseOp<Place - 1, Op>;
-	
-	template<class T, class U>
-	using RType = decltype(Op::value(T{}, U{}));
-
-	//Matrix-Matrix operations
-	//Recursive Case
-	template<size_t Rows, size_t Cols, class T, class U, class... Tail>
-	static constexpr Matrix<Rows, Cols, RType<T, U>> mmop(const Matrix<Rows, Cols, T>& a, const Matrix<Rows, Cols, U>& b, Tail... tail) {
-		return Succ::mmop(a, b, Op::value(a.template get<Place>(), b.template get<Place>()), tail...);
-	}
-
-	//Matrix-Scalar operations
-	//Recursive Case
-	template<size_t Dim, class VType, class ScalarType, class... Ts>
-	static constexpr Vec<Dim, VType> smop(const Vec<Dim, VType>& v, ScalarType s, Ts... ts) {
-		return Succ::smop(v, s, Op::value(v.template get<Place>(), s), ts...);
-	}
-};
-
-template<class Op>
-struct ComponentwiseOp<0, Op> {
-	template<class T, class U>
-	using RType = decltype(Op::value(T{}, U{}));
-
-	//Matrix-Matrix operations
-	//Base case
-	template<size_t Rows, size_t Cols, class T, class U, class... Tail>
-	static constexpr Matrix<Rows, Cols, RType<T, U>> mmop(const Matrix<Rows, Cols, T>& a, const Matrix<Rows, Cols, U>& b, Tail... tail) {
-		return { Op::value(a.template get<0>(), b.template get<0>()), tail... };
-	}
-
-	//Scalar-Vector Operations
-	//Base case
-	template<size_t Dim, class VType, class ScalarType, class... Ts>
-	static constexpr Vec<Dim, VType> smop(const Vec<Dim, VType>& v, ScalarType s, Ts... ts) {
-		return { Op::value(v.template get<0>(), s), ts... };
-	}
-};
-
-template<size_t Place>
-struct DotProdIteration {
-	using Succ = DotProdIteration<Place - 1>;
-	
-	template<class T, class U>
-	using RType = decltype(T{} *U{});
-
-	//Recursive Case
-	template<size_t Dim, class T, class U>
-	static constexpr RType<T, U> dot(const Vec<Dim, T>& t, const Vec<Dim, U>& u) {
-		return (t.template get<Place>() * u.template get<Place>()) + Succ::dot(t, u);
-	}
-	
-	//defining both equals and notequals explicitly here until I get around to
-	//verifying the compiler can apply demorgans to optimize whenever appropriate
-	template<size_t Dim, class T, class U>
-	static constexpr bool equals(const Vec<Dim, T>& t, const Vec<Dim, U>& u) {
-		return (t.template get<Place>() == u.template get<Place>()) && Succ::equals(t, u);
-	}
-
-	template<size_t Dim, class T, class U>
-	static constexpr bool notequals(const Vec<Dim, T>& t, const Vec<Dim, U>& u) {
-		return (t.template get<Place>() != u.template get<Place>()) || Succ::notequals(t, u);
-	}
-};
-
-template<>
-struct DotProdIteration<0> {
-	template<class T, class U>
-	using RType = decltype(T{} *U{});
-
-	//base case
-	template<size_t Dim, class T, class U>
-	static constexpr RType<T, U> dot(const Vec<Dim, T>& t, const Vec<Dim, U>& u) {
-		return t.template get<0>() * u.template get<0>();
-	}
-
-	template<size_t Dim, class T, class U>
-	static constexpr bool equals(const Vec<Dim, T>& t, const Vec<Dim, U>& u) {
-		return t.template get<0>() == u.template get<0>();
-	}
-
-	template<size_t Dim, class T, class U>
-	static constexpr bool notequals(const Vec<Dim, T>& t, const Vec<Dim, U>& u) {
-		return t.template get<0>() != u.template get<0>();
-	}
-};
-
-}
-
-/*
-* Matrix Addition and Subtraction
-*/
-template<size_t Rows, size_t Cols, class T, class U, class R = decltype(T{} + U{}) >
-constexpr math3d::Matrix<Rows, Cols, R> operator+(const math3d::Matrix<Rows, Cols, T>& a, const math3d::Matrix<Rows, Cols, U>& b) {
-	using Add = math3d::MatrixArithmetic<Rows, Cols, T, U>::Add;
-	return math3d::ComponentwiseOp<Rows - 1, Add>::mmop(a, b);
-}
-
-template<size_t Rows, size_t Cols, class T, class U, class R = decltype(T{} - U{}) >
-constexpr math3d::Matrix<Rows, Cols, R> operator-(const math3d::Matrix<Rows, Cols, T>& a, const math3d::Matrix<Rows, Cols, U>& b) {
-	using Subtract = math3d::MatrixArithmetic<Rows, Cols, T, U>::Subtract;
-	return math3d::ComponentwiseOp<Rows - 1, Subtract>::mmop(a, b);
-}
-
-/*
-* Componentwise Multiplication (Hadamard Product)
-* You can optionally use operator* as componentwiseProduct by
-*	using math3d::componentwise::operator*;
-*/
-template<size_t Rows, size_t Cols, class T, class U, class R = decltype(T{} *U{}) >
-constexpr math3d::Matrix < Rows, Cols, R> componentwiseProduct(const math3d::Matrix<Rows, Cols, T>& a, const math3d::Matrix<Rows, Cols, U>& b) {
-	using Mult = math3d::MatrixArithmetic<Rows, Cols, T, U>::Multiply;
-	return ComponentwiseOp<Rows - 1, Mult>::mmop(a, b);
-}
-
-/*
- * Scalar Multiplication:
- * Returns Vec of the same type as the Vec argument, regardless of scalar type
- */
-
-template<size_t Rows, size_t Cols, class MType, class ScalarType>
-constexpr math3d::Matrix<Rows, Cols, MType> operator*(ScalarType c, const math3d::Matrix<Rows, Cols, MType>& m) {
-	using Multiply = math3d::MatrixArithmetic<Rows, Cols, MType, ScalarType>::ScalarMultiply;
-	return math3d::ComponentwiseOp<Rows - 1, Multiply>::smop(m, c);
-}
-
-template<size_t Rows, size_t Cols, class MType, class ScalarType>
-constexpr math3d::Matrix<Rows, Cols, MType> operator*(const math3d::Matrix<Rows, Cols, MType>& m, ScalarType c) {
-	return operator*(c, m);
-}
-
-template<size_t Rows, size_t Cols, class MType, class ScalarType>
-constexpr math3d::Matrix<Rows, Cols, MType> operator/(const math3d::Matrix<Rows, Cols, MType>& m, ScalarType c) {
-	using Divide = math3d::MatrixArithmetic<Rows, Cols, MType, ScalarType>::ScalarDivide;
-	return math3d::ComponentwiseOp<Rows - 1, Divide>::smop(m, c);
-}
-
-//////////////////////////////////////////////
-
-/*
-* Dot Product
-* Actually, I don't know what the dot product of a Vec4 in homogeneous coordinates should be...
-*	Well, it's still important for matrix operations, but maybe 3d vector products should also be here
-*	for Vec4 in homogeneous coordinates?
-*/
-template<size_t Dim, class T, class U, class R = decltype(T{} *U{}) >
-constexpr R dotProduct(const math3d::Vec<Dim, T>& a, const math3d::Vec<Dim, U>& b) {
-	return math3d::DotProdIteration<Dim - 1>::dot(a, b);
-}
-
-template<size_t Dim, class T>
-constexpr T lengthSquared(const math3d::Vec<Dim, T>& v) {
-	return dotProduct(v, v);
-}
-
-template<size_t Dim, class T, class U>
-constexpr bool operator!=(const math3d::Vec<Dim, T>& a, const math3d::Vec<Dim, U>& b) {
-	return math3d::DotProdIteration<Dim - 1>::notequals(a, b);
-}
-
-template<size_t Dim, class T, class U>
-constexpr bool operator==(const math3d::Vec<Dim, T>& a, const math3d::Vec<Dim, U>& b) {
-	return math3d::DotProdIteration<Dim - 1>::equals(a, b);
-}
-
-/*
-* Cross Product (2D)
-*/
-template<class T, class U, class R >
-constexpr R crossProduct(const math3d::Vec<2, T>& a, const math3d::Vec<2, U>& b) {
-	return a.x * b.y - a.y * b.x;
-}
-
-/*
-* Cross Product (3D)
-*/
-template<class T, class U, class R >
-constexpr math3d::Vec < 3, R > crossProduct(const math3d::Vec<3, T>& a, const math3d::Vec<3, U>& b) {
-	return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
-}
-
-/*
-* Geometry metrics
-*/
-namespace std {
-	//forward declarations to avoid inclusion of cmath here
-	float sqrt(float);
-	double sqrt(double);
-	long double sqrt(long double);
-
-	float atan2(float, float);
-	double atan2(double, double);
-	long double atan2(long double, long double);
-}
-
-template<class T>
-using RootType = decltype(std::sqrt(T{}));
-template<size_t Dim, class T>
-RootType<T> length(const math3d::Vec<Dim, T>& v) {
-	return std::sqrt(lengthSquared(v));
-}
-
-template<class T, class U>
-using AngleType = decltype(std::atan2(T{} *U{}, T{} *U{}));
-template<class T, class U>
-AngleType<T, U> angle(const math3d::Vec<2, T>& t, const math3d::Vec<2, U>& u) {
-	return std::atan2(crossProduct(t, u), dotProduct(t, u));
-}
-
-//You really want the angle and also the axis that angle is about,
-//should be able to get the pair from another function
-template<class T, class U>
-AngleType<T, U> angle(const math3d::Vec<3, T>& t, const math3d::Vec<3, U>& u) {
-	return atan2(length(crossProduct(t, u)), dotProduct(t, u));
-}
-
-template<size_t Dim, class T>
-math3d::Vec<Dim, RootType<T>> unit(const math3d::Vec<Dim, T>& v) {
-	return v / length(v);
+#pragma once
+
+#include <cstddef>
+#include <cmath>
+#include <type_traits>
+#include <utility>
+
+#include "simd.h"
+
+namespace math3d {
+
+template<size_t Rows, size_t Cols, class T>
+struct Matrix;
+
+/*
+* Column or Row Vector?
+* There is NO DISTINCTION here between column vectors and row vectors. All vectors
+* are implemented as 1-Column matrices, which suggests they're "column vectors", but that's
+* not meaningful.
+* In particular:
+*	-Getting the ith column of a matrix returns the same vector orientation as getting a row.
+*	-For matrix multiplication, a vector v on the right in (Mv) is interpreted
+*	 a column vector, a vector on the left in (vM), the v on the left is a row vector
+*   -if you write the dot product of v an w as a matrix multiplication, the vector on the left will
+*	 be interpreted as a row and the vector on the right will be a column.
+*	-In the case that you want the outer product/dyad product of v and w,
+*	 there is a particular function for that, outerProduct(v, w).
+*	-You cannot explicitly transpose a vector
+*/
+template<size_t Dim, class T>
+using Vec = Matrix<Dim, 1, T>;
+
+template<class T>
+inline constexpr bool IsMatrix = false;
+
+template<size_t Rows, size_t Cols, class T>
+inline constexpr bool IsMatrix<Matrix<Rows, Cols, T>> = true;
+
+}
+
+//forward declarations of crossProduct so that they can be defined in Vec2, Vec3 interface
+//Visual Studio intellisense is sometimes not happy about these cross product
+//functions, but they compile fine
+template<class T, class U, class R = decltype(T{} *U{}) >
+constexpr R crossProduct(const math3d::Vec<2, T>& a, const math3d::Vec<2, U>& b);
+
+template<class T, class U, class R = decltype(T{} *U{}) >
+constexpr math3d::Vec<3, R> crossProduct(const math3d::Vec<3, T>& a, const math3d::Vec<3, U>& b);
+
+//forward declarations of the arithmetic operators, so that MatrixArithmetic can apply them
+//to the rows of a matrix
+template<size_t Rows, size_t Cols, class T, class U, class R = decltype(T{} + U{}) >
+constexpr math3d::Matrix<Rows, Cols, R> operator+(const math3d::Matrix<Rows, Cols, T>& a, const math3d::Matrix<Rows, Cols, U>& b);
+
+template<size_t Rows, size_t Cols, class T, class U, class R = decltype(T{} - U{}) >
+constexpr math3d::Matrix<Rows, Cols, R> operator-(const math3d::Matrix<Rows, Cols, T>& a, const math3d::Matrix<Rows, Cols, U>& b);
+
+template<size_t Rows, size_t Cols, class MType, class ScalarType> requires (!math3d::IsMatrix<ScalarType>)
+constexpr math3d::Matrix<Rows, Cols, MType> operator*(ScalarType c, const math3d::Matrix<Rows, Cols, MType>& m);
+
+template<size_t Rows, size_t Cols, class MType, class ScalarType> requires (!math3d::IsMatrix<ScalarType>)
+constexpr math3d::Matrix<Rows, Cols, MType> operator*(const math3d::Matrix<Rows, Cols, MType>& m, ScalarType c);
+
+template<size_t Rows, size_t Cols, class MType, class ScalarType> requires (!math3d::IsMatrix<ScalarType>)
+constexpr math3d::Matrix<Rows, Cols, MType> operator/(const math3d::Matrix<Rows, Cols, MType>& m, ScalarType c);
+
+template<size_t Rows, size_t Cols, class T, class U, class R = decltype(T{} *U{}) >
+constexpr math3d::Matrix<Rows, Cols, R> componentwiseProduct(const math3d::Matrix<Rows, Cols, T>& a, const math3d::Matrix<Rows, Cols, U>& b);
+
+template<size_t Rows, size_t Cols, class T, class U>
+constexpr bool operator!=(const math3d::Matrix<Rows, Cols, T>& a, const math3d::Matrix<Rows, Cols, U>& b);
+
+template<size_t Rows, size_t Cols, class T, class U>
+constexpr bool operator==(const math3d::Matrix<Rows, Cols, T>& a, const math3d::Matrix<Rows, Cols, U>& b);
+
+namespace math3d {
+
+/*
+* Rows of the 2, 3 and 4 row specializations, which are named x, y, z and w
+* Both return a const reference for a const matrix.
+*/
+template<size_t I, class M>
+constexpr auto& namedRow(M& m) {
+	if constexpr (I == 0) {
+		return m.x;
+	}
+	else if constexpr (I == 1) {
+		return m.y;
+	}
+	else if constexpr (I == 2) {
+		return m.z;
+	}
+	else {
+		static_assert(I == 3, "row index out of range");
+		return m.w;
+	}
+}
+
+//i must be less than the number of rows
+template<class M>
+constexpr auto& namedRow(M& m, size_t i) {
+	if constexpr (requires { m.w; }) {
+		if (i == 3) {
+			return m.w;
+		}
+	}
+	if constexpr (requires { m.z; }) {
+		if (i == 2) {
+			return m.z;
+		}
+	}
+	return i == 0 ? m.x : m.y;
+}
+
+/*
+* 2-Vector
+*/
+template<class T>
+struct Matrix<2, 1, T>{
+	using RowType = T;
+
+	T x = 0;
+	T y = 0;
+
+	template<class U>
+	constexpr explicit operator Vec<2, U>() const {
+		return { static_cast<U>(x), static_cast<U>(y) };
+	}
+
+	constexpr const T& operator[](size_t i) const {
+		return namedRow(*this, i);
+	}
+
+	constexpr T& operator[](size_t i) {
+		return namedRow(*this, i);
+	}
+
+	template<size_t I>
+	constexpr const T& get() const {
+		return namedRow<I>(*this);
+	}
+
+	template<size_t I>
+	constexpr T& get() {
+		return namedRow<I>(*this);
+	}
+
+	template<class U>
+	constexpr decltype(T{} *U{}) cross(const Vec<2, U>& u) const {
+		return ::crossProduct(*this, u);
+	}
+
+	constexpr Vec<2, T> normal() const{
+		return { -y, x };
+	}
+};
+
+/*
+* 3-Vector
+*/
+template<class T>
+struct Matrix<3, 1, T>{
+	using RowType = T;
+
+	T x = 0;
+	T y = 0;
+	T z = 0;
+
+	template<class U>
+	constexpr explicit operator Vec<3, U>() const {
+		return { static_cast<U>(x), static_cast<U>(y), static_cast<U>(z) };
+	}
+
+	constexpr const T& operator[](size_t i) const {
+		return namedRow(*this, i);
+	}
+
+	constexpr T& operator[](size_t i) {
+		return namedRow(*this, i);
+	}
+
+	template<size_t I>
+	constexpr const T& get() const {
+		return namedRow<I>(*this);
+	}
+
+	template<size_t I>
+	constexpr T& get() {
+		return namedRow<I>(*this);
+	}
+
+	template<class U>
+	constexpr Vec<3, decltype(T{} *U{})> cross(const Vec<3, U>& u) const {
+		return ::crossProduct(*this, u);
+	}
+};
+
+/*
+* 4-Vector
+* Vec<4, float> is always 16 byte aligned so that SIMD loads of it are aligned and
+* so that it has the same layout whether or not MATH3D_SIMD is enabled
+*/
+template<class T>
+struct alignas(std::is_same_v<T, float> ? 16 : alignof(T)) Matrix<4, 1, T>{
+	using RowType = T;
+
+	T x = 0;
+	T y = 0;
+	T z = 0;
+	T w = 0;
+
+	template<class U>
+	constexpr explicit operator Vec<4, U>() const {
+		return { static_cast<U>(x), static_cast<U>(y), static_cast<U>(z), static_cast<U>(w) };
+	}
+
+	constexpr const T& operator[](size_t i) const {
+		return namedRow(*this, i);
+	}
+
+	constexpr T& operator[](size_t i) {
+		return namedRow(*this, i);
+	}
+
+	template<size_t I>
+	constexpr const T& get() const {
+		return namedRow<I>(*this);
+	}
+
+	template<size_t I>
+	constexpr T& get() {
+		return namedRow<I>(*this);
+	}
+};
+
+template<size_t Cols, class T>
+struct Matrix<2, Cols, T> {
+	using RowType = Vec<Cols, T>;
+
+	RowType x = {};
+	RowType y = {};
+
+	constexpr const RowType& operator[](size_t i) const {
+		return namedRow(*this, i);
+	}
+
+	constexpr RowType& operator[](size_t i) {
+		return namedRow(*this, i);
+	}
+
+	template<size_t I>
+	constexpr const RowType& get() const {
+		return namedRow<I>(*this);
+	}
+
+	template<size_t I>
+	constexpr RowType& get() {
+		return namedRow<I>(*this);
+	}
+};
+
+template<size_t Cols, class T>
+struct Matrix<3, Cols, T> {
+	using RowType = Vec<Cols, T>;
+
+	RowType x = {};
+	RowType y = {};
+	RowType z = {};
+
+	constexpr const RowType& operator[](size_t i) const {
+		return namedRow(*this, i);
+	}
+
+	constexpr RowType& operator[](size_t i) {
+		return namedRow(*this, i);
+	}
+
+	template<size_t I>
+	constexpr const RowType& get() const {
+		return namedRow<I>(*this);
+	}
+
+	template<size_t I>
+	constexpr RowType& get() {
+		return namedRow<I>(*this);
+	}
+};
+
+template<size_t Cols, class T>
+struct Matrix<4, Cols, T> {
+	using RowType = Vec<Cols, T>;
+
+	RowType x = {};
+	RowType y = {};
+	RowType z = {};
+	RowType w = {};
+
+	constexpr const RowType& operator[](size_t i) const {
+		return namedRow(*this, i);
+	}
+
+	constexpr RowType& operator[](size_t i) {
+		return namedRow(*this, i);
+	}
+
+	template<size_t I>
+	constexpr const RowType& get() const {
+		return namedRow<I>(*this);
+	}
+
+	template<size_t I>
+	constexpr RowType& get() {
+		return namedRow<I>(*this);
+	}
+};
+
+/*
+* N-Vector and N-Row Matrix
+* Every other size, e.g. 6 or 9 dimensional state vectors and 6x6 covariance matrices.
+* The rows are stored contiguously in an array, so a Vec is initialized like one,
+*	Vec<6, float>{ 1, 2, 3, 4, 5, 6 }
+* and a matrix from its rows, Matrix<6, 6, float>{ r0, r1, r2, r3, r4, r5 }, or from
+* braced rows with one more pair of braces around them.
+*/
+template<size_t Rows, size_t Cols, class T>
+struct Matrix {
+	static_assert(Rows > 0 && Cols > 0);
+	using RowType = std::conditional_t<Cols == 1, T, Vec<Cols, T>>;
+
+	RowType rows[Rows] = {};
+
+	template<class U> requires (Cols == 1)
+	constexpr explicit operator Vec<Rows, U>() const {
+		Vec<Rows, U> v;
+		for (size_t i = 0; i < Rows; ++i) {
+			v.rows[i] = static_cast<U>(rows[i]);
+		}
+		return v;
+	}
+
+	constexpr const RowType& operator[](size_t i) const {
+		return rows[i];
+	}
+
+	constexpr RowType& operator[](size_t i) {
+		return rows[i];
+	}
+
+	template<size_t I>
+	constexpr const RowType& get() const {
+		static_assert(I < Rows, "row index out of range");
+		return rows[I];
+	}
+
+	template<size_t I>
+	constexpr RowType& get() {
+		static_assert(I < Rows, "row index out of range");
+		return rows[I];
+	}
+};
+
+//For scalar-matrix operations, parameter T is used for the matrix element type
+//and parameter U is used for the scalar type
+template<size_t Rows, size_t Cols, class T, class U>
+struct MatrixArithmetic {
+	using Mat_t = Matrix<Rows, Cols, T>;
+	using Mat_u = Matrix<Rows, Cols, U>;
+	using R_t = Mat_t::RowType;
+	using R_u = Mat_u::RowType;
+
+
+	struct Add {
+		static constexpr decltype(R_t{} + R_u{}) value(const R_t &tRow, const R_u &uRow) {
+			return tRow + uRow;
+		}
+	};
+
+	struct Subtract {
+		static constexpr decltype(R_t{} - R_u{}) value(const R_t &tRow, const R_u &uRow) {
+			return tRow - uRow;
+		}
+	};
+
+	//operator* on two rows would be a dot product, so rows are multiplied componentwise too
+	struct Multiply {
+		static constexpr auto value(const R_t &a, const R_u &b) {
+			if constexpr (Cols == 1) {
+				return a * b;
+			}
+			else {
+				return componentwiseProduct(a, b);
+			}
+		}
+	};
+
+	struct ScalarMultiply {
+		static constexpr R_t value(R_t vec, U scalar) {
+			return static_cast<R_t>(vec * scalar);
+		}
+	};
+
+	struct ScalarDivide {
+		//here, parameter a will the vector component, b will be the scalar
+		static constexpr R_t value(R_t vec, U scalar) {
+			return static_cast<R_t>(vec / scalar);
+		}
+	};
+};
+
+//Element type of a row, so that the result type of an Op applied to rows can be
+//turned back into a Matrix element type
+template<class Row>
+struct RowElement {
+	using type = Row;
+};
+
+template<size_t Dim, class T>
+struct RowElement<Vec<Dim, T>> {
+	using type = T;
+};
+
+template<class Op, size_t Rows, size_t Cols, class T, class U>
+using OpElementType = RowElement<decltype(Op::value(typename Matrix<Rows, Cols, T>::RowType{}, typename Matrix<Rows, Cols, U>::RowType{}))>::type;
+
+/*
+* Componentwise operations
+* Op is applied to every pair of rows (or to every row and a scalar) in one pack
+* expansion, so the instantiation depth does not grow with the number of rows.
+*/
+template<class Op>
+struct ComponentwiseOp {
+	//Matrix-Matrix operations
+	template<size_t Rows, size_t Cols, class T, class U, size_t... I>
+	static constexpr Matrix<Rows, Cols, OpElementType<Op, Rows, Cols, T, U>> mmop(const Matrix<Rows, Cols, T>& a, const Matrix<Rows, Cols, U>& b, std::index_sequence<I...>) {
+		return { Op::value(a.template get<I>(), b.template get<I>())... };
+	}
+
+	template<size_t Rows, size_t Cols, class T, class U>
+	static constexpr Matrix<Rows, Cols, OpElementType<Op, Rows, Cols, T, U>> mmop(const Matrix<Rows, Cols, T>& a, const Matrix<Rows, Cols, U>& b) {
+		return mmop(a, b, std::make_index_sequence<Rows>{});
+	}
+
+	//Matrix-Scalar operations
+	template<size_t Rows, size_t Cols, class MType, class ScalarType, size_t... I>
+	static constexpr Matrix<Rows, Cols, MType> smop(const Matrix<Rows, Cols, MType>& v, ScalarType s, std::index_sequence<I...>) {
+		return { Op::value(v.template get<I>(), s)... };
+	}
+
+	template<size_t Rows, size_t Cols, class MType, class ScalarType>
+	static constexpr Matrix<Rows, Cols, MType> smop(const Matrix<Rows, Cols, MType>& v, ScalarType s) {
+		return smop(v, s, std::make_index_sequence<Rows>{});
+	}
+};
+
+namespace componentwise {
+	template<size_t Rows, size_t Cols, class T, class U, class R = decltype(T{} *U{}) >
+	constexpr Matrix < Rows, Cols, R> operator*(const Matrix<Rows, Cols, T>& a, const Matrix<Rows, Cols, U>& b) {
+		using Mult = MatrixArithmetic<Rows, Cols, T, U>::Multiply;
+		return ComponentwiseOp<Mult>::mmop(a, b);
+	}
+}
+
+/*
+* Folds over the components, the dot product is summed left to right
+*/
+struct ComponentwiseFold {
+	template<size_t Dim, class T, class U, size_t... I>
+	static constexpr decltype(T{} *U{}) dot(const Vec<Dim, T>& t, const Vec<Dim, U>& u, std::index_sequence<I...>) {
+		return (... + (t.template get<I>() * u.template get<I>()));
+	}
+
+	//defining both equals and notequals explicitly here until I get around to
+	//verifying the compiler can apply demorgans to optimize whenever appropriate
+	template<size_t Rows, size_t Cols, class T, class U, size_t... I>
+	static constexpr bool equals(const Matrix<Rows, Cols, T>& t, const Matrix<Rows, Cols, U>& u, std::index_sequence<I...>) {
+		return (... && (t.template get<I>() == u.template get<I>()));
+	}
+
+	template<size_t Rows, size_t Cols, class T, class U, size_t... I>
+	static constexpr bool notequals(const Matrix<Rows, Cols, T>& t, const Matrix<Rows, Cols, U>& u, std::index_sequence<I...>) {
+		return (... || (t.template get<I>() != u.template get<I>()));
+	}
+};
+
+/*
+* Element access by compile time row and column. For a Vec, Col must be 0
+*/
+template<size_t Row, size_t Col, size_t Rows, size_t Cols, class T>
+constexpr T element(const Matrix<Rows, Cols, T>& m) {
+	if constexpr (Cols == 1) {
+		static_assert(Col == 0);
+		return m.template get<Row>();
+	}
+	else {
+		return m.template get<Row>().template get<Col>();
+	}
+}
+
+/*
+* Matrix product kernels, unrolled at compile time
+* Every entry of the result is the left fold of its Inner products, which is
+* the same summation order as the SIMD kernels
+*/
+template<size_t Rows, size_t Inner, size_t Cols, class T, class U>
+struct MatrixProduct {
+	using R = decltype(T{} *U{});
+	using Result = Matrix<Rows, Cols, R>;
+	using Left = Matrix<Rows, Inner, T>;
+	using Right = Matrix<Inner, Cols, U>;
+
+	template<size_t I, size_t J, size_t... K>
+	static constexpr R entry(const Left& a, const Right& b, std::index_sequence<K...>) {
+		return (... + (element<I, K>(a) * element<K, J>(b)));
+	}
+
+	template<size_t I, size_t... J>
+	static constexpr Result::RowType row(const Left& a, const Right& b, std::index_sequence<J...>) {
+		if constexpr (Cols == 1) {
+			return entry<I, 0>(a, b, std::make_index_sequence<Inner>{});
+		}
+		else {
+			return { entry<I, J>(a, b, std::make_index_sequence<Inner>{})... };
+		}
+	}
+
+	template<size_t... I>
+	static constexpr Result product(const Left& a, const Right& b, std::index_sequence<I...>) {
+		return { row<I>(a, b, std::make_index_sequence<Cols>{})... };
+	}
+};
+
+//v M, with v as a row vector
+template<size_t Dim, size_t Cols, class T, class U>
+struct RowVectorProduct {
+	using R = decltype(T{} *U{});
+
+	template<size_t J, size_t... K>
+	static constexpr R entry(const Vec<Dim, T>& v, const Matrix<Dim, Cols, U>& m, std::index_sequence<K...>) {
+		return (... + (element<K, 0>(v) * element<K, J>(m)));
+	}
+
+	template<size_t... J>
+	static constexpr Vec<Cols, R> product(const Vec<Dim, T>& v, const Matrix<Dim, Cols, U>& m, std::index_sequence<J...>) {
+		return { entry<J>(v, m, std::make_index_sequence<Dim>{})... };
+	}
+};
+
+//Row I of a b^T is a[I] b
+template<size_t Rows, size_t Cols, class T, class U, class R = decltype(T{} *U{}) >
+struct OuterProduct {
+	template<size_t I, size_t... J>
+	static constexpr typename Matrix<Rows, Cols, R>::RowType row(const Vec<Rows, T>& a, const Vec<Cols, U>& b, std::index_sequence<J...>) {
+		if constexpr (Cols == 1) {
+			return a.template get<I>() * b.template get<0>();
+		}
+		else {
+			return { (a.template get<I>() * b.template get<J>())... };
+		}
+	}
+
+	template<size_t... I>
+	static constexpr Matrix<Rows, Cols, R> product(const Vec<Rows, T>& a, const Vec<Cols, U>& b, std::index_sequence<I...>) {
+		return { row<I>(a, b, std::make_index_sequence<Cols>{})... };
+	}
+};
+
+template<size_t Rows, size_t Cols, class T>
+struct Transpose {
+	template<size_t J, size_t... I>
+	static constexpr Vec<Rows, T> column(const Matrix<Rows, Cols, T>& m, std::index_sequence<I...>) {
+		return { element<I, J>(m)... };
+	}
+
+	template<size_t... J>
+	static constexpr Matrix<Cols, Rows, T> apply(const Matrix<Rows, Cols, T>& m, std::index_sequence<J...>) {
+		return { column<J>(m, std::make_index_sequence<Rows>{})... };
+	}
+};
+
+/*
+* SIMD kernels for Vec<3, float> and Vec<4, float>
+* The operators below use these when MATH3D_SIMD is enabled, except during constant
+* evaluation. Matrix<4, 4, float> and Matrix<3, 3, float> get them through their rows.
+* Results are identical to the scalar path except for dotProduct, where the
+* lanes are summed pairwise, so the last bit can differ.
+*/
+namespace simd {
+	template<size_t Rows, size_t Cols, class T, class U>
+	inline constexpr bool Accelerated = MATH3D_SSE && Cols == 1 && (Rows == 3 || Rows == 4)
+		&& std::is_same_v<T, float> && std::is_same_v<U, float>;
+
+	//Scalars which the scalar operators would convert to float before operating
+	template<class ScalarType>
+	inline constexpr bool FloatScalar = std::is_same_v<ScalarType, float> || std::is_integral_v<ScalarType>;
+
+	template<size_t Dim>
+	inline f32x4 load(const Vec<Dim, float>& v) {
+		if constexpr (Dim == 4) {
+			return load(&v.x);
+		}
+		else {
+			return load3(&v.x);
+		}
+	}
+
+	template<size_t Dim>
+	inline Vec<Dim, float> toVec(f32x4 a) {
+		Vec<Dim, float> v;
+		if constexpr (Dim == 4) {
+			store(&v.x, a);
+		}
+		else {
+			store3(&v.x, a);
+		}
+		return v;
+	}
+
+	template<size_t Dim>
+	inline Vec<Dim, float> add(const Vec<Dim, float>& a, const Vec<Dim, float>& b) {
+		return toVec<Dim>(add(load(a), load(b)));
+	}
+
+	template<size_t Dim>
+	inline Vec<Dim, float> sub(const Vec<Dim, float>& a, const Vec<Dim, float>& b) {
+		return toVec<Dim>(sub(load(a), load(b)));
+	}
+
+	template<size_t Dim>
+	inline Vec<Dim, float> scale(const Vec<Dim, float>& v, float s) {
+		return toVec<Dim>(mul(load(v), splat(s)));
+	}
+
+	template<size_t Dim>
+	inline Vec<Dim, float> divide(const Vec<Dim, float>& v, float s) {
+		return toVec<Dim>(div(load(v), splat(s)));
+	}
+
+	template<size_t Dim>
+	inline float dot(const Vec<Dim, float>& a, const Vec<Dim, float>& b) {
+		return dot4(load(a), load(b));
+	}
+
+	inline Vec<3, float> cross(const Vec<3, float>& a, const Vec<3, float>& b) {
+		return toVec<3>(cross3(load(a), load(b)));
+	}
+
+	//Lane 3 of a Vec<3, float> load is zero in both operands, so all four lanes must match
+	template<size_t Dim>
+	inline bool equal(const Vec<Dim, float>& a, const Vec<Dim, float>& b) {
+		return equalMask(load(a), load(b)) == 0xF;
+	}
+
+	/*
+	* 4x4 products
+	* The rows of b are kept in registers and each row of the result is a linear
+	* combination of them. M v transposes the four row products so that the sums
+	* are vertical adds.
+	*/
+	template<size_t Rows, size_t Inner, size_t Cols, class T, class U>
+	inline constexpr bool AcceleratedProduct = MATH3D_SSE && Rows == 4 && Inner == 4 && (Cols == 4 || Cols == 1)
+		&& std::is_same_v<T, float> && std::is_same_v<U, float>;
+
+	inline Matrix<4, 4, float> multiply(const Matrix<4, 4, float>& a, const Matrix<4, 4, float>& b) {
+		f32x4 b0 = load(b.x);
+		f32x4 b1 = load(b.y);
+		f32x4 b2 = load(b.z);
+		f32x4 b3 = load(b.w);
+		Matrix<4, 4, float> result;
+		result.x = toVec<4>(linearCombination(load(a.x), b0, b1, b2, b3));
+		result.y = toVec<4>(linearCombination(load(a.y), b0, b1, b2, b3));
+		result.z = toVec<4>(linearCombination(load(a.z), b0, b1, b2, b3));
+		result.w = toVec<4>(linearCombination(load(a.w), b0, b1, b2, b3));
+		return result;
+	}
+
+	inline Vec<4, float> multiply(const Matrix<4, 4, float>& m, const Vec<4, float>& v) {
+		f32x4 vv = load(v);
+		f32x4 p0 = mul(load(m.x), vv);
+		f32x4 p1 = mul(load(m.y), vv);
+		f32x4 p2 = mul(load(m.z), vv);
+		f32x4 p3 = mul(load(m.w), vv);
+		transpose4(p0, p1, p2, p3);
+		return toVec<4>(add(add(add(p0, p1), p2), p3));
+	}
+
+	inline Vec<4, float> multiply(const Vec<4, float>& v, const Matrix<4, 4, float>& m) {
+		return toVec<4>(linearCombination(load(v), load(m.x), load(m.y), load(m.z), load(m.w)));
+	}
+
+	inline Matrix<4, 4, float> transpose(const Matrix<4, 4, float>& m) {
+		f32x4 r0 = load(m.x);
+		f32x4 r1 = load(m.y);
+		f32x4 r2 = load(m.z);
+		f32x4 r3 = load(m.w);
+		transpose4(r0, r1, r2, r3);
+		return { toVec<4>(r0), toVec<4>(r1), toVec<4>(r2), toVec<4>(r3) };
+	}
+
+	/*
+	* 4x4 inverse by 2x2 blocks
+	* m is split into the 2x2 blocks A B / C D, each held in one register as
+	* (m00, m01, m10, m11). The inverse is assembled from block products with the
+	* 2x2 adjugates, which needs no divisions but the one by the determinant.
+	*/
+	//a b
+	inline f32x4 mat2Mul(f32x4 a, f32x4 b) {
+		return add(mul(a, shuffle<0, 3, 0, 3>(b, b)), mul(shuffle<1, 0, 3, 2>(a, a), shuffle<2, 1, 2, 1>(b, b)));
+	}
+
+	//adj(a) b
+	inline f32x4 mat2AdjMul(f32x4 a, f32x4 b) {
+		return sub(mul(shuffle<3, 3, 0, 0>(a, a), b), mul(shuffle<1, 1, 2, 2>(a, a), shuffle<2, 3, 0, 1>(b, b)));
+	}
+
+	//a adj(b)
+	inline f32x4 mat2MulAdj(f32x4 a, f32x4 b) {
+		return sub(mul(a, shuffle<3, 0, 3, 0>(b, b)), mul(shuffle<1, 0, 3, 2>(a, a), shuffle<2, 1, 2, 1>(b, b)));
+	}
+
+	inline Matrix<4, 4, float> inverse(const Matrix<4, 4, float>& m) {
+		f32x4 r0 = load(m.x);
+		f32x4 r1 = load(m.y);
+		f32x4 r2 = load(m.z);
+		f32x4 r3 = load(m.w);
+		f32x4 a = shuffle<0, 1, 0, 1>(r0, r1);
+		f32x4 b = shuffle<2, 3, 2, 3>(r0, r1);
+		f32x4 c = shuffle<0, 1, 0, 1>(r2, r3);
+		f32x4 d = shuffle<2, 3, 2, 3>(r2, r3);
+		//determinants of A, B, C and D
+		f32x4 blockDet = sub(mul(shuffle<0, 2, 0, 2>(r0, r2), shuffle<1, 3, 1, 3>(r1, r3)),
+			mul(shuffle<1, 3, 1, 3>(r0, r2), shuffle<0, 2, 0, 2>(r1, r3)));
+		f32x4 detA = broadcast<0>(blockDet);
+		f32x4 detB = broadcast<1>(blockDet);
+		f32x4 detC = broadcast<2>(blockDet);
+		f32x4 detD = broadcast<3>(blockDet);
+		f32x4 dc = mat2AdjMul(d, c);
+		f32x4 ab = mat2AdjMul(a, b);
+		f32x4 x = sub(mul(detD, a), mat2Mul(b, dc));
+		f32x4 y = sub(mul(detB, c), mat2MulAdj(d, ab));
+		f32x4 z = sub(mul(detC, b), mat2MulAdj(a, dc));
+		f32x4 w = sub(mul(detA, d), mat2Mul(c, ab));
+		//|M| = |A||D| + |B||C| - tr(adj(A) B adj(D) C)
+		float trace = hsum(mul(ab, shuffle<0, 2, 1, 3>(dc, dc)));
+		f32x4 det = sub(add(mul(detA, detD), mul(detB, detC)), splat(trace));
+		f32x4 scale = div(set(1, -1, -1, 1), det);
+		x = mul(x, scale);
+		y = mul(y, scale);
+		z = mul(z, scale);
+		w = mul(w, scale);
+		return {
+			toVec<4>(shuffle<3, 1, 3, 1>(x, y)),
+			toVec<4>(shuffle<2, 0, 2, 0>(x, y)),
+			toVec<4>(shuffle<3, 1, 3, 1>(z, w)),
+			toVec<4>(shuffle<2, 0, 2, 0>(z, w))
+		};
+	}
+}
+
+}
+
+/*
+* Matrix Addition and Subtraction
+*/
+template<size_t Rows, size_t Cols, class T, class U, class R>
+constexpr math3d::Matrix<Rows, Cols, R> operator+(const math3d::Matrix<Rows, Cols, T>& a, const math3d::Matrix<Rows, Cols, U>& b) {
+	if constexpr (math3d::simd::Accelerated<Rows, Cols, T, U>) {
+		if (!std::is_constant_evaluated()) {
+			return math3d::simd::add(a, b);
+		}
+	}
+	using Add = math3d::MatrixArithmetic<Rows, Cols, T, U>::Add;
+	return math3d::ComponentwiseOp<Add>::mmop(a, b);
+}
+
+template<size_t Rows, size_t Cols, class T, class U, class R>
+constexpr math3d::Matrix<Rows, Cols, R> operator-(const math3d::Matrix<Rows, Cols, T>& a, const math3d::Matrix<Rows, Cols, U>& b) {
+	if constexpr (math3d::simd::Accelerated<Rows, Cols, T, U>) {
+		if (!std::is_constant_evaluated()) {
+			return math3d::simd::sub(a, b);
+		}
+	}
+	using Subtract = math3d::MatrixArithmetic<Rows, Cols, T, U>::Subtract;
+	return math3d::ComponentwiseOp<Subtract>::mmop(a, b);
+}
+
+/*
+* Componentwise Multiplication (Hadamard Product)
+* operator* on two matrices is the matrix product (see below). You can optionally use
+* operator* as componentwiseProduct by
+*	using math3d::componentwise::operator*;
+* but then it is ambiguous with the matrix product for square matrices.
+*/
+template<size_t Rows, size_t Cols, class T, class U, class R>
+constexpr math3d::Matrix<Rows, Cols, R> componentwiseProduct(const math3d::Matrix<Rows, Cols, T>& a, const math3d::Matrix<Rows, Cols, U>& b) {
+	using Mult = math3d::MatrixArithmetic<Rows, Cols, T, U>::Multiply;
+	return math3d::ComponentwiseOp<Mult>::mmop(a, b);
+}
+
+/*
+ * Scalar Multiplication:
+ * Returns Vec of the same type as the Vec argument, regardless of scalar type
+ */
+
+template<size_t Rows, size_t Cols, class MType, class ScalarType> requires (!math3d::IsMatrix<ScalarType>)
+constexpr math3d::Matrix<Rows, Cols, MType> operator*(ScalarType c, const math3d::Matrix<Rows, Cols, MType>& m) {
+	if constexpr (math3d::simd::Accelerated<Rows, Cols, MType, float> && math3d::simd::FloatScalar<ScalarType>) {
+		if (!std::is_constant_evaluated()) {
+			return math3d::simd::scale(m, static_cast<float>(c));
+		}
+	}
+	using Multiply = math3d::MatrixArithmetic<Rows, Cols, MType, ScalarType>::ScalarMultiply;
+	return math3d::ComponentwiseOp<Multiply>::smop(m, c);
+}
+
+template<size_t Rows, size_t Cols, class MType, class ScalarType> requires (!math3d::IsMatrix<ScalarType>)
+constexpr math3d::Matrix<Rows, Cols, MType> operator*(const math3d::Matrix<Rows, Cols, MType>& m, ScalarType c) {
+	return operator*(c, m);
+}
+
+template<size_t Rows, size_t Cols, class MType, class ScalarType> requires (!math3d::IsMatrix<ScalarType>)
+constexpr math3d::Matrix<Rows, Cols, MType> operator/(const math3d::Matrix<Rows, Cols, MType>& m, ScalarType c) {
+	if constexpr (math3d::simd::Accelerated<Rows, Cols, MType, float> && math3d::simd::FloatScalar<ScalarType>) {
+		if (!std::is_constant_evaluated()) {
+			return math3d::simd::divide(m, static_cast<float>(c));
+		}
+	}
+	using Divide = math3d::MatrixArithmetic<Rows, Cols, MType, ScalarType>::ScalarDivide;
+	return math3d::ComponentwiseOp<Divide>::smop(m, c);
+}
+
+//////////////////////////////////////////////
+
+/*
+* Dot Product
+* Actually, I don't know what the dot product of a Vec4 in homogeneous coordinates should be...
+*	Well, it's still important for matrix operations, but maybe 3d vector products should also be here
+*	for Vec4 in homogeneous coordinates?
+*/
+template<size_t Dim, class T, class U, class R = decltype(T{} *U{}) >
+constexpr R dotProduct(const math3d::Vec<Dim, T>& a, const math3d::Vec<Dim, U>& b) {
+	if constexpr (math3d::simd::Accelerated<Dim, 1, T, U>) {
+		if (!std::is_constant_evaluated()) {
+			return math3d::simd::dot(a, b);
+		}
+	}
+	return math3d::ComponentwiseFold::dot(a, b, std::make_index_sequence<Dim>{});
+}
+
+template<size_t Dim, class T>
+constexpr T lengthSquared(const math3d::Vec<Dim, T>& v) {
+	return dotProduct(v, v);
+}
+
+template<size_t Rows, size_t Cols, class T, class U>
+constexpr bool operator!=(const math3d::Matrix<Rows, Cols, T>& a, const math3d::Matrix<Rows, Cols, U>& b) {
+	if constexpr (math3d::simd::Accelerated<Rows, Cols, T, U>) {
+		if (!std::is_constant_evaluated()) {
+			return !math3d::simd::equal(a, b);
+		}
+	}
+	return math3d::ComponentwiseFold::notequals(a, b, std::make_index_sequence<Rows>{});
+}
+
+template<size_t Rows, size_t Cols, class T, class U>
+constexpr bool operator==(const math3d::Matrix<Rows, Cols, T>& a, const math3d::Matrix<Rows, Cols, U>& b) {
+	if constexpr (math3d::simd::Accelerated<Rows, Cols, T, U>) {
+		if (!std::is_constant_evaluated()) {
+			return math3d::simd::equal(a, b);
+		}
+	}
+	return math3d::ComponentwiseFold::equals(a, b, std::make_index_sequence<Rows>{});
+}
+
+/*
+* Cross Product (2D)
+*/
+template<class T, class U, class R >
+constexpr R crossProduct(const math3d::Vec<2, T>& a, const math3d::Vec<2, U>& b) {
+	return a.x * b.y - a.y * b.x;
+}
+
+/*
+* Cross Product (3D)
+*/
+template<class T, class U, class R >
+constexpr math3d::Vec < 3, R > crossProduct(const math3d::Vec<3, T>& a, const math3d::Vec<3, U>& b) {
+	if constexpr (math3d::simd::Accelerated<3, 1, T, U>) {
+		if (!std::is_constant_evaluated()) {
+			return math3d::simd::cross(a, b);
+		}
+	}
+	return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+/*
+* Outer Product
+* a b^T, the matrix whose entry (i, j) is a[i] b[j]. Batched sums of outer products
+* are in reduce.h.
+*/
+template<size_t Rows, size_t Cols, class T, class U, class R = decltype(T{} *U{}) >
+constexpr math3d::Matrix<Rows, Cols, R> outerProduct(const math3d::Vec<Rows, T>& a, const math3d::Vec<Cols, U>& b) {
+	return math3d::OuterProduct<Rows, Cols, T, U>::product(a, b, std::make_index_sequence<Rows>{});
+}
+
+/*
+* Matrix Multiplication
+* M N is defined whenever the columns of M match the rows of N. A Vec on the right
+* is a column vector, a Vec on the left is a row vector, so v M combines the rows of M
+* and v w is the dot product.
+*/
+template<size_t Rows, size_t Inner, size_t Cols, class T, class U, class R = decltype(T{} *U{}) >
+constexpr math3d::Matrix<Rows, Cols, R> operator*(const math3d::Matrix<Rows, Inner, T>& a, const math3d::Matrix<Inner, Cols, U>& b) {
+	if constexpr (math3d::simd::AcceleratedProduct<Rows, Inner, Cols, T, U>) {
+		if (!std::is_constant_evaluated()) {
+			return math3d::simd::multiply(a, b);
+		}
+	}
+	return math3d::MatrixProduct<Rows, Inner, Cols, T, U>::product(a, b, std::make_index_sequence<Rows>{});
+}
+
+template<size_t Dim, size_t Cols, class T, class U, class R = decltype(T{} *U{}) >
+constexpr math3d::Vec<Cols, R> operator*(const math3d::Vec<Dim, T>& v, const math3d::Matrix<Dim, Cols, U>& m) {
+	if constexpr (math3d::simd::AcceleratedProduct<Cols, Dim, 1, T, U>) {
+		if (!std::is_constant_evaluated()) {
+			return math3d::simd::multiply(v, m);
+		}
+	}
+	return math3d::RowVectorProduct<Dim, Cols, T, U>::product(v, m, std::make_index_sequence<Cols>{});
+}
+
+template<size_t Dim, class T, class U, class R = decltype(T{} *U{}) >
+constexpr R operator*(const math3d::Vec<Dim, T>& v, const math3d::Vec<Dim, U>& w) {
+	return dotProduct(v, w);
+}
+
+/*
+* Transpose
+* Vectors have no orientation (see Vec), so only matrices with at least two columns
+* can be transposed
+*/
+template<size_t Rows, size_t Cols, class T>
+constexpr math3d::Matrix<Cols, Rows, T> transpose(const math3d::Matrix<Rows, Cols, T>& m) {
+	static_assert(Cols > 1, "vectors cannot be transposed");
+	if constexpr (math3d::simd::AcceleratedProduct<Rows, Cols, Rows, T, T>) {
+		if (!std::is_constant_evaluated()) {
+			return math3d::simd::transpose(m);
+		}
+	}
+	return math3d::Transpose<Rows, Cols, T>::apply(m, std::make_index_sequence<Cols>{});
+}
+
+/*
+* Determinant, Adjugate and Inverse
+* Closed forms for 2x2, 3x3 and 4x4. The adjugate is the transposed cofactor matrix,
+* so m * adjugate(m) == determinant(m) * I exactly for integer matrices. inverse
+* divides it by the determinant, which gives inf or NaN entries for a singular m,
+* check the determinant first when that is possible. Affine and rigid transforms
+* have cheaper inverses in transform.h.
+*/
+template<class T, class R = decltype(T{} *T{}) >
+constexpr R determinant(const math3d::Matrix<2, 2, T>& m) {
+	return m.x.x * m.y.y - m.x.y * m.y.x;
+}
+
+template<class T, class R = decltype(T{} *T{}) >
+constexpr R determinant(const math3d::Matrix<3, 3, T>& m) {
+	return dotProduct(m.x, crossProduct(m.y, m.z));
+}
+
+namespace math3d {
+	//The 2x2 determinants of the top two rows (s) and the bottom two rows (c) of a 4x4 matrix
+	template<class T, class R = decltype(T{} *T{}) >
+	struct Minors4 {
+		R s[6];
+		R c[6];
+
+		constexpr explicit Minors4(const Matrix<4, 4, T>& m) :
+			s{
+				m.x.x * m.y.y - m.y.x * m.x.y,
+				m.x.x * m.y.z - m.y.x * m.x.z,
+				m.x.x * m.y.w - m.y.x * m.x.w,
+				m.x.y * m.y.z - m.y.y * m.x.z,
+				m.x.y * m.y.w - m.y.y * m.x.w,
+				m.x.z * m.y.w - m.y.z * m.x.w
+			},
+			c{
+				m.z.x * m.w.y - m.w.x * m.z.y,
+				m.z.x * m.w.z - m.w.x * m.z.z,
+				m.z.x * m.w.w - m.w.x * m.z.w,
+				m.z.y * m.w.z - m.w.y * m.z.z,
+				m.z.y * m.w.w - m.w.y * m.z.w,
+				m.z.z * m.w.w - m.w.z * m.z.w
+			} {
+		}
+
+		constexpr R determinant() const {
+			return s[0] * c[5] - s[1] * c[4] + s[2] * c[3] + s[3] * c[2] - s[4] * c[1] + s[5] * c[0];
+		}
+	};
+}
+
+template<class T, class R = decltype(T{} *T{}) >
+constexpr R determinant(const math3d::Matrix<4, 4, T>& m) {
+	return math3d::Minors4<T>(m).determinant();
+}
+
+template<class T, class R = decltype(T{} *T{}) >
+constexpr math3d::Matrix<2, 2, R> adjugate(const math3d::Matrix<2, 2, T>& m) {
+	return { { m.y.y, -m.x.y }, { -m.y.x, m.x.x } };
+}
+
+//The cross products of the rows are the columns of the adjugate
+template<class T, class R = decltype(T{} *T{}) >
+constexpr math3d::Matrix<3, 3, R> adjugate(const math3d::Matrix<3, 3, T>& m) {
+	return transpose(math3d::Matrix<3, 3, R>{ crossProduct(m.y, m.z), crossProduct(m.z, m.x), crossProduct(m.x, m.y) });
+}
+
+template<class T, class R = decltype(T{} *T{}) >
+constexpr math3d::Matrix<4, 4, R> adjugate(const math3d::Matrix<4, 4, T>& m) {
+	const math3d::Minors4<T> minors(m);
+	const R* s = minors.s;
+	const R* c = minors.c;
+	return {
+		{ m.y.y * c[5] - m.y.z * c[4] + m.y.w * c[3], -m.x.y * c[5] + m.x.z * c[4] - m.x.w * c[3],
+			m.w.y * s[5] - m.w.z * s[4] + m.w.w * s[3], -m.z.y * s[5] + m.z.z * s[4] - m.z.w * s[3] },
+		{ -m.y.x * c[5] + m.y.z * c[2] - m.y.w * c[1], m.x.x * c[5] - m.x.z * c[2] + m.x.w * c[1],
+			-m.w.x * s[5] + m.w.z * s[2] - m.w.w * s[1], m.z.x * s[5] - m.z.z * s[2] + m.z.w * s[1] },
+		{ m.y.x * c[4] - m.y.y * c[2] + m.y.w * c[0], -m.x.x * c[4] + m.x.y * c[2] - m.x.w * c[0],
+			m.w.x * s[4] - m.w.y * s[2] + m.w.w * s[0], -m.z.x * s[4] + m.z.y * s[2] - m.z.w * s[0] },
+		{ -m.y.x * c[3] + m.y.y * c[1] - m.y.z * c[0], m.x.x * c[3] - m.x.y * c[1] + m.x.z * c[0],
+			-m.w.x * s[3] + m.w.y * s[1] - m.w.z * s[0], m.z.x * s[3] - m.z.y * s[1] + m.z.z * s[0] }
+	};
+}
+
+template<size_t Dim, class T>
+constexpr math3d::Matrix<Dim, Dim, T> inverse(const math3d::Matrix<Dim, Dim, T>& m) {
+	static_assert(std::is_floating_point_v<T>, "inverse needs a floating point element type");
+	static_assert(Dim >= 2 && Dim <= 4, "inverse is only defined for 2x2, 3x3 and 4x4 matrices");
+	if constexpr (math3d::simd::AcceleratedProduct<Dim, Dim, Dim, T, T>) {
+		if (!std::is_constant_evaluated()) {
+			return math3d::simd::inverse(m);
+		}
+	}
+	return adjugate(m) * (T{ 1 } / determinant(m));
+}
+
+/*
+* Geometry metrics
+*/
+template<class T>
+using RootType = decltype(std::sqrt(T{}));
+template<size_t Dim, class T>
+RootType<T> length(const math3d::Vec<Dim, T>& v) {
+	return std::sqrt(lengthSquared(v));
+}
+
+template<class T, class U>
+using AngleType = decltype(std::atan2(T{} *U{}, T{} *U{}));
+template<class T, class U>
+AngleType<T, U> angle(const math3d::Vec<2, T>& t, const math3d::Vec<2, U>& u) {
+	return std::atan2(crossProduct(t, u), dotProduct(t, u));
+}
+
+//You really want the angle and also the axis that angle is about,
+//should be able to get the pair from another function
+template<class T, class U>
+AngleType<T, U> angle(const math3d::Vec<3, T>& t, const math3d::Vec<3, U>& u) {
+	return std::atan2(length(crossProduct(t, u)), dotProduct(t, u));
+}
+
+template<size_t Dim, class T>
+math3d::Vec<Dim, RootType<T>> unit(const math3d::Vec<Dim, T>& v) {
+	return v / length(v);
+}
+
+/*
+* Fast Angles
+* atan2Fast is atan2 at one of the math3d::Precision tiers, a polynomial for Estimate
+* and Refined (see simd.h for the error bounds), and angleFast is angle computed with
+* it. The polynomials are float only, other element types use std::atan2 at every tier.
+*/
+template<math3d::Precision P = math3d::Precision::Refined, class T>
+AngleType<T, T> atan2Fast(T y, T x) {
+	if constexpr (std::is_same_v<T, float>) {
+		return math3d::simd::atan2<P>(y, x);
+	}
+	else {
+		return std::atan2(y, x);
+	}
+}
+
+template<math3d::Precision P = math3d::Precision::Refined, class T, class U>
+AngleType<T, U> angleFast(const math3d::Vec<2, T>& t, const math3d::Vec<2, U>& u) {
+	return atan2Fast<P>(static_cast<AngleType<T, U>>(crossProduct(t, u)), static_cast<AngleType<T, U>>(dotProduct(t, u)));
+}
+
+template<math3d::Precision P = math3d::Precision::Refined, class T, class U>
+AngleType<T, U> angleFast(const math3d::Vec<3, T>& t, const math3d::Vec<3, U>& u) {
+	return atan2Fast<P>(static_cast<AngleType<T, U>>(length(crossProduct(t, u))), static_cast<AngleType<T, U>>(dotProduct(t, u)));
+}
+
+/*
+* Fast Normalization
+* rsqrt is 1 / sqrt(x) at one of the math3d::Precision tiers (see simd.h for the
+* error bounds), and unitFast multiplies v by rsqrt of its squared length instead of
+* dividing by its length. Other element types than float start from the float
+* estimate and refine it in double, so Estimate and Refined are only float accurate,
+* and x must be within float range. A zero vector gives NaN, like unit.
+*/
+template<math3d::Precision P = math3d::Precision::Refined, class T>
+RootType<T> rsqrt(T x) {
+	using R = RootType<T>;
+	if constexpr (std::is_same_v<T, float>) {
+		return math3d::simd::rsqrt<P>(x);
+	}
+	else if constexpr (P == math3d::Precision::Full) {
+		return 1 / std::sqrt(static_cast<R>(x));
+	}
+	else {
+		R y = math3d::simd::rsqrt<P>(static_cast<float>(x));
+		if constexpr (P == math3d::Precision::Refined) {
+			y = y + R(0.5) * y * (1 - x * y * y);
+		}
+		return y;
+	}
+}
+
+namespace math3d {
+	template<size_t Dim, class T, class S, size_t... I>
+	constexpr Vec<Dim, S> scaledAs(const Vec<Dim, T>& v, S s, std::index_sequence<I...>) {
+		return { static_cast<S>(v.template get<I>()) * s... };
+	}
+}
+
+template<math3d::Precision P = math3d::Precision::Refined, size_t Dim, class T>
+math3d::Vec<Dim, RootType<T>> unitFast(const math3d::Vec<Dim, T>& v) {
+	RootType<T> scale = rsqrt<P>(lengthSquared(v));
+	if constexpr (std::is_same_v<T, RootType<T>>) {
+		return v * scale;
+	}
+	else {
+		return math3d::scaledAs(v, scale, std::make_index_sequence<Dim>{});
+	}
 }
\ No newline at end of file
@@ -0,0 +1,375 @@
+#pragma once
+
+#include "math3d.h"
+#include "parallel.h"
+#include "reduce.h"
+#include "vecArray.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace math3d {
+
+namespace mortonKernels {
+	/*
+	* Morton Codes
+	* A point is quantized to a cell of a 2^Bits per axis grid over bounds, and the bits
+	* of its x, y and z cells are interleaved, x in the lowest bit of each group of three:
+	*	code = ... z1 y1 x1 z0 y0 x0
+	* Points near each other in space mostly have codes near each other, so sorting by
+	* code walks the points along a Z shaped curve. Points outside bounds are clamped to
+	* the nearest cell, NaN coordinates go to cell 0, and an axis along which bounds
+	* are flat maps every point to cell 0.
+	*/
+	inline constexpr uint32_t spread10(uint32_t v) {
+		v &= 0x3ff;
+		v = (v | v << 16) & 0x030000ff;
+		v = (v | v << 8) & 0x0300f00f;
+		v = (v | v << 4) & 0x030c30c3;
+		v = (v | v << 2) & 0x09249249;
+		return v;
+	}
+
+	inline constexpr uint64_t spread21(uint64_t v) {
+		v &= 0x1fffff;
+		v = (v | v << 32) & 0x001f00000000ffffull;
+		v = (v | v << 16) & 0x001f0000ff0000ffull;
+		v = (v | v << 8) & 0x100f00f00f00f00full;
+		v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+		v = (v | v << 2) & 0x1249249249249249ull;
+		return v;
+	}
+
+	template<class T, uint32_t Bits>
+	struct Grid {
+		static constexpr T Cells = static_cast<T>(1u << Bits);
+		static constexpr T Last = Cells - 1;
+
+		Vec<3, T> lower;
+		Vec<3, T> scale;
+
+		explicit Grid(const Aabb<T>& bounds) : lower(bounds.lower), scale{} {
+			for (size_t k = 0; k < 3; ++k) {
+				const T extent = bounds.upper[k] - bounds.lower[k];
+				scale[k] = extent > 0 ? Cells / extent : 0;
+			}
+		}
+
+		uint32_t cell(const Vec<3, T>& p, size_t k) const {
+			const T c = (p[k] - lower[k]) * scale[k];
+			return static_cast<uint32_t>(c > 0 ? (c < Last ? c : Last) : 0);
+		}
+	};
+
+	template<class T>
+	uint32_t code30(const Grid<T, 10>& grid, const Vec<3, T>& p) {
+		return spread10(grid.cell(p, 0)) | spread10(grid.cell(p, 1)) << 1 | spread10(grid.cell(p, 2)) << 2;
+	}
+
+	template<class T>
+	uint64_t code63(const Grid<T, 21>& grid, const Vec<3, T>& p) {
+		return spread21(grid.cell(p, 0)) | spread21(grid.cell(p, 1)) << 1 | spread21(grid.cell(p, 2)) << 2;
+	}
+
+	template<class T, class Points, class Code>
+	void codes(ThreadPool* pool, const Points& points, size_t count, const Aabb<T>& bounds, Code* out) {
+		auto body = [&](size_t begin, size_t end) {
+			if constexpr (std::is_same_v<Code, uint32_t>) {
+				const Grid<T, 10> grid(bounds);
+				for (size_t i = begin; i < end; ++i) {
+					out[i] = code30(grid, points.get(i));
+				}
+			}
+			else {
+				const Grid<T, 21> grid(bounds);
+				for (size_t i = begin; i < end; ++i) {
+					out[i] = code63(grid, points.get(i));
+				}
+			}
+		};
+		if (pool) {
+			parallelFor(*pool, count, chunkItems(sizeof(Vec<3, T>) + sizeof(Code)), body);
+		}
+		else {
+			body(0, count);
+		}
+	}
+
+	/*
+	* LSD Radix Sort
+	* Keys are sorted by RadixBits bit digits from the lowest up, every pass a stable
+	* counting sort from one buffer into the other. The digit counts of every pass are
+	* taken in one sweep up front, and passes where every key has the same digit are
+	* skipped, e.g. the top digits of codes of fewer bits than the key type.
+	*
+	* With a pool every pass counts the digits of each chunk of SortGrain keys on its
+	* own thread, and the chunks then scatter their keys to offsets ordered by digit,
+	* then chunk, which is the single threaded order. The result does not depend on the
+	* number of threads.
+	*/
+	inline constexpr size_t RadixBits = 8;
+	inline constexpr size_t Buckets = size_t(1) << RadixBits;
+	inline constexpr size_t SortGrain = 64 * 1024;
+
+	using Counts = std::array<size_t, Buckets>;
+
+	template<class Key>
+	inline constexpr size_t Passes = (sizeof(Key) * 8 + RadixBits - 1) / RadixBits;
+
+	template<class Key>
+	size_t digit(Key key, size_t pass) {
+		return static_cast<size_t>(key >> (pass * RadixBits)) & (Buckets - 1);
+	}
+
+	template<class Body>
+	void forChunks(ThreadPool* pool, size_t count, size_t grain, Body&& body) {
+		if (pool) {
+			parallelFor(*pool, count, grain, body);
+		}
+		else {
+			body(0, count);
+		}
+	}
+
+	template<class Key, class Value>
+	void radixSort(ThreadPool* pool, std::span<Key> keys, std::span<Value> values) {
+		static_assert(std::is_unsigned_v<Key>, "radixSort sorts unsigned integer keys");
+		const size_t n = keys.size();
+		if (n < 2) {
+			return;
+		}
+		const size_t grain = pool ? SortGrain : n;
+		const size_t chunks = (n + grain - 1) / grain;
+		constexpr size_t P = Passes<Key>;
+
+		std::vector<std::array<Counts, P>> sweep(chunks);
+		forChunks(pool, n, grain, [&](size_t begin, size_t end) {
+			std::array<Counts, P>& counts = sweep[begin / grain];
+			for (Counts& c : counts) {
+				c.fill(0);
+			}
+			for (size_t i = begin; i < end; ++i) {
+				for (size_t pass = 0; pass < P; ++pass) {
+					++counts[pass][digit(keys[i], pass)];
+				}
+			}
+		});
+		std::array<Counts, P> totals{};
+		for (const auto& counts : sweep) {
+			for (size_t pass = 0; pass < P; ++pass) {
+				for (size_t d = 0; d < Buckets; ++d) {
+					totals[pass][d] += counts[pass][d];
+				}
+			}
+		}
+
+		std::vector<Key> keyScratch(n);
+		std::vector<Value> valueScratch(n);
+		std::span<Key> keysIn = keys;
+		std::span<Key> keysOut = keyScratch;
+		std::span<Value> valuesIn = values;
+		std::span<Value> valuesOut = valueScratch;
+		std::vector<Counts> offsets(chunks);
+		for (size_t pass = 0; pass < P; ++pass) {
+			if (std::find(totals[pass].begin(), totals[pass].end(), n) != totals[pass].end()) {
+				continue;
+			}
+			//a single chunk counted this pass in the sweep, since the counts do not depend on the order
+			if (chunks == 1) {
+				offsets[0] = totals[pass];
+			}
+			else {
+				forChunks(pool, n, grain, [&](size_t begin, size_t end) {
+					Counts& c = offsets[begin / grain];
+					c.fill(0);
+					for (size_t i = begin; i < end; ++i) {
+						++c[digit(keysIn[i], pass)];
+					}
+				});
+			}
+			size_t at = 0;
+			for (size_t d = 0; d < Buckets; ++d) {
+				for (Counts& c : offsets) {
+					at += std::exchange(c[d], at);
+				}
+			}
+			forChunks(pool, n, grain, [&](size_t begin, size_t end) {
+				Counts& c = offsets[begin / grain];
+				for (size_t i = begin; i < end; ++i) {
+					const size_t to = c[digit(keysIn[i], pass)]++;
+					keysOut[to] = keysIn[i];
+					valuesOut[to] = std::move(valuesIn[i]);
+				}
+			});
+			std::swap(keysIn, keysOut);
+			std::swap(valuesIn, valuesOut);
+		}
+		if (keysIn.data() != keys.data()) {
+			forChunks(pool, n, grain, [&](size_t begin, size_t end) {
+				std::copy(keysIn.begin() + begin, keysIn.begin() + end, keys.begin() + begin);
+				std::move(valuesIn.begin() + begin, valuesIn.begin() + end, values.begin() + begin);
+			});
+		}
+	}
+
+	template<class T>
+	void permute(ThreadPool* pool, std::span<const uint32_t> order, const T* in, T* out) {
+		forChunks(pool, order.size(), chunkItems(sizeof(T) + sizeof(uint32_t)), [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				out[i] = in[order[i]];
+			}
+		});
+	}
+
+	template<size_t Dim, class T>
+	void permute(ThreadPool* pool, std::span<const uint32_t> order, const VecArray<Dim, T>& in, VecArray<Dim, T>& out) {
+		out.resize(order.size());
+		for (size_t k = 0; k < Dim; ++k) {
+			permute(pool, order, in.component(k), out.component(k));
+		}
+	}
+
+	template<class T, class Points>
+	std::vector<uint32_t> order(ThreadPool* pool, const Points& points, size_t count, const Aabb<T>& bounds) {
+		if (count > std::numeric_limits<uint32_t>::max()) {
+			throw std::invalid_argument("math3d: a Morton order holds at most 2^32 points");
+		}
+		std::vector<uint64_t> keys(count);
+		codes(pool, points, count, bounds, keys.data());
+		std::vector<uint32_t> order(count);
+		std::iota(order.begin(), order.end(), uint32_t(0));
+		radixSort(pool, std::span<uint64_t>(keys), std::span<uint32_t>(order));
+		return order;
+	}
+}
+
+}
+
+/*
+* Morton codes of points, 30 bit codes of 10 bits per axis, or 63 bit codes of 21
+* bits per axis, over bounds, usually bounds(points). out must hold points.size()
+* codes. morton30 and morton63 give the code of a single point.
+*/
+template<class T>
+uint32_t morton30(const math3d::Vec<3, T>& p, const math3d::Aabb<T>& bounds) {
+	return math3d::mortonKernels::code30(math3d::mortonKernels::Grid<T, 10>(bounds), p);
+}
+
+template<class T>
+uint64_t morton63(const math3d::Vec<3, T>& p, const math3d::Aabb<T>& bounds) {
+	return math3d::mortonKernels::code63(math3d::mortonKernels::Grid<T, 21>(bounds), p);
+}
+
+template<class T>
+void morton30(std::span<const math3d::Vec<3, T>> points, const math3d::Aabb<T>& bounds, std::span<uint32_t> out) {
+	math3d::mortonKernels::codes(nullptr, math3d::reduceKernels::view(points), points.size(), bounds, out.data());
+}
+
+template<class T>
+void morton30(math3d::ThreadPool& pool, std::span<const math3d::Vec<3, T>> points, const math3d::Aabb<T>& bounds, std::span<uint32_t> out) {
+	math3d::mortonKernels::codes(&pool, math3d::reduceKernels::view(points), points.size(), bounds, out.data());
+}
+
+template<class T>
+void morton30(const math3d::VecArray<3, T>& points, const math3d::Aabb<T>& bounds, std::span<uint32_t> out) {
+	math3d::mortonKernels::codes(nullptr, math3d::reduceKernels::view(points), points.size(), bounds, out.data());
+}
+
+template<class T>
+void morton30(math3d::ThreadPool& pool, const math3d::VecArray<3, T>& points, const math3d::Aabb<T>& bounds, std::span<uint32_t> out) {
+	math3d::mortonKernels::codes(&pool, math3d::reduceKernels::view(points), points.size(), bounds, out.data());
+}
+
+template<class T>
+void morton63(std::span<const math3d::Vec<3, T>> points, const math3d::Aabb<T>& bounds, std::span<uint64_t> out) {
+	math3d::mortonKernels::codes(nullptr, math3d::reduceKernels::view(points), points.size(), bounds, out.data());
+}
+
+template<class T>
+void morton63(math3d::ThreadPool& pool, std::span<const math3d::Vec<3, T>> points, const math3d::Aabb<T>& bounds, std::span<uint64_t> out) {
+	math3d::mortonKernels::codes(&pool, math3d::reduceKernels::view(points), points.size(), bounds, out.data());
+}
+
+template<class T>
+void morton63(const math3d::VecArray<3, T>& points, const math3d::Aabb<T>& bounds, std::span<uint64_t> out) {
+	math3d::mortonKernels::codes(nullptr, math3d::reduceKernels::view(points), points.size(), bounds, out.data());
+}
+
+template<class T>
+void morton63(math3d::ThreadPool& pool, const math3d::VecArray<3, T>& points, const math3d::Aabb<T>& bounds, std::span<uint64_t> out) {
+	math3d::mortonKernels::codes(&pool, math3d::reduceKernels::view(points), points.size(), bounds, out.data());
+}
+
+/*
+* Stable sort of keys, with values moved along, e.g. Morton codes and the indices of
+* their points. keys and values have the same size. Keys are unsigned integers.
+*/
+template<class Key, class Value>
+void radixSort(std::span<Key> keys, std::span<Value> values) {
+	math3d::mortonKernels::radixSort(nullptr, keys, values);
+}
+
+template<class Key, class Value>
+void radixSort(math3d::ThreadPool& pool, std::span<Key> keys, std::span<Value> values) {
+	math3d::mortonKernels::radixSort(&pool, keys, values);
+}
+
+/*
+* Reordering, out[i] = in[order[i]], for any arrays of the same length, e.g. the
+* positions, normals and colors of a point set. out must hold order.size() elements,
+* a VecArray out is resized. order is usually a permutation, so nothing is lost.
+*/
+template<class T>
+void permute(std::span<const uint32_t> order, std::span<const T> in, std::span<T> out) {
+	math3d::mortonKernels::permute(nullptr, order, in.data(), out.data());
+}
+
+template<class T>
+void permute(math3d::ThreadPool& pool, std::span<const uint32_t> order, std::span<const T> in, std::span<T> out) {
+	math3d::mortonKernels::permute(&pool, order, in.data(), out.data());
+}
+
+template<size_t Dim, class T>
+void permute(std::span<const uint32_t> order, const math3d::VecArray<Dim, T>& in, math3d::VecArray<Dim, T>& out) {
+	math3d::mortonKernels::permute(nullptr, order, in, out);
+}
+
+template<size_t Dim, class T>
+void permute(math3d::ThreadPool& pool, std::span<const uint32_t> order, const math3d::VecArray<Dim, T>& in, math3d::VecArray<Dim, T>& out) {
+	math3d::mortonKernels::permute(&pool, order, in, out);
+}
+
+/*
+* The order of points along the 63 bit Morton curve over their bounds, points with
+* the same code in their original order. Reordering a point set, and everything that
+* goes along with it, with permute(mortonOrder(points), ...) once puts points near
+* each other in space near each other in memory for every pass that follows.
+*/
+template<class T>
+std::vector<uint32_t> mortonOrder(std::span<const math3d::Vec<3, T>> points) {
+	return math3d::mortonKernels::order(nullptr, math3d::reduceKernels::view(points), points.size(), bounds(points));
+}
+
+template<class T>
+std::vector<uint32_t> mortonOrder(math3d::ThreadPool& pool, std::span<const math3d::Vec<3, T>> points) {
+	return math3d::mortonKernels::order(&pool, math3d::reduceKernels::view(points), points.size(), bounds(pool, points));
+}
+
+template<class T>
+std::vector<uint32_t> mortonOrder(const math3d::VecArray<3, T>& points) {
+	return math3d::mortonKernels::order(nullptr, math3d::reduceKernels::view(points), points.size(), bounds(points));
+}
+
+template<class T>
+std::vector<uint32_t> mortonOrder(math3d::ThreadPool& pool, const math3d::VecArray<3, T>& points) {
+	return math3d::mortonKernels::order(&pool, math3d::reduceKernels::view(points), points.size(), bounds(pool, points));
+}
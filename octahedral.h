@@ -0,0 +1,270 @@
+#pragma once
+
+#include "math3d.h"
+#include "storage.h"
+#include "vecArray.h"
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+namespace math3d {
+
+/*
+* Octahedral Normal Encoding
+* A unit Vec<3, float> has two degrees of freedom. Projecting it onto the octahedron
+* |x| + |y| + |z| = 1 and folding the lower half over the diagonals maps it to the
+* square [-1, 1]^2, which is stored as two signed normalized integers:
+*	oct32: two int16, 4 bytes, at most 0.0037 degrees from the input
+*	oct16: two int8, 2 bytes, at most 0.94 degrees from the input
+* (measured bounds, checked by testOctahedral). Decoding unfolds the square and
+* normalizes, so the result has unit length to within a float ulp.
+*
+* Encoding rounds to the nearest step, ties to even, like snorm16. The input is
+* expected to be a unit vector, but only its direction matters; a zero vector encodes
+* to an arbitrary direction.
+*/
+template<class Int>
+struct OctahedralNormal;
+
+using oct32 = OctahedralNormal<int16_t>;
+using oct16 = OctahedralNormal<int8_t>;
+
+namespace octKernels {
+	constexpr bool negative(float f) {
+		return (std::bit_cast<uint32_t>(f) >> 31) != 0;
+	}
+
+	constexpr float absolute(float f) {
+		return std::bit_cast<float>(std::bit_cast<uint32_t>(f) & 0x7fffffff);
+	}
+
+	//a with its sign flipped if b is negative (or -0), as simd::mulSign
+	constexpr float mulSign(float a, float b) {
+		return std::bit_cast<float>(std::bit_cast<uint32_t>(a) ^ (std::bit_cast<uint32_t>(b) & 0x80000000));
+	}
+
+	template<class Int>
+	constexpr float scale() {
+		return static_cast<float>(std::numeric_limits<Int>::max());
+	}
+
+	/*
+	* The scalar and 8 wide versions below do the same operations in the same order,
+	* so they give the same bits.
+	*/
+	template<class Int>
+	constexpr OctahedralNormal<Int> encode(float x, float y, float z) {
+		const float s = (absolute(x) + absolute(y)) + absolute(z);
+		float u = x / s;
+		float v = y / s;
+		if (negative(z)) {
+			const float foldedU = mulSign(1 - absolute(v), u);
+			const float foldedV = mulSign(1 - absolute(u), v);
+			u = foldedU;
+			v = foldedV;
+		}
+		return {
+			static_cast<Int>(storageKernels::roundEven(storageKernels::clampNormalized(u, -1) * scale<Int>())),
+			static_cast<Int>(storageKernels::roundEven(storageKernels::clampNormalized(v, -1) * scale<Int>()))
+		};
+	}
+
+	template<class Int>
+	inline Vec<3, float> decode(OctahedralNormal<Int> n) {
+		float u = n.u / scale<Int>();
+		float v = n.v / scale<Int>();
+		//the lowest integer is also -1
+		u = u > -1 ? u : -1;
+		v = v > -1 ? v : -1;
+		const float z = (1 - absolute(u)) - absolute(v);
+		float t = 0 - z;
+		t = t > 0 ? t : 0;
+		const float x = u - mulSign(t, u);
+		const float y = v - mulSign(t, v);
+		const float length = std::sqrt((x * x + y * y) + z * z);
+		return { x / length, y / length, z / length };
+	}
+}
+
+template<class Int>
+struct OctahedralNormal {
+	Int u = 0;
+	Int v = 0;
+
+	constexpr OctahedralNormal() = default;
+
+	constexpr OctahedralNormal(Int encodedU, Int encodedV)
+		: u(encodedU), v(encodedV) {
+	}
+
+	constexpr explicit OctahedralNormal(const Vec<3, float>& n)
+		: OctahedralNormal(octKernels::encode<Int>(n.x, n.y, n.z)) {
+	}
+
+	explicit operator Vec<3, float>() const {
+		return octKernels::decode(*this);
+	}
+
+	constexpr bool operator==(const OctahedralNormal&) const = default;
+};
+
+static_assert(sizeof(oct32) == 4 && sizeof(oct16) == 2);
+
+/*
+* Batched encode and decode
+* 8 normals per iteration with SSE2, deinterleaved into one register per component
+* like the transform kernels. The rest, and everything without SSE, goes through
+* the scalar functions above, which give the same results.
+*/
+namespace octKernels {
+	using namespace simd;
+
+	template<class Int>
+	void encode8(f32x8 x, f32x8 y, f32x8 z, Int* out) {
+		const f32x8 one = splat8(1);
+		const f32x8 s = add(add(abs(x), abs(y)), abs(z));
+		f32x8 u = div(x, s);
+		f32x8 v = div(y, s);
+		const f32x8 foldedU = mulSign(sub(one, abs(v)), u);
+		const f32x8 foldedV = mulSign(sub(one, abs(u)), v);
+		u = selectNegative(z, foldedU, u);
+		v = selectNegative(z, foldedV, v);
+		const f32x8 lowest = splat8(-1);
+		const f32x8 range = splat8(scale<Int>());
+		u = mul(min(max(u, lowest), one), range);
+		v = mul(min(max(v, lowest), one), range);
+		if constexpr (std::is_same_v<Int, int16_t>) {
+			storeInt16Pairs(out, u, v);
+		}
+		else {
+			storeInt8Pairs(out, u, v);
+		}
+	}
+
+	template<class Int>
+	void decode8(const Int* in, f32x8& x, f32x8& y, f32x8& z) {
+		f32x8 u;
+		f32x8 v;
+		if constexpr (std::is_same_v<Int, int16_t>) {
+			loadInt16Pairs(in, u, v);
+		}
+		else {
+			loadInt8Pairs(in, u, v);
+		}
+		const f32x8 zero = splat8(0);
+		const f32x8 range = splat8(scale<Int>());
+		const f32x8 lowest = splat8(-1);
+		u = max(div(u, range), lowest);
+		v = max(div(v, range), lowest);
+		z = sub(sub(splat8(1), abs(u)), abs(v));
+		const f32x8 t = max(sub(zero, z), zero);
+		x = sub(u, mulSign(t, u));
+		y = sub(v, mulSign(t, v));
+		const f32x8 length = sqrt(add(add(mul(x, x), mul(y, y)), mul(z, z)));
+		x = div(x, length);
+		y = div(y, length);
+		z = div(z, length);
+	}
+
+	template<class Int>
+	void encode(const Vec<3, float>* in, OctahedralNormal<Int>* out, size_t n) {
+		size_t i = 0;
+		if constexpr (MATH3D_SSE) {
+			for (; i + 8 <= n; i += 8) {
+				const float* src = &in[i].x;
+				f32x4 x0, y0, z0, x1, y1, z1;
+				deinterleave3(loadu(src), loadu(src + 4), loadu(src + 8), x0, y0, z0);
+				deinterleave3(loadu(src + 12), loadu(src + 16), loadu(src + 20), x1, y1, z1);
+				encode8(combine(x0, x1), combine(y0, y1), combine(z0, z1), &out[i].u);
+			}
+		}
+		for (; i < n; ++i) {
+			out[i] = OctahedralNormal<Int>(in[i]);
+		}
+	}
+
+	template<class Int>
+	void encode(const float* x, const float* y, const float* z, OctahedralNormal<Int>* out, size_t n) {
+		size_t i = 0;
+		if constexpr (MATH3D_SSE) {
+			for (; i + 8 <= n; i += 8) {
+				encode8(loadu8(x + i), loadu8(y + i), loadu8(z + i), &out[i].u);
+			}
+		}
+		for (; i < n; ++i) {
+			out[i] = encode<Int>(x[i], y[i], z[i]);
+		}
+	}
+
+	template<class Int>
+	void decode(const OctahedralNormal<Int>* in, Vec<3, float>* out, size_t n) {
+		size_t i = 0;
+		if constexpr (MATH3D_SSE) {
+			for (; i + 8 <= n; i += 8) {
+				f32x8 x, y, z;
+				decode8(&in[i].u, x, y, z);
+				float* dst = &out[i].x;
+				f32x4 packed[6];
+				interleave3(low(x), low(y), low(z), packed[0], packed[1], packed[2]);
+				interleave3(high(x), high(y), high(z), packed[3], packed[4], packed[5]);
+				for (int k = 0; k < 6; ++k) {
+					storeu(dst + 4 * k, packed[k]);
+				}
+			}
+		}
+		for (; i < n; ++i) {
+			out[i] = decode(in[i]);
+		}
+	}
+
+	template<class Int>
+	void decode(const OctahedralNormal<Int>* in, float* x, float* y, float* z, size_t n) {
+		size_t i = 0;
+		if constexpr (MATH3D_SSE) {
+			for (; i + 8 <= n; i += 8) {
+				f32x8 vx, vy, vz;
+				decode8(&in[i].u, vx, vy, vz);
+				storeu(x + i, vx);
+				storeu(y + i, vy);
+				storeu(z + i, vz);
+			}
+		}
+		for (; i < n; ++i) {
+			const Vec<3, float> v = decode(in[i]);
+			x[i] = v.x;
+			y[i] = v.y;
+			z[i] = v.z;
+		}
+	}
+}
+
+}
+
+/*
+* Bulk Pack and Unpack of normals
+* out must hold at least as many elements as in, except for the VecArray output,
+* which is resized.
+*/
+template<class Int>
+void pack(std::span<const math3d::Vec<3, float>> in, std::span<math3d::OctahedralNormal<Int>> out) {
+	math3d::octKernels::encode(in.data(), out.data(), in.size());
+}
+
+template<class Int>
+void unpack(std::span<const math3d::OctahedralNormal<Int>> in, std::span<math3d::Vec<3, float>> out) {
+	math3d::octKernels::decode(in.data(), out.data(), in.size());
+}
+
+template<class Int>
+void pack(const math3d::VecArray<3, float>& in, std::span<math3d::OctahedralNormal<Int>> out) {
+	math3d::octKernels::encode(in.component(0), in.component(1), in.component(2), out.data(), in.size());
+}
+
+template<class Int>
+void unpack(std::span<const math3d::OctahedralNormal<Int>> in, math3d::VecArray<3, float>& out) {
+	out.resize(in.size());
+	math3d::octKernels::decode(in.data(), out.component(0), out.component(1), out.component(2), in.size());
+}
@@ -0,0 +1,488 @@
+#pragma once
+
+#include "math3d.h"
+#include "transform.h"
+#include "vecArray.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace math3d {
+
+/*
+* Work Stealing Thread Pool
+* Every worker owns a deque of tasks. A task is a range of chunks of one job: the
+* thread that runs it keeps splitting it in half, pushing the upper half onto the
+* back of its own deque, until a single chunk is left, which it runs. Owners pop
+* from the back, so they continue with the chunks next to the ones they just ran,
+* and idle threads steal from the front, where the largest ranges are.
+*
+* The thread that starts a job works on it too, so a pool of n threads has n - 1
+* workers, and a job started from inside another job (on a worker) cannot deadlock.
+* Workers sleep while there is nothing to steal.
+*/
+class ThreadPool {
+public:
+	//threads counts the calling thread, a pool of 1 runs everything on the caller
+	explicit ThreadPool(size_t threads = defaultThreads()) {
+		threads = std::max<size_t>(threads, 1);
+		//the last queue is shared by the threads that are not workers of this pool
+		for (size_t i = 0; i < threads; ++i) {
+			queues.push_back(std::make_unique<Queue>());
+		}
+		workers.reserve(threads - 1);
+		for (size_t i = 0; i + 1 < threads; ++i) {
+			workers.emplace_back([this, i] { work(i); });
+		}
+	}
+
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (auto& worker : workers) {
+			worker.join();
+		}
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	//Number of threads that work on a job, including the one that started it
+	size_t concurrency() const {
+		return workers.size() + 1;
+	}
+
+	static size_t defaultThreads() {
+		return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	}
+
+	//Shared pool with defaultThreads() threads, created on first use
+	static ThreadPool& global() {
+		static ThreadPool pool;
+		return pool;
+	}
+
+	/*
+	* Runs body(chunk) for every chunk in [0, chunks) and returns when all of them
+	* are done. The first exception thrown by body is rethrown here, after the
+	* other chunks have finished.
+	*/
+	template<class Body>
+	void run(size_t chunks, Body& body) {
+		if (chunks == 0) {
+			return;
+		}
+		if (chunks == 1 || workers.empty()) {
+			std::exception_ptr error;
+			for (size_t i = 0; i < chunks; ++i) {
+				try {
+					body(i);
+				}
+				catch (...) {
+					if (!error) {
+						error = std::current_exception();
+					}
+				}
+			}
+			if (error) {
+				std::rethrow_exception(error);
+			}
+			return;
+		}
+		Job job;
+		job.body = &body;
+		job.run = [](void* b, size_t chunk) { (*static_cast<Body*>(b))(chunk); };
+		job.remaining.store(chunks, std::memory_order_relaxed);
+
+		//one contiguous range per thread, the caller's own range goes to its own queue
+		const size_t self = currentQueue();
+		const size_t parts = std::min(chunks, concurrency());
+		for (size_t p = 0; p < parts; ++p) {
+			size_t queue = p == 0 ? self : (self + p) % queues.size();
+			push(queue, { &job, chunks * p / parts, chunks * (p + 1) / parts }, false);
+		}
+		notify();
+
+		while (job.remaining.load(std::memory_order_acquire) != 0) {
+			Task task;
+			if (findTask(self, task)) {
+				execute(self, task);
+			}
+			else {
+				std::this_thread::yield();
+			}
+		}
+		if (job.error) {
+			std::rethrow_exception(job.error);
+		}
+	}
+
+private:
+	struct Job {
+		void (*run)(void* body, size_t chunk) = nullptr;
+		void* body = nullptr;
+		std::atomic<size_t> remaining{ 0 };
+		std::mutex errorMutex;
+		std::exception_ptr error;
+	};
+
+	//chunks [begin, end) of job
+	struct Task {
+		Job* job = nullptr;
+		size_t begin = 0;
+		size_t end = 0;
+	};
+
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	size_t currentQueue() const {
+		return currentPool == this ? currentIndex : queues.size() - 1;
+	}
+
+	void push(size_t queue, const Task& task, bool wakeOne = true) {
+		{
+			std::lock_guard<std::mutex> lock(queues[queue]->mutex);
+			queues[queue]->tasks.push_back(task);
+			queued.fetch_add(1);
+		}
+		if (wakeOne && sleeping.load() != 0) {
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			wake.notify_one();
+		}
+	}
+
+	void notify() {
+		if (sleeping.load() != 0) {
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			wake.notify_all();
+		}
+	}
+
+	//The back of the thread's own queue, otherwise the front of another one
+	bool findTask(size_t self, Task& task) {
+		if (queued.load() == 0) {
+			return false;
+		}
+		for (size_t k = 0; k < queues.size(); ++k) {
+			size_t index = (self + k) % queues.size();
+			Queue& queue = *queues[index];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.tasks.empty()) {
+				if (k == 0) {
+					task = queue.tasks.back();
+					queue.tasks.pop_back();
+				}
+				else {
+					task = queue.tasks.front();
+					queue.tasks.pop_front();
+				}
+				queued.fetch_sub(1);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void execute(size_t self, Task task) {
+		while (task.end - task.begin > 1) {
+			size_t middle = task.begin + (task.end - task.begin) / 2;
+			push(self, { task.job, middle, task.end });
+			task.end = middle;
+		}
+		Job& job = *task.job;
+		try {
+			job.run(job.body, task.begin);
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock(job.errorMutex);
+			if (!job.error) {
+				job.error = std::current_exception();
+			}
+		}
+		//the job may be destroyed as soon as its count reaches zero
+		job.remaining.fetch_sub(1, std::memory_order_acq_rel);
+	}
+
+	void work(size_t index) {
+		currentPool = this;
+		currentIndex = index;
+		while (true) {
+			Task task;
+			if (findTask(index, task)) {
+				execute(index, task);
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			sleeping.fetch_add(1);
+			wake.wait(lock, [&] { return stopping || queued.load() != 0; });
+			sleeping.fetch_sub(1);
+			if (stopping) {
+				return;
+			}
+		}
+	}
+
+	static inline thread_local const ThreadPool* currentPool = nullptr;
+	static inline thread_local size_t currentIndex = 0;
+
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> workers;
+	std::atomic<size_t> queued{ 0 };
+	std::atomic<size_t> sleeping{ 0 };
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	bool stopping = false;
+};
+
+/*
+* Chunk sizes
+* Work is split into chunks of about ChunkBytes of data, which stay in a core's
+* L2 cache while they are processed, and are large enough that scheduling costs
+* nothing in comparison. Chunks are a multiple of 64 items, so that chunks of SoA
+* streams start on cache lines and two threads never write to the same line.
+*/
+inline constexpr size_t ChunkBytes = 64 * 1024;
+
+inline constexpr size_t chunkItems(size_t bytesPerItem) {
+	size_t items = ChunkBytes / std::max<size_t>(bytesPerItem, 1);
+	return std::max<size_t>(items / 64 * 64, 64);
+}
+
+/*
+* Parallel Loops
+* body(begin, end) is called for consecutive ranges of [0, count) of at most grain
+* items, on every thread of the pool. The ranges only depend on count and grain.
+*/
+template<class Body>
+void parallelFor(ThreadPool& pool, size_t count, size_t grain, Body&& body) {
+	grain = std::max<size_t>(grain, 1);
+	auto chunk = [&](size_t c) {
+		body(c * grain, std::min(count, (c + 1) * grain));
+	};
+	pool.run((count + grain - 1) / grain, chunk);
+}
+
+template<class Body>
+void parallelFor(size_t count, size_t grain, Body&& body) {
+	parallelFor(ThreadPool::global(), count, grain, std::forward<Body>(body));
+}
+
+/*
+* kernel(inChunk, outChunk) is a batched function over spans, applied to matching
+* chunks of in and out, e.g.
+*	parallelTransform(points, out, [&](auto in, auto out) { transformPoints(m, in, out); });
+* out must hold at least in.size() elements.
+*/
+template<class In, class Out, class Kernel>
+void parallelTransform(ThreadPool& pool, std::span<In> in, std::span<Out> out, Kernel&& kernel, size_t grain = chunkItems(sizeof(In) + sizeof(Out))) {
+	parallelFor(pool, in.size(), grain, [&](size_t begin, size_t end) {
+		kernel(in.subspan(begin, end - begin), out.subspan(begin, end - begin));
+	});
+}
+
+template<class In, class Out, class Kernel>
+void parallelTransform(std::span<In> in, std::span<Out> out, Kernel&& kernel, size_t grain = chunkItems(sizeof(In) + sizeof(Out))) {
+	parallelTransform(ThreadPool::global(), in, out, std::forward<Kernel>(kernel), grain);
+}
+
+/*
+* Deterministic Reduction
+* map(begin, end) reduces one chunk, and the chunk results are combined pairwise in
+* a fixed tree: ((c0 + c1) + (c2 + c3)) + .... The chunks only depend on count and
+* grain, so the result is the same, bit for bit, whatever the number of threads and
+* however the chunks were scheduled. The pairwise tree also keeps the rounding
+* error of a long floating point sum at O(log chunks) rather than O(chunks).
+* Returns identity for an empty range.
+*/
+template<class R, class Combine>
+R combinePairwise(std::vector<R>& partial, Combine& combine) {
+	const size_t chunks = partial.size();
+	for (size_t width = 1; width < chunks; width *= 2) {
+		for (size_t i = 0; i + width < chunks; i += 2 * width) {
+			partial[i] = combine(partial[i], partial[i + width]);
+		}
+	}
+	return partial[0];
+}
+
+template<class R, class Map, class Combine>
+R parallelReduce(ThreadPool& pool, size_t count, size_t grain, R identity, Map&& map, Combine&& combine) {
+	grain = std::max<size_t>(grain, 1);
+	const size_t chunks = (count + grain - 1) / grain;
+	if (chunks == 0) {
+		return identity;
+	}
+	std::vector<R> partial(chunks, identity);
+	parallelFor(pool, count, grain, [&](size_t begin, size_t end) {
+		partial[begin / grain] = map(begin, end);
+	});
+	return combinePairwise(partial, combine);
+}
+
+template<class R, class Map, class Combine>
+R parallelReduce(size_t count, size_t grain, R identity, Map&& map, Combine&& combine) {
+	return parallelReduce(ThreadPool::global(), count, grain, std::move(identity), std::forward<Map>(map), std::forward<Combine>(combine));
+}
+
+//parallelReduce on the calling thread alone, with the same chunks and tree, so the same bits
+template<class R, class Map, class Combine>
+R sequentialReduce(size_t count, size_t grain, R identity, Map&& map, Combine&& combine) {
+	grain = std::max<size_t>(grain, 1);
+	const size_t chunks = (count + grain - 1) / grain;
+	if (chunks == 0) {
+		return identity;
+	}
+	std::vector<R> partial;
+	partial.reserve(chunks);
+	for (size_t begin = 0; begin < count; begin += grain) {
+		partial.push_back(map(begin, std::min(count, begin + grain)));
+	}
+	return combinePairwise(partial, combine);
+}
+
+//Chunks of a VecArray whose streams are Dim arrays of T
+template<size_t Dim, class T>
+inline constexpr size_t ArrayChunk = chunkItems(Dim * sizeof(T));
+
+}
+
+/*
+* Parallel Batched Functions
+* The batched VecArray and span functions, run in chunks on every thread of pool.
+* Results are identical to the single threaded functions. out is resized to the
+* size of the inputs (for VecArray) or must hold that many elements (for spans).
+*/
+template<size_t Dim, class T, class U, class R>
+void add(math3d::ThreadPool& pool, const math3d::VecArray<Dim, T>& a, const math3d::VecArray<Dim, U>& b, math3d::VecArray<Dim, R>& out) {
+	out.resize(a.size());
+	math3d::parallelFor(pool, a.size(), math3d::ArrayChunk<Dim, R>, [&](size_t begin, size_t end) {
+		math3d::combineStreams(a, b, out, begin, end, [](T x, U y) { return x + y; });
+	});
+}
+
+template<size_t Dim, class T, class U, class R>
+void subtract(math3d::ThreadPool& pool, const math3d::VecArray<Dim, T>& a, const math3d::VecArray<Dim, U>& b, math3d::VecArray<Dim, R>& out) {
+	out.resize(a.size());
+	math3d::parallelFor(pool, a.size(), math3d::ArrayChunk<Dim, R>, [&](size_t begin, size_t end) {
+		math3d::combineStreams(a, b, out, begin, end, [](T x, U y) { return x - y; });
+	});
+}
+
+//out = a * s, keeping the element type of a as the scalar operator* does. out may be a
+template<size_t Dim, class T, class ScalarType>
+void scale(math3d::ThreadPool& pool, const math3d::VecArray<Dim, T>& a, ScalarType s, math3d::VecArray<Dim, T>& out) {
+	if (&out != &a) {
+		out.resize(a.size());
+	}
+	math3d::parallelFor(pool, a.size(), math3d::ArrayChunk<Dim, T>, [&](size_t begin, size_t end) {
+		math3d::mapStreams(a, out, begin, end, [s](T x) { return x * s; });
+	});
+}
+
+template<size_t Dim, class T, class U, class R>
+void dotProduct(math3d::ThreadPool& pool, const math3d::VecArray<Dim, T>& a, const math3d::VecArray<Dim, U>& b, std::span<R> out) {
+	math3d::parallelFor(pool, a.size(), math3d::ArrayChunk<Dim, T>, [&](size_t begin, size_t end) {
+		math3d::dotProducts(a, b, out.data(), begin, end);
+	});
+}
+
+//out may be v
+template<size_t Dim, class T, class R = RootType<T>>
+void unit(math3d::ThreadPool& pool, const math3d::VecArray<Dim, T>& v, math3d::VecArray<Dim, R>& out) {
+	if (static_cast<const void*>(&out) != static_cast<const void*>(&v)) {
+		out.resize(v.size());
+	}
+	math3d::parallelFor(pool, v.size(), math3d::ArrayChunk<Dim, T>, [&](size_t begin, size_t end) {
+		math3d::normalize(v, out, begin, end, math3d::inverseSqrt<R>);
+	});
+}
+
+template<class T, class ScalarType>
+void axpy(math3d::ThreadPool& pool, ScalarType alpha, std::span<const T> x, std::span<T> y) {
+	math3d::parallelFor(pool, x.size(), math3d::chunkItems(2 * sizeof(T)), [&](size_t begin, size_t end) {
+		math3d::addScaled(static_cast<T>(alpha), x.data(), y.data(), begin, end);
+	});
+}
+
+template<size_t Dim, class T, class ScalarType>
+void axpy(math3d::ThreadPool& pool, ScalarType alpha, std::span<const math3d::Vec<Dim, T>> x, std::span<math3d::Vec<Dim, T>> y) {
+	static_assert(sizeof(math3d::Vec<Dim, T>) == Dim * sizeof(T));
+	axpy(pool, alpha, std::span<const T>(reinterpret_cast<const T*>(x.data()), Dim * x.size()), std::span<T>(reinterpret_cast<T*>(y.data()), Dim * y.size()));
+}
+
+template<size_t Dim, class T, class ScalarType>
+void axpy(math3d::ThreadPool& pool, ScalarType alpha, const math3d::VecArray<Dim, T>& x, math3d::VecArray<Dim, T>& y) {
+	math3d::parallelFor(pool, x.size(), math3d::ArrayChunk<Dim, T>, [&](size_t begin, size_t end) {
+		math3d::addScaled(static_cast<T>(alpha), x, y, begin, end);
+	});
+}
+
+/*
+* Parallel Batched Transforms
+* Whether to stream is decided once for the whole output, see math3d::StoreMode.
+*/
+template<size_t Dim, class T>
+void transformPoints(math3d::ThreadPool& pool, const math3d::Matrix<4, 4, T>& m, std::span<const math3d::Vec<Dim, std::type_identity_t<T>>> in,
+	std::span<math3d::Vec<Dim, std::type_identity_t<T>>> out, math3d::StoreMode mode = math3d::StoreMode::Automatic) {
+	mode = math3d::useStreaming(mode, in.size() * sizeof(math3d::Vec<Dim, T>)) ? math3d::StoreMode::Streaming : math3d::StoreMode::Cached;
+	math3d::parallelTransform(pool, in, out, [&](auto inChunk, auto outChunk) {
+		transformPoints(m, inChunk, outChunk, mode);
+	});
+}
+
+template<size_t Dim, class T>
+void transformDirections(math3d::ThreadPool& pool, const math3d::Matrix<4, 4, T>& m, std::span<const math3d::Vec<Dim, std::type_identity_t<T>>> in,
+	std::span<math3d::Vec<Dim, std::type_identity_t<T>>> out, math3d::StoreMode mode = math3d::StoreMode::Automatic) {
+	mode = math3d::useStreaming(mode, in.size() * sizeof(math3d::Vec<Dim, T>)) ? math3d::StoreMode::Streaming : math3d::StoreMode::Cached;
+	math3d::parallelTransform(pool, in, out, [&](auto inChunk, auto outChunk) {
+		transformDirections(m, inChunk, outChunk, mode);
+	});
+}
+
+namespace math3d {
+	template<bool Translate, class T>
+	void transformArray(ThreadPool& pool, const Matrix<4, 4, T>& m, const VecArray<3, T>& in, VecArray<3, T>& out, StoreMode mode) {
+		out.resize(in.size());
+		const bool streaming = useStreaming(mode, 3 * in.paddedSize() * sizeof(T));
+		parallelFor(pool, in.size(), ArrayChunk<3, T>, [&](size_t begin, size_t end) {
+			if constexpr (std::is_same_v<T, float>) {
+				//the last chunk also covers the padding, so there is no scalar tail
+				transformKernels::transformSoA<Translate>(m, in, out, begin, end == in.size() ? in.paddedSize() : end, streaming);
+			}
+			else {
+				for (size_t i = begin; i < end; ++i) {
+					out.set(i, Translate ? transformPoint(m, in.get(i)) : transformDirection(m, in.get(i)));
+				}
+			}
+		});
+	}
+}
+
+//out may be in
+template<class T>
+void transformPoints(math3d::ThreadPool& pool, const math3d::Matrix<4, 4, T>& m, const math3d::VecArray<3, T>& in, math3d::VecArray<3, T>& out,
+	math3d::StoreMode mode = math3d::StoreMode::Automatic) {
+	math3d::transformArray<true>(pool, m, in, out, mode);
+}
+
+template<class T>
+void transformDirections(math3d::ThreadPool& pool, const math3d::Matrix<4, 4, T>& m, const math3d::VecArray<3, T>& in, math3d::VecArray<3, T>& out,
+	math3d::StoreMode mode = math3d::StoreMode::Automatic) {
+	math3d::transformArray<false>(pool, m, in, out, mode);
+}
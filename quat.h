@@ -0,0 +1,350 @@
+#pragma once
+
+#include "math3d.h"
+#include "transform.h"
+#include "vecArray.h"
+
+#include <cmath>
+#include <span>
+#include <type_traits>
+
+/*
+* Quaternions
+* Quat<T> stores x, y, z (the vector part) and w (the scalar part) in a Vec<4, T>, so
+* a Quat<float> is as big and as aligned as a Vec<4, float>, a quarter of a 4x4 matrix.
+* Only unit quaternions are rotations, and the functions below assume unit input
+* unless they say otherwise. q and -q are the same rotation.
+* Composition follows matrices: (a * b) rotates by b first, then by a, and
+* toMatrix3x3(a * b) == toMatrix3x3(a) * toMatrix3x3(b).
+*/
+namespace math3d {
+
+template<class T>
+struct Quat {
+	static_assert(std::is_floating_point_v<T>, "Quat needs a floating point element type");
+
+	Vec<4, T> xyzw{ 0, 0, 0, 1 };
+
+	constexpr Vec<3, T> vector() const {
+		return { xyzw.x, xyzw.y, xyzw.z };
+	}
+
+	constexpr T scalar() const {
+		return xyzw.w;
+	}
+
+	//Rotation by angle radians about a unit axis, counterclockwise looking down the axis
+	static Quat axisAngle(const Vec<3, T>& axis, T angle) {
+		T s = std::sin(angle / 2);
+		return { { axis.x * s, axis.y * s, axis.z * s, std::cos(angle / 2) } };
+	}
+};
+
+/*
+* Kernels for Quat<float>
+* The Hamilton product is four broadcasts of a against signed swizzles of b.
+* Batches are blended four at a time, transposed so that each register holds one
+* component of four quaternions and every step is a vertical operation.
+*/
+namespace quatKernels {
+	using namespace simd;
+
+	inline Quat<float> multiply(const Quat<float>& a, const Quat<float>& b) {
+		f32x4 p = load(a.xyzw);
+		f32x4 q = load(b.xyzw);
+		f32x4 r = mul(broadcast<3>(p), q);
+		r = madd(broadcast<0>(p), mul(shuffle<3, 2, 1, 0>(q, q), set(1, -1, 1, -1)), r);
+		r = madd(broadcast<1>(p), mul(shuffle<2, 3, 0, 1>(q, q), set(1, 1, -1, -1)), r);
+		r = madd(broadcast<2>(p), mul(shuffle<1, 0, 3, 2>(q, q), set(-1, 1, 1, -1)), r);
+		return { toVec<4>(r) };
+	}
+
+	struct Quat4 {
+		f32x4 x, y, z, w;
+	};
+
+	inline Quat4 load4(const Quat<float>* q) {
+		Quat4 r{ load(q[0].xyzw), load(q[1].xyzw), load(q[2].xyzw), load(q[3].xyzw) };
+		transpose4(r.x, r.y, r.z, r.w);
+		return r;
+	}
+
+	inline void store4(Quat<float>* q, Quat4 r) {
+		transpose4(r.x, r.y, r.z, r.w);
+		store(&q[0].xyzw.x, r.x);
+		store(&q[1].xyzw.x, r.y);
+		store(&q[2].xyzw.x, r.z);
+		store(&q[3].xyzw.x, r.w);
+	}
+
+	inline f32x4 dot(const Quat4& a, const Quat4& b) {
+		return madd(a.w, b.w, madd(a.z, b.z, madd(a.y, b.y, mul(a.x, b.x))));
+	}
+
+	//ca a + cb b
+	inline Quat4 combine(const Quat4& a, f32x4 ca, const Quat4& b, f32x4 cb) {
+		return { madd(b.x, cb, mul(a.x, ca)), madd(b.y, cb, mul(a.y, ca)), madd(b.z, cb, mul(a.z, ca)), madd(b.w, cb, mul(a.w, ca)) };
+	}
+
+	/*
+	* sin(t angle) / sin(angle) for the angle whose cosine is x >= 0, as a product of
+	* 12 factors 1 + (t^2 - i^2) / (i (2i + 1)) (x - 1) from its series (D. Eberly,
+	* A Fast and Accurate Algorithm for Computing SLERP). The last factor is scaled
+	* by Mu, fitted so that the error over 0 <= t <= 1, 0 <= x <= 1 stays below 1e-6.
+	* Only multiplies and adds.
+	*/
+	struct SlerpSeries {
+		static constexpr int Terms = 12;
+		static constexpr float Mu = 1.894f;
+		float u[Terms];
+		float v[Terms];
+
+		constexpr SlerpSeries() : u{}, v{} {
+			for (int i = 1; i <= Terms; ++i) {
+				float scale = i == Terms ? Mu : 1.0f;
+				u[i - 1] = scale / static_cast<float>(i * (2 * i + 1));
+				v[i - 1] = scale * static_cast<float>(i) / static_cast<float>(2 * i + 1);
+			}
+		}
+	};
+
+	inline f32x4 slerpWeight(f32x4 t, f32x4 xm1) {
+		constexpr SlerpSeries series;
+		f32x4 tt = mul(t, t);
+		f32x4 product = splat(1);
+		for (int i = SlerpSeries::Terms - 1; i >= 0; --i) {
+			f32x4 factor = mul(sub(mul(splat(series.u[i]), tt), splat(series.v[i])), xm1);
+			product = madd(factor, product, splat(1));
+		}
+		return mul(t, product);
+	}
+
+	template<bool Slerp>
+	inline Quat4 blend(const Quat4& a, Quat4 b, f32x4 t) {
+		//flip b into the hemisphere of a to take the shorter arc
+		f32x4 d = dot(a, b);
+		b = { mulSign(b.x, d), mulSign(b.y, d), mulSign(b.z, d), mulSign(b.w, d) };
+		if constexpr (Slerp) {
+			f32x4 xm1 = sub(mulSign(d, d), splat(1));
+			return combine(a, slerpWeight(sub(splat(1), t), xm1), b, slerpWeight(t, xm1));
+		}
+		else {
+			Quat4 r = combine(a, sub(splat(1), t), b, t);
+			f32x4 scale = rsqrt<Precision::Refined>(dot(r, r));
+			return { mul(r.x, scale), mul(r.y, scale), mul(r.z, scale), mul(r.w, scale) };
+		}
+	}
+
+	//weight(i) is the f32x4 of blend factors for elements i to i + 3
+	template<bool Slerp, class Weight>
+	void blendArrays(const Quat<float>* a, const Quat<float>* b, Quat<float>* out, size_t n, Weight weight) {
+		for (size_t i = 0; i + 4 <= n; i += 4) {
+			store4(out + i, blend<Slerp>(load4(a + i), load4(b + i), weight(i)));
+		}
+	}
+}
+
+}
+
+template<class T>
+constexpr bool operator==(const math3d::Quat<T>& a, const math3d::Quat<T>& b) {
+	return a.xyzw == b.xyzw;
+}
+
+template<class T>
+constexpr bool operator!=(const math3d::Quat<T>& a, const math3d::Quat<T>& b) {
+	return a.xyzw != b.xyzw;
+}
+
+/*
+* Quaternion Product
+* Hamilton product, the rotation by b followed by the rotation by a
+*/
+template<class T>
+constexpr math3d::Quat<T> operator*(const math3d::Quat<T>& a, const math3d::Quat<T>& b) {
+	if constexpr (math3d::simd::Accelerated<4, 1, T, T>) {
+		if (!std::is_constant_evaluated()) {
+			return math3d::quatKernels::multiply(a, b);
+		}
+	}
+	const math3d::Vec<4, T>& p = a.xyzw;
+	const math3d::Vec<4, T>& q = b.xyzw;
+	return { {
+		p.w * q.x + p.x * q.w + p.y * q.z - p.z * q.y,
+		p.w * q.y - p.x * q.z + p.y * q.w + p.z * q.x,
+		p.w * q.z + p.x * q.y - p.y * q.x + p.z * q.w,
+		p.w * q.w - p.x * q.x - p.y * q.y - p.z * q.z
+	} };
+}
+
+//The inverse rotation of a unit quaternion
+template<class T>
+constexpr math3d::Quat<T> conjugate(const math3d::Quat<T>& q) {
+	return { { -q.xyzw.x, -q.xyzw.y, -q.xyzw.z, q.xyzw.w } };
+}
+
+template<class T>
+constexpr T dotProduct(const math3d::Quat<T>& a, const math3d::Quat<T>& b) {
+	return dotProduct(a.xyzw, b.xyzw);
+}
+
+//Any nonzero quaternion scaled to unit length
+template<class T>
+math3d::Quat<T> unit(const math3d::Quat<T>& q) {
+	return { unit(q.xyzw) };
+}
+
+/*
+* Rotation of a Vec<3, T>
+* q v q* expanded with the vector part u and t = 2 (u x v) into v + w t + u x t
+*/
+template<class T>
+constexpr math3d::Vec<3, T> rotate(const math3d::Quat<T>& q, const math3d::Vec<3, T>& v) {
+	const math3d::Vec<3, T> u = q.vector();
+	const math3d::Vec<3, T> t = crossProduct(u, v) * T{ 2 };
+	return v + t * q.scalar() + crossProduct(u, t);
+}
+
+/*
+* Conversion to and from Matrices
+* toQuat takes the largest of w, x, y, z from the diagonal first, which keeps the
+* square root and the divisions well conditioned for any rotation. The 4x4 versions
+* only use the upper 3x3, the rotation of an affine transform.
+*/
+template<class T>
+constexpr math3d::Matrix<3, 3, T> toMatrix3x3(const math3d::Quat<T>& q) {
+	const T x = q.xyzw.x;
+	const T y = q.xyzw.y;
+	const T z = q.xyzw.z;
+	const T w = q.xyzw.w;
+	const T xx = x * x * 2, yy = y * y * 2, zz = z * z * 2;
+	const T xy = x * y * 2, xz = x * z * 2, yz = y * z * 2;
+	const T wx = w * x * 2, wy = w * y * 2, wz = w * z * 2;
+	return {
+		{ 1 - (yy + zz), xy - wz, xz + wy },
+		{ xy + wz, 1 - (xx + zz), yz - wx },
+		{ xz - wy, yz + wx, 1 - (xx + yy) }
+	};
+}
+
+template<class T>
+constexpr math3d::Matrix<4, 4, T> toMatrix4x4(const math3d::Quat<T>& q) {
+	const math3d::Matrix<3, 3, T> m = toMatrix3x3(q);
+	return { { m.x.x, m.x.y, m.x.z, 0 }, { m.y.x, m.y.y, m.y.z, 0 }, { m.z.x, m.z.y, m.z.z, 0 }, { 0, 0, 0, 1 } };
+}
+
+template<class T>
+math3d::Quat<T> toQuat(const math3d::Matrix<3, 3, T>& m) {
+	const T trace = m.x.x + m.y.y + m.z.z;
+	if (trace > 0) {
+		const T s = std::sqrt(trace + 1) * 2;
+		return { { (m.z.y - m.y.z) / s, (m.x.z - m.z.x) / s, (m.y.x - m.x.y) / s, s / 4 } };
+	}
+	if (m.x.x > m.y.y && m.x.x > m.z.z) {
+		const T s = std::sqrt(1 + m.x.x - m.y.y - m.z.z) * 2;
+		return { { s / 4, (m.x.y + m.y.x) / s, (m.x.z + m.z.x) / s, (m.z.y - m.y.z) / s } };
+	}
+	if (m.y.y > m.z.z) {
+		const T s = std::sqrt(1 + m.y.y - m.x.x - m.z.z) * 2;
+		return { { (m.x.y + m.y.x) / s, s / 4, (m.y.z + m.z.y) / s, (m.x.z - m.z.x) / s } };
+	}
+	const T s = std::sqrt(1 + m.z.z - m.x.x - m.y.y) * 2;
+	return { { (m.x.z + m.z.x) / s, (m.y.z + m.z.y) / s, s / 4, (m.y.x - m.x.y) / s } };
+}
+
+template<class T>
+math3d::Quat<T> toQuat(const math3d::Matrix<4, 4, T>& m) {
+	return toQuat(math3d::Matrix<3, 3, T>{ { m.x.x, m.x.y, m.x.z }, { m.y.x, m.y.y, m.y.z }, { m.z.x, m.z.y, m.z.z } });
+}
+
+/*
+* Interpolation
+* Both take the shorter arc, so they may return the negation of b at t = 1.
+* nlerp blends linearly and renormalizes: cheap, exact at the ends, but not
+* constant speed. slerp rotates at constant speed along the arc.
+*/
+template<class T>
+math3d::Quat<T> nlerp(const math3d::Quat<T>& a, const math3d::Quat<T>& b, std::type_identity_t<T> t) {
+	const math3d::Vec<4, T> to = dotProduct(a, b) < 0 ? b.xyzw * T{ -1 } : b.xyzw;
+	return { unit(a.xyzw + (to - a.xyzw) * t) };
+}
+
+template<class T>
+math3d::Quat<T> slerp(const math3d::Quat<T>& a, const math3d::Quat<T>& b, std::type_identity_t<T> t) {
+	T d = dotProduct(a, b);
+	const math3d::Vec<4, T> to = d < 0 ? b.xyzw * T{ -1 } : b.xyzw;
+	d = std::abs(d);
+	//sin(angle) underflows for nearly equal rotations, where the arc is a line anyway
+	if (d > T(0.9995)) {
+		return { unit(a.xyzw + (to - a.xyzw) * t) };
+	}
+	const T angle = std::acos(d);
+	const T s = std::sin(angle);
+	return { a.xyzw * (std::sin((1 - t) * angle) / s) + to * (std::sin(t * angle) / s) };
+}
+
+/*
+* Batched Rotation
+* One rotation applied to many vectors goes through its matrix, which takes 9
+* multiply-adds per vector instead of the 18 of rotate, using the batched
+* transform kernels. out may be the same array as in.
+*/
+template<class T>
+void rotate(const math3d::Quat<T>& q, std::span<const math3d::Vec<3, std::type_identity_t<T>>> in,
+	std::span<math3d::Vec<3, std::type_identity_t<T>>> out, math3d::StoreMode mode = math3d::StoreMode::Automatic) {
+	transformDirections(toMatrix4x4(q), in, out, mode);
+}
+
+template<class T>
+void rotate(const math3d::Quat<T>& q, const math3d::VecArray<3, T>& in, math3d::VecArray<3, T>& out,
+	math3d::StoreMode mode = math3d::StoreMode::Automatic) {
+	transformDirections(toMatrix4x4(q), in, out, mode);
+}
+
+/*
+* Batched Interpolation
+* Blends a[i] toward b[i] by one shared t or by t[i], into out[i], which may alias a
+* or b. Quat<float> runs 4 quaternions per iteration in SIMD registers. The batched
+* slerp replaces acos and sin by a polynomial, so it agrees with the single slerp
+* to about 1e-6, and batched nlerp renormalizes with rsqrt<Precision::Refined>.
+*/
+namespace math3d {
+	template<bool Slerp, class T, class Weight>
+	void blendArrays(std::span<const Quat<T>> a, std::span<const Quat<T>> b, std::span<Quat<T>> out, Weight weight) {
+		size_t i = 0;
+		if constexpr (std::is_same_v<T, float>) {
+			quatKernels::blendArrays<Slerp>(a.data(), b.data(), out.data(), a.size(), [&](size_t j) {
+				return simd::set(weight(j), weight(j + 1), weight(j + 2), weight(j + 3));
+			});
+			i = a.size() - a.size() % 4;
+		}
+		for (; i < a.size(); ++i) {
+			if constexpr (Slerp) {
+				out[i] = ::slerp(a[i], b[i], weight(i));
+			}
+			else {
+				out[i] = ::nlerp(a[i], b[i], weight(i));
+			}
+		}
+	}
+}
+
+template<class T>
+void nlerp(std::span<const math3d::Quat<T>> a, std::span<const math3d::Quat<T>> b, std::type_identity_t<T> t, std::span<math3d::Quat<T>> out) {
+	math3d::blendArrays<false>(a, b, out, [t](size_t) { return t; });
+}
+
+template<class T>
+void nlerp(std::span<const math3d::Quat<T>> a, std::span<const math3d::Quat<T>> b, std::span<const std::type_identity_t<T>> t, std::span<math3d::Quat<T>> out) {
+	math3d::blendArrays<false>(a, b, out, [t](size_t i) { return t[i]; });
+}
+
+template<class T>
+void slerp(std::span<const math3d::Quat<T>> a, std::span<const math3d::Quat<T>> b, std::type_identity_t<T> t, std::span<math3d::Quat<T>> out) {
+	math3d::blendArrays<true>(a, b, out, [t](size_t) { return t; });
+}
+
+template<class T>
+void slerp(std::span<const math3d::Quat<T>> a, std::span<const math3d::Quat<T>> b, std::span<const std::type_identity_t<T>> t, std::span<math3d::Quat<T>> out) {
+	math3d::blendArrays<true>(a, b, out, [t](size_t i) { return t[i]; });
+}
@@ -0,0 +1,731 @@
+#pragma once
+
+#include "math3d.h"
+#include "parallel.h"
+#include "simd.h"
+#include "vecArray.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <span>
+#include <type_traits>
+
+namespace math3d {
+
+/*
+* Axis Aligned Bounding Box
+* The default box is empty, lower = +infinity and upper = -infinity, so growing it
+* by any point or box gives that point or box.
+*/
+template<class T>
+struct Aabb {
+	static constexpr T Infinity = std::numeric_limits<T>::infinity();
+
+	Vec<3, T> lower = { Infinity, Infinity, Infinity };
+	Vec<3, T> upper = { -Infinity, -Infinity, -Infinity };
+
+	constexpr bool empty() const {
+		return !(lower.x <= upper.x && lower.y <= upper.y && lower.z <= upper.z);
+	}
+
+	constexpr Aabb& grow(const Vec<3, T>& p) {
+		for (size_t k = 0; k < 3; ++k) {
+			lower[k] = p[k] < lower[k] ? p[k] : lower[k];
+			upper[k] = p[k] > upper[k] ? p[k] : upper[k];
+		}
+		return *this;
+	}
+
+	constexpr Aabb& grow(const Aabb& box) {
+		for (size_t k = 0; k < 3; ++k) {
+			lower[k] = box.lower[k] < lower[k] ? box.lower[k] : lower[k];
+			upper[k] = box.upper[k] > upper[k] ? box.upper[k] : upper[k];
+		}
+		return *this;
+	}
+
+	constexpr Vec<3, T> center() const {
+		return { (lower.x + upper.x) / 2, (lower.y + upper.y) / 2, (lower.z + upper.z) / 2 };
+	}
+
+	constexpr Vec<3, T> extent() const {
+		return { upper.x - lower.x, upper.y - lower.y, upper.z - lower.z };
+	}
+
+	//Surface area, 0 for an empty box
+	constexpr T area() const {
+		if (empty()) {
+			return 0;
+		}
+		const Vec<3, T> e = extent();
+		return 2 * (e.x * e.y + e.y * e.z + e.z * e.x);
+	}
+
+	//Boxes that touch overlap, an empty box overlaps nothing
+	constexpr bool overlaps(const Aabb& box) const {
+		return lower.x <= box.upper.x && box.lower.x <= upper.x && lower.y <= box.upper.y && box.lower.y <= upper.y
+			&& lower.z <= box.upper.z && box.lower.z <= upper.z;
+	}
+
+	//Squared distance from p to the nearest point of the box, 0 inside
+	constexpr T distanceSquared(const Vec<3, T>& p) const {
+		T d = 0;
+		for (size_t k = 0; k < 3; ++k) {
+			const T below = lower[k] - p[k];
+			const T above = p[k] - upper[k];
+			const T outside = below > above ? below : above;
+			d += outside > 0 ? outside * outside : 0;
+		}
+		return d;
+	}
+
+	constexpr bool operator==(const Aabb&) const = default;
+};
+
+//Sums of float are accumulated in double
+template<class T>
+using AccumulatorType = std::conditional_t<(sizeof(T) < sizeof(double)), double, T>;
+
+template<class T>
+struct PointStatistics {
+	size_t count = 0;
+	Aabb<T> bounds;
+	Vec<3, T> centroid;
+	Matrix<3, 3, T> covariance;
+};
+
+/*
+* Point Set Reductions
+* Points are reduced in chunks that only depend on the number of points, and the
+* chunk results are combined in the fixed pairwise tree of parallelReduce, so the
+* single threaded and the parallel functions give the same bits whatever the
+* number of threads.
+*
+* Within a chunk, float points are accumulated in 8 float lanes (one f32x8 with
+* SSE, 8 scalars without, in the same order), relative to the first point of the
+* chunk so that point sets far from the origin keep their precision. Every 512
+* points the lanes are added to double totals. The chunk results are combined in
+* double, the means and scatter matrices with the pairwise update of Chan et al:
+*	delta = meanB - meanA
+*	mean = meanA + delta * nB / n
+*	scatter = scatterA + scatterB + delta delta^T * nA nB / n
+* which, unlike sum(p p^T) / n - mean mean^T, does not cancel catastrophically.
+*/
+namespace reduceKernels {
+	using namespace simd;
+
+	inline constexpr size_t Lanes = 8;
+	inline constexpr size_t BlockItems = 64 * Lanes;
+
+	template<class T>
+	inline constexpr size_t Chunk = chunkItems(sizeof(Vec<3, T>));
+
+	template<class T>
+	inline constexpr bool Simd = MATH3D_SSE && std::is_same_v<T, float>;
+
+	template<class T>
+	struct AoSPoints {
+		const Vec<3, T>* points;
+
+		Vec<3, T> get(size_t i) const {
+			return points[i];
+		}
+
+		void load8(size_t i, f32x8& x, f32x8& y, f32x8& z) const {
+			const float* src = &points[i].x;
+			f32x4 x0, y0, z0, x1, y1, z1;
+			deinterleave3(loadu(src), loadu(src + 4), loadu(src + 8), x0, y0, z0);
+			deinterleave3(loadu(src + 12), loadu(src + 16), loadu(src + 20), x1, y1, z1);
+			x = combine(x0, x1);
+			y = combine(y0, y1);
+			z = combine(z0, z1);
+		}
+	};
+
+	template<class T>
+	struct SoAPoints {
+		const T* x;
+		const T* y;
+		const T* z;
+
+		Vec<3, T> get(size_t i) const {
+			return { x[i], y[i], z[i] };
+		}
+
+		void load8(size_t i, f32x8& vx, f32x8& vy, f32x8& vz) const {
+			vx = loadu8(x + i);
+			vy = loadu8(y + i);
+			vz = loadu8(z + i);
+		}
+	};
+
+	template<class T>
+	AoSPoints<T> view(std::span<const Vec<3, T>> points) {
+		return { points.data() };
+	}
+
+	template<class T>
+	SoAPoints<T> view(const VecArray<3, T>& points) {
+		return { points.x(), points.y(), points.z() };
+	}
+
+	//The lanes summed in a fixed tree
+	template<class A, class T>
+	A sumLanes(const T (&lanes)[Lanes]) {
+		return ((A(lanes[0]) + A(lanes[1])) + (A(lanes[2]) + A(lanes[3]))) + ((A(lanes[4]) + A(lanes[5])) + (A(lanes[6]) + A(lanes[7])));
+	}
+
+	template<class T, class Points>
+	Aabb<T> bounds(const Points& points, size_t begin, size_t end) {
+		T lower[3][Lanes];
+		T upper[3][Lanes];
+		std::fill_n(&lower[0][0], 3 * Lanes, Aabb<T>::Infinity);
+		std::fill_n(&upper[0][0], 3 * Lanes, -Aabb<T>::Infinity);
+		size_t i = begin;
+		if constexpr (Simd<T>) {
+			f32x8 lo[3] = { splat8(Aabb<T>::Infinity), splat8(Aabb<T>::Infinity), splat8(Aabb<T>::Infinity) };
+			f32x8 hi[3] = { splat8(-Aabb<T>::Infinity), splat8(-Aabb<T>::Infinity), splat8(-Aabb<T>::Infinity) };
+			for (; i + Lanes <= end; i += Lanes) {
+				f32x8 p[3];
+				points.load8(i, p[0], p[1], p[2]);
+				for (size_t k = 0; k < 3; ++k) {
+					lo[k] = min(p[k], lo[k]);
+					hi[k] = max(p[k], hi[k]);
+				}
+			}
+			for (size_t k = 0; k < 3; ++k) {
+				storeu(lower[k], lo[k]);
+				storeu(upper[k], hi[k]);
+			}
+		}
+		for (; i < end; ++i) {
+			const Vec<3, T> p = points.get(i);
+			const size_t lane = (i - begin) % Lanes;
+			for (size_t k = 0; k < 3; ++k) {
+				lower[k][lane] = p[k] < lower[k][lane] ? p[k] : lower[k][lane];
+				upper[k][lane] = p[k] > upper[k][lane] ? p[k] : upper[k][lane];
+			}
+		}
+		Aabb<T> box;
+		for (size_t lane = 0; lane < Lanes; ++lane) {
+			box.grow(Aabb<T>{ { lower[0][lane], lower[1][lane], lower[2][lane] }, { upper[0][lane], upper[1][lane], upper[2][lane] } });
+		}
+		return box;
+	}
+
+	/*
+	* Sums of d = p - origin over [begin, end): d.x, d.y, d.z, then with Products
+	* also d.x d.x, d.x d.y, d.x d.z, d.y d.y, d.y d.z, d.z d.z
+	*/
+	template<bool Products, class T, class Points, class A = AccumulatorType<T>>
+	void accumulate(const Points& points, size_t begin, size_t end, const Vec<3, T>& origin, A (&total)[Products ? 9 : 3]) {
+		constexpr size_t Sums = Products ? 9 : 3;
+		std::fill_n(total, Sums, A(0));
+		for (size_t block = begin; block < end; block += BlockItems) {
+			const size_t blockEnd = std::min(end, block + BlockItems);
+			T lanes[Sums][Lanes] = {};
+			size_t i = block;
+			if constexpr (Simd<T>) {
+				const f32x8 ox = splat8(origin.x);
+				const f32x8 oy = splat8(origin.y);
+				const f32x8 oz = splat8(origin.z);
+				f32x8 sums[Sums];
+				std::fill_n(sums, Sums, splat8(0));
+				for (; i + Lanes <= blockEnd; i += Lanes) {
+					f32x8 x, y, z;
+					points.load8(i, x, y, z);
+					x = sub(x, ox);
+					y = sub(y, oy);
+					z = sub(z, oz);
+					sums[0] = add(sums[0], x);
+					sums[1] = add(sums[1], y);
+					sums[2] = add(sums[2], z);
+					if constexpr (Products) {
+						sums[3] = add(sums[3], mul(x, x));
+						sums[4] = add(sums[4], mul(x, y));
+						sums[5] = add(sums[5], mul(x, z));
+						sums[6] = add(sums[6], mul(y, y));
+						sums[7] = add(sums[7], mul(y, z));
+						sums[8] = add(sums[8], mul(z, z));
+					}
+				}
+				for (size_t k = 0; k < Sums; ++k) {
+					storeu(lanes[k], sums[k]);
+				}
+			}
+			for (; i < blockEnd; ++i) {
+				const Vec<3, T> p = points.get(i);
+				const size_t lane = (i - block) % Lanes;
+				const T x = p.x - origin.x;
+				const T y = p.y - origin.y;
+				const T z = p.z - origin.z;
+				lanes[0][lane] += x;
+				lanes[1][lane] += y;
+				lanes[2][lane] += z;
+				if constexpr (Products) {
+					lanes[3][lane] += x * x;
+					lanes[4][lane] += x * y;
+					lanes[5][lane] += x * z;
+					lanes[6][lane] += y * y;
+					lanes[7][lane] += y * z;
+					lanes[8][lane] += z * z;
+				}
+			}
+			for (size_t k = 0; k < Sums; ++k) {
+				total[k] += sumLanes<A>(lanes[k]);
+			}
+		}
+	}
+
+	template<class A>
+	Vec<3, A> addVec(const Vec<3, A>& a, const Vec<3, A>& b) {
+		return { a.x + b.x, a.y + b.y, a.z + b.z };
+	}
+
+	template<class T, class Points, class A = AccumulatorType<T>>
+	Vec<3, A> sum(const Points& points, size_t begin, size_t end) {
+		const Vec<3, T> origin = points.get(begin);
+		A d[3];
+		accumulate<false>(points, begin, end, origin, d);
+		const A n = static_cast<A>(end - begin);
+		return { A(origin.x) * n + d[0], A(origin.y) * n + d[1], A(origin.z) * n + d[2] };
+	}
+
+	template<class A>
+	struct Moments {
+		size_t count = 0;
+		Vec<3, A> mean;
+		//sum of (p - mean) (p - mean)^T
+		Matrix<3, 3, A> scatter;
+	};
+
+	template<class T, class Points, class A = AccumulatorType<T>>
+	Moments<A> moments(const Points& points, size_t begin, size_t end) {
+		const Vec<3, T> origin = points.get(begin);
+		A d[9];
+		accumulate<true>(points, begin, end, origin, d);
+		const A n = static_cast<A>(end - begin);
+		const A s[3] = { d[0], d[1], d[2] };
+		const A products[3][3] = { { d[3], d[4], d[5] }, { d[4], d[6], d[7] }, { d[5], d[7], d[8] } };
+		Moments<A> m;
+		m.count = end - begin;
+		for (size_t r = 0; r < 3; ++r) {
+			m.mean[r] = A(origin[r]) + s[r] / n;
+			for (size_t c = 0; c < 3; ++c) {
+				m.scatter[r][c] = products[r][c] - s[r] * s[c] / n;
+			}
+		}
+		return m;
+	}
+
+	template<class A>
+	Moments<A> merge(const Moments<A>& a, const Moments<A>& b) {
+		if (a.count == 0) {
+			return b;
+		}
+		if (b.count == 0) {
+			return a;
+		}
+		const A na = static_cast<A>(a.count);
+		const A nb = static_cast<A>(b.count);
+		const A n = na + nb;
+		const A weight = na * nb / n;
+		Moments<A> m;
+		m.count = a.count + b.count;
+		A delta[3];
+		for (size_t r = 0; r < 3; ++r) {
+			delta[r] = b.mean[r] - a.mean[r];
+			m.mean[r] = a.mean[r] + delta[r] * (nb / n);
+		}
+		for (size_t r = 0; r < 3; ++r) {
+			for (size_t c = 0; c < 3; ++c) {
+				m.scatter[r][c] = (a.scatter[r][c] + b.scatter[r][c]) + delta[r] * delta[c] * weight;
+			}
+		}
+		return m;
+	}
+
+	template<class T, class A>
+	Matrix<3, 3, T> covariance(const Moments<A>& m) {
+		Matrix<3, 3, T> out;
+		if (m.count == 0) {
+			return out;
+		}
+		const A n = static_cast<A>(m.count);
+		for (size_t r = 0; r < 3; ++r) {
+			for (size_t c = 0; c < 3; ++c) {
+				out[r][c] = static_cast<T>(m.scatter[r][c] / n);
+			}
+		}
+		return out;
+	}
+
+	template<size_t Rows, size_t Cols, class M>
+	constexpr M& entry(Matrix<Rows, Cols, M>& m, size_t r, size_t c) {
+		if constexpr (Cols == 1) {
+			return m[r];
+		}
+		else {
+			return m[r][c];
+		}
+	}
+
+	template<size_t Rows, size_t Cols, class M>
+	Matrix<Rows, Cols, M> addEntries(Matrix<Rows, Cols, M> a, Matrix<Rows, Cols, M> b) {
+		for (size_t r = 0; r < Rows; ++r) {
+			for (size_t c = 0; c < Cols; ++c) {
+				entry(a, r, c) += entry(b, r, c);
+			}
+		}
+		return a;
+	}
+
+	//8 float vectors at a time from the streams of a VecArray, or from interleaved Vec3
+	template<size_t Dim>
+	struct Streams {
+		const VecArray<Dim, float>* array;
+
+		void load8(size_t i, f32x8 (&v)[Dim]) const {
+			for (size_t c = 0; c < Dim; ++c) {
+				v[c] = loadu8(array->component(c) + i);
+			}
+		}
+
+		float get(size_t i, size_t c) const {
+			return array->component(c)[i];
+		}
+	};
+
+	struct Interleaved3 {
+		const Vec<3, float>* vecs;
+
+		void load8(size_t i, f32x8 (&v)[3]) const {
+			AoSPoints<float>{ vecs }.load8(i, v[0], v[1], v[2]);
+		}
+
+		float get(size_t i, size_t c) const {
+			return vecs[i][c];
+		}
+	};
+
+	/*
+	* Sum of a[i] b[i]^T over [begin, end), in entries of type M
+	* Float VecArrays and Vec3 spans run 8 vectors at a time with one f32x8 per entry
+	* of the result, other float Vec3 and Vec4 spans one vector at a time with one
+	* f32x4 per row. The lanes are added to the totals in M after every block, so a
+	* double M keeps double precision over long arrays. Other types are summed in M
+	* directly.
+	*/
+	template<class M, size_t Rows, size_t Cols, class A, class B>
+	Matrix<Rows, Cols, M> outerProductSum8(const A& a, const B& b, size_t begin, size_t end) {
+		Matrix<Rows, Cols, M> total;
+		for (size_t block = begin; block < end; block += BlockItems) {
+			const size_t blockEnd = std::min(end, block + BlockItems);
+			f32x8 sums[Rows][Cols];
+			std::fill_n(&sums[0][0], Rows * Cols, splat8(0));
+			size_t i = block;
+			for (; i + Lanes <= blockEnd; i += Lanes) {
+				f32x8 va[Rows];
+				f32x8 vb[Cols];
+				a.load8(i, va);
+				b.load8(i, vb);
+				for (size_t r = 0; r < Rows; ++r) {
+					for (size_t c = 0; c < Cols; ++c) {
+						sums[r][c] = madd(va[r], vb[c], sums[r][c]);
+					}
+				}
+			}
+			for (size_t r = 0; r < Rows; ++r) {
+				for (size_t c = 0; c < Cols; ++c) {
+					float lanes[Lanes];
+					storeu(lanes, sums[r][c]);
+					entry(total, r, c) += sumLanes<M>(lanes);
+				}
+			}
+			for (; i < blockEnd; ++i) {
+				for (size_t r = 0; r < Rows; ++r) {
+					for (size_t c = 0; c < Cols; ++c) {
+						entry(total, r, c) += static_cast<M>(a.get(i, r) * b.get(i, c));
+					}
+				}
+			}
+		}
+		return total;
+	}
+
+	template<class M, size_t Rows, size_t Cols, class T, class U>
+	Matrix<Rows, Cols, M> outerProductSum(const VecArray<Rows, T>& a, const VecArray<Cols, U>& b, size_t begin, size_t end) {
+		if constexpr (MATH3D_SSE && std::is_same_v<T, float> && std::is_same_v<U, float>) {
+			return outerProductSum8<M, Rows, Cols>(Streams<Rows>{ &a }, Streams<Cols>{ &b }, begin, end);
+		}
+		else {
+			Matrix<Rows, Cols, M> total;
+			for (size_t r = 0; r < Rows; ++r) {
+				const T* __restrict pa = a.component(r);
+				for (size_t c = 0; c < Cols; ++c) {
+					const U* __restrict pb = b.component(c);
+					M sum = 0;
+					for (size_t i = begin; i < end; ++i) {
+						sum += static_cast<M>(pa[i] * pb[i]);
+					}
+					entry(total, r, c) = sum;
+				}
+			}
+			return total;
+		}
+	}
+
+	template<class M, size_t Rows, size_t Cols, class T, class U>
+	Matrix<Rows, Cols, M> outerProductSum(const Vec<Rows, T>* a, const Vec<Cols, U>* b, size_t begin, size_t end) {
+		Matrix<Rows, Cols, M> total;
+		if constexpr (MATH3D_SSE && std::is_same_v<T, float> && std::is_same_v<U, float> && Rows == 3 && Cols == 3) {
+			return outerProductSum8<M, Rows, Cols>(Interleaved3{ a }, Interleaved3{ b }, begin, end);
+		}
+		else if constexpr (MATH3D_SSE && std::is_same_v<T, float> && std::is_same_v<U, float> && (Cols == 3 || Cols == 4)) {
+			//every lane takes one product per vector, so the blocks are shorter
+			constexpr size_t RowBlockItems = BlockItems / Lanes;
+			for (size_t block = begin; block < end; block += RowBlockItems) {
+				const size_t blockEnd = std::min(end, block + RowBlockItems);
+				f32x4 rows[Rows];
+				std::fill_n(rows, Rows, splat(0));
+				for (size_t i = block; i < blockEnd; ++i) {
+					f32x4 vb;
+					if constexpr (Cols == 4) {
+						vb = loadu(&b[i].x);
+					}
+					else {
+						vb = load3(&b[i].x);
+					}
+					for (size_t r = 0; r < Rows; ++r) {
+						rows[r] = madd(splat(a[i][r]), vb, rows[r]);
+					}
+				}
+				for (size_t r = 0; r < Rows; ++r) {
+					float lanes[4];
+					storeu(lanes, rows[r]);
+					for (size_t c = 0; c < Cols; ++c) {
+						entry(total, r, c) += static_cast<M>(lanes[c]);
+					}
+				}
+			}
+		}
+		else {
+			for (size_t i = begin; i < end; ++i) {
+				for (size_t r = 0; r < Rows; ++r) {
+					for (size_t c = 0; c < Cols; ++c) {
+						entry(total, r, c) += static_cast<M>(a[i][r] * b[i][c]);
+					}
+				}
+			}
+		}
+		return total;
+	}
+
+	//Runs the reduction with parallelReduce on pool, or sequentialReduce without one
+	template<class R, class Map, class Combine>
+	R reduce(ThreadPool* pool, size_t count, size_t grain, Map&& map, Combine&& combine) {
+		if (pool) {
+			return parallelReduce(*pool, count, grain, R{}, map, combine);
+		}
+		return sequentialReduce(count, grain, R{}, map, combine);
+	}
+
+	template<class T, class Points>
+	Aabb<T> bounds(ThreadPool* pool, const Points& points, size_t count) {
+		return reduce<Aabb<T>>(pool, count, Chunk<T>,
+			[&](size_t begin, size_t end) { return bounds<T>(points, begin, end); },
+			[](Aabb<T> a, const Aabb<T>& b) { return a.grow(b); });
+	}
+
+	template<class T, class Points, class A = AccumulatorType<T>>
+	Vec<3, A> sum(ThreadPool* pool, const Points& points, size_t count) {
+		return reduce<Vec<3, A>>(pool, count, Chunk<T>,
+			[&](size_t begin, size_t end) { return sum<T>(points, begin, end); },
+			[](const Vec<3, A>& a, const Vec<3, A>& b) { return addVec(a, b); });
+	}
+
+	template<class T, class Points>
+	Vec<3, T> centroid(ThreadPool* pool, const Points& points, size_t count) {
+		if (count == 0) {
+			return {};
+		}
+		const auto total = sum<T>(pool, points, count);
+		const auto n = static_cast<AccumulatorType<T>>(count);
+		return { static_cast<T>(total.x / n), static_cast<T>(total.y / n), static_cast<T>(total.z / n) };
+	}
+
+	template<class T, class Points, class A = AccumulatorType<T>>
+	Moments<A> moments(ThreadPool* pool, const Points& points, size_t count) {
+		return reduce<Moments<A>>(pool, count, Chunk<T>,
+			[&](size_t begin, size_t end) { return moments<T>(points, begin, end); },
+			[](const Moments<A>& a, const Moments<A>& b) { return merge(a, b); });
+	}
+
+	//m += sum of a[i] b[i]^T, where a and b are VecArrays or pointers to Vecs
+	template<class A, class B, size_t Rows, size_t Cols, class M>
+	void addOuterProducts(ThreadPool* pool, const A& a, const B& b, size_t count, size_t bytesPerItem, Matrix<Rows, Cols, M>& m) {
+		const Matrix<Rows, Cols, M> sum = reduce<Matrix<Rows, Cols, M>>(pool, count, chunkItems(bytesPerItem),
+			[&](size_t begin, size_t end) { return outerProductSum<M>(a, b, begin, end); },
+			[](const Matrix<Rows, Cols, M>& x, const Matrix<Rows, Cols, M>& y) { return addEntries(x, y); });
+		m = addEntries(m, sum);
+	}
+
+	//Bounds and moments in one pass over the points, the second kernel reads the chunk from cache
+	template<class T, class Points, class A = AccumulatorType<T>>
+	PointStatistics<T> statistics(ThreadPool* pool, const Points& points, size_t count) {
+		struct Partial {
+			Aabb<T> bounds;
+			Moments<A> moments;
+		};
+		const Partial all = reduce<Partial>(pool, count, Chunk<T>,
+			[&](size_t begin, size_t end) { return Partial{ bounds<T>(points, begin, end), moments<T>(points, begin, end) }; },
+			[](Partial a, const Partial& b) { return Partial{ a.bounds.grow(b.bounds), merge(a.moments, b.moments) }; });
+		PointStatistics<T> out;
+		out.count = count;
+		out.bounds = all.bounds;
+		for (size_t k = 0; k < 3; ++k) {
+			out.centroid[k] = static_cast<T>(all.moments.mean[k]);
+		}
+		out.covariance = covariance<T>(all.moments);
+		return out;
+	}
+}
+
+}
+
+/*
+* Bounds, sum, centroid and covariance of a point set, in AoS spans or VecArray
+* Every function has a single threaded version and one that runs on every thread
+* of pool, with identical results. covariance is the population covariance,
+* sum((p - centroid) (p - centroid)^T) / n, multiply by n / (n - 1) for the sample
+* covariance. An empty set has empty bounds, and zero sum, centroid and covariance.
+*/
+template<class T>
+math3d::Aabb<T> bounds(std::span<const math3d::Vec<3, T>> points) {
+	return math3d::reduceKernels::bounds<T>(nullptr, math3d::reduceKernels::view(points), points.size());
+}
+
+template<class T>
+math3d::Aabb<T> bounds(math3d::ThreadPool& pool, std::span<const math3d::Vec<3, T>> points) {
+	return math3d::reduceKernels::bounds<T>(&pool, math3d::reduceKernels::view(points), points.size());
+}
+
+template<class T>
+math3d::Aabb<T> bounds(const math3d::VecArray<3, T>& points) {
+	return math3d::reduceKernels::bounds<T>(nullptr, math3d::reduceKernels::view(points), points.size());
+}
+
+template<class T>
+math3d::Aabb<T> bounds(math3d::ThreadPool& pool, const math3d::VecArray<3, T>& points) {
+	return math3d::reduceKernels::bounds<T>(&pool, math3d::reduceKernels::view(points), points.size());
+}
+
+template<class T>
+math3d::Vec<3, math3d::AccumulatorType<T>> sum(std::span<const math3d::Vec<3, T>> points) {
+	return math3d::reduceKernels::sum<T>(nullptr, math3d::reduceKernels::view(points), points.size());
+}
+
+template<class T>
+math3d::Vec<3, math3d::AccumulatorType<T>> sum(math3d::ThreadPool& pool, std::span<const math3d::Vec<3, T>> points) {
+	return math3d::reduceKernels::sum<T>(&pool, math3d::reduceKernels::view(points), points.size());
+}
+
+template<class T>
+math3d::Vec<3, math3d::AccumulatorType<T>> sum(const math3d::VecArray<3, T>& points) {
+	return math3d::reduceKernels::sum<T>(nullptr, math3d::reduceKernels::view(points), points.size());
+}
+
+template<class T>
+math3d::Vec<3, math3d::AccumulatorType<T>> sum(math3d::ThreadPool& pool, const math3d::VecArray<3, T>& points) {
+	return math3d::reduceKernels::sum<T>(&pool, math3d::reduceKernels::view(points), points.size());
+}
+
+template<class T>
+math3d::Vec<3, T> centroid(std::span<const math3d::Vec<3, T>> points) {
+	return math3d::reduceKernels::centroid<T>(nullptr, math3d::reduceKernels::view(points), points.size());
+}
+
+template<class T>
+math3d::Vec<3, T> centroid(math3d::ThreadPool& pool, std::span<const math3d::Vec<3, T>> points) {
+	return math3d::reduceKernels::centroid<T>(&pool, math3d::reduceKernels::view(points), points.size());
+}
+
+template<class T>
+math3d::Vec<3, T> centroid(const math3d::VecArray<3, T>& points) {
+	return math3d::reduceKernels::centroid<T>(nullptr, math3d::reduceKernels::view(points), points.size());
+}
+
+template<class T>
+math3d::Vec<3, T> centroid(math3d::ThreadPool& pool, const math3d::VecArray<3, T>& points) {
+	return math3d::reduceKernels::centroid<T>(&pool, math3d::reduceKernels::view(points), points.size());
+}
+
+template<class T>
+math3d::Matrix<3, 3, T> covariance(std::span<const math3d::Vec<3, T>> points) {
+	return math3d::reduceKernels::covariance<T>(math3d::reduceKernels::moments<T>(nullptr, math3d::reduceKernels::view(points), points.size()));
+}
+
+template<class T>
+math3d::Matrix<3, 3, T> covariance(math3d::ThreadPool& pool, std::span<const math3d::Vec<3, T>> points) {
+	return math3d::reduceKernels::covariance<T>(math3d::reduceKernels::moments<T>(&pool, math3d::reduceKernels::view(points), points.size()));
+}
+
+template<class T>
+math3d::Matrix<3, 3, T> covariance(const math3d::VecArray<3, T>& points) {
+	return math3d::reduceKernels::covariance<T>(math3d::reduceKernels::moments<T>(nullptr, math3d::reduceKernels::view(points), points.size()));
+}
+
+template<class T>
+math3d::Matrix<3, 3, T> covariance(math3d::ThreadPool& pool, const math3d::VecArray<3, T>& points) {
+	return math3d::reduceKernels::covariance<T>(math3d::reduceKernels::moments<T>(&pool, math3d::reduceKernels::view(points), points.size()));
+}
+
+//Bounds, centroid and covariance together, in a single pass over the points
+template<class T>
+math3d::PointStatistics<T> statistics(std::span<const math3d::Vec<3, T>> points) {
+	return math3d::reduceKernels::statistics<T>(nullptr, math3d::reduceKernels::view(points), points.size());
+}
+
+template<class T>
+math3d::PointStatistics<T> statistics(math3d::ThreadPool& pool, std::span<const math3d::Vec<3, T>> points) {
+	return math3d::reduceKernels::statistics<T>(&pool, math3d::reduceKernels::view(points), points.size());
+}
+
+template<class T>
+math3d::PointStatistics<T> statistics(const math3d::VecArray<3, T>& points) {
+	return math3d::reduceKernels::statistics<T>(nullptr, math3d::reduceKernels::view(points), points.size());
+}
+
+template<class T>
+math3d::PointStatistics<T> statistics(math3d::ThreadPool& pool, const math3d::VecArray<3, T>& points) {
+	return math3d::reduceKernels::statistics<T>(&pool, math3d::reduceKernels::view(points), points.size());
+}
+
+/*
+* Sums of Outer Products
+* m += sum of a[i] b[i]^T, e.g. the normal equations A^T A of least squares with
+* a = b, or the inertia tensor, in a single pass without forming a matrix per
+* vector. The entries are summed in the element type of m, so a Matrix of double
+* accumulates float vectors in double. Like the reductions above, the result is the
+* same for every number of threads. a and b must have the same size.
+*/
+template<size_t Rows, size_t Cols, class T, class U, class M>
+void addOuterProducts(std::span<const math3d::Vec<Rows, T>> a, std::span<const math3d::Vec<Cols, U>> b, math3d::Matrix<Rows, Cols, M>& m) {
+	math3d::reduceKernels::addOuterProducts(nullptr, a.data(), b.data(), a.size(), sizeof(math3d::Vec<Rows, T>) + sizeof(math3d::Vec<Cols, U>), m);
+}
+
+template<size_t Rows, size_t Cols, class T, class U, class M>
+void addOuterProducts(math3d::ThreadPool& pool, std::span<const math3d::Vec<Rows, T>> a, std::span<const math3d::Vec<Cols, U>> b, math3d::Matrix<Rows, Cols, M>& m) {
+	math3d::reduceKernels::addOuterProducts(&pool, a.data(), b.data(), a.size(), sizeof(math3d::Vec<Rows, T>) + sizeof(math3d::Vec<Cols, U>), m);
+}
+
+template<size_t Rows, size_t Cols, class T, class U, class M>
+void addOuterProducts(const math3d::VecArray<Rows, T>& a, const math3d::VecArray<Cols, U>& b, math3d::Matrix<Rows, Cols, M>& m) {
+	math3d::reduceKernels::addOuterProducts(nullptr, a, b, a.size(), Rows * sizeof(T) + Cols * sizeof(U), m);
+}
+
+template<size_t Rows, size_t Cols, class T, class U, class M>
+void addOuterProducts(math3d::ThreadPool& pool, const math3d::VecArray<Rows, T>& a, const math3d::VecArray<Cols, U>& b, math3d::Matrix<Rows, Cols, M>& m) {
+	math3d::reduceKernels::addOuterProducts(&pool, a, b, a.size(), Rows * sizeof(T) + Cols * sizeof(U), m);
+}
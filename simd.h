@@ -0,0 +1,1011 @@
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+
+/*
+* Opt-in SIMD backend
+* Define MATH3D_SIMD (for the whole program, before math3d.h is included) to do the
+* arithmetic of Vec<4, float>, Vec<3, float> and Matrix<4, 4, float> in SSE registers.
+* Without MATH3D_SIMD, or on a target without SSE2, f32x4 is a plain array of four
+* floats and every function here is a scalar loop, so kernels can be written once
+* against this interface.
+*
+* AVX, FMA and F16C are only used when the compiler is already targeting them
+* (-mavx / -mfma / -mf16c / /arch:AVX2), nothing here dispatches at run time.
+*/
+#if defined(MATH3D_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define MATH3D_SSE 1
+#include <immintrin.h>
+#else
+#define MATH3D_SSE 0
+#endif
+
+#if MATH3D_SSE && defined(__AVX__)
+#define MATH3D_AVX 1
+#else
+#define MATH3D_AVX 0
+#endif
+
+#if MATH3D_SSE && defined(__FMA__)
+#define MATH3D_FMA 1
+#else
+#define MATH3D_FMA 0
+#endif
+
+//msvc has no F16C macro, every CPU with AVX2 has F16C
+#if MATH3D_AVX && (defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__)))
+#define MATH3D_F16C 1
+#else
+#define MATH3D_F16C 0
+#endif
+
+namespace math3d {
+
+/*
+* Accuracy tiers for reciprocal square roots (rsqrt, unitFast)
+*	Estimate: the hardware estimate alone, relative error at most 1.5 * 2^-12 (about 6000 ulp)
+*	Refined: the estimate plus one Newton-Raphson step, at most 4 ulp
+*	Full: 1 / sqrt(x) with IEEE sqrt and divide, at most 1.5 ulp
+* Without SSE there is no estimate instruction, so all three tiers are Full.
+*
+* The same tiers select the arctangent for atan2Fast and angleFast, see atan2 below
+* for their error bounds.
+*/
+enum class Precision {
+	Estimate,
+	Refined,
+	Full
+};
+
+}
+
+namespace math3d::simd {
+
+/*
+* Four float lanes
+*/
+struct f32x4 {
+#if MATH3D_SSE
+	__m128 v;
+#else
+	float v[4];
+#endif
+};
+
+#if MATH3D_SSE
+
+//p must be 16 byte aligned
+inline f32x4 load(const float* p) {
+	return { _mm_load_ps(p) };
+}
+
+inline f32x4 loadu(const float* p) {
+	return { _mm_loadu_ps(p) };
+}
+
+//loads p[0], p[1], p[2] into lanes 0-2 without touching p[3], lane 3 is zero
+inline f32x4 load3(const float* p) {
+	__m128 xy = _mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+	__m128 z = _mm_load_ss(p + 2);
+	return { _mm_movelh_ps(xy, z) };
+}
+
+inline void store(float* p, f32x4 a) {
+	_mm_store_ps(p, a.v);
+}
+
+inline void storeu(float* p, f32x4 a) {
+	_mm_storeu_ps(p, a.v);
+}
+
+//stores lanes 0-2 without touching p[3]
+inline void store3(float* p, f32x4 a) {
+	_mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_castps_si128(a.v));
+	_mm_store_ss(p + 2, _mm_movehl_ps(a.v, a.v));
+}
+
+//Non-temporal store, p must be 16 byte aligned. Call streamFence() after the last one
+inline void stream(float* p, f32x4 a) {
+	_mm_stream_ps(p, a.v);
+}
+
+inline void streamFence() {
+	_mm_sfence();
+}
+
+inline f32x4 splat(float s) {
+	return { _mm_set1_ps(s) };
+}
+
+inline f32x4 set(float x, float y, float z, float w) {
+	return { _mm_setr_ps(x, y, z, w) };
+}
+
+inline f32x4 add(f32x4 a, f32x4 b) {
+	return { _mm_add_ps(a.v, b.v) };
+}
+
+inline f32x4 sub(f32x4 a, f32x4 b) {
+	return { _mm_sub_ps(a.v, b.v) };
+}
+
+inline f32x4 mul(f32x4 a, f32x4 b) {
+	return { _mm_mul_ps(a.v, b.v) };
+}
+
+inline f32x4 div(f32x4 a, f32x4 b) {
+	return { _mm_div_ps(a.v, b.v) };
+}
+
+//a * b + c, fused when FMA is available
+inline f32x4 madd(f32x4 a, f32x4 b, f32x4 c) {
+#if MATH3D_FMA
+	return { _mm_fmadd_ps(a.v, b.v, c.v) };
+#else
+	return { _mm_add_ps(_mm_mul_ps(a.v, b.v), c.v) };
+#endif
+}
+
+inline f32x4 min(f32x4 a, f32x4 b) {
+	return { _mm_min_ps(a.v, b.v) };
+}
+
+inline f32x4 max(f32x4 a, f32x4 b) {
+	return { _mm_max_ps(a.v, b.v) };
+}
+
+inline f32x4 sqrt(f32x4 a) {
+	return { _mm_sqrt_ps(a.v) };
+}
+
+inline f32x4 rsqrtEstimate(f32x4 a) {
+	return { _mm_rsqrt_ps(a.v) };
+}
+
+inline float rsqrtEstimate(float a) {
+	return _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(a)));
+}
+
+//Every lane set to lane I of a
+template<int I>
+inline f32x4 broadcast(f32x4 a) {
+	return { _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(I, I, I, I)) };
+}
+
+inline float first(f32x4 a) {
+	return _mm_cvtss_f32(a.v);
+}
+
+//Sum of all four lanes
+inline float hsum(f32x4 a) {
+	__m128 shuf = _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(2, 3, 0, 1));
+	__m128 sums = _mm_add_ps(a.v, shuf);
+	shuf = _mm_movehl_ps(shuf, sums);
+	return _mm_cvtss_f32(_mm_add_ss(sums, shuf));
+}
+
+//Bitmask of lanes where a == b, lane 0 in bit 0
+inline int equalMask(f32x4 a, f32x4 b) {
+	return _mm_movemask_ps(_mm_cmpeq_ps(a.v, b.v));
+}
+
+//(a.y, a.z, a.x, a.w)
+inline f32x4 yzxw(f32x4 a) {
+	return { _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(3, 0, 2, 1)) };
+}
+
+//(a[A], a[B], b[C], b[D])
+template<int A, int B, int C, int D>
+inline f32x4 shuffle(f32x4 a, f32x4 b) {
+	return { _mm_shuffle_ps(a.v, b.v, _MM_SHUFFLE(D, C, B, A)) };
+}
+
+//a with its sign flipped in the lanes where b is negative (or -0)
+inline f32x4 mulSign(f32x4 a, f32x4 b) {
+	return { _mm_xor_ps(a.v, _mm_and_ps(b.v, _mm_set1_ps(-0.0f))) };
+}
+
+inline f32x4 abs(f32x4 a) {
+	return { _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v) };
+}
+
+//a in the lanes where c has its sign bit set (negative or -0), b elsewhere
+inline f32x4 selectNegative(f32x4 c, f32x4 a, f32x4 b) {
+	__m128 mask = _mm_castsi128_ps(_mm_srai_epi32(_mm_castps_si128(c.v), 31));
+	return { _mm_or_ps(_mm_and_ps(mask, a.v), _mm_andnot_ps(mask, b.v)) };
+}
+
+/*
+* Comparisons give lane masks, all bits set where the comparison holds and zero
+* elsewhere, which combine with bitAnd. signMask turns them into a bitmask
+*/
+inline f32x4 lessEqual(f32x4 a, f32x4 b) {
+	return { _mm_cmple_ps(a.v, b.v) };
+}
+
+//also true where either lane is NaN
+inline f32x4 notEqual(f32x4 a, f32x4 b) {
+	return { _mm_cmpneq_ps(a.v, b.v) };
+}
+
+inline f32x4 bitAnd(f32x4 a, f32x4 b) {
+	return { _mm_and_ps(a.v, b.v) };
+}
+
+//Bitmask of the sign bits of the lanes, lane 0 in bit 0
+inline int signMask(f32x4 a) {
+	return _mm_movemask_ps(a.v);
+}
+
+//Transposes the 4x4 block whose rows are r0-r3
+inline void transpose4(f32x4& r0, f32x4& r1, f32x4& r2, f32x4& r3) {
+	_MM_TRANSPOSE4_PS(r0.v, r1.v, r2.v, r3.v);
+}
+
+/*
+* Four packed xyz triples (x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3) to and from
+* one register per component
+*/
+inline void deinterleave3(f32x4 a, f32x4 b, f32x4 c, f32x4& x, f32x4& y, f32x4& z) {
+	__m128 b2c1 = _mm_shuffle_ps(b.v, c.v, _MM_SHUFFLE(1, 1, 2, 2));
+	x.v = _mm_shuffle_ps(a.v, b2c1, _MM_SHUFFLE(2, 0, 3, 0));
+	__m128 a1b0 = _mm_shuffle_ps(a.v, b.v, _MM_SHUFFLE(0, 0, 1, 1));
+	__m128 b3c2 = _mm_shuffle_ps(b.v, c.v, _MM_SHUFFLE(2, 2, 3, 3));
+	y.v = _mm_shuffle_ps(a1b0, b3c2, _MM_SHUFFLE(2, 0, 2, 0));
+	__m128 a2b1 = _mm_shuffle_ps(a.v, b.v, _MM_SHUFFLE(1, 1, 2, 2));
+	__m128 c0c3 = _mm_shuffle_ps(c.v, c.v, _MM_SHUFFLE(3, 3, 0, 0));
+	z.v = _mm_shuffle_ps(a2b1, c0c3, _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+inline void interleave3(f32x4 x, f32x4 y, f32x4 z, f32x4& a, f32x4& b, f32x4& c) {
+	__m128 x0y0 = _mm_shuffle_ps(x.v, y.v, _MM_SHUFFLE(0, 0, 0, 0));
+	__m128 z0x1 = _mm_shuffle_ps(z.v, x.v, _MM_SHUFFLE(1, 1, 0, 0));
+	a.v = _mm_shuffle_ps(x0y0, z0x1, _MM_SHUFFLE(2, 0, 2, 0));
+	__m128 y1z1 = _mm_shuffle_ps(y.v, z.v, _MM_SHUFFLE(1, 1, 1, 1));
+	__m128 x2y2 = _mm_shuffle_ps(x.v, y.v, _MM_SHUFFLE(2, 2, 2, 2));
+	b.v = _mm_shuffle_ps(y1z1, x2y2, _MM_SHUFFLE(2, 0, 2, 0));
+	__m128 z2x3 = _mm_shuffle_ps(z.v, x.v, _MM_SHUFFLE(3, 3, 2, 2));
+	__m128 y3z3 = _mm_shuffle_ps(y.v, z.v, _MM_SHUFFLE(3, 3, 3, 3));
+	c.v = _mm_shuffle_ps(z2x3, y3z3, _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+#else
+
+inline f32x4 load(const float* p) {
+	return { { p[0], p[1], p[2], p[3] } };
+}
+
+inline f32x4 loadu(const float* p) {
+	return load(p);
+}
+
+inline f32x4 load3(const float* p) {
+	return { { p[0], p[1], p[2], 0 } };
+}
+
+inline void store(float* p, f32x4 a) {
+	for (int i = 0; i < 4; ++i) {
+		p[i] = a.v[i];
+	}
+}
+
+inline void storeu(float* p, f32x4 a) {
+	store(p, a);
+}
+
+inline void store3(float* p, f32x4 a) {
+	for (int i = 0; i < 3; ++i) {
+		p[i] = a.v[i];
+	}
+}
+
+inline void stream(float* p, f32x4 a) {
+	store(p, a);
+}
+
+inline void streamFence() {
+}
+
+inline f32x4 splat(float s) {
+	return { { s, s, s, s } };
+}
+
+inline f32x4 set(float x, float y, float z, float w) {
+	return { { x, y, z, w } };
+}
+
+template<class Op>
+inline f32x4 lanewise(f32x4 a, f32x4 b, Op op) {
+	return { { op(a.v[0], b.v[0]), op(a.v[1], b.v[1]), op(a.v[2], b.v[2]), op(a.v[3], b.v[3]) } };
+}
+
+inline f32x4 add(f32x4 a, f32x4 b) {
+	return lanewise(a, b, [](float s, float t) { return s + t; });
+}
+
+inline f32x4 sub(f32x4 a, f32x4 b) {
+	return lanewise(a, b, [](float s, float t) { return s - t; });
+}
+
+inline f32x4 mul(f32x4 a, f32x4 b) {
+	return lanewise(a, b, [](float s, float t) { return s * t; });
+}
+
+inline f32x4 div(f32x4 a, f32x4 b) {
+	return lanewise(a, b, [](float s, float t) { return s / t; });
+}
+
+inline f32x4 madd(f32x4 a, f32x4 b, f32x4 c) {
+	return add(mul(a, b), c);
+}
+
+//same operand order as minps/maxps: the second operand is returned for NaN
+inline f32x4 min(f32x4 a, f32x4 b) {
+	return lanewise(a, b, [](float s, float t) { return s < t ? s : t; });
+}
+
+inline f32x4 max(f32x4 a, f32x4 b) {
+	return lanewise(a, b, [](float s, float t) { return s > t ? s : t; });
+}
+
+inline f32x4 sqrt(f32x4 a) {
+	return { { std::sqrt(a.v[0]), std::sqrt(a.v[1]), std::sqrt(a.v[2]), std::sqrt(a.v[3]) } };
+}
+
+inline f32x4 rsqrtEstimate(f32x4 a) {
+	return div(splat(1), sqrt(a));
+}
+
+inline float rsqrtEstimate(float a) {
+	return 1 / std::sqrt(a);
+}
+
+template<int I>
+inline f32x4 broadcast(f32x4 a) {
+	return splat(a.v[I]);
+}
+
+inline float first(f32x4 a) {
+	return a.v[0];
+}
+
+inline float hsum(f32x4 a) {
+	return (a.v[0] + a.v[1]) + (a.v[2] + a.v[3]);
+}
+
+inline int equalMask(f32x4 a, f32x4 b) {
+	return (a.v[0] == b.v[0]) | (a.v[1] == b.v[1]) << 1 | (a.v[2] == b.v[2]) << 2 | (a.v[3] == b.v[3]) << 3;
+}
+
+inline f32x4 yzxw(f32x4 a) {
+	return { { a.v[1], a.v[2], a.v[0], a.v[3] } };
+}
+
+template<int A, int B, int C, int D>
+inline f32x4 shuffle(f32x4 a, f32x4 b) {
+	return { { a.v[A], a.v[B], b.v[C], b.v[D] } };
+}
+
+inline f32x4 mulSign(f32x4 a, f32x4 b) {
+	f32x4 r;
+	for (int i = 0; i < 4; ++i) {
+		//gcc 12 fails to compile a vectorized std::signbit here at -O3
+		r.v[i] = a.v[i] * std::copysign(1.0f, b.v[i]);
+	}
+	return r;
+}
+
+inline f32x4 abs(f32x4 a) {
+	f32x4 r;
+	for (int i = 0; i < 4; ++i) {
+		r.v[i] = std::abs(a.v[i]);
+	}
+	return r;
+}
+
+inline f32x4 selectNegative(f32x4 c, f32x4 a, f32x4 b) {
+	f32x4 r;
+	for (int i = 0; i < 4; ++i) {
+		r.v[i] = std::copysign(1.0f, c.v[i]) < 0 ? a.v[i] : b.v[i];
+	}
+	return r;
+}
+
+inline float laneMask(bool b) {
+	return std::bit_cast<float>(b ? 0xffffffffu : 0u);
+}
+
+inline f32x4 lessEqual(f32x4 a, f32x4 b) {
+	return { { laneMask(a.v[0] <= b.v[0]), laneMask(a.v[1] <= b.v[1]), laneMask(a.v[2] <= b.v[2]), laneMask(a.v[3] <= b.v[3]) } };
+}
+
+inline f32x4 notEqual(f32x4 a, f32x4 b) {
+	return { { laneMask(!(a.v[0] == b.v[0])), laneMask(!(a.v[1] == b.v[1])), laneMask(!(a.v[2] == b.v[2])), laneMask(!(a.v[3] == b.v[3])) } };
+}
+
+inline f32x4 bitAnd(f32x4 a, f32x4 b) {
+	f32x4 r;
+	for (int i = 0; i < 4; ++i) {
+		r.v[i] = std::bit_cast<float>(std::bit_cast<uint32_t>(a.v[i]) & std::bit_cast<uint32_t>(b.v[i]));
+	}
+	return r;
+}
+
+inline int signMask(f32x4 a) {
+	int mask = 0;
+	for (int i = 0; i < 4; ++i) {
+		mask |= static_cast<int>(std::bit_cast<uint32_t>(a.v[i]) >> 31) << i;
+	}
+	return mask;
+}
+
+inline void transpose4(f32x4& r0, f32x4& r1, f32x4& r2, f32x4& r3) {
+	f32x4 c0 = { { r0.v[0], r1.v[0], r2.v[0], r3.v[0] } };
+	f32x4 c1 = { { r0.v[1], r1.v[1], r2.v[1], r3.v[1] } };
+	f32x4 c2 = { { r0.v[2], r1.v[2], r2.v[2], r3.v[2] } };
+	f32x4 c3 = { { r0.v[3], r1.v[3], r2.v[3], r3.v[3] } };
+	r0 = c0;
+	r1 = c1;
+	r2 = c2;
+	r3 = c3;
+}
+
+inline void deinterleave3(f32x4 a, f32x4 b, f32x4 c, f32x4& x, f32x4& y, f32x4& z) {
+	x = { { a.v[0], a.v[3], b.v[2], c.v[1] } };
+	y = { { a.v[1], b.v[0], b.v[3], c.v[2] } };
+	z = { { a.v[2], b.v[1], c.v[0], c.v[3] } };
+}
+
+inline void interleave3(f32x4 x, f32x4 y, f32x4 z, f32x4& a, f32x4& b, f32x4& c) {
+	a = { { x.v[0], y.v[0], z.v[0], x.v[1] } };
+	b = { { y.v[1], z.v[1], x.v[2], y.v[2] } };
+	c = { { z.v[2], x.v[3], y.v[3], z.v[3] } };
+}
+
+#endif
+
+/*
+* Vector products on the lanes
+*/
+inline float dot4(f32x4 a, f32x4 b) {
+	return hsum(mul(a, b));
+}
+
+//w.x * r0 + w.y * r1 + w.z * r2 + w.w * r3, summed left to right
+inline f32x4 linearCombination(f32x4 w, f32x4 r0, f32x4 r1, f32x4 r2, f32x4 r3) {
+	f32x4 sum = mul(broadcast<0>(w), r0);
+	sum = madd(broadcast<1>(w), r1, sum);
+	sum = madd(broadcast<2>(w), r2, sum);
+	return madd(broadcast<3>(w), r3, sum);
+}
+
+//Cross product of lanes 0-2, lane 3 of the result is a.w * b.w - a.w * b.w
+inline f32x4 cross3(f32x4 a, f32x4 b) {
+	f32x4 zxy = sub(mul(a, yzxw(b)), mul(yzxw(a), b));
+	return yzxw(zxy);
+}
+
+/*
+* Eight float lanes
+* One AVX register when AVX is enabled, otherwise a pair of f32x4. Batched kernels
+* work on f32x8 so that they are 8 wide with AVX and two 4 wide halves in flight
+* without it.
+*/
+#if MATH3D_AVX
+
+struct f32x8 {
+	__m256 v;
+};
+
+//p must be 32 byte aligned
+inline f32x8 load8(const float* p) {
+	return { _mm256_load_ps(p) };
+}
+
+inline f32x8 loadu8(const float* p) {
+	return { _mm256_loadu_ps(p) };
+}
+
+inline void store(float* p, f32x8 a) {
+	_mm256_store_ps(p, a.v);
+}
+
+inline void storeu(float* p, f32x8 a) {
+	_mm256_storeu_ps(p, a.v);
+}
+
+//p must be 32 byte aligned
+inline void stream(float* p, f32x8 a) {
+	_mm256_stream_ps(p, a.v);
+}
+
+inline f32x8 splat8(float s) {
+	return { _mm256_set1_ps(s) };
+}
+
+inline f32x8 combine(f32x4 lo, f32x4 hi) {
+	return { _mm256_insertf128_ps(_mm256_castps128_ps256(lo.v), hi.v, 1) };
+}
+
+inline f32x4 low(f32x8 a) {
+	return { _mm256_castps256_ps128(a.v) };
+}
+
+inline f32x4 high(f32x8 a) {
+	return { _mm256_extractf128_ps(a.v, 1) };
+}
+
+inline f32x8 add(f32x8 a, f32x8 b) {
+	return { _mm256_add_ps(a.v, b.v) };
+}
+
+inline f32x8 sub(f32x8 a, f32x8 b) {
+	return { _mm256_sub_ps(a.v, b.v) };
+}
+
+inline f32x8 mul(f32x8 a, f32x8 b) {
+	return { _mm256_mul_ps(a.v, b.v) };
+}
+
+inline f32x8 div(f32x8 a, f32x8 b) {
+	return { _mm256_div_ps(a.v, b.v) };
+}
+
+inline f32x8 madd(f32x8 a, f32x8 b, f32x8 c) {
+#if MATH3D_FMA
+	return { _mm256_fmadd_ps(a.v, b.v, c.v) };
+#else
+	return { _mm256_add_ps(_mm256_mul_ps(a.v, b.v), c.v) };
+#endif
+}
+
+inline f32x8 min(f32x8 a, f32x8 b) {
+	return { _mm256_min_ps(a.v, b.v) };
+}
+
+inline f32x8 max(f32x8 a, f32x8 b) {
+	return { _mm256_max_ps(a.v, b.v) };
+}
+
+inline f32x8 sqrt(f32x8 a) {
+	return { _mm256_sqrt_ps(a.v) };
+}
+
+inline f32x8 rsqrtEstimate(f32x8 a) {
+	return { _mm256_rsqrt_ps(a.v) };
+}
+
+inline f32x8 mulSign(f32x8 a, f32x8 b) {
+	return { _mm256_xor_ps(a.v, _mm256_and_ps(b.v, _mm256_set1_ps(-0.0f))) };
+}
+
+inline f32x8 abs(f32x8 a) {
+	return { _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v) };
+}
+
+inline f32x8 selectNegative(f32x8 c, f32x8 a, f32x8 b) {
+	return { _mm256_blendv_ps(b.v, a.v, c.v) };
+}
+
+inline f32x8 lessEqual(f32x8 a, f32x8 b) {
+	return { _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ) };
+}
+
+inline f32x8 notEqual(f32x8 a, f32x8 b) {
+	return { _mm256_cmp_ps(a.v, b.v, _CMP_NEQ_UQ) };
+}
+
+inline f32x8 bitAnd(f32x8 a, f32x8 b) {
+	return { _mm256_and_ps(a.v, b.v) };
+}
+
+inline int signMask(f32x8 a) {
+	return _mm256_movemask_ps(a.v);
+}
+
+#else
+
+struct f32x8 {
+	f32x4 lo;
+	f32x4 hi;
+};
+
+inline f32x8 load8(const float* p) {
+	return { load(p), load(p + 4) };
+}
+
+inline f32x8 loadu8(const float* p) {
+	return { loadu(p), loadu(p + 4) };
+}
+
+inline void store(float* p, f32x8 a) {
+	store(p, a.lo);
+	store(p + 4, a.hi);
+}
+
+inline void storeu(float* p, f32x8 a) {
+	storeu(p, a.lo);
+	storeu(p + 4, a.hi);
+}
+
+inline void stream(float* p, f32x8 a) {
+	stream(p, a.lo);
+	stream(p + 4, a.hi);
+}
+
+inline f32x8 splat8(float s) {
+	return { splat(s), splat(s) };
+}
+
+inline f32x8 combine(f32x4 lo, f32x4 hi) {
+	return { lo, hi };
+}
+
+inline f32x4 low(f32x8 a) {
+	return a.lo;
+}
+
+inline f32x4 high(f32x8 a) {
+	return a.hi;
+}
+
+inline f32x8 add(f32x8 a, f32x8 b) {
+	return { add(a.lo, b.lo), add(a.hi, b.hi) };
+}
+
+inline f32x8 sub(f32x8 a, f32x8 b) {
+	return { sub(a.lo, b.lo), sub(a.hi, b.hi) };
+}
+
+inline f32x8 mul(f32x8 a, f32x8 b) {
+	return { mul(a.lo, b.lo), mul(a.hi, b.hi) };
+}
+
+inline f32x8 div(f32x8 a, f32x8 b) {
+	return { div(a.lo, b.lo), div(a.hi, b.hi) };
+}
+
+inline f32x8 madd(f32x8 a, f32x8 b, f32x8 c) {
+	return { madd(a.lo, b.lo, c.lo), madd(a.hi, b.hi, c.hi) };
+}
+
+inline f32x8 min(f32x8 a, f32x8 b) {
+	return { min(a.lo, b.lo), min(a.hi, b.hi) };
+}
+
+inline f32x8 max(f32x8 a, f32x8 b) {
+	return { max(a.lo, b.lo), max(a.hi, b.hi) };
+}
+
+inline f32x8 sqrt(f32x8 a) {
+	return { sqrt(a.lo), sqrt(a.hi) };
+}
+
+inline f32x8 rsqrtEstimate(f32x8 a) {
+	return { rsqrtEstimate(a.lo), rsqrtEstimate(a.hi) };
+}
+
+inline f32x8 mulSign(f32x8 a, f32x8 b) {
+	return { mulSign(a.lo, b.lo), mulSign(a.hi, b.hi) };
+}
+
+inline f32x8 abs(f32x8 a) {
+	return { abs(a.lo), abs(a.hi) };
+}
+
+inline f32x8 selectNegative(f32x8 c, f32x8 a, f32x8 b) {
+	return { selectNegative(c.lo, a.lo, b.lo), selectNegative(c.hi, a.hi, b.hi) };
+}
+
+inline f32x8 lessEqual(f32x8 a, f32x8 b) {
+	return { lessEqual(a.lo, b.lo), lessEqual(a.hi, b.hi) };
+}
+
+inline f32x8 notEqual(f32x8 a, f32x8 b) {
+	return { notEqual(a.lo, b.lo), notEqual(a.hi, b.hi) };
+}
+
+inline f32x8 bitAnd(f32x8 a, f32x8 b) {
+	return { bitAnd(a.lo, b.lo), bitAnd(a.hi, b.hi) };
+}
+
+inline int signMask(f32x8 a) {
+	return signMask(a.lo) | signMask(a.hi) << 4;
+}
+
+#endif
+
+template<class V>
+inline V splatAs(float s) {
+	if constexpr (std::is_same_v<V, f32x8>) {
+		return splat8(s);
+	}
+	else {
+		return splat(s);
+	}
+}
+
+/*
+* 1 / sqrt(a) at the requested precision, for float, f32x4 and f32x8
+*/
+template<Precision P, class V>
+inline V rsqrt(V a) {
+	if constexpr (P == Precision::Full || !MATH3D_SSE) {
+		if constexpr (std::is_same_v<V, float>) {
+			return 1 / std::sqrt(a);
+		}
+		else {
+			return div(splatAs<V>(1), sqrt(a));
+		}
+	}
+	else if constexpr (P == Precision::Estimate) {
+		return rsqrtEstimate(a);
+	}
+	else {
+		//y + y (1 - a y^2) / 2, adding the small correction last rounds better than y (3 - a y^2) / 2
+		V y = rsqrtEstimate(a);
+		if constexpr (std::is_same_v<V, float>) {
+			return y + 0.5f * y * (1.0f - a * y * y);
+		}
+		else {
+			V residual = sub(splatAs<V>(1), mul(mul(a, y), y));
+			return add(y, mul(mul(splatAs<V>(0.5f), y), residual));
+		}
+	}
+}
+
+/*
+* atan2(y, x) at the requested precision, for float, f32x4 and f32x8
+*	Estimate: degree 7 minimax polynomial, absolute error at most 1e-4 radians
+*	Refined: degree 15 minimax polynomial, absolute error at most 4e-7 radians
+*	Full: std::atan2 in every lane
+* The polynomials approximate atan on [0, 1], the octant is restored from the signs
+* and magnitudes of x and y, so the result is in [-pi, pi] with the signs of zeros
+* handled like std::atan2. They do not depend on the SIMD backend, so every tier is
+* available everywhere. Both x and y infinite gives 0 instead of a multiple of pi / 4.
+*/
+template<Precision P>
+struct AtanPolynomial {
+	static constexpr float c[4] = { 0.9992138126f, -0.3211749694f, 0.1462644637f, -0.03898651420f };
+};
+
+template<>
+struct AtanPolynomial<Precision::Refined> {
+	static constexpr float c[8] = { 0.9999993356f, -0.3332986078f, 0.1994656564f, -0.1390862951f,
+		0.09642197238f, -0.05591232569f, 0.02186295721f, -0.004054567046f };
+};
+
+template<Precision P, class V>
+inline V atan2(V y, V x) {
+	constexpr float HalfPi = 1.57079632679f;
+	constexpr float Pi = 3.14159265359f;
+	constexpr auto& c = AtanPolynomial<P>::c;
+	constexpr int N = static_cast<int>(std::size(c));
+	if constexpr (std::is_same_v<V, float>) {
+		if constexpr (P == Precision::Full) {
+			return std::atan2(y, x);
+		}
+		else {
+			const float ax = std::abs(x);
+			const float ay = std::abs(y);
+			//same operand order as the SSE min and max, which also turn 0 / 0 into 0
+			float a = (ax < ay ? ax : ay) / (ax > ay ? ax : ay);
+			a = a > 0 ? a : 0;
+			const float t = a * a;
+			float p = c[N - 1];
+			for (int i = N - 2; i >= 0; --i) {
+				p = p * t + c[i];
+			}
+			float r = a * p;
+			r = std::signbit(ax - ay) ? HalfPi - r : r;
+			r = std::signbit(x) ? Pi - r : r;
+			return std::signbit(y) ? -r : r;
+		}
+	}
+	else if constexpr (P == Precision::Full) {
+		constexpr int Lanes = sizeof(V) / sizeof(float);
+		float ly[Lanes];
+		float lx[Lanes];
+		storeu(ly, y);
+		storeu(lx, x);
+		for (int i = 0; i < Lanes; ++i) {
+			ly[i] = std::atan2(ly[i], lx[i]);
+		}
+		if constexpr (std::is_same_v<V, f32x8>) {
+			return loadu8(ly);
+		}
+		else {
+			return loadu(ly);
+		}
+	}
+	else {
+		const V ax = abs(x);
+		const V ay = abs(y);
+		V a = max(div(min(ax, ay), max(ax, ay)), splatAs<V>(0));
+		const V t = mul(a, a);
+		V p = splatAs<V>(c[N - 1]);
+		for (int i = N - 2; i >= 0; --i) {
+			p = madd(p, t, splatAs<V>(c[i]));
+		}
+		V r = mul(a, p);
+		r = selectNegative(sub(ax, ay), sub(splatAs<V>(HalfPi), r), r);
+		r = selectNegative(x, sub(splatAs<V>(Pi), r), r);
+		return mulSign(r, y);
+	}
+}
+
+/*
+* Eight 16 bit integers, and eight interleaved pairs (a0 b0 a1 b1 ...) of 16 or 8 bit integers
+* Loads convert to float exactly. Stores round to the nearest integer, ties to even,
+* and saturate to the range of the integer type.
+*/
+#if MATH3D_SSE
+
+inline f32x8 loadInt16(const int16_t* p) {
+	__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+	//each value goes to the high half of a 32 bit lane, the shift sign extends it
+	f32x4 lo{ _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16)) };
+	f32x4 hi{ _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16)) };
+	return combine(lo, hi);
+}
+
+inline f32x8 loadUint16(const uint16_t* p) {
+	__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+	__m128i zero = _mm_setzero_si128();
+	f32x4 lo{ _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero)) };
+	f32x4 hi{ _mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero)) };
+	return combine(lo, hi);
+}
+
+inline void storeInt16(int16_t* p, f32x8 a) {
+	__m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(low(a).v), _mm_cvtps_epi32(high(a).v));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(p), packed);
+}
+
+inline void storeUint16(uint16_t* p, f32x8 a) {
+	//SSE2 only packs with signed saturation, so the values are moved into the int16 range and back
+	const __m128i bias = _mm_set1_epi32(32768);
+	__m128i lo = _mm_sub_epi32(_mm_cvtps_epi32(low(a).v), bias);
+	__m128i hi = _mm_sub_epi32(_mm_cvtps_epi32(high(a).v), bias);
+	__m128i packed = _mm_xor_si128(_mm_packs_epi32(lo, hi), _mm_set1_epi16(-32768));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(p), packed);
+}
+
+//v0 and v1 hold four int16 pairs each, a in the low half of every 32 bit lane
+inline void splitPairs(__m128i v0, __m128i v1, f32x8& a, f32x8& b) {
+	a = combine({ _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(v0, 16), 16)) }, { _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(v1, 16), 16)) });
+	b = combine({ _mm_cvtepi32_ps(_mm_srai_epi32(v0, 16)) }, { _mm_cvtepi32_ps(_mm_srai_epi32(v1, 16)) });
+}
+
+inline void loadInt16Pairs(const int16_t* p, f32x8& a, f32x8& b) {
+	splitPairs(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 8)), a, b);
+}
+
+inline void loadInt8Pairs(const int8_t* p, f32x8& a, f32x8& b) {
+	__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+	//each byte goes to the high half of a 16 bit lane, the shift sign extends it
+	splitPairs(_mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8), _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8), a, b);
+}
+
+inline void storeInt16Pairs(int16_t* p, f32x8 a, f32x8 b) {
+	__m128i pa = _mm_packs_epi32(_mm_cvtps_epi32(low(a).v), _mm_cvtps_epi32(high(a).v));
+	__m128i pb = _mm_packs_epi32(_mm_cvtps_epi32(low(b).v), _mm_cvtps_epi32(high(b).v));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_unpacklo_epi16(pa, pb));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(p + 8), _mm_unpackhi_epi16(pa, pb));
+}
+
+inline void storeInt8Pairs(int8_t* p, f32x8 a, f32x8 b) {
+	__m128i pa = _mm_packs_epi32(_mm_cvtps_epi32(low(a).v), _mm_cvtps_epi32(high(a).v));
+	__m128i pb = _mm_packs_epi32(_mm_cvtps_epi32(low(b).v), _mm_cvtps_epi32(high(b).v));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_packs_epi16(_mm_unpacklo_epi16(pa, pb), _mm_unpackhi_epi16(pa, pb)));
+}
+
+#else
+
+template<class Int>
+inline f32x8 loadInt(const Int* p) {
+	f32x8 r;
+	for (int i = 0; i < 4; ++i) {
+		r.lo.v[i] = static_cast<float>(p[i]);
+		r.hi.v[i] = static_cast<float>(p[i + 4]);
+	}
+	return r;
+}
+
+template<class Int>
+inline void storeInt(Int* p, f32x8 a) {
+	constexpr float lowest = static_cast<float>(std::is_signed_v<Int> ? -32768 : 0);
+	constexpr float highest = static_cast<float>(std::is_signed_v<Int> ? 32767 : 65535);
+	auto convert = [&](float f) {
+		//nearbyint rounds ties to even in the default rounding mode
+		f = std::nearbyint(f);
+		return static_cast<Int>(f < lowest ? lowest : f > highest ? highest : f);
+	};
+	for (int i = 0; i < 4; ++i) {
+		p[i] = convert(a.lo.v[i]);
+		p[i + 4] = convert(a.hi.v[i]);
+	}
+}
+
+inline f32x8 loadInt16(const int16_t* p) {
+	return loadInt(p);
+}
+
+inline f32x8 loadUint16(const uint16_t* p) {
+	return loadInt(p);
+}
+
+inline void storeInt16(int16_t* p, f32x8 a) {
+	storeInt(p, a);
+}
+
+inline void storeUint16(uint16_t* p, f32x8 a) {
+	storeInt(p, a);
+}
+
+template<class Int>
+inline void loadPairs(const Int* p, f32x8& a, f32x8& b) {
+	for (int i = 0; i < 4; ++i) {
+		a.lo.v[i] = static_cast<float>(p[2 * i]);
+		b.lo.v[i] = static_cast<float>(p[2 * i + 1]);
+		a.hi.v[i] = static_cast<float>(p[2 * i + 8]);
+		b.hi.v[i] = static_cast<float>(p[2 * i + 9]);
+	}
+}
+
+template<class Int>
+inline void storePairs(Int* p, f32x8 a, f32x8 b) {
+	constexpr float lowest = static_cast<float>(std::numeric_limits<Int>::lowest());
+	constexpr float highest = static_cast<float>(std::numeric_limits<Int>::max());
+	auto convert = [&](float f) {
+		f = std::nearbyint(f);
+		return static_cast<Int>(f < lowest ? lowest : f > highest ? highest : f);
+	};
+	for (int i = 0; i < 4; ++i) {
+		p[2 * i] = convert(a.lo.v[i]);
+		p[2 * i + 1] = convert(b.lo.v[i]);
+		p[2 * i + 8] = convert(a.hi.v[i]);
+		p[2 * i + 9] = convert(b.hi.v[i]);
+	}
+}
+
+inline void loadInt16Pairs(const int16_t* p, f32x8& a, f32x8& b) {
+	loadPairs(p, a, b);
+}
+
+inline void loadInt8Pairs(const int8_t* p, f32x8& a, f32x8& b) {
+	loadPairs(p, a, b);
+}
+
+inline void storeInt16Pairs(int16_t* p, f32x8 a, f32x8 b) {
+	storePairs(p, a, b);
+}
+
+inline void storeInt8Pairs(int8_t* p, f32x8 a, f32x8 b) {
+	storePairs(p, a, b);
+}
+
+#endif
+
+/*
+* Eight IEEE binary16 (half precision) values, stored as their bits
+* Only with F16C, converting to half rounds to nearest even.
+*/
+#if MATH3D_F16C
+
+inline f32x8 loadHalf(const uint16_t* p) {
+	return { _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) };
+}
+
+inline void storeHalf(uint16_t* p, f32x8 a) {
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm256_cvtps_ph(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+}
+
+#endif
+
+}
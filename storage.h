@@ -0,0 +1,289 @@
+#pragma once
+
+#include "math3d.h"
+#include "vecArray.h"
+
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+
+namespace math3d {
+
+/*
+* Compact Storage Types
+* half (IEEE binary16), snorm16 (-1 to 1) and unorm16 (0 to 1) hold a float in 16 bits.
+* They convert implicitly to and from float, so they can be the element type of a Vec
+* or Matrix: Vec<3, half> is 6 bytes, and arithmetic on it is done in float, e.g.
+* Vec<3, half> + Vec<3, half> is a Vec<3, float>. Use them for buffers that are read
+* and written in bulk, with pack and unpack below, and do the math in float.
+*
+* Converting to half rounds to nearest even, overflows to infinity and keeps NaN.
+* The normalized types clamp to their range (NaN becomes the lowest value) and round
+* to the nearest step, ties to even, so every step is hit exactly and a value
+* survives unpacking and packing again unchanged.
+*/
+namespace storageKernels {
+	//Nearest integer, ties to even, for |x| < 2^23
+	constexpr float roundEven(float x) {
+		int32_t truncated = static_cast<int32_t>(x);
+		float t = static_cast<float>(truncated);
+		float fraction = x - t;
+		bool odd = (truncated & 1) != 0;
+		if (fraction > 0.5f || (fraction == 0.5f && odd)) {
+			return t + 1;
+		}
+		if (fraction < -0.5f || (fraction == -0.5f && odd)) {
+			return t - 1;
+		}
+		return t;
+	}
+
+	//Same as simd::min(simd::max(x, lowest), 1), which also replaces NaN by lowest
+	constexpr float clampNormalized(float x, float lowest) {
+		x = x > lowest ? x : lowest;
+		return x < 1 ? x : 1;
+	}
+
+	constexpr uint16_t toHalfBits(float f) {
+		const uint32_t x = std::bit_cast<uint32_t>(f);
+		const uint16_t sign = static_cast<uint16_t>((x >> 16) & 0x8000);
+		const uint32_t magnitude = x & 0x7fffffff;
+		if (magnitude >= 0x7f800000) {
+			//infinity, or NaN with the top of its payload and the quiet bit set
+			return magnitude == 0x7f800000 ? sign | 0x7c00 : static_cast<uint16_t>(sign | 0x7e00 | ((magnitude >> 13) & 0x3ff));
+		}
+		if (magnitude >= 0x477ff000) {
+			//65520 and above round to infinity
+			return sign | 0x7c00;
+		}
+		if (magnitude < 0x38800000) {
+			//subnormal half, the value in units of 2^-24 rounded to nearest even
+			if (magnitude <= 0x33000000) {
+				return sign;
+			}
+			const uint32_t mantissa = (magnitude & 0x7fffff) | 0x800000;
+			const uint32_t shift = 126 - (magnitude >> 23);
+			uint32_t h = mantissa >> shift;
+			const uint32_t remainder = mantissa & ((1u << shift) - 1);
+			const uint32_t halfway = 1u << (shift - 1);
+			if (remainder > halfway || (remainder == halfway && (h & 1))) {
+				++h;
+			}
+			return static_cast<uint16_t>(sign | h);
+		}
+		//rebias the exponent from 127 to 15, rounding may carry into the exponent
+		uint32_t h = (magnitude - 0x38000000) >> 13;
+		const uint32_t remainder = magnitude & 0x1fff;
+		if (remainder > 0x1000 || (remainder == 0x1000 && (h & 1))) {
+			++h;
+		}
+		return static_cast<uint16_t>(sign | h);
+	}
+
+	constexpr float fromHalfBits(uint16_t h) {
+		const uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+		const uint32_t exponent = (h >> 10) & 0x1f;
+		const uint32_t mantissa = h & 0x3ff;
+		if (exponent == 0x1f) {
+			//NaN comes back quiet, as with F16C
+			return std::bit_cast<float>(sign | 0x7f800000 | (mantissa << 13) | (mantissa ? 0x400000 : 0));
+		}
+		if (exponent == 0) {
+			//zero or subnormal, mantissa * 2^-24 is exact
+			float magnitude = static_cast<float>(mantissa) * 0x1p-24f;
+			return sign ? -magnitude : magnitude;
+		}
+		return std::bit_cast<float>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+	}
+}
+
+struct half {
+	uint16_t bits = 0;
+
+	constexpr half() = default;
+
+	constexpr half(float f)
+		: bits(storageKernels::toHalfBits(f)) {
+	}
+
+	constexpr operator float() const {
+		return storageKernels::fromHalfBits(bits);
+	}
+
+	static constexpr half fromBits(uint16_t b) {
+		half h;
+		h.bits = b;
+		return h;
+	}
+};
+
+//-1 to 1 in steps of 1/32767, -32768 is also -1
+struct snorm16 {
+	static constexpr float Lowest = -1;
+	static constexpr float Scale = 32767;
+
+	int16_t bits = 0;
+
+	constexpr snorm16() = default;
+
+	constexpr snorm16(float f)
+		: bits(static_cast<int16_t>(storageKernels::roundEven(storageKernels::clampNormalized(f, Lowest) * Scale))) {
+	}
+
+	constexpr operator float() const {
+		float f = bits / Scale;
+		return f > Lowest ? f : Lowest;
+	}
+
+	static constexpr snorm16 fromBits(int16_t b) {
+		snorm16 s;
+		s.bits = b;
+		return s;
+	}
+};
+
+//0 to 1 in steps of 1/65535
+struct unorm16 {
+	static constexpr float Lowest = 0;
+	static constexpr float Scale = 65535;
+
+	uint16_t bits = 0;
+
+	constexpr unorm16() = default;
+
+	constexpr unorm16(float f)
+		: bits(static_cast<uint16_t>(storageKernels::roundEven(storageKernels::clampNormalized(f, Lowest) * Scale))) {
+	}
+
+	constexpr operator float() const {
+		return bits / Scale;
+	}
+
+	static constexpr unorm16 fromBits(uint16_t b) {
+		unorm16 u;
+		u.bits = b;
+		return u;
+	}
+};
+
+template<class T>
+inline constexpr bool IsStorageType = std::is_same_v<T, half> || std::is_same_v<T, snorm16> || std::is_same_v<T, unorm16>;
+
+static_assert(sizeof(half) == 2 && sizeof(snorm16) == 2 && sizeof(unorm16) == 2);
+static_assert(std::is_trivially_copyable_v<half> && std::is_trivially_copyable_v<snorm16> && std::is_trivially_copyable_v<unorm16>);
+
+/*
+* Bulk conversion kernels
+* 8 values per iteration: F16C for half, SSE2 for the normalized types. The rest,
+* and everything without them, is converted one value at a time with the scalar
+* conversions above, which give the same results.
+*/
+namespace storageKernels {
+	using namespace simd;
+
+	template<class T>
+	void pack(const float* in, T* out, size_t n) {
+		size_t i = 0;
+		if constexpr (std::is_same_v<T, half>) {
+#if MATH3D_F16C
+			for (; i + 8 <= n; i += 8) {
+				storeHalf(&out[i].bits, loadu8(in + i));
+			}
+#endif
+		}
+		else if constexpr (MATH3D_SSE) {
+			const f32x8 lowest = splat8(T::Lowest);
+			const f32x8 one = splat8(1);
+			const f32x8 scale = splat8(T::Scale);
+			for (; i + 8 <= n; i += 8) {
+				f32x8 v = mul(min(max(loadu8(in + i), lowest), one), scale);
+				if constexpr (std::is_same_v<T, snorm16>) {
+					storeInt16(&out[i].bits, v);
+				}
+				else {
+					storeUint16(&out[i].bits, v);
+				}
+			}
+		}
+		for (; i < n; ++i) {
+			out[i] = T(in[i]);
+		}
+	}
+
+	template<class T>
+	void unpack(const T* in, float* out, size_t n) {
+		size_t i = 0;
+		if constexpr (std::is_same_v<T, half>) {
+#if MATH3D_F16C
+			for (; i + 8 <= n; i += 8) {
+				storeu(out + i, loadHalf(&in[i].bits));
+			}
+#endif
+		}
+		else if constexpr (MATH3D_SSE) {
+			const f32x8 scale = splat8(T::Scale);
+			const f32x8 lowest = splat8(T::Lowest);
+			for (; i + 8 <= n; i += 8) {
+				f32x8 v;
+				if constexpr (std::is_same_v<T, snorm16>) {
+					v = max(div(loadInt16(&in[i].bits), scale), lowest);
+				}
+				else {
+					v = div(loadUint16(&in[i].bits), scale);
+				}
+				storeu(out + i, v);
+			}
+		}
+		for (; i < n; ++i) {
+			out[i] = static_cast<float>(in[i]);
+		}
+	}
+}
+
+}
+
+/*
+* Bulk Pack and Unpack
+* float to a storage type and back. out must hold at least in.size() elements.
+* The Vec versions convert arrays of Vec<Dim, float> and Vec<Dim, T>, which are
+* Dim contiguous elements each.
+*/
+template<class T> requires math3d::IsStorageType<T>
+void pack(std::span<const float> in, std::span<T> out) {
+	math3d::storageKernels::pack(in.data(), out.data(), in.size());
+}
+
+template<class T> requires math3d::IsStorageType<T>
+void unpack(std::span<const T> in, std::span<float> out) {
+	math3d::storageKernels::unpack(in.data(), out.data(), in.size());
+}
+
+template<size_t Dim, class T> requires math3d::IsStorageType<T>
+void pack(std::span<const math3d::Vec<Dim, float>> in, std::span<math3d::Vec<Dim, T>> out) {
+	static_assert(sizeof(math3d::Vec<Dim, float>) == Dim * sizeof(float) && sizeof(math3d::Vec<Dim, T>) == Dim * sizeof(T));
+	math3d::storageKernels::pack(reinterpret_cast<const float*>(in.data()), reinterpret_cast<T*>(out.data()), Dim * in.size());
+}
+
+template<size_t Dim, class T> requires math3d::IsStorageType<T>
+void unpack(std::span<const math3d::Vec<Dim, T>> in, std::span<math3d::Vec<Dim, float>> out) {
+	static_assert(sizeof(math3d::Vec<Dim, float>) == Dim * sizeof(float) && sizeof(math3d::Vec<Dim, T>) == Dim * sizeof(T));
+	math3d::storageKernels::unpack(reinterpret_cast<const T*>(in.data()), reinterpret_cast<float*>(out.data()), Dim * in.size());
+}
+
+//out is resized to in.size()
+template<size_t Dim, class T> requires math3d::IsStorageType<T>
+void pack(const math3d::VecArray<Dim, float>& in, math3d::VecArray<Dim, T>& out) {
+	out.resize(in.size());
+	for (size_t c = 0; c < Dim; ++c) {
+		math3d::storageKernels::pack(in.component(c), out.component(c), in.size());
+	}
+}
+
+template<size_t Dim, class T> requires math3d::IsStorageType<T>
+void unpack(const math3d::VecArray<Dim, T>& in, math3d::VecArray<Dim, float>& out) {
+	out.resize(in.size());
+	for (size_t c = 0; c < Dim; ++c) {
+		math3d::storageKernels::unpack(in.component(c), out.component(c), in.size());
+	}
+}
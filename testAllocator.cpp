@@ -0,0 +1,164 @@
+#include "allocator.h"
+#include "math3d.h"
+#include <cassert>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+using Vec3f = math3d::Vec<3, float>;
+using Vec4f = math3d::Vec<4, float>;
+using Mat4f = math3d::Matrix<4, 4, float>;
+
+bool aligned(const void* p, size_t alignment) {
+	return reinterpret_cast<std::uintptr_t>(p) % alignment == 0;
+}
+
+void arenaTest() {
+	math3d::Arena arena(4096);
+	std::set<const void*> first;
+	for (size_t n : { 1, 3, 7, 100, 0, 5 }) {
+		auto vecs = arena.allocateArray<Vec3f>(n);
+		assert(vecs.size() == n && aligned(vecs.data(), 64));
+		for (const Vec3f& v : vecs) {
+			assert(v == (Vec3f{ 0, 0, 0 }));
+		}
+		first.insert(vecs.data());
+	}
+	//32 byte alignment asks for no less than a cache line, larger alignments are kept
+	assert(aligned(arena.allocate(10, 32), 64));
+	assert(aligned(arena.allocate(10, 256), 256));
+	assert(aligned(arena.allocate(10, 4096), 4096));
+	bool threw = false;
+	try {
+		arena.allocate(10, 48);
+	}
+	catch (const std::invalid_argument&) {
+		threw = true;
+	}
+	assert(threw);
+
+	//larger than a block, gets a block of its own
+	auto big = arena.allocateArray<Mat4f>(1000);
+	assert(big.size() == 1000 && aligned(big.data(), 64));
+	for (Mat4f& m : big) {
+		m = Mat4f{ { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, 0, 1 } };
+	}
+	const size_t capacity = arena.capacity();
+	assert(capacity >= 1000 * sizeof(Mat4f) + 4096);
+
+	//after reset the same sequence of requests gets the same memory, and no new blocks
+	for (int frame = 0; frame < 3; ++frame) {
+		arena.reset();
+		std::set<const void*> again;
+		for (size_t n : { 1, 3, 7, 100, 0, 5 }) {
+			again.insert(arena.allocateArray<Vec3f>(n).data());
+		}
+		assert(again == first);
+		arena.allocate(10, 32);
+		arena.allocate(10, 256);
+		arena.allocate(10, 4096);
+		auto bigAgain = arena.allocateArray<Mat4f>(1000);
+		assert(bigAgain.data() == big.data());
+		assert(bigAgain[999] == Mat4f{});
+		assert(arena.capacity() == capacity);
+	}
+
+	//many small arrays fill the blocks in turn
+	arena.reset();
+	for (int i = 0; i < 1000; ++i) {
+		auto v = arena.allocateArray<Vec4f>(4);
+		assert(aligned(v.data(), 64));
+		v[3] = Vec4f{ 1, 2, 3, 4 };
+	}
+	arena.release();
+	assert(arena.capacity() == 0);
+	assert(aligned(arena.allocateArray<float>(3).data(), 64));
+}
+
+void poolTest() {
+	math3d::Pool pool(sizeof(Mat4f), 64, 4);
+	assert(pool.blockSize() == sizeof(Mat4f) && pool.blockAlignment() == 64);
+	std::vector<void*> blocks;
+	for (int i = 0; i < 10; ++i) {
+		void* p = pool.allocate();
+		assert(aligned(p, 64));
+		for (void* q : blocks) {
+			assert(q != p);
+		}
+		*static_cast<Mat4f*>(p) = Mat4f{};
+		blocks.push_back(p);
+	}
+	//freed blocks are handed out again, last in first out
+	pool.deallocate(blocks[3]);
+	pool.deallocate(blocks[7]);
+	assert(pool.allocate() == blocks[7]);
+	assert(pool.allocate() == blocks[3]);
+
+	//reset starts carving from the first chunk again
+	pool.reset();
+	std::vector<void*> again;
+	for (int i = 0; i < 10; ++i) {
+		again.push_back(pool.allocate());
+	}
+	assert(again == blocks);
+
+	math3d::Pool wide(8, 256);
+	assert(aligned(wide.allocate(), 256) && aligned(wide.allocate(), 256));
+}
+
+void adapterTest() {
+	math3d::Arena arena(1 << 16);
+	{
+		std::vector<Vec3f, math3d::ArenaAllocator<Vec3f>> points{ math3d::ArenaAllocator<Vec3f>(arena) };
+		points.reserve(100);
+		for (int i = 0; i < 100; ++i) {
+			points.push_back({ static_cast<float>(i), 0, 0 });
+		}
+		assert(aligned(points.data(), 64) && points[99].x == 99);
+		//growing leaves the old buffer behind, still aligned
+		points.push_back({});
+		assert(aligned(points.data(), 64) && points[99].x == 99);
+
+		std::vector<Vec4f, math3d::ArenaAllocator<Vec4f, 256>> wide{ math3d::ArenaAllocator<Vec4f, 256>(arena) };
+		wide.resize(3);
+		assert(aligned(wide.data(), 256));
+		assert(points.get_allocator() == math3d::ArenaAllocator<int>(arena));
+	}
+	arena.reset();
+
+	math3d::Pool pool(64);
+	{
+		std::list<Mat4f, math3d::PoolAllocator<Mat4f>> transforms{ math3d::PoolAllocator<Mat4f>(pool) };
+		for (int i = 0; i < 50; ++i) {
+			transforms.push_back(Mat4f{});
+		}
+		assert(transforms.size() == 50);
+		std::map<int, Vec3f, std::less<int>, math3d::PoolAllocator<std::pair<const int, Vec3f>>> byId{ math3d::PoolAllocator<std::pair<const int, Vec3f>>(pool) };
+		for (int i = 0; i < 100; ++i) {
+			byId[i] = { static_cast<float>(i), 1, 2 };
+		}
+		for (auto& [id, v] : byId) {
+			assert(v.x == static_cast<float>(id));
+		}
+		//requests that do not fit the blocks go to the aligned heap
+		std::vector<Vec3f, math3d::PoolAllocator<Vec3f>> points{ math3d::PoolAllocator<Vec3f>(pool) };
+		points.resize(1000);
+		assert(aligned(points.data(), 64));
+	}
+
+	std::vector<Vec4f, math3d::AlignedAllocator<Vec4f>> aligned64(17);
+	std::vector<float, math3d::AlignedAllocator<float, 32>> aligned32(5);
+	assert(aligned(aligned64.data(), 64) && aligned(aligned32.data(), 32));
+	std::vector<Vec4f, math3d::AlignedAllocator<Vec4f>> copy = aligned64;
+	assert(aligned(copy.data(), 64) && copy.size() == 17);
+}
+
+int main() {
+	arenaTest();
+	poolTest();
+	adapterTest();
+	return 0;
+}
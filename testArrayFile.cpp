@@ -0,0 +1,231 @@
+#include "arrayFile.h"
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+using Vec3f = math3d::Vec<3, float>;
+using Vec4f = math3d::Vec<4, float>;
+using Mat4f = math3d::Matrix<4, 4, float>;
+using Vec3h = math3d::Vec<3, math3d::half>;
+
+//the Scalar and Simd builds of this test may run at the same time
+std::filesystem::path tempPath(const char* name) {
+	std::random_device random;
+	return std::filesystem::temp_directory_path() / (std::string("math3d_") + name + "_" + std::to_string(random()) + ".bin");
+}
+
+template<class T>
+bool throws(T&& f) {
+	try {
+		f();
+	}
+	catch (const std::runtime_error&) {
+		return true;
+	}
+	return false;
+}
+
+bool aligned(const void* p) {
+	return reinterpret_cast<std::uintptr_t>(p) % math3d::arrayFile::Alignment == 0;
+}
+
+void roundTripTest() {
+	const size_t n = 1001;
+	std::vector<Vec3f> points(n);
+	std::vector<Mat4f> transforms(n / 10);
+	std::vector<uint32_t> indices(n * 3);
+	std::vector<Vec3h> colors(n);
+	for (size_t i = 0; i < n; ++i) {
+		float f = static_cast<float>(i);
+		points[i] = { f, -f, std::sin(f) };
+		colors[i] = static_cast<Vec3h>(Vec3f{ f / n, 0.5f, 1 });
+	}
+	for (size_t i = 0; i < transforms.size(); ++i) {
+		float f = static_cast<float>(i);
+		transforms[i] = { { 1, 0, 0, f }, { 0, 1, 0, -f }, { 0, 0, 1, 2 * f }, { 0, 0, 0, 1 } };
+	}
+	for (size_t i = 0; i < indices.size(); ++i) {
+		indices[i] = static_cast<uint32_t>(i * 7 % n);
+	}
+	const math3d::VecArray<3, double> soa{ std::span<const math3d::Vec<3, double>>(std::vector<math3d::Vec<3, double>>{ { 1, 2, 3 }, { 4, 5, 6 }, { 7, 8, 9 } }) };
+
+	const auto path = tempPath("roundTrip");
+	{
+		math3d::ArrayFileWriter writer(path);
+		writer.add("points", std::span<const Vec3f>(points));
+		writer.add("transforms", std::span<const Mat4f>(transforms));
+		writer.add("indices", std::span<const uint32_t>(indices));
+		writer.add("colors", std::span<const Vec3h>(colors));
+		writer.add("soa", soa);
+		writer.add("empty", std::span<const Vec4f>());
+		assert(throws([&] { writer.add("points", std::span<const Vec3f>(points)); }));
+		assert(throws([&] { writer.add("", std::span<const Vec3f>(points)); }));
+		assert(throws([&] { writer.add(std::string(64, 'a'), std::span<const Vec3f>(points)); }));
+		writer.close();
+		assert(throws([&] { writer.add("late", std::span<const Vec3f>(points)); }));
+	}
+
+	{
+		math3d::MappedArrayFile file(path);
+		assert(file.entries().size() == 6);
+		assert(file.find("points") && !file.find("point") && !file.find("pointsx"));
+		assert(file.find("transforms")->rows == 4 && file.find("transforms")->cols == 4);
+
+		auto mappedPoints = file.get<Vec3f>("points");
+		assert(mappedPoints.size() == n && aligned(mappedPoints.data()));
+		for (size_t i = 0; i < n; ++i) {
+			assert(mappedPoints[i] == points[i]);
+		}
+		auto mappedTransforms = file.get<Mat4f>("transforms");
+		assert(mappedTransforms.size() == transforms.size() && aligned(mappedTransforms.data()));
+		for (size_t i = 0; i < transforms.size(); ++i) {
+			assert(mappedTransforms[i] == transforms[i]);
+		}
+		auto mappedIndices = file.get<uint32_t>("indices");
+		assert(std::equal(mappedIndices.begin(), mappedIndices.end(), indices.begin(), indices.end()));
+		auto mappedColors = file.get<Vec3h>("colors");
+		for (size_t i = 0; i < n; ++i) {
+			assert(mappedColors[i] == colors[i]);
+		}
+		assert(file.get<Vec4f>("empty").empty());
+
+		auto streams = file.components<3, double>("soa");
+		assert(streams[1].size() == 3 && streams[1][2] == 8 && aligned(streams[2].data()));
+		math3d::VecArray<3, double> loaded;
+		file.load("soa", loaded);
+		assert(loaded.size() == 3 && loaded.get(2) == (math3d::Vec<3, double>{ 7, 8, 9 }));
+
+		//the type, shape and layout have to match what was written
+		assert(throws([&] { file.get<Vec4f>("points"); }));
+		assert(throws([&] { file.get<math3d::Vec<3, double>>("points"); }));
+		assert(throws([&] { file.get<float>("points"); }));
+		assert(throws([&] { file.get<int32_t>("indices"); }));
+		assert(throws([&] { file.get<math3d::Vec<3, double>>("soa"); }));
+		assert(throws([&] { file.components<3, float>("points"); }));
+		assert(throws([&] { file.get<Vec3f>("missing"); }));
+
+		//moving keeps the mapping
+		math3d::MappedArrayFile moved = std::move(file);
+		assert(moved.get<Vec3f>("points").data() == mappedPoints.data());
+	}
+	std::filesystem::remove(path);
+}
+
+void invalidFileTest() {
+	bool missing = false;
+	try {
+		math3d::MappedArrayFile file(tempPath("missing"));
+	}
+	catch (const std::system_error&) {
+		missing = true;
+	}
+	assert(missing);
+
+	//a writer that was never closed leaves a blank header
+	const auto path = tempPath("invalid");
+	{
+		math3d::ArrayFileWriter writer(path);
+		writer.add("values", std::span<const float>(std::vector<float>(100, 1.0f)));
+	}
+	assert(throws([&] { math3d::MappedArrayFile file(path); }));
+
+	{
+		math3d::ArrayFileWriter writer(path);
+		writer.add("values", std::span<const float>(std::vector<float>(100, 1.0f)));
+		writer.close();
+	}
+	const auto size = std::filesystem::file_size(path);
+	{
+		math3d::MappedArrayFile file(path);
+		assert(file.get<float>("values").size() == 100);
+	}
+	//cut off in the directory
+	std::filesystem::resize_file(path, size - 8);
+	assert(throws([&] { math3d::MappedArrayFile file(path); }));
+	//cut off in the header, and empty
+	std::filesystem::resize_file(path, 20);
+	assert(throws([&] { math3d::MappedArrayFile file(path); }));
+	std::filesystem::resize_file(path, 0);
+	assert(throws([&] { math3d::MappedArrayFile file(path); }));
+	std::filesystem::remove(path);
+}
+
+//Writes a file with one entry, changes the header or the entry and opens it again
+template<class Corrupt>
+bool opensCorrupt(Corrupt&& corrupt) {
+	using Record = std::conditional_t<std::is_invocable_v<Corrupt&, math3d::ArrayFileHeader&>, math3d::ArrayFileHeader, math3d::ArrayFileEntry>;
+	const auto path = tempPath("corrupt");
+	{
+		math3d::ArrayFileWriter writer(path);
+		writer.add("values", std::span<const float>(std::vector<float>(100, 1.0f)));
+		writer.close();
+	}
+	const auto size = std::filesystem::file_size(path);
+	const auto position = static_cast<std::streamoff>(std::is_same_v<Record, math3d::ArrayFileHeader> ? 0 : size - sizeof(Record));
+	Record record;
+	{
+		std::ifstream in(path, std::ios::binary);
+		in.seekg(position);
+		in.read(reinterpret_cast<char*>(&record), sizeof(record));
+	}
+	corrupt(record);
+	{
+		std::fstream out(path, std::ios::binary | std::ios::in | std::ios::out);
+		out.seekp(position);
+		out.write(reinterpret_cast<const char*>(&record), sizeof(record));
+	}
+	const bool threw = throws([&] { math3d::MappedArrayFile file(path); });
+	std::filesystem::remove(path);
+	return threw;
+}
+
+void corruptEntryTest() {
+	//more data than the file has
+	assert(opensCorrupt([](math3d::ArrayFileEntry& e) {
+		e.count = 1000;
+		e.stride = 1000;
+		e.bytes = 4000;
+	}));
+	//no rows or columns, an unknown element type or layout, and a shape whose size overflows
+	assert(opensCorrupt([](math3d::ArrayFileEntry& e) { e.rows = 0; }));
+	assert(opensCorrupt([](math3d::ArrayFileEntry& e) { e.cols = 0; }));
+	assert(opensCorrupt([](math3d::ArrayFileEntry& e) { e.elementType = static_cast<math3d::ElementType>(99); }));
+	assert(opensCorrupt([](math3d::ArrayFileEntry& e) {
+		e.layout = math3d::ArrayLayout::SoA;
+		e.elementType = static_cast<math3d::ElementType>(0);
+	}));
+	assert(opensCorrupt([](math3d::ArrayFileEntry& e) { e.layout = static_cast<math3d::ArrayLayout>(7); }));
+	assert(opensCorrupt([](math3d::ArrayFileEntry& e) {
+		e.rows = 1u << 31;
+		e.cols = 1u << 31;
+	}));
+	//the unchanged file opens
+	assert(!opensCorrupt([](math3d::ArrayFileEntry&) {}));
+}
+
+void corruptHeaderTest() {
+	//the writer records the alignment
+	assert(!opensCorrupt([](math3d::ArrayFileHeader& h) { assert(h.alignment == math3d::arrayFile::Alignment); }));
+	//no alignment, one that is not a multiple of 64, and one the array offset (64) is not a multiple of
+	assert(opensCorrupt([](math3d::ArrayFileHeader& h) { h.alignment = 0; }));
+	assert(opensCorrupt([](math3d::ArrayFileHeader& h) { h.alignment = 32; }));
+	assert(opensCorrupt([](math3d::ArrayFileHeader& h) { h.alignment = 96; }));
+	assert(opensCorrupt([](math3d::ArrayFileHeader& h) { h.alignment = 128; }));
+}
+
+int main() {
+	roundTripTest();
+	invalidFileTest();
+	corruptEntryTest();
+	corruptHeaderTest();
+	return 0;
+}
@@ -0,0 +1,289 @@
+#include "bvh.h"
+#include "testing.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+using Vec3f = math3d::Vec<3, float>;
+using math3d::Aabb;
+using math3d::Ray;
+using math3d::TriangleHit;
+using testing::Random;
+
+//Small triangles scattered through a cube, on a grid or anywhere
+std::vector<Vec3f> makeTriangles(size_t n, bool grid, uint64_t seed) {
+	Random random{ seed };
+	std::vector<Vec3f> corners;
+	for (size_t i = 0; i < n; ++i) {
+		const Vec3f a = grid ? random.grid(-20, 20) : random.vec(-20, 20);
+		for (int c = 0; c < 3; ++c) {
+			corners.push_back(a + (grid ? random.grid(-1, 1) : random.vec(-2, 2)));
+		}
+	}
+	return corners;
+}
+
+//Every item is in exactly one leaf, and every box contains the boxes below it
+void checkStructure(const math3d::Bvh& bvh, std::span<const Aabb<float>> boxes) {
+	const auto nodes = bvh.nodes();
+	const auto items = bvh.items();
+	std::vector<int> seen(boxes.size());
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		const math3d::BvhNode& node = nodes[i];
+		Aabb<float> inside;
+		if (node.leaf()) {
+			for (uint32_t j = node.index; j < node.index + node.count; ++j) {
+				if (items[j] != math3d::Bvh::NoItem) {
+					++seen[items[j]];
+					inside.grow(boxes[items[j]]);
+				}
+			}
+		}
+		else {
+			assert(node.index > i + 1 && node.index < nodes.size());
+			inside.grow(nodes[i + 1].bounds).grow(nodes[node.index].bounds);
+		}
+		assert(inside == node.bounds);
+	}
+	for (size_t i = 0; i < boxes.size(); ++i) {
+		assert(seen[i] == (boxes[i].empty() ? 0 : 1));
+	}
+}
+
+std::vector<Aabb<float>> triangleBounds(const std::vector<Vec3f>& corners) {
+	std::vector<Aabb<float>> boxes(corners.size() / 3);
+	for (size_t i = 0; i < boxes.size(); ++i) {
+		boxes[i].grow(corners[3 * i]).grow(corners[3 * i + 1]).grow(corners[3 * i + 2]);
+	}
+	return boxes;
+}
+
+void boxTest() {
+	Random random{ 7 };
+	std::vector<Aabb<float>> boxes(3000);
+	for (size_t i = 0; i < boxes.size(); ++i) {
+		//some empty boxes, which are left out, and some points
+		if (i % 97 == 5) {
+			continue;
+		}
+		const Vec3f p = random.vec(-50, 50);
+		boxes[i].grow(p);
+		if (i % 13 != 0) {
+			boxes[i].grow(p + random.vec(0, 4));
+		}
+	}
+	const math3d::Bvh bvh{ std::span<const Aabb<float>>(boxes) };
+	checkStructure(bvh, boxes);
+
+	for (int q = 0; q < 200; ++q) {
+		Aabb<float> query;
+		const Vec3f p = random.vec(-60, 60);
+		query.grow(p).grow(p + random.vec(0, 15));
+		std::vector<uint32_t> found;
+		bvh.overlapping(query, [&](uint32_t item) {
+			if (boxes[item].overlaps(query)) {
+				found.push_back(item);
+			}
+		});
+		std::sort(found.begin(), found.end());
+		std::vector<uint32_t> expected;
+		for (uint32_t i = 0; i < boxes.size(); ++i) {
+			if (boxes[i].overlaps(query)) {
+				expected.push_back(i);
+			}
+		}
+		assert(found == expected);
+
+		//the candidates of a ray cast include every box the ray hits
+		const Ray<float> ray{ random.vec(-60, 60), random.vec(-1, 1), 0, q % 3 == 0 ? 30.0f : math3d::Aabb<float>::Infinity };
+		std::vector<int> candidate(boxes.size());
+		bvh.raycast(ray, [&](uint32_t item, Ray<float>&) {
+			++candidate[item];
+			return false;
+		});
+		for (uint32_t i = 0; i < boxes.size(); ++i) {
+			float entry;
+			assert(candidate[i] <= 1);
+			assert(!intersect(ray, boxes[i], entry) || candidate[i] == 1);
+		}
+
+		//nearest box, within a limit
+		float best = q % 4 == 0 ? 25.0f : math3d::Aabb<float>::Infinity;
+		const uint32_t nearest = bvh.nearest(p, [&](uint32_t item) { return boxes[item].distanceSquared(p); }, best);
+		float expectedBest = q % 4 == 0 ? 25.0f : math3d::Aabb<float>::Infinity;
+		uint32_t expectedItem = math3d::Bvh::NoItem;
+		for (uint32_t i = 0; i < boxes.size(); ++i) {
+			if (boxes[i].distanceSquared(p) < expectedBest) {
+				expectedBest = boxes[i].distanceSquared(p);
+				expectedItem = i;
+			}
+		}
+		assert(best == expectedBest);
+		assert(nearest == expectedItem || (nearest != math3d::Bvh::NoItem && boxes[nearest].distanceSquared(p) == best));
+	}
+
+	//a ray cast stops when f returns true
+	size_t calls = 0;
+	bvh.raycast(Ray<float>{ { -60, 0, 0 }, { 1, 0.01f, 0.02f } }, [&](uint32_t, Ray<float>&) { return ++calls == 1; });
+	assert(calls <= 1);
+}
+
+void triangleTest(size_t n, bool grid) {
+	const auto corners = makeTriangles(n, grid, n + grid);
+	const std::span<const Vec3f> view(corners);
+	const math3d::TriangleBvh bvh(view);
+	const auto boxes = triangleBounds(corners);
+	checkStructure(bvh.hierarchy(), boxes);
+	//leaves are whole packets
+	for (const math3d::BvhNode& node : bvh.hierarchy().nodes()) {
+		assert(!node.leaf() || (node.index % math3d::PacketLanes == 0 && node.count <= math3d::PacketLanes));
+	}
+
+	std::vector<math3d::TrianglePacket> all(math3d::packetCount(n));
+	packTriangles(view, std::span<math3d::TrianglePacket>(all));
+	const std::span<const math3d::TrianglePacket> packets(all);
+	Random random{ 11 };
+	for (int q = 0; q < 300; ++q) {
+		Ray<float> ray{ grid ? random.grid(-22, 22) : random.vec(-22, 22), grid ? random.grid(-1, 1) : random.vec(-1, 1) };
+		if (q % 5 == 0) {
+			ray.direction[q % 3] = 0;
+		}
+		if (q % 7 == 0) {
+			ray.tMin = 1;
+			ray.tMax = 10;
+		}
+		//the packet kernel gives the same t for a triangle in any lane, so only equally near triangles may differ
+		TriangleHit<float> hit;
+		TriangleHit<float> expected;
+		const bool found = bvh.closestHit(ray, hit);
+		assert(found == closestHit(ray, packets, expected));
+		assert(bvh.occluded(ray) == found);
+		if (found) {
+			assert(hit.t == expected.t);
+			if (hit.triangle != expected.triangle) {
+				math3d::TrianglePacket single;
+				single.set(0, corners[3 * hit.triangle], corners[3 * hit.triangle + 1], corners[3 * hit.triangle + 2]);
+				math3d::PacketHits hits;
+				assert((intersect(ray, single, hits) & 1) && hits.t[0] == hit.t);
+			}
+			else {
+				assert(hit.u == expected.u && hit.v == expected.v);
+			}
+		}
+
+		const Vec3f p = random.vec(-25, 25);
+		const float limit = q % 4 == 0 ? 2.0f : math3d::Aabb<float>::Infinity;
+		float nearest = limit * limit;
+		for (size_t t = 0; t < n; ++t) {
+			const Vec3f a = corners[3 * t];
+			const Vec3f point = a + math3d::intersectKernels::closestPoint(p, a, corners[3 * t + 1] - a, corners[3 * t + 2] - a);
+			nearest = std::min(nearest, lengthSquared(point - p));
+		}
+		math3d::ClosestPoint<float> closest;
+		if (bvh.closestPoint(p, closest, limit)) {
+			assert(closest.distanceSquared == nearest);
+			assert(closest.distanceSquared == lengthSquared(closest.point - p));
+			assert(closest.point == closestPoint(p, corners[3 * closest.triangle], corners[3 * closest.triangle + 1], corners[3 * closest.triangle + 2]));
+		}
+		else {
+			assert(nearest == limit * limit);
+		}
+
+		Aabb<float> query;
+		query.grow(p).grow(p + random.vec(0, 6));
+		std::vector<size_t> overlap;
+		bvh.overlapping(query, [&](size_t t) { overlap.push_back(t); });
+		std::sort(overlap.begin(), overlap.end());
+		std::vector<size_t> expectedOverlap;
+		for (size_t t = 0; t < n; ++t) {
+			//the bounds of the corner and edges a packet holds
+			const Vec3f a = corners[3 * t];
+			Aabb<float> bounds;
+			bounds.grow(a).grow(a + (corners[3 * t + 1] - a)).grow(a + (corners[3 * t + 2] - a));
+			if (bounds.overlaps(query)) {
+				expectedOverlap.push_back(t);
+			}
+		}
+		assert(overlap == expectedOverlap);
+	}
+}
+
+//The tree only depends on the input, not on the threads that built it
+void parallelTest() {
+	const auto corners = makeTriangles(60000, false, 5);
+	const std::span<const Vec3f> view(corners);
+	const auto boxes = triangleBounds(corners);
+	const math3d::Bvh sequential{ std::span<const Aabb<float>>(boxes) };
+	const math3d::TriangleBvh triangles(view);
+	checkStructure(sequential, boxes);
+	for (size_t threads : { 1, 2, 3, 4 }) {
+		math3d::ThreadPool pool(threads);
+		const math3d::Bvh parallel(pool, std::span<const Aabb<float>>(boxes));
+		assert(parallel.nodes().size() == sequential.nodes().size());
+		assert(std::memcmp(parallel.nodes().data(), sequential.nodes().data(), sequential.nodes().size_bytes()) == 0);
+		assert(std::equal(parallel.items().begin(), parallel.items().end(), sequential.items().begin(), sequential.items().end()));
+		const math3d::TriangleBvh parallelTriangles(pool, view);
+		const auto a = parallelTriangles.hierarchy().nodes();
+		const auto b = triangles.hierarchy().nodes();
+		assert(a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size_bytes()) == 0);
+	}
+}
+
+void edgeCaseTest() {
+	//nothing to build
+	const math3d::TriangleBvh none{ std::span<const Vec3f>() };
+	TriangleHit<float> hit;
+	math3d::ClosestPoint<float> closest;
+	assert(none.hierarchy().empty() && none.hierarchy().bounds().empty());
+	assert(!none.closestHit(Ray<float>{ {}, { 0, 0, 1 } }, hit) && !none.occluded(Ray<float>{ {}, { 0, 0, 1 } }));
+	assert(!none.closestPoint({ 1, 2, 3 }, closest));
+	const math3d::Bvh empty{ std::span<const Aabb<float>>(std::vector<Aabb<float>>(3)) };
+	assert(empty.empty() && empty.items().empty());
+
+	//one triangle, from vertices and indices
+	const Vec3f vertices[] = { { 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 } };
+	const uint32_t indices[] = { 0, 1, 2 };
+	const math3d::TriangleBvh one{ std::span<const Vec3f>(vertices), std::span<const uint32_t>(indices) };
+	assert(one.closestHit(Ray<float>{ { 0.25f, 0.25f, 1 }, { 0, 0, -1 } }, hit) && hit.t == 1 && hit.triangle == 0);
+	assert(one.closestPoint({ 2, 0, 0 }, closest) && closest.point == (Vec3f{ 1, 0, 0 }) && closest.distanceSquared == 1);
+	assert(!one.closestPoint({ 2, 0, 0 }, closest, 0.5f));
+
+	//identical boxes can only be split at the median
+	const std::vector<Aabb<float>> same(100, Aabb<float>{ { 0, 0, 0 }, { 1, 1, 1 } });
+	const math3d::Bvh stacked{ std::span<const Aabb<float>>(same), 4 };
+	checkStructure(stacked, same);
+	for (const math3d::BvhNode& node : stacked.nodes()) {
+		assert(!node.leaf() || node.count <= 4);
+	}
+
+	//exponentially spread boxes make the most unbalanced SAH tree, its depth is still bounded
+	std::vector<Aabb<float>> spread(300);
+	for (size_t i = 0; i < spread.size(); ++i) {
+		const float x = std::ldexp(1.0f, static_cast<int>(i % 120) - 60);
+		spread[i].grow(Vec3f{ x, 0, 0 }).grow(Vec3f{ x * 1.5f, 1, 1 });
+	}
+	const math3d::Bvh deep{ std::span<const Aabb<float>>(spread), 1 };
+	checkStructure(deep, spread);
+	std::vector<int> seen(spread.size());
+	deep.raycast(Ray<float>{ { -1, 0.5f, 0.5f }, { 1, 0, 0 } }, [&](uint32_t item, Ray<float>&) {
+		++seen[item];
+		return false;
+	});
+	assert(std::count(seen.begin(), seen.end(), 1) == static_cast<long>(spread.size()));
+}
+
+int main() {
+	boxTest();
+	for (bool grid : { false, true }) {
+		triangleTest(1, grid);
+		triangleTest(9, grid);
+		triangleTest(2000, grid);
+	}
+	parallelTest();
+	edgeCaseTest();
+	return 0;
+}
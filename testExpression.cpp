@@ -0,0 +1,98 @@
+#include "expression.h"
+#include <cassert>
+#include <vector>
+
+using Vec3f = math3d::Vec<3, float>;
+using Vec3i = math3d::Vec<3, int>;
+using Mat2f = math3d::Matrix<2, 2, float>;
+using math3d::expr::lazy;
+
+constexpr Vec3f a{ 1.5f, -2.0f, 3.25f };
+constexpr Vec3f b{ 0.5f, 4.0f, -1.0f };
+constexpr Vec3f c{ 8.0f, 2.0f, 6.0f };
+
+void matchesEagerTest() {
+	//same operations in the same order as the eager operators, so results are exact
+	constexpr float s = 3.0f;
+	constexpr float t = 4.0f;
+	constexpr Vec3f eager = a + b * s - c / t;
+	constexpr Vec3f fused = lazy(a) + lazy(b) * s - lazy(c) / t;
+	static_assert(fused == eager);
+	static_assert(math3d::expr::eval(lazy(a) + lazy(b) * s - lazy(c) / t) == eager);
+
+	//plain matrices combine with expressions on either side
+	static_assert(Vec3f(lazy(a) - b) == a - b);
+	static_assert(Vec3f(a - lazy(b)) == a - b);
+	static_assert(Vec3f(-lazy(a)) == -1 * a);
+	static_assert(Vec3f(2 * lazy(a) + lazy(b) * 0.5) == 2 * a + b * 0.5);
+
+	//runtime
+	Vec3f ra = a;
+	Vec3f r = lazy(ra) + lazy(b) * s - lazy(c) / t;
+	assert(r == eager);
+}
+
+void elementTypeTest() {
+	//element types follow the eager operators
+	constexpr Vec3i i{ 1, 2, 3 };
+	constexpr Vec3f sum = lazy(i) + lazy(a);
+	static_assert(sum == i + a);
+	using Sum = decltype(math3d::expr::eval(lazy(i) + lazy(a)));
+	static_assert(std::is_same_v<Sum, Vec3f>);
+	//scalar products keep the element type
+	using Scaled = decltype(math3d::expr::eval(lazy(i) * 0.5));
+	static_assert(std::is_same_v<Scaled, Vec3i>);
+	static_assert(math3d::expr::eval(lazy(i) * 0.5) == i * 0.5);
+	//conversion to another element type casts each element
+	constexpr math3d::Vec<3, double> widened = lazy(a) + lazy(b);
+	static_assert(widened == a + b);
+}
+
+void matrixTest() {
+	constexpr Mat2f m{ {1, 2}, {3, 4} };
+	constexpr Mat2f n{ {-1, 0.5f}, {2, 8} };
+	constexpr Mat2f fused = lazy(m) * 2 - lazy(n) / 2 + m;
+	static_assert(fused == m * 2 - n / 2 + m);
+}
+
+void arrayTest(size_t count) {
+	std::vector<Vec3f> positions(count);
+	std::vector<Vec3f> velocities(count);
+	for (size_t i = 0; i < count; ++i) {
+		float f = static_cast<float>(i);
+		positions[i] = { f, -f, f * 0.5f };
+		velocities[i] = { 1, f * 0.25f, -2 };
+	}
+	math3d::VecArray<3, float> p{ std::span<const Vec3f>(positions) };
+	math3d::VecArray<3, float> v{ std::span<const Vec3f>(velocities) };
+
+	//into a new array
+	math3d::VecArray<3, float> out;
+	math3d::expr::assign(out, lazy(p) + lazy(v) * 0.5f - lazy(c) / 2.0f);
+	assert(out.size() == count);
+	for (size_t i = 0; i < count; ++i) {
+		assert(out.get(i) == positions[i] + velocities[i] * 0.5f - c / 2.0f);
+	}
+
+	//in place, with the destination as an operand
+	math3d::expr::assign(p, lazy(p) + lazy(v) * 2.0f);
+	for (size_t i = 0; i < count; ++i) {
+		assert(p.get(i) == positions[i] + velocities[i] * 2.0f);
+	}
+
+	//an expression without arrays is broadcast
+	math3d::expr::assign(p, lazy(a) + lazy(b));
+	for (size_t i = 0; i < count; ++i) {
+		assert(p.get(i) == a + b);
+	}
+}
+
+int main() {
+	matchesEagerTest();
+	elementTypeTest();
+	matrixTest();
+	for (size_t n : { 0, 1, 5, 16, 17, 100 }) {
+		arrayTest(n);
+	}
+	return 0;
+}
@@ -0,0 +1,189 @@
+#include "frustum.h"
+#include "testing.h"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+template<class T>
+using Vec3 = math3d::Vec<3, T>;
+template<class T>
+using Vec4 = math3d::Vec<4, T>;
+template<class T>
+using Mat4 = math3d::Matrix<4, 4, T>;
+
+using testing::Contracted;
+using testing::Random;
+
+//A camera at eye looking down -z, 90 degree field of view, near 1 and far 100, projecting to z in [-w, w] or [0, w]
+template<class T>
+Mat4<T> viewProjection(const Vec3<T>& eye, math3d::DepthRange depth) {
+	const T n = 1, f = 100;
+	const Mat4<T> projection = depth == math3d::DepthRange::ZeroToOne
+		? Mat4<T>{ { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, f / (n - f), n * f / (n - f) }, { 0, 0, -1, 0 } }
+		: Mat4<T>{ { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, (f + n) / (n - f), 2 * f * n / (n - f) }, { 0, 0, -1, 0 } };
+	const Mat4<T> view{ { 1, 0, 0, -eye.x }, { 0, 1, 0, -eye.y }, { 0, 0, 1, -eye.z }, { 0, 0, 0, 1 } };
+	return projection * view;
+}
+
+template<class T>
+void planeTest() {
+	Random random{ 1 };
+	for (math3d::DepthRange depth : { math3d::DepthRange::NegativeOneToOne, math3d::DepthRange::ZeroToOne }) {
+		const Vec3<T> eye{ 3, -2, 5 };
+		const Mat4<T> m = viewProjection(eye, depth);
+		const std::array<Vec4<T>, 6> planes = math3d::frustumPlanes(m, depth);
+		const std::span<const Vec4<T>> view(planes);
+		for (const Vec4<T>& p : planes) {
+			assert(std::abs(p.x * p.x + p.y * p.y + p.z * p.z - 1) <= T(1e-5));
+		}
+
+		//the far plane is 100 in front of the eye, the near plane 1, the side planes at 45 degrees
+		assert(std::abs(planes[5].w - (planes[5].z * -eye.z + 100 + planes[5].x * -eye.x + planes[5].y * -eye.y)) <= T(1e-3));
+		assert(isVisible(view, eye + Vec3<T>{ 0, 0, -50 }, T(0)));
+		assert(!isVisible(view, eye + Vec3<T>{ 0, 0, -0.5 }, T(0)));
+		assert(isVisible(view, eye + Vec3<T>{ 0, 0, -0.5 }, T(1)));
+		assert(!isVisible(view, eye + Vec3<T>{ 0, 0, -101 }, T(0.5)));
+		assert(!isVisible(view, eye + Vec3<T>{ 12, 0, -10 }, T(1)));
+		assert(isVisible(view, eye + Vec3<T>{ 12, 0, -10 }, T(2)));
+		assert(!isVisible(view, eye + Vec3<T>{ 0, 0, 10 }, T(5)));
+		assert(isVisible(view, math3d::Aabb<T>{ eye + Vec3<T>{ -20, -1, -11 }, eye + Vec3<T>{ -9, 1, -9 } }));
+		assert(!isVisible(view, math3d::Aabb<T>{ eye + Vec3<T>{ -20, -1, -11 }, eye + Vec3<T>{ -12, 1, -9 } }));
+
+		//the planes contain the points that project into the clip volume, away from its faces
+		for (int i = 0; i < 10000; ++i) {
+			const Vec3<T> p = eye + Vec3<T>{ static_cast<T>(random(-150, 150)), static_cast<T>(random(-150, 150)), static_cast<T>(random(-150, 10)) };
+			const Vec4<T> clip = m * Vec4<T>{ p.x, p.y, p.z, 1 };
+			const T lowZ = depth == math3d::DepthRange::ZeroToOne ? 0 : -clip.w;
+			const T margin = std::min({ clip.w - std::abs(clip.x), clip.w - std::abs(clip.y), clip.z - lowZ, clip.w - clip.z });
+			if (std::abs(margin) > T(1e-3) * (1 + std::abs(clip.w))) {
+				assert(isVisible(view, p, T(0)) == (margin > 0));
+			}
+		}
+	}
+}
+
+//The smallest distance of the single test, to skip objects on a plane when FMA contraction may round them to either side
+template<class T>
+T sphereMargin(std::span<const Vec4<T>> planes, const Vec3<T>& c, T r) {
+	T smallest = std::numeric_limits<T>::infinity();
+	for (const Vec4<T>& p : planes) {
+		smallest = std::min(smallest, math3d::cullKernels::sphereDistance(p, c, r));
+	}
+	return smallest;
+}
+
+template<class T>
+T boxMargin(std::span<const Vec4<T>> planes, const Vec3<T>& lower, const Vec3<T>& upper) {
+	T smallest = std::numeric_limits<T>::infinity();
+	for (const Vec4<T>& p : planes) {
+		smallest = std::min(smallest, math3d::cullKernels::boxDistance(p, math3d::cullKernels::boxCenter(lower, upper), math3d::cullKernels::boxHalf(lower, upper)));
+	}
+	return smallest;
+}
+
+//The indices are the set bits of the mask in order, and match the single test
+template<class T, class Single, class Margin>
+void checkCull(size_t n, const std::vector<uint32_t>& indices, size_t count, const std::vector<uint64_t>& mask, size_t maskCount, Single&& single, Margin&& margin) {
+	assert(count == maskCount);
+	size_t next = 0;
+	for (size_t i = 0; i < n; ++i) {
+		const bool bit = (mask[i / 64] >> (i % 64) & 1) != 0;
+		if (bit) {
+			assert(next < count && indices[next] == i);
+			++next;
+		}
+		if (!Contracted || std::abs(margin(i)) > T(1e-4)) {
+			assert(bit == single(i));
+		}
+	}
+	assert(next == count);
+	if (n % 64 != 0) {
+		assert(mask[n / 64] >> (n % 64) == 0);
+	}
+}
+
+template<class T>
+void cullTest(size_t n, uint64_t seed) {
+	Random random{ seed };
+	const std::array<Vec4<T>, 6> planes = math3d::frustumPlanes(viewProjection(Vec3<T>{}, math3d::DepthRange::NegativeOneToOne));
+	const std::span<const Vec4<T>> view(planes);
+	std::vector<Vec3<T>> centers(n), lower(n), upper(n);
+	std::vector<T> radii(n);
+	for (size_t i = 0; i < n; ++i) {
+		centers[i] = { static_cast<T>(random(-120, 120)), static_cast<T>(random(-120, 120)), static_cast<T>(random(-120, 20)) };
+		radii[i] = static_cast<T>(random(0, 10));
+		const Vec3<T> half{ static_cast<T>(random(0, 10)), static_cast<T>(random(0, 10)), static_cast<T>(random(0, 10)) };
+		lower[i] = centers[i] - half;
+		upper[i] = centers[i] + half;
+	}
+	//NaN is kept, a sphere reaching past a plane is kept, a point behind it is not
+	if (n > 3) {
+		centers[0].x = std::numeric_limits<T>::quiet_NaN();
+		lower[1].y = std::numeric_limits<T>::quiet_NaN();
+		centers[2] = { 0, 0, -110 };
+		radii[2] = 10.25;
+		centers[3] = { 0, 0, -101 };
+		radii[3] = 0;
+	}
+	const math3d::VecArray<3, T> soaCenters{ std::span<const Vec3<T>>(centers) };
+	const math3d::VecArray<3, T> soaLower{ std::span<const Vec3<T>>(lower) };
+	const math3d::VecArray<3, T> soaUpper{ std::span<const Vec3<T>>(upper) };
+	const std::span<const T> r(radii);
+	const size_t words = (n + 63) / 64;
+
+	std::vector<uint32_t> spheres(n);
+	std::vector<uint64_t> sphereMask(words, ~uint64_t(0));
+	const size_t sphereCount = cullSpheres(view, soaCenters, r, std::span<uint32_t>(spheres));
+	const size_t sphereMaskCount = cullSpheresMask(view, soaCenters, r, std::span<uint64_t>(sphereMask));
+	checkCull<T>(n, spheres, sphereCount, sphereMask, sphereMaskCount,
+		[&](size_t i) { return isVisible(view, centers[i], radii[i]); },
+		[&](size_t i) { return sphereMargin(view, centers[i], radii[i]); });
+
+	std::vector<uint32_t> boxes(n);
+	std::vector<uint64_t> boxMask(words, ~uint64_t(0));
+	const size_t boxCount = cullBoxes(view, soaLower, soaUpper, std::span<uint32_t>(boxes));
+	const size_t boxMaskCount = cullBoxesMask(view, soaLower, soaUpper, std::span<uint64_t>(boxMask));
+	checkCull<T>(n, boxes, boxCount, boxMask, boxMaskCount,
+		[&](size_t i) { return isVisible(view, math3d::Aabb<T>{ lower[i], upper[i] }); },
+		[&](size_t i) { return boxMargin(view, lower[i], upper[i]); });
+
+	if (n > 3) {
+		assert(sphereMask[0] & 1 && boxMask[0] & 2);
+		assert(sphereMask[0] & 4 && !(sphereMask[0] & 8));
+	}
+	//a box around its sphere is kept whenever the sphere is
+	for (size_t i = 4; i < n; ++i) {
+		if ((sphereMask[i / 64] >> (i % 64) & 1) != 0) {
+			const Vec3<T> half{ radii[i], radii[i], radii[i] };
+			assert(isVisible(view, math3d::Aabb<T>{ centers[i] - half, centers[i] + half }));
+		}
+	}
+
+	//the same bits on any number of threads
+	for (size_t threads : { 1, 3 }) {
+		math3d::ThreadPool pool(threads);
+		std::vector<uint32_t> parallel(n);
+		std::vector<uint64_t> parallelMask(words, ~uint64_t(0));
+		assert(cullSpheres(pool, view, soaCenters, r, std::span<uint32_t>(parallel)) == sphereCount);
+		assert(cullSpheresMask(pool, view, soaCenters, r, std::span<uint64_t>(parallelMask)) == sphereCount);
+		assert(std::equal(spheres.begin(), spheres.begin() + sphereCount, parallel.begin()) && parallelMask == sphereMask);
+		assert(cullBoxes(pool, view, soaLower, soaUpper, std::span<uint32_t>(parallel)) == boxCount);
+		assert(cullBoxesMask(pool, view, soaLower, soaUpper, std::span<uint64_t>(parallelMask)) == boxCount);
+		assert(std::equal(boxes.begin(), boxes.begin() + boxCount, parallel.begin()) && parallelMask == boxMask);
+	}
+}
+
+int main() {
+	planeTest<float>();
+	planeTest<double>();
+	for (size_t n : { 0, 1, 7, 8, 9, 63, 64, 65, 1000, 70001 }) {
+		cullTest<float>(n, n + 1);
+		cullTest<double>(n, n + 2);
+	}
+	return 0;
+}
@@ -0,0 +1,188 @@
+#include "hierarchy.h"
+#include "testing.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+template<class T>
+using Mat4 = math3d::Matrix<4, 4, T>;
+template<class T>
+using Hierarchy = math3d::TransformHierarchy<T>;
+
+constexpr uint32_t NoParent = Hierarchy<float>::NoParent;
+
+using testing::Random;
+
+//A rotation about z with a translation, so chains of them stay well scaled
+template<class T>
+Mat4<T> transform(Random& random) {
+	const T c = static_cast<T>(random(-1, 1));
+	const T s = std::sqrt(1 - c * c);
+	return { { c, -s, 0, static_cast<T>(random(-1, 1)) }, { s, c, 0, static_cast<T>(random(-1, 1)) }, { 0, 0, 1, static_cast<T>(random(-1, 1)) }, { 0, 0, 0, 1 } };
+}
+
+/*
+* A forest of n nodes, about one in 100 a root, the parent of every other node one of
+* the fanIn nodes before it, few for deep chains, many for wide levels. The nodes are
+* labeled in shuffled order, so parents are not in index order.
+*/
+std::vector<uint32_t> makeParents(size_t n, size_t fanIn, Random& random) {
+	std::vector<uint32_t> label(n);
+	std::iota(label.begin(), label.end(), uint32_t(0));
+	for (size_t i = n; i > 1; --i) {
+		std::swap(label[i - 1], label[random.next() % i]);
+	}
+	std::vector<uint32_t> parents(n, NoParent);
+	for (size_t i = 1; i < n; ++i) {
+		if (random.next() % 100 != 0) {
+			const size_t lowest = i > fanIn ? i - fanIn : 0;
+			parents[label[i]] = label[lowest + random.next() % (i - lowest)];
+		}
+	}
+	return parents;
+}
+
+//The world transform multiplied down the chain of parents
+template<class T>
+Mat4<T> chain(const std::vector<uint32_t>& parents, const std::vector<Mat4<T>>& locals, uint32_t node) {
+	return parents[node] == NoParent ? locals[node] : chain(parents, locals, parents[node]) * locals[node];
+}
+
+template<class T>
+bool sameBits(const Mat4<T>& a, const Mat4<T>& b) {
+	return std::memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+template<class T>
+void check(const Hierarchy<T>& h, const std::vector<uint32_t>& parents, const std::vector<Mat4<T>>& locals) {
+	assert(h.size() == parents.size() && !h.needsUpdate());
+	for (uint32_t node = 0; node < parents.size(); ++node) {
+		assert(h.parent(node) == parents[node] && sameBits(h.local(node), locals[node]));
+		assert(sameBits(h.world(node), chain(parents, locals, node)));
+	}
+	//breadth first, every parent before its children, worlds in the same order
+	std::vector<size_t> position(parents.size());
+	for (size_t i = 0; i < h.nodes().size(); ++i) {
+		position[h.nodes()[i]] = i;
+		assert(sameBits(h.worlds()[i], h.world(h.nodes()[i])));
+	}
+	for (uint32_t node = 0; node < parents.size(); ++node) {
+		assert(parents[node] == NoParent || position[parents[node]] < position[node]);
+	}
+}
+
+//The nodes in the subtrees of the changed nodes
+size_t subtreeNodes(const std::vector<uint32_t>& parents, const std::vector<bool>& changed) {
+	size_t count = 0;
+	for (uint32_t node = 0; node < parents.size(); ++node) {
+		for (uint32_t n = node; n != NoParent; n = parents[n]) {
+			if (changed[n]) {
+				++count;
+				break;
+			}
+		}
+	}
+	return count;
+}
+
+template<class T>
+void hierarchyTest(size_t n, size_t fanIn, uint64_t seed) {
+	Random random{ seed };
+	const std::vector<uint32_t> parents = makeParents(n, fanIn, random);
+	std::vector<Mat4<T>> locals(n);
+	for (auto& m : locals) {
+		m = transform<T>(random);
+	}
+	Hierarchy<T> h{ std::span<const uint32_t>(parents), std::span<const Mat4<T>>(locals) };
+	check(h, parents, locals);
+	math3d::ThreadPool pool(3);
+	Hierarchy<T> parallel{ pool, std::span<const uint32_t>(parents), std::span<const Mat4<T>>(locals) };
+	assert(parallel.levels() == h.levels());
+	assert(std::equal(h.nodes().begin(), h.nodes().end(), parallel.nodes().begin()));
+	assert(n == 0 || std::memcmp(h.worlds().data(), parallel.worlds().data(), n * sizeof(Mat4<T>)) == 0);
+
+	//nothing changed, nothing recomputed
+	assert(h.update() == 0 && parallel.update(pool) == 0);
+
+	//a few changes recompute their subtrees and nothing else, the same on a pool
+	for (int round = 0; round < 4 && n > 0; ++round) {
+		std::vector<bool> changed(n, false);
+		for (size_t k = 0; k < 1 + n / 500; ++k) {
+			const uint32_t node = static_cast<uint32_t>(random.next() % n);
+			changed[node] = true;
+			locals[node] = transform<T>(random);
+			h.setLocal(node, locals[node]);
+			parallel.setLocal(node, locals[node]);
+		}
+		assert(h.needsUpdate());
+		const size_t expected = subtreeNodes(parents, changed);
+		assert(h.update() == expected);
+		assert(parallel.update(pool) == expected);
+		check(h, parents, locals);
+		assert(std::memcmp(h.worlds().data(), parallel.worlds().data(), n * sizeof(Mat4<T>)) == 0);
+	}
+}
+
+void structureTest() {
+	const Mat4<float> identity{ { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, 0, 1 } };
+
+	//empty, and a chain with one node per level
+	const Hierarchy<float> none{ std::span<const uint32_t>(), std::span<const Mat4<float>>() };
+	assert(none.empty() && none.levels() == 0 && !none.needsUpdate());
+	const std::vector<uint32_t> chainParents{ 3, NoParent, 0, 1 };
+	const std::vector<Mat4<float>> four(4, identity);
+	Hierarchy<float> line{ std::span<const uint32_t>(chainParents), std::span<const Mat4<float>>(four) };
+	assert(line.levels() == 4 && (line.nodes()[0] == 1 && line.nodes()[1] == 3 && line.nodes()[3] == 2));
+	Mat4<float> moved = identity;
+	moved.x.w = 5;
+	line.setLocal(0, moved);
+	assert(line.update() == 2 && line.world(2).x.w == 5 && line.world(3).x.w == 0);
+
+	//invalid forests throw
+	const std::vector<uint32_t> cycle{ NoParent, 2, 1 };
+	const std::vector<uint32_t> outside{ NoParent, 7 };
+	const std::vector<Mat4<float>> three(3, identity);
+	bool threw = false;
+	try {
+		Hierarchy<float>{ std::span<const uint32_t>(cycle), std::span<const Mat4<float>>(three) };
+	}
+	catch (const std::invalid_argument&) {
+		threw = true;
+	}
+	assert(threw);
+	threw = false;
+	try {
+		Hierarchy<float>{ std::span<const uint32_t>(outside), std::span<const Mat4<float>>(three).first(2) };
+	}
+	catch (const std::invalid_argument&) {
+		threw = true;
+	}
+	assert(threw);
+	threw = false;
+	try {
+		Hierarchy<float>{ std::span<const uint32_t>(cycle), std::span<const Mat4<float>>(four) };
+	}
+	catch (const std::invalid_argument&) {
+		threw = true;
+	}
+	assert(threw);
+}
+
+int main() {
+	structureTest();
+	for (size_t n : { 0, 1, 2, 100, 5000 }) {
+		hierarchyTest<float>(n, n, n + 1);
+		hierarchyTest<double>(n, n, n + 2);
+	}
+	//wide levels, which run on every thread of the pool, and deep chains
+	hierarchyTest<float>(60000, 20000, 7);
+	hierarchyTest<float>(3000, 2, 8);
+	hierarchyTest<double>(30000, 20000, 9);
+	return 0;
+}
@@ -0,0 +1,275 @@
+#include "intersect.h"
+#include "testing.h"
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+using Vec3f = math3d::Vec<3, float>;
+using math3d::Aabb;
+using math3d::Ray;
+using math3d::TriangleHit;
+using testing::Contracted;
+using testing::Random;
+
+bool sameBits(float a, float b) {
+	return std::memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+bool agree(float a, float b) {
+	return Contracted ? std::abs(a - b) <= 1e-4f * (1 + std::abs(a) + std::abs(b)) : sameBits(a, b);
+}
+
+//Lanes tested and lanes where the packet and the scalar test disagree on a hit
+size_t lanes = 0;
+size_t disagreements = 0;
+
+bool sameHit(bool expected, int mask, size_t lane) {
+	++lanes;
+	if (expected != ((mask >> lane & 1) != 0)) {
+		++disagreements;
+		return false;
+	}
+	return true;
+}
+
+void scalarTest() {
+	const Vec3f a{ 0, 0, 0 };
+	const Vec3f b{ 1, 0, 0 };
+	const Vec3f c{ 0, 1, 0 };
+	TriangleHit<float> hit;
+	assert(intersect(Ray<float>{ { 0.25f, 0.5f, 2 }, { 0, 0, -1 } }, a, b, c, hit));
+	assert(hit.t == 2 && hit.u == 0.25f && hit.v == 0.5f);
+	//from behind, and with a direction that is not a unit vector
+	assert(intersect(Ray<float>{ { 0.25f, 0.25f, -1 }, { 0, 0, 4 } }, a, b, c, hit));
+	assert(hit.t == 0.25f);
+	//outside, beyond tMax, before tMin and in the plane
+	assert(!intersect(Ray<float>{ { 0.75f, 0.75f, 1 }, { 0, 0, -1 } }, a, b, c, hit));
+	assert(!intersect(Ray<float>{ { 0.25f, 0.25f, 1 }, { 0, 0, -1 }, 0, 0.5f }, a, b, c, hit));
+	assert(!intersect(Ray<float>{ { 0.25f, 0.25f, 1 }, { 0, 0, -1 }, 1.5f }, a, b, c, hit));
+	assert(!intersect(Ray<float>{ { -1, 0.25f, 0 }, { 1, 0, 0 } }, a, b, c, hit));
+	//a degenerate triangle
+	assert(!intersect(Ray<float>{ { 0.5f, 0, 1 }, { 0, 0, -1 } }, a, b, b, hit));
+
+	const Aabb<float> box{ { -1, -1, -1 }, { 1, 2, 3 } };
+	float entry;
+	assert(intersect(Ray<float>{ { -5, 0, 0 }, { 1, 0, 0 } }, box, entry) && entry == 4);
+	assert(intersect(Ray<float>{ { 0, 10, 0 }, { 0, -2, 0 } }, box, entry) && entry == 4);
+	//starting inside, the entry is tMin
+	assert(intersect(Ray<float>{ { 0, 0, 0 }, { 1, 1, 1 } }, box, entry) && entry == 0);
+	assert(!intersect(Ray<float>{ { -5, 0, 0 }, { -1, 0, 0 } }, box, entry));
+	//parallel to a slab, above and below it
+	assert(!intersect(Ray<float>{ { -5, 5, 0 }, { 1, 0, 0 } }, box, entry));
+	assert(!intersect(Ray<float>{ { -5, -5, 0 }, { 1, 0, 0 } }, box, entry));
+	assert(!intersect(Ray<float>{ { -5, -5, 0 }, { 1, -0.0f, 0 } }, box, entry));
+	assert(!intersect(Ray<float>{ { -5, 0, 0 }, { 1, 0, 0 }, 0, 3 }, box, entry));
+	assert(!intersect(Ray<float>{ { 0, 0, 0 }, { 1, 0, 0 } }, Aabb<float>{}, entry));
+	//grazing a face
+	assert(intersect(Ray<float>{ { -5, 2, 0 }, { 1, 0, 0 } }, box, entry) && entry == 4);
+}
+
+//Random triangles, some degenerate, against random rays, some running in the planes of the triangles
+void trianglePacketTest() {
+	Random random{ 1 };
+	for (int round = 0; round < 400; ++round) {
+		const size_t n = 1 + round % 29;
+		const bool grid = round % 2 == 1;
+		std::vector<Vec3f> corners(3 * n);
+		for (Vec3f& corner : corners) {
+			corner = grid ? random.grid(-2, 2) : random.vec(-2, 2);
+		}
+		if (round % 5 == 0) {
+			corners[1] = corners[0];
+		}
+		std::vector<math3d::TrianglePacket> packets(math3d::packetCount(n));
+		packTriangles(std::span<const Vec3f>(corners), std::span<math3d::TrianglePacket>(packets));
+
+		for (int r = 0; r < 50; ++r) {
+			Ray<float> ray{ grid ? random.grid(-3, 3) : random.vec(-3, 3), grid ? random.grid(-1, 1) : random.vec(-1, 1) };
+			if (r % 7 == 0) {
+				ray.tMin = random.uniform(0, 1);
+				ray.tMax = random.uniform(1, 4);
+			}
+			bool any = false;
+			bool found = false;
+			TriangleHit<float> closest;
+			for (size_t p = 0; p < packets.size(); ++p) {
+				math3d::PacketHits hits;
+				const int mask = intersect(ray, packets[p], hits);
+				assert(mask >> math3d::PacketLanes == 0);
+				for (size_t lane = 0; lane < math3d::PacketLanes; ++lane) {
+					const size_t i = p * math3d::PacketLanes + lane;
+					TriangleHit<float> expected;
+					const bool hit = i < n && intersect(ray, corners[3 * i], corners[3 * i + 1], corners[3 * i + 2], expected);
+					if (sameHit(hit, mask, lane) && hit) {
+						assert(agree(hits.t[lane], expected.t) && agree(hits.u[lane], expected.u) && agree(hits.v[lane], expected.v));
+						any = true;
+						if (!found || expected.t < closest.t) {
+							found = true;
+							closest = expected;
+							closest.triangle = i;
+						}
+					}
+				}
+			}
+			TriangleHit<float> nearest;
+			assert(closestHit(ray, std::span<const math3d::TrianglePacket>(packets), nearest) == found || Contracted);
+			if (found && !Contracted) {
+				assert(nearest.triangle == closest.triangle && sameBits(nearest.t, closest.t));
+				assert(sameBits(nearest.u, closest.u) && sameBits(nearest.v, closest.v));
+			}
+			assert(Contracted || occluded(ray, std::span<const math3d::TrianglePacket>(packets)) == any);
+		}
+	}
+
+	//indexed triangles pack like their corners
+	const Vec3f vertices[] = { { 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 }, { 1, 1, 0 } };
+	const uint32_t indices[] = { 0, 1, 2, 1, 3, 2 };
+	const Vec3f corners[] = { vertices[0], vertices[1], vertices[2], vertices[1], vertices[3], vertices[2] };
+	math3d::TrianglePacket indexed[1];
+	math3d::TrianglePacket direct[1];
+	packTriangles(std::span<const Vec3f>(vertices), std::span<const uint32_t>(indices), std::span<math3d::TrianglePacket>(indexed));
+	packTriangles(std::span<const Vec3f>(corners), std::span<math3d::TrianglePacket>(direct));
+	assert(std::memcmp(indexed, direct, sizeof(direct)) == 0);
+	TriangleHit<float> hit;
+	assert(closestHit(Ray<float>{ { 0.75f, 0.75f, 1 }, { 0, 0, -1 } }, std::span<const math3d::TrianglePacket>(indexed), hit));
+	assert(hit.triangle == 1 && hit.t == 1);
+	//on the shared edge both are hit, the first one wins
+	assert(closestHit(Ray<float>{ { 0.5f, 0.5f, 1 }, { 0, 0, -1 } }, std::span<const math3d::TrianglePacket>(indexed), hit));
+	assert(hit.triangle == 0);
+}
+
+//Random boxes, some empty or flat, against random rays, many parallel to the axes
+void boxPacketTest() {
+	Random random{ 2 };
+	for (int round = 0; round < 400; ++round) {
+		const size_t n = 1 + round % 23;
+		const bool grid = round % 2 == 1;
+		std::vector<Aabb<float>> boxes(n);
+		for (size_t i = 0; i < n; ++i) {
+			if (i % 11 == 3) {
+				continue;
+			}
+			boxes[i].grow(grid ? random.grid(-2, 2) : random.vec(-2, 2));
+			if (i % 13 != 5) {
+				boxes[i].grow(grid ? random.grid(-2, 2) : random.vec(-2, 2));
+			}
+		}
+		std::vector<math3d::BoxPacket> packets(math3d::packetCount(n));
+		packBoxes(std::span<const Aabb<float>>(boxes), std::span<math3d::BoxPacket>(packets));
+
+		std::vector<Ray<float>> rays(27);
+		for (size_t r = 0; r < rays.size(); ++r) {
+			rays[r] = { grid ? random.grid(-3, 3) : random.vec(-3, 3), grid ? random.grid(-1, 1) : random.vec(-1, 1) };
+			if (r % 5 == 0) {
+				rays[r].direction[r % 3] = r % 2 == 0 ? 0.0f : -0.0f;
+			}
+			if (r % 7 == 0) {
+				rays[r].tMin = random.uniform(0, 1);
+				rays[r].tMax = random.uniform(1, 4);
+			}
+		}
+		std::vector<math3d::RayPacket> rayPackets(math3d::packetCount(rays.size()));
+		for (size_t r = 0; r < rays.size(); ++r) {
+			rayPackets[r / math3d::PacketLanes].set(r % math3d::PacketLanes, rays[r]);
+		}
+
+		for (const Ray<float>& ray : rays) {
+			for (size_t p = 0; p < packets.size(); ++p) {
+				float entry[math3d::PacketLanes];
+				const int mask = intersect(ray, packets[p], entry);
+				for (size_t lane = 0; lane < math3d::PacketLanes; ++lane) {
+					const size_t i = p * math3d::PacketLanes + lane;
+					float expected;
+					const bool hit = i < n && intersect(ray, boxes[i], expected);
+					assert(!sameHit(hit, mask, lane) || !hit || agree(entry[lane], expected));
+					assert(!boxes[i % n].empty() || !intersect(ray, boxes[i % n], expected));
+				}
+			}
+		}
+		for (const Aabb<float>& box : boxes) {
+			for (size_t p = 0; p < rayPackets.size(); ++p) {
+				float entry[math3d::PacketLanes];
+				const int mask = intersect(rayPackets[p], box, entry);
+				for (size_t lane = 0; lane < math3d::PacketLanes; ++lane) {
+					const size_t r = p * math3d::PacketLanes + lane;
+					float expected;
+					const bool hit = r < rays.size() && intersect(rays[r], box, expected);
+					assert(!sameHit(hit, mask, lane) || !hit || agree(entry[lane], expected));
+				}
+			}
+		}
+	}
+}
+
+//A ray that hits a triangle hits its bounds, no earlier than the bounds are entered
+void consistencyTest() {
+	Random random{ 3 };
+	for (int i = 0; i < 20000; ++i) {
+		const Vec3f a = random.vec(-1, 1);
+		const Vec3f b = random.vec(-1, 1);
+		const Vec3f c = random.vec(-1, 1);
+		const Ray<float> ray{ random.vec(-3, 3), random.vec(-1, 1) };
+		TriangleHit<float> hit;
+		if (intersect(ray, a, b, c, hit)) {
+			Aabb<float> bounds;
+			bounds.grow(a).grow(b).grow(c);
+			//slightly grown, the hit point is rounded
+			const Vec3f margin{ 1e-4f, 1e-4f, 1e-4f };
+			bounds.lower = bounds.lower - margin;
+			bounds.upper = bounds.upper + margin;
+			float entry;
+			assert(intersect(ray, bounds, entry));
+			assert(entry <= hit.t * (1 + 1e-5f) + 1e-5f);
+			const Vec3f p = ray.origin + ray.direction * hit.t;
+			const Vec3f q = a * (1 - hit.u - hit.v) + b * hit.u + c * hit.v;
+			assert(lengthSquared(p - q) < 1e-8f);
+		}
+	}
+}
+
+//Every Voronoi region of the triangle, and degenerate triangles, against dense sampling
+void closestPointTest() {
+	const Vec3f a{ 0, 0, 0 };
+	const Vec3f b{ 2, 0, 0 };
+	const Vec3f c{ 0, 2, 0 };
+	assert(closestPoint(Vec3f{ -1, -1, 3 }, a, b, c) == a);
+	assert(closestPoint(Vec3f{ 3, -1, 0 }, a, b, c) == b);
+	assert(closestPoint(Vec3f{ -1, 5, -2 }, a, b, c) == c);
+	assert(closestPoint(Vec3f{ 1, -3, 1 }, a, b, c) == (Vec3f{ 1, 0, 0 }));
+	assert(closestPoint(Vec3f{ -3, 1, 1 }, a, b, c) == (Vec3f{ 0, 1, 0 }));
+	assert(closestPoint(Vec3f{ 2, 2, 0 }, a, b, c) == (Vec3f{ 1, 1, 0 }));
+	assert(closestPoint(Vec3f{ 0.5f, 0.25f, -4 }, a, b, c) == (Vec3f{ 0.5f, 0.25f, 0 }));
+
+	Random random{ 4 };
+	for (int i = 0; i < 2000; ++i) {
+		Vec3f corners[3] = { random.vec(-1, 1), random.vec(-1, 1), random.vec(-1, 1) };
+		if (i % 10 == 0) {
+			//a segment, or a point
+			corners[2] = i % 20 == 0 ? corners[1] : corners[0] + (corners[1] - corners[0]) * 0.5f;
+			corners[1] = i % 40 == 0 ? corners[0] : corners[1];
+		}
+		const Vec3f p = random.vec(-2, 2);
+		const Vec3f q = closestPoint(p, corners[0], corners[1], corners[2]);
+		const float d = lengthSquared(q - p);
+		for (int s = 0; s <= 40; ++s) {
+			for (int t = 0; s + t <= 40; ++t) {
+				const Vec3f sample = corners[0] + (corners[1] - corners[0]) * (s / 40.0f) + (corners[2] - corners[0]) * (t / 40.0f);
+				assert(d <= lengthSquared(sample - p) + 1e-5f);
+			}
+		}
+	}
+}
+
+int main() {
+	static_assert(math3d::packetCount(0) == 0 && math3d::packetCount(8) == 1 && math3d::packetCount(9) == 2);
+	scalarTest();
+	trianglePacketTest();
+	boxPacketTest();
+	consistencyTest();
+	closestPointTest();
+	assert(Contracted ? disagreements * 1000 <= lanes : disagreements == 0);
+	return 0;
+}
@@ -0,0 +1,212 @@
+#include "kdtree.h"
+#include "testing.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+using Vec3f = math3d::Vec<3, float>;
+using math3d::KdTree;
+using math3d::Neighbor;
+using testing::Random;
+
+//integer coordinates on a grid give many points at the same distance
+Vec3f makePoint(Random& random, float lo, float hi, bool grid) {
+	const Vec3f v = random.vec(lo, hi);
+	return grid ? Vec3f{ std::floor(v.x), std::floor(v.y), std::floor(v.z) } : v;
+}
+
+std::vector<Vec3f> makePoints(size_t n, bool grid, uint64_t seed) {
+	Random random{ seed };
+	std::vector<Vec3f> points(n);
+	for (auto& p : points) {
+		p = makePoint(random, -8, 8, grid);
+	}
+	return points;
+}
+
+//Every point sorted by distance to q, then index
+std::vector<Neighbor> bruteForce(const std::vector<Vec3f>& points, const Vec3f& q) {
+	std::vector<Neighbor> all(points.size());
+	for (size_t i = 0; i < points.size(); ++i) {
+		all[i] = { static_cast<uint32_t>(i), lengthSquared(q - points[i]) };
+	}
+	std::sort(all.begin(), all.end(), [](const Neighbor& a, const Neighbor& b) {
+		return a.distanceSquared < b.distanceSquared || (a.distanceSquared == b.distanceSquared && a.index < b.index);
+	});
+	return all;
+}
+
+bool same(const Neighbor& a, const Neighbor& b) {
+	return a.index == b.index && a.distanceSquared == b.distanceSquared;
+}
+
+//The points of [begin, m) are at most points[m] along axes[m], the points of [m + 1, end) at least
+void checkSplits(std::span<const math3d::KdPoint> points, std::span<const uint8_t> axes, size_t begin, size_t end) {
+	if (end - begin <= math3d::kdKernels::LeafSize) {
+		return;
+	}
+	const size_t m = math3d::kdKernels::middle(begin, end);
+	const uint8_t axis = axes[m];
+	assert(axis < 3);
+	const float split = points[m].point[axis];
+	for (size_t i = begin; i < m; ++i) {
+		assert(points[i].point[axis] <= split);
+	}
+	for (size_t i = m + 1; i < end; ++i) {
+		assert(points[i].point[axis] >= split);
+	}
+	checkSplits(points, axes, begin, m);
+	checkSplits(points, axes, m + 1, end);
+}
+
+//Every point of the tree is a point of the input, and every split orders its range
+void checkStructure(const KdTree& tree, const std::vector<Vec3f>& points) {
+	const auto stored = tree.points();
+	assert(stored.size() == points.size());
+	assert(tree.splitAxes().size() == points.size());
+	std::vector<int> seen(points.size());
+	for (const auto& p : stored) {
+		++seen[p.index];
+		assert(std::memcmp(&p.point, &points[p.index], sizeof(Vec3f)) == 0);
+	}
+	assert(std::count(seen.begin(), seen.end(), 1) == static_cast<long>(points.size()));
+	checkSplits(stored, tree.splitAxes(), 0, stored.size());
+}
+
+void queryTest(size_t n, bool grid) {
+	const auto points = makePoints(n, grid, n + grid);
+	const KdTree tree{ std::span<const Vec3f>(points) };
+	checkStructure(tree, points);
+	Random random{ 3 };
+	for (int i = 0; i < 200; ++i) {
+		const Vec3f q = makePoint(random, -10, 10, grid);
+		const auto expected = bruteForce(points, q);
+
+		//k nearest, including more than the tree holds
+		for (size_t k : { 1, 4, 17 }) {
+			std::vector<Neighbor> found(k);
+			const size_t count = tree.nearest(q, found);
+			assert(count == std::min(k, n));
+			for (size_t j = 0; j < k; ++j) {
+				assert(j < count ? same(found[j], expected[j]) : found[j].index == KdTree::NoPoint);
+			}
+		}
+		assert(same(tree.nearest(q), expected[0]));
+
+		//radius, inclusive, so grid points exactly on the sphere are found
+		const float radius = grid ? 3 : random.uniform(0.5f, 4);
+		std::vector<Neighbor> within;
+		tree.withinRadius(q, radius, within);
+		std::sort(within.begin(), within.end(), [](const Neighbor& a, const Neighbor& b) {
+			return a.distanceSquared < b.distanceSquared || (a.distanceSquared == b.distanceSquared && a.index < b.index);
+		});
+		const size_t inside = std::count_if(expected.begin(), expected.end(), [&](const Neighbor& e) {
+			return e.distanceSquared <= radius * radius;
+		});
+		assert(within.size() == inside);
+		for (size_t j = 0; j < inside; ++j) {
+			assert(same(within[j], expected[j]));
+		}
+	}
+}
+
+//The batched queries give the single query results in query order, on any number of threads
+void batchTest() {
+	const auto points = makePoints(50000, false, 9);
+	const auto queries = makePoints(3000, true, 10);
+	const std::span<const Vec3f> view(points);
+	const KdTree tree(view);
+	constexpr size_t K = 5;
+	constexpr float Radius = 0.75f;
+
+	std::vector<Neighbor> nearest(queries.size() * K);
+	tree.nearest(queries, K, nearest);
+	std::vector<size_t> offsets;
+	std::vector<Neighbor> within;
+	tree.withinRadius(queries, Radius, offsets, within);
+	assert(offsets.size() == queries.size() + 1 && offsets.back() == within.size());
+	for (size_t q = 0; q < queries.size(); ++q) {
+		std::vector<Neighbor> single(K);
+		tree.nearest(queries[q], single);
+		for (size_t j = 0; j < K; ++j) {
+			assert(same(single[j], nearest[q * K + j]));
+		}
+		std::vector<Neighbor> around;
+		tree.withinRadius(queries[q], Radius, around);
+		assert(around.size() == offsets[q + 1] - offsets[q]);
+		for (size_t j = 0; j < around.size(); ++j) {
+			assert(same(around[j], within[offsets[q] + j]));
+		}
+	}
+
+	for (size_t threads : { 1, 2, 3, 4 }) {
+		math3d::ThreadPool pool(threads);
+		const KdTree parallel(pool, view);
+		assert(std::memcmp(parallel.points().data(), tree.points().data(), tree.points().size_bytes()) == 0);
+		std::vector<Neighbor> parallelNearest(queries.size() * K);
+		parallel.nearest(pool, queries, K, parallelNearest);
+		assert(std::memcmp(parallelNearest.data(), nearest.data(), nearest.size() * sizeof(Neighbor)) == 0);
+		std::vector<size_t> parallelOffsets;
+		std::vector<Neighbor> parallelWithin;
+		parallel.withinRadius(pool, queries, Radius, parallelOffsets, parallelWithin);
+		assert(parallelOffsets == offsets);
+		assert(std::memcmp(parallelWithin.data(), within.data(), within.size() * sizeof(Neighbor)) == 0);
+	}
+}
+
+void edgeCaseTest() {
+	//nothing to search
+	const KdTree none{ std::span<const Vec3f>() };
+	assert(none.empty() && none.nearest({ 1, 2, 3 }).index == KdTree::NoPoint);
+	std::vector<size_t> offsets{ 7 };
+	std::vector<Neighbor> within(3);
+	none.withinRadius(std::span<const Vec3f>(), 1, offsets, within);
+	assert(offsets.size() == 1 && offsets[0] == 0 && within.empty());
+
+	//identical points are ordered by index
+	const std::vector<Vec3f> same(100, Vec3f{ 1, 1, 1 });
+	const KdTree duplicates{ std::span<const Vec3f>(same) };
+	std::vector<Neighbor> found(10);
+	assert(duplicates.nearest({ 0, 0, 0 }, found) == 10);
+	for (size_t j = 0; j < found.size(); ++j) {
+		assert(found[j].index == j && found[j].distanceSquared == 3);
+	}
+
+	//points along a line, spread over many orders of magnitude
+	std::vector<Vec3f> line;
+	for (int i = 0; i < 120; ++i) {
+		line.push_back({ std::ldexp(1.0f, i - 60), 0, 0 });
+	}
+	const KdTree spread{ std::span<const Vec3f>(line) };
+	checkStructure(spread, line);
+	for (size_t i = 0; i < line.size(); ++i) {
+		assert(spread.nearest(line[i]).index == i);
+	}
+
+	bool thrown = false;
+	try {
+		const std::vector<Vec3f> bad{ { 0, 0, 0 }, { 0, std::nanf(""), 0 } };
+		KdTree tree{ std::span<const Vec3f>(bad) };
+	}
+	catch (const std::invalid_argument&) {
+		thrown = true;
+	}
+	assert(thrown);
+}
+
+int main() {
+	for (bool grid : { false, true }) {
+		queryTest(1, grid);
+		queryTest(8, grid);
+		queryTest(9, grid);
+		queryTest(1000, grid);
+	}
+	batchTest();
+	edgeCaseTest();
+	return 0;
+}
@@ -0,0 +1,187 @@
+#include "linearAlgebra.h"
+#include "testing.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+template<class T>
+using Mat3 = math3d::Matrix<3, 3, T>;
+template<class T>
+using Vec3 = math3d::Vec<3, T>;
+
+using testing::Contracted;
+using testing::Random;
+
+template<class T>
+Mat3<T> symmetric(Random& random) {
+	Mat3<T> m;
+	for (size_t i = 0; i < 3; ++i) {
+		for (size_t j = i; j < 3; ++j) {
+			m[i][j] = m[j][i] = static_cast<T>(random(-1, 1));
+		}
+	}
+	return m;
+}
+
+template<class T>
+T largest(const Mat3<T>& m) {
+	T l = 0;
+	for (size_t i = 0; i < 3; ++i) {
+		for (size_t j = 0; j < 3; ++j) {
+			l = std::max(l, std::abs(m[i][j]));
+		}
+	}
+	return l;
+}
+
+//Eigenpairs with residuals within tolerance of the largest entry, ascending, and a rotation of unit vectors
+template<class T>
+void checkEigen(const Mat3<T>& m, const math3d::SymmetricEigen<T>& e, T tolerance) {
+	const T scale = largest(m);
+	assert(e.values.x <= e.values.y && e.values.y <= e.values.z);
+	for (size_t k = 0; k < 3; ++k) {
+		const Vec3<T> v = e.vectors[k];
+		assert(std::abs(length(v) - 1) <= tolerance);
+		assert(length(m * v - e.values[k] * v) <= tolerance * scale);
+	}
+	assert(std::abs(dotProduct(e.vectors.x, e.vectors.y)) <= tolerance);
+	assert(std::abs(determinant(e.vectors) - 1) <= tolerance);
+}
+
+template<class T>
+void eigenTest(T tolerance) {
+	//diagonal, in any order
+	const auto diagonal = eigenSymmetric(Mat3<T>{ { 3, 0, 0 }, { 0, -1, 0 }, { 0, 0, 2 } });
+	assert(diagonal.values == (Vec3<T>{ -1, 2, 3 }));
+	assert(std::abs(diagonal.vectors.x.y) == 1 && std::abs(diagonal.vectors.y.z) == 1 && std::abs(diagonal.vectors.z.x) == 1);
+
+	Random random{ 1 };
+	for (int i = 0; i < 20000; ++i) {
+		const Mat3<T> m = symmetric<T>(random);
+		checkEigen(m, eigenSymmetric(m), tolerance);
+	}
+
+	//repeated eigenvalues: a multiple of the identity, rank one v v^T, and all zero
+	const auto same = eigenSymmetric(Mat3<T>{ { 5, 0, 0 }, { 0, 5, 0 }, { 0, 0, 5 } });
+	assert(same.values == (Vec3<T>{ 5, 5, 5 }));
+	for (int i = 0; i < 1000; ++i) {
+		const Vec3<T> v{ static_cast<T>(random(-1, 1)), static_cast<T>(random(-1, 1)), static_cast<T>(random(-1, 1)) };
+		const Mat3<T> m = outerProduct(v, v);
+		const auto e = eigenSymmetric(m);
+		checkEigen(m, e, tolerance);
+		assert(std::abs(e.values.x) <= tolerance * lengthSquared(v) && std::abs(e.values.z - lengthSquared(v)) <= tolerance * lengthSquared(v));
+		assert(std::abs(std::abs(dotProduct(e.vectors.z, v)) - length(v)) <= tolerance * length(v));
+	}
+	const auto zero = eigenSymmetric(Mat3<T>{});
+	assert(zero.values == (Vec3<T>{}) && std::abs(determinant(zero.vectors) - 1) <= tolerance);
+
+	//the same relative accuracy far from 1, where the squares of the entries would overflow or underflow
+	for (T s : { T(1e-30), T(1e30) }) {
+		const Mat3<T> m = symmetric<T>(random);
+		auto scaled = eigenSymmetric(m * s);
+		scaled.values = scaled.values / s;
+		checkEigen(m, scaled, tolerance);
+	}
+
+	//the covariance of points near a plane has the plane normal as the direction of least variance
+	const Vec3<T> normal = unit(Vec3<T>{ 1, -2, 2 });
+	const Vec3<T> u = unit(crossProduct(normal, Vec3<T>{ 0, 0, 1 }));
+	const Vec3<T> w = crossProduct(normal, u);
+	Mat3<T> covariance{};
+	for (int i = 0; i < 100; ++i) {
+		const Vec3<T> p = static_cast<T>(random(-1, 1)) * u + static_cast<T>(random(-1, 1)) * w + static_cast<T>(random(-1e-3, 1e-3)) * normal;
+		covariance = covariance + outerProduct(p, p);
+	}
+	const auto plane = eigenSymmetric(covariance);
+	assert(std::abs(std::abs(dotProduct(plane.vectors.x, normal)) - 1) <= T(1e-5));
+}
+
+template<class T>
+void solveTest(T tolerance) {
+	Random random{ 2 };
+	for (int i = 0; i < 20000; ++i) {
+		//diagonally dominant, so well conditioned
+		Mat3<T> a;
+		Vec3<T> b;
+		for (size_t r = 0; r < 3; ++r) {
+			b[r] = static_cast<T>(random(-10, 10));
+			for (size_t c = 0; c < 3; ++c) {
+				a[r][c] = static_cast<T>(random(-1, 1)) + (r == c ? 4 : 0);
+			}
+		}
+		Vec3<T> x;
+		assert(solve(a, b, x));
+		assert(length(a * x - b) <= tolerance * (1 + length(b)));
+	}
+
+	//singular and nearly singular, also tiny ones, where the determinant alone would look singular
+	Vec3<T> x{ 1, 1, 1 };
+	const Mat3<T> rank2{ { 1, 2, 3 }, { 4, 5, 6 }, { 5, 7, 9 } };
+	assert(!solve(rank2, Vec3<T>{ 1, 2, 3 }, x) && x == (Vec3<T>{}));
+	assert(!solve(Mat3<T>{}, Vec3<T>{ 1, 2, 3 }, x) && x == (Vec3<T>{}));
+	const Mat3<T> tiny = Mat3<T>{ { 2, 1, 0 }, { 1, 3, 1 }, { 0, 1, 4 } } * T(1e-10);
+	assert(solve(tiny, Vec3<T>{ 1, 2, 3 }, x));
+	assert(length(tiny * x - Vec3<T>{ 1, 2, 3 }) <= tolerance * 4 && x.x > 0);
+}
+
+template<class T>
+bool same(T a, T b) {
+	return Contracted ? std::abs(a - b) <= T(1e-5) * (1 + std::abs(a) + std::abs(b)) : std::memcmp(&a, &b, sizeof(T)) == 0;
+}
+
+template<class T>
+void batchTest() {
+	Random random{ 3 };
+	constexpr size_t N = 1003;
+	std::vector<Mat3<T>> m(N);
+	std::vector<Vec3<T>> b(N);
+	for (size_t i = 0; i < N; ++i) {
+		m[i] = symmetric<T>(random);
+		b[i] = { static_cast<T>(random(-1, 1)), static_cast<T>(random(-1, 1)), static_cast<T>(random(-1, 1)) };
+	}
+	//some singular systems
+	for (size_t i = 0; i < N; i += 97) {
+		m[i].z = {};
+	}
+	const std::span<const Mat3<T>> view(m);
+
+	std::vector<math3d::SymmetricEigen<T>> eigen(N);
+	eigenSymmetric(view, std::span<math3d::SymmetricEigen<T>>(eigen));
+	std::vector<Vec3<T>> x(N);
+	const size_t singular = solve(view, std::span<const Vec3<T>>(b), std::span<Vec3<T>>(x));
+	size_t expected = 0;
+	for (size_t i = 0; i < N; ++i) {
+		Vec3<T> single;
+		expected += solve(m[i], b[i], single) ? 0 : 1;
+		const auto e = eigenSymmetric(m[i]);
+		for (size_t k = 0; k < 3; ++k) {
+			assert(same(single[k], x[i][k]) && same(e.values[k], eigen[i].values[k]));
+			for (size_t j = 0; j < 3; ++j) {
+				assert(same(e.vectors[k][j], eigen[i].vectors[k][j]));
+			}
+		}
+	}
+	assert(singular == expected && singular == (N + 96) / 97);
+
+	math3d::ThreadPool pool(3);
+	std::vector<math3d::SymmetricEigen<T>> parallelEigen(N);
+	eigenSymmetric(pool, view, std::span<math3d::SymmetricEigen<T>>(parallelEigen));
+	std::vector<Vec3<T>> parallelX(N);
+	assert(solve(pool, view, std::span<const Vec3<T>>(b), std::span<Vec3<T>>(parallelX)) == singular);
+	assert(std::memcmp(parallelEigen.data(), eigen.data(), N * sizeof(eigen[0])) == 0);
+	assert(std::memcmp(parallelX.data(), x.data(), N * sizeof(x[0])) == 0);
+}
+
+int main() {
+	eigenTest<float>(1e-5f);
+	eigenTest<double>(1e-13);
+	solveTest<float>(1e-5f);
+	solveTest<double>(1e-13);
+	batchTest<float>();
+	batchTest<double>();
+	return 0;
+}
@@ -1,301 +1,651 @@
-#include "math3d.h"
-#include <cassert>
-#include <cmath>
-
-using Vec2f = math3d::Vec<2, float>;
-using Vec2i = math3d::Vec<2, int>;
-using Vec3f = math3d::Vec<3, float>;
-using Vec3i = math3d::Vec<3, int>;
-using Vec4f = math3d::Vec<4, float>;
-
-template<class VecType, class ScalarType>
-void scalarProductCompileTest() {
-	VecType vec{};
-	ScalarType scalar{};
-	VecType prod = scalar * vec;
-	prod = vec * scalar;
-	prod = vec / scalar;
-}
-
-template<class VType, class UType, class SumType>
-void sumCompilesTest() {
-	VType v{};
-	UType u{};
-	SumType sum = v + u;
-	sum = u + v;
-	sum = v - u;
-	sum = u - v;
-}
-
-template<class VType, class UType, class ResultType>
-void dotProductCompilesTest() {
-	VType v{};
-	UType u{};
-
-	ResultType product = dotProduct(v, u);
-	product = dotProduct(u, v);
-}
-
-template<size_t Dim, class T>
-void dotProductInterfaceCompilesTest() {
-	math3d::Vec<Dim, T> v{};
-	math3d::Vec<Dim, T> u{};
-	T product = v.dot(u);
-	product = v.lengthSquared();
-	product = v.length();
-}
-
-void pythagoreanTests() {
-	constexpr Vec2f a = { 3, 0 };
-	constexpr Vec2f b = { 0, 4 };
-	constexpr Vec2f c = a + b;
-	static_assert(lengthSquared(c) == 25.0);
-
-	//check other right triangles of pythagorean triples
-}
-
-template<class T>
-void constexprTests() {
-	using Vec2 = math3d::Vec<2, T>;
-	using Vec3 = math3d::Vec<3, T>;
-	using Vec4 = math3d::Vec<4, T>;
-	{
-		constexpr Vec2 zero{};
-		static_assert(sizeof(Vec2) == 2 * sizeof(T));
-		static_assert(zero.x == 0);
-		static_assert(zero.y == 0);
-		static_assert(zero.get<0>() == 0);
-		static_assert(zero.get<1>() == 0);
-	}
-	{
-		constexpr Vec3 zero{};
-		static_assert(sizeof(Vec3) == 3 * sizeof(T));
-		static_assert(zero.x == 0);
-		static_assert(zero.y == 0);
-		static_assert(zero.z == 0);
-		static_assert(zero.get<0>() == 0);
-		static_assert(zero.get<1>() == 0);
-		static_assert(zero.get<2>() == 0);
-	}
-
-	{
-		constexpr Vec4 zero{};
-		static_assert(sizeof(Vec4) == 4 * sizeof(T));
-		static_assert(zero.x == 0);
-		static_assert(zero.y == 0);
-		static_assert(zero.z == 0);
-		static_assert(zero.w == 0);
-		static_assert(zero.get<0>() == 0);
-		static_assert(zero.get<1>() == 0);
-		static_assert(zero.get<2>() == 0);
-		static_assert(zero.get<3>() == 0);
-	}
-}
-
-template<size_t Dim, class T>
-struct TestVec {
-	//This struct is used to provide a vector of dimension Dim
-	//with each component a different value
-};
-
-template<class T>
-struct TestVec<2, T> {
-	static constexpr math3d::Vec<2, T> value{ (T)1.1, (T)2.1 };
-};
-
-template<class T>
-struct TestVec<3, T> {
-	static constexpr math3d::Vec<3, T> value{ (T)1.1, (T)2.1, (T)3.1 };
-};
-
-template<class T>
-struct TestVec<4, T> {
-	static constexpr math3d::Vec<4, T> value{ (T)1.1, (T)2.1, (T)3.1, (T)4.1 };
-};
-
-template<size_t Dim, class T>
-void equalsTest() {
-
-	using Vec = math3d::Vec<Dim, T>;
-	constexpr Vec a = TestVec<Dim, T>::value;
-	constexpr Vec b = TestVec<Dim, T>::value;
-	constexpr Vec zero{};
-	static_assert(a == b);
-	static_assert(b == a);
-	static_assert((a == b) != (a != b));
-	static_assert(zero == zero);
-	static_assert((zero == zero) != (zero != zero));
-	static_assert(a != zero);
-	static_assert(b != zero);
-	static_assert(zero != a);
-	static_assert((a != zero) != (a == zero));
-}
-
-template<size_t Dim, class T>
-void additiveIdentityTest() {
-	using Vec = math3d::Vec<Dim, T>;
-	constexpr Vec zero{};
-	constexpr Vec a = TestVec<Dim, T>::value;
-	static_assert(a + zero == a);
-	static_assert(zero + a == a);
-	static_assert(a - zero == a);
-}
-
-template<size_t Dim, class T>
-void scalarMultIdentityTest() {
-	using Vec = math3d::Vec<Dim, T>;
-	constexpr Vec a = TestVec<Dim, T>::value;
-	static_assert(1.0f * a == a);
-	static_assert(a * 1.0f == a);
-	static_assert(a / 1.0f == a);
-	static_assert(1.0 * a == a);
-	static_assert(a * 1.0 == a);
-	static_assert(a / 1.0 == a);
-	static_assert(1 * a == a);
-	static_assert(a * 1 == a);
-	static_assert(a / 1 == a);
-}
-
-template<class T, class U, class R>
-void matrix2x2AdditionTest() {
-	using MatT = math3d::Matrix<2, 2, T>;
-	using MatU = math3d::Matrix<2, 2, U>;
-	using MatR = math3d::Matrix<2, 2, R>;
-	constexpr MatT a{ {1, 2}, {3, 4} };
-	constexpr MatU b{ {10, 20}, {30, 40} };
-	constexpr MatT zero{};
-	constexpr MatR sum_ab = a + b;
-	constexpr MatR sum_ba = b + a;
-	static_assert(sum_ab.x.x == 11);
-	static_assert(sum_ab.x.y == 22);
-	static_assert(sum_ab.y.x == 33);
-	static_assert(sum_ab.y.y == 44);
-	static_assert(sum_ab.x.x == sum_ba.x.x);
-	static_assert(sum_ab.x.y == sum_ba.x.y);
-	static_assert(sum_ab.y.x == sum_ba.y.x);
-	static_assert(sum_ab.y.y == sum_ba.y.y);
-
-	constexpr MatR diff_ba = b - a;
-	static_assert(diff_ba.x.x == 9);
-	static_assert(diff_ba.x.y == 18);
-	static_assert(diff_ba.y.x == 27);
-	static_assert(diff_ba.y.y == 36);
-}
-
-
-
-int main() {
-	//These expressions must compile
-	constexprTests<float>();
-	constexprTests<int>();
-	constexprTests<double>();
-	constexprTests<short>();
-
-	//scalar product defined with same numeric type
-	scalarProductCompileTest<Vec2f, float>();
-	scalarProductCompileTest<Vec2i, int>();
-
-	//scalar product defined with differing numeric types
-	//scalar product conserves Vec type
-	scalarProductCompileTest<Vec2f, int>();
-	scalarProductCompileTest<Vec2i, float>();
-
-	//sum commutes with same result type
-	sumCompilesTest<Vec2i, Vec2i, Vec2i>();
-	sumCompilesTest<Vec2f, Vec2f, Vec2f>();
-	sumCompilesTest<Vec2f, Vec2i, Vec2f>();
-	sumCompilesTest<Vec3f, Vec3f, Vec3f>();
-	sumCompilesTest<Vec3i, Vec3i, Vec3i>();
-	sumCompilesTest<Vec3f, Vec3i, Vec3f>();
-
-	//dot product is defined
-	dotProductCompilesTest<Vec2i, Vec2i, int>();
-	dotProductCompilesTest<Vec3i, Vec3i, int>();
-	dotProductCompilesTest<Vec2f, Vec2f, float>();
-	dotProductCompilesTest<Vec3f, Vec3f, float>();
-	dotProductCompilesTest<Vec3i, Vec3f, float>();
-
-	pythagoreanTests();
-
-	{
-		//cross product defined for 2-Vec
-		Vec2f v{}, u{};
-		auto x = crossProduct(v, u);
-		float f = v.cross(u);
-
-		Vec2i iv{}, iu{};
-		int i = iv.cross(iu);
-	}
-	{
-		constexpr Vec2f v{};
-		constexpr Vec2f normal = v.normal();
-		static_assert(dotProduct(v, normal) == 0);
-	}
-
-	{
-		constexpr Vec3f v{1, 0, 0}, u{0, 1, 0};
-		constexpr Vec3f product = v.cross(u);
-		static_assert(dotProduct(v, product) == 0);
-		static_assert(dotProduct(u, product) == 0);
-		static_assert(lengthSquared(v) * lengthSquared(u) == lengthSquared(product));
-	}
-
-	{
-		constexpr Vec3f v{ 0, 1, 2 };
-		constexpr Vec3f u{ 3, 4, 5 };
-		constexpr Vec3f sum = v + u;
-		static_assert(sum.x == 3);
-		static_assert(sum.y == 5);
-		static_assert(sum.z == 7);
-
-	}
-
-	//operator== and operator!= defined, need tests
-	equalsTest<2, float>();
-	equalsTest<3, float>();
-	equalsTest<4, float>();
-	equalsTest<2, int>();
-	equalsTest<3, int>();
-	equalsTest<4, int>();
-	equalsTest<2, short>();
-	equalsTest<3, short>();
-	equalsTest<4, short>();
-	equalsTest<2, double>();
-	equalsTest<3, double>();
-	equalsTest<4, double>();
-	
-	//arithmetic identity tests: a + {0}, a - {0}, 1 * a, a * 1, a / 1, {0} + a
-	additiveIdentityTest<2, float>();
-	additiveIdentityTest<3, float>();
-	additiveIdentityTest<4, float>();
-	additiveIdentityTest<2, int>();
-	additiveIdentityTest<3, int>();
-	additiveIdentityTest<4, int>();
-	additiveIdentityTest<2, double>();
-	additiveIdentityTest<3, double>();
-	additiveIdentityTest<4, double>();
-	additiveIdentityTest<2, short>();
-	additiveIdentityTest<3, short>();
-	additiveIdentityTest<4, short>();
-
-	scalarMultIdentityTest<2, float>();
-	scalarMultIdentityTest<3, float>();
-	scalarMultIdentityTest<4, float>();
-	scalarMultIdentityTest<2, int>();
-	scalarMultIdentityTest<3, int>();
-	scalarMultIdentityTest<4, int>();
-	scalarMultIdentityTest<2, double>();
-	scalarMultIdentityTest<3, double>();
-	scalarMultIdentityTest<4, double>();
-	scalarMultIdentityTest<2, short>();
-	scalarMultIdentityTest<3, short>();
-	scalarMultIdentityTest<4, short>();
-
-	//arithmetic correctness tests: a + b, a - b, scalar * v, v * scalar, v / scalar
-	//dot product, cross product
-	//lengthSquared
-	//length
-	//unit(v)
-
-	return 0;
-}
+#include "math3d.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+using Vec2f = math3d::Vec<2, float>;
+using Vec2i = math3d::Vec<2, int>;
+using Vec3f = math3d::Vec<3, float>;
+using Vec3i = math3d::Vec<3, int>;
+using Vec4f = math3d::Vec<4, float>;
+
+template<class VecType, class ScalarType>
+void scalarProductCompileTest() {
+	VecType vec{};
+	ScalarType scalar{ 1 };
+	VecType prod = scalar * vec;
+	prod = vec * scalar;
+	prod = vec / scalar;
+}
+
+template<class VType, class UType, class SumType>
+void sumCompilesTest() {
+	VType v{};
+	UType u{};
+	SumType sum = v + u;
+	sum = u + v;
+	sum = v - u;
+	sum = u - v;
+}
+
+template<class VType, class UType, class ResultType>
+void dotProductCompilesTest() {
+	VType v{};
+	UType u{};
+
+	ResultType product = dotProduct(v, u);
+	product = dotProduct(u, v);
+}
+
+template<size_t Dim, class T>
+void dotProductInterfaceCompilesTest() {
+	math3d::Vec<Dim, T> v{};
+	math3d::Vec<Dim, T> u{};
+	T product = v.dot(u);
+	product = v.lengthSquared();
+	product = v.length();
+}
+
+void pythagoreanTests() {
+	constexpr Vec2f a = { 3, 0 };
+	constexpr Vec2f b = { 0, 4 };
+	constexpr Vec2f c = a + b;
+	static_assert(lengthSquared(c) == 25.0);
+
+	//check other right triangles of pythagorean triples
+}
+
+template<class T>
+void constexprTests() {
+	using Vec2 = math3d::Vec<2, T>;
+	using Vec3 = math3d::Vec<3, T>;
+	using Vec4 = math3d::Vec<4, T>;
+	{
+		constexpr Vec2 zero{};
+		static_assert(sizeof(Vec2) == 2 * sizeof(T));
+		static_assert(zero.x == 0);
+		static_assert(zero.y == 0);
+		static_assert(zero.get<0>() == 0);
+		static_assert(zero.get<1>() == 0);
+	}
+	{
+		constexpr Vec3 zero{};
+		static_assert(sizeof(Vec3) == 3 * sizeof(T));
+		static_assert(zero.x == 0);
+		static_assert(zero.y == 0);
+		static_assert(zero.z == 0);
+		static_assert(zero.get<0>() == 0);
+		static_assert(zero.get<1>() == 0);
+		static_assert(zero.get<2>() == 0);
+	}
+
+	{
+		constexpr Vec4 zero{};
+		static_assert(sizeof(Vec4) == 4 * sizeof(T));
+		static_assert(zero.x == 0);
+		static_assert(zero.y == 0);
+		static_assert(zero.z == 0);
+		static_assert(zero.w == 0);
+		static_assert(zero.get<0>() == 0);
+		static_assert(zero.get<1>() == 0);
+		static_assert(zero.get<2>() == 0);
+		static_assert(zero.get<3>() == 0);
+	}
+}
+
+template<size_t Dim, class T>
+struct TestVec {
+	//This struct is used to provide a vector of dimension Dim
+	//with each component a different value
+};
+
+template<class T>
+struct TestVec<2, T> {
+	static constexpr math3d::Vec<2, T> value{ (T)1.1, (T)2.1 };
+};
+
+template<class T>
+struct TestVec<3, T> {
+	static constexpr math3d::Vec<3, T> value{ (T)1.1, (T)2.1, (T)3.1 };
+};
+
+template<class T>
+struct TestVec<4, T> {
+	static constexpr math3d::Vec<4, T> value{ (T)1.1, (T)2.1, (T)3.1, (T)4.1 };
+};
+
+template<class T>
+struct TestVec<6, T> {
+	static constexpr math3d::Vec<6, T> value{ (T)1.1, (T)2.1, (T)3.1, (T)4.1, (T)5.1, (T)6.1 };
+};
+
+template<class T>
+struct TestVec<9, T> {
+	static constexpr math3d::Vec<9, T> value{ (T)1.1, (T)2.1, (T)3.1, (T)4.1, (T)5.1, (T)6.1, (T)7.1, (T)8.1, (T)9.1 };
+};
+
+template<size_t Dim, class T>
+void equalsTest() {
+
+	using Vec = math3d::Vec<Dim, T>;
+	constexpr Vec a = TestVec<Dim, T>::value;
+	constexpr Vec b = TestVec<Dim, T>::value;
+	constexpr Vec zero{};
+	static_assert(a == b);
+	static_assert(b == a);
+	static_assert((a == b) != (a != b));
+	static_assert(zero == zero);
+	static_assert((zero == zero) != (zero != zero));
+	static_assert(a != zero);
+	static_assert(b != zero);
+	static_assert(zero != a);
+	static_assert((a != zero) != (a == zero));
+}
+
+template<size_t Dim, class T>
+void additiveIdentityTest() {
+	using Vec = math3d::Vec<Dim, T>;
+	constexpr Vec zero{};
+	constexpr Vec a = TestVec<Dim, T>::value;
+	static_assert(a + zero == a);
+	static_assert(zero + a == a);
+	static_assert(a - zero == a);
+}
+
+template<size_t Dim, class T>
+void scalarMultIdentityTest() {
+	using Vec = math3d::Vec<Dim, T>;
+	constexpr Vec a = TestVec<Dim, T>::value;
+	static_assert(1.0f * a == a);
+	static_assert(a * 1.0f == a);
+	static_assert(a / 1.0f == a);
+	static_assert(1.0 * a == a);
+	static_assert(a * 1.0 == a);
+	static_assert(a / 1.0 == a);
+	static_assert(1 * a == a);
+	static_assert(a * 1 == a);
+	static_assert(a / 1 == a);
+}
+
+template<class T, class U, class R>
+void matrix2x2AdditionTest() {
+	using MatT = math3d::Matrix<2, 2, T>;
+	using MatU = math3d::Matrix<2, 2, U>;
+	using MatR = math3d::Matrix<2, 2, R>;
+	constexpr MatT a{ {1, 2}, {3, 4} };
+	constexpr MatU b{ {10, 20}, {30, 40} };
+	constexpr MatT zero{};
+	constexpr MatR sum_ab = a + b;
+	constexpr MatR sum_ba = b + a;
+	static_assert(sum_ab.x.x == 11);
+	static_assert(sum_ab.x.y == 22);
+	static_assert(sum_ab.y.x == 33);
+	static_assert(sum_ab.y.y == 44);
+	static_assert(sum_ab.x.x == sum_ba.x.x);
+	static_assert(sum_ab.x.y == sum_ba.x.y);
+	static_assert(sum_ab.y.x == sum_ba.y.x);
+	static_assert(sum_ab.y.y == sum_ba.y.y);
+
+	constexpr MatR diff_ba = b - a;
+	static_assert(diff_ba.x.x == 9);
+	static_assert(diff_ba.x.y == 18);
+	static_assert(diff_ba.y.x == 27);
+	static_assert(diff_ba.y.y == 36);
+}
+
+
+void matrixProductTest() {
+	using Mat23 = math3d::Matrix<2, 3, int>;
+	using Mat32 = math3d::Matrix<3, 2, int>;
+	using Mat22 = math3d::Matrix<2, 2, int>;
+	using Mat33 = math3d::Matrix<3, 3, int>;
+	constexpr Mat23 a{ {1, 2, 3}, {4, 5, 6} };
+	constexpr Mat32 b{ {7, 8}, {9, 10}, {11, 12} };
+
+	constexpr Mat22 ab = a * b;
+	static_assert(ab == Mat22{ {58, 64}, {139, 154} });
+	constexpr Mat33 ba = b * a;
+	static_assert(ba == Mat33{ {39, 54, 69}, {49, 68, 87}, {59, 82, 105} });
+
+	//matrix-vector, vector on the right is a column
+	constexpr Vec3i v{ 1, 0, -1 };
+	static_assert(a * v == Vec2i{ -2, -2 });
+
+	//vector-matrix, vector on the left is a row
+	constexpr Vec2i w{ 1, -1 };
+	static_assert(w * a == Vec3i{ -3, -3, -3 });
+
+	//vector-vector is the dot product
+	static_assert(v * v == 2);
+	static_assert(w * Vec2i{ 3, 4 } == dotProduct(w, Vec2i{ 3, 4 }));
+
+	//mixed element types
+	constexpr math3d::Matrix<2, 2, float> half{ {0.5f, 0}, {0, 0.5f} };
+	static_assert(half * Vec2i{ 2, 4 } == Vec2f{ 1, 2 });
+}
+
+template<class T>
+void matrix4x4ProductTest() {
+	using Mat4 = math3d::Matrix<4, 4, T>;
+	using Vec4 = math3d::Vec<4, T>;
+	constexpr Mat4 identity{ {1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1} };
+	constexpr Mat4 m{ {1, 2, 3, 4}, {5, 6, 7, 8}, {9, 10, 11, 12}, {13, 14, 15, 16} };
+	constexpr Mat4 translate{ {1, 0, 0, 10}, {0, 1, 0, 20}, {0, 0, 1, 30}, {0, 0, 0, 1} };
+	static_assert(identity * m == m);
+	static_assert(m * identity == m);
+	static_assert(m * m == Mat4{ {90, 100, 110, 120}, {202, 228, 254, 280}, {314, 356, 398, 440}, {426, 484, 542, 600} });
+	static_assert(translate * Vec4{ 1, 2, 3, 1 } == Vec4{ 11, 22, 33, 1 });
+	static_assert(translate * Vec4{ 1, 2, 3, 0 } == Vec4{ 1, 2, 3, 0 });
+	static_assert(Vec4{ 1, 2, 3, 1 } * transpose(translate) == Vec4{ 11, 22, 33, 1 });
+
+	//the runtime (possibly SIMD) path must agree with the constexpr path
+	Mat4 rm = m;
+	Mat4 rt = translate;
+	assert(rm * rm == m * m);
+	assert(rt * rm == translate * m);
+	assert((rt * Vec4{ 1, 2, 3, 1 } == Vec4{ 11, 22, 33, 1 }));
+	assert((Vec4{ 1, 2, 3, 1 } * rm == Vec4{ 1, 2, 3, 1 } * m));
+	assert(transpose(rm) == transpose(m));
+	assert(transpose(transpose(rm)) == m);
+}
+
+void transposeTest() {
+	using Mat23 = math3d::Matrix<2, 3, int>;
+	using Mat32 = math3d::Matrix<3, 2, int>;
+	constexpr Mat23 a{ {1, 2, 3}, {4, 5, 6} };
+	static_assert(transpose(a) == Mat32{ {1, 4}, {2, 5}, {3, 6} });
+	static_assert(transpose(transpose(a)) == a);
+	//(AB)^T = B^T A^T
+	constexpr Mat32 b{ {7, 8}, {9, 10}, {11, 12} };
+	static_assert(transpose(a * b) == transpose(b) * transpose(a));
+}
+
+template<size_t Dim, class T>
+constexpr math3d::Matrix<Dim, Dim, T> scaledIdentity(T s) {
+	math3d::Matrix<Dim, Dim, T> m{};
+	for (size_t i = 0; i < Dim; ++i) {
+		m[i][i] = s;
+	}
+	return m;
+}
+
+void indexTest() {
+	//operator[] reads and writes the named rows and components
+	constexpr Vec3f v{ 1, 2, 3 };
+	static_assert(v[0] == 1 && v[1] == 2 && v[2] == 3);
+	constexpr math3d::Matrix<4, 4, int> m = [] {
+		math3d::Matrix<4, 4, int> m{};
+		for (size_t i = 0; i < 4; ++i) {
+			for (size_t j = 0; j < 4; ++j) {
+				m[i][j] = static_cast<int>(4 * i + j);
+			}
+		}
+		return m;
+	}();
+	static_assert(m.x == math3d::Vec<4, int>{ 0, 1, 2, 3 });
+	static_assert(m.w.z == 14);
+	static_assert(m[2] == m.z);
+	static_assert(m.get<1>().get<3>() == 7);
+
+	Vec4f r{ 1, 2, 3, 4 };
+	r[3] = 5;
+	r.get<0>() = -1;
+	assert((r == Vec4f{ -1, 2, 3, 5 }));
+	const Vec2f c{ 6, 7 };
+	assert(&c[1] == &c.y);
+
+	//explicit conversion between element types
+	static_assert(static_cast<Vec3f>(Vec3i{ 1, -2, 3 }) == Vec3f{ 1, -2, 3 });
+	static_assert(static_cast<math3d::Vec<6, int>>(TestVec<6, float>::value) == math3d::Vec<6, int>{ 1, 2, 3, 4, 5, 6 });
+}
+
+template<class T>
+void genericMatrixTest() {
+	using Vec6 = math3d::Vec<6, T>;
+	using Mat6 = math3d::Matrix<6, 6, T>;
+	//contiguous storage, without padding
+	static_assert(sizeof(Vec6) == 6 * sizeof(T));
+	static_assert(sizeof(Mat6) == 36 * sizeof(T));
+
+	constexpr Vec6 a{ 1, 2, 3, 4, 5, 6 };
+	constexpr Vec6 b{ 6, 5, 4, 3, 2, 1 };
+	static_assert(a + b == Vec6{ 7, 7, 7, 7, 7, 7 });
+	static_assert(a - b == Vec6{ -5, -3, -1, 1, 3, 5 });
+	static_assert(2 * a == a + a);
+	static_assert(a * 3 / 3 == a);
+	static_assert(componentwiseProduct(a, b) == Vec6{ 6, 10, 12, 12, 10, 6 });
+	static_assert(dotProduct(a, b) == 56);
+	static_assert(a * b == 56);
+	static_assert(lengthSquared(a) == 91);
+	static_assert(a[5] == 6 && a.template get<4>() == 5);
+
+	//a 6x6 matrix from its rows
+	constexpr Mat6 identity = scaledIdentity<6>(T{ 1 });
+	constexpr Mat6 m{ a, b, 2 * a, 2 * b, a - b, b - a };
+	static_assert(identity * m == m);
+	static_assert(m * identity == m);
+	static_assert(identity * a == a);
+	static_assert(m * a == Vec6{ 91, 56, 182, 112, 35, -35 });
+	static_assert(a * transpose(m) == m * a);
+	static_assert(transpose(transpose(m)) == m);
+	static_assert(transpose(m)[0] == Vec6{ 1, 6, 2, 12, -5, 5 });
+	static_assert(m + m == 2 * m);
+	static_assert(m - m == Mat6{});
+	static_assert(m != identity);
+
+	//non-square products between the named and the generic specializations
+	constexpr math3d::Matrix<2, 6, T> wide{ a, b };
+	static_assert(wide * transpose(wide) == math3d::Matrix<2, 2, T>{ { 91, 56 }, { 56, 91 } });
+	static_assert(transpose(wide) * wide == math3d::Matrix<6, 6, T>{
+		{ a[0] * a + b[0] * b, a[1] * a + b[1] * b, a[2] * a + b[2] * b, a[3] * a + b[3] * b, a[4] * a + b[4] * b, a[5] * a + b[5] * b } });
+
+	//9 dimensional state vectors
+	constexpr math3d::Vec<9, T> s = TestVec<9, T>::value;
+	static_assert(dotProduct(s, math3d::Vec<9, T>{ 1, 1, 1, 1, 1, 1, 1, 1, 1 }) == s[0] + s[1] + s[2] + s[3] + s[4] + s[5] + s[6] + s[7] + s[8]);
+
+	//the runtime path
+	Mat6 rm = m;
+	Vec6 ra = a;
+	assert(rm * ra == m * a);
+	assert(transpose(rm) == transpose(m));
+	assert(rm * rm == m * m);
+	assert(dotProduct(ra, ra) == 91);
+}
+
+//the componentwise operations do not instantiate one level per component
+void largeDimensionTest() {
+	constexpr auto ones = [] {
+		math3d::Vec<256, int> v;
+		for (size_t i = 0; i < 256; ++i) {
+			v[i] = 1;
+		}
+		return v;
+	}();
+	static_assert(dotProduct(ones, ones) == 256);
+	static_assert(ones + ones == 2 * ones);
+	static_assert(ones - ones == math3d::Vec<256, int>{});
+}
+
+void determinantTest() {
+	using Mat22 = math3d::Matrix<2, 2, int>;
+	using Mat33 = math3d::Matrix<3, 3, int>;
+	using Mat44 = math3d::Matrix<4, 4, int>;
+	constexpr Mat22 a{ {3, 8}, {4, 6} };
+	constexpr Mat33 b{ {6, 1, 1}, {4, -2, 5}, {2, 8, 7} };
+	constexpr Mat44 c{ {1, 0, 2, -1}, {3, 0, 0, 5}, {2, 1, 4, -3}, {1, 0, 5, 0} };
+	static_assert(determinant(a) == -14);
+	static_assert(determinant(b) == -306);
+	static_assert(determinant(c) == 30);
+	static_assert(determinant(transpose(c)) == 30);
+	static_assert(determinant(c * c) == 900);
+	//singular
+	static_assert(determinant(Mat44{ {1, 2, 3, 4}, {5, 6, 7, 8}, {9, 10, 11, 12}, {13, 14, 15, 16} }) == 0);
+
+	//m adj(m) = adj(m) m = |m| I, exactly for integers
+	static_assert(a * adjugate(a) == scaledIdentity<2>(determinant(a)));
+	static_assert(b * adjugate(b) == scaledIdentity<3>(determinant(b)));
+	static_assert(c * adjugate(c) == scaledIdentity<4>(determinant(c)));
+	static_assert(adjugate(c) * c == scaledIdentity<4>(determinant(c)));
+
+	//short promotes like the products do
+	static_assert(std::is_same_v<decltype(determinant(math3d::Matrix<3, 3, short>{})), int>);
+}
+
+template<class T>
+void inverseTest() {
+	using Mat2 = math3d::Matrix<2, 2, T>;
+	using Mat3 = math3d::Matrix<3, 3, T>;
+	using Mat4 = math3d::Matrix<4, 4, T>;
+	//determinant 1 with integer entries, so the inverse is exact
+	constexpr Mat2 a{ {2, 3}, {1, 2} };
+	constexpr Mat3 b{ {1, 2, 3}, {0, 1, 4}, {5, 6, 0} };
+	constexpr Mat4 c{ {1, 2, 0, 0}, {0, 1, 3, 0}, {0, 0, 1, 4}, {0, 0, 0, 1} };
+	static_assert(inverse(a) == Mat2{ {2, -3}, {-1, 2} });
+	static_assert(inverse(b) == Mat3{ {-24, 18, 5}, {20, -15, -4}, {-5, 4, 1} });
+	static_assert(inverse(c) == Mat4{ {1, -2, 6, -24}, {0, 1, -3, 12}, {0, 0, 1, -4}, {0, 0, 0, 1} });
+	static_assert(inverse(inverse(c)) == c);
+
+	//the runtime (possibly SIMD) path
+	Mat4 rc = c;
+	assert(inverse(rc) == inverse(c));
+	Mat4 m{ {2, -1, 0.5, 3}, {0.25, 4, -2, 1}, {1, 1, 5, -0.5}, {-3, 0.5, 1, 6} };
+	Mat4 product = m * inverse(m);
+	Mat4 identity = scaledIdentity<4>(T{ 1 });
+	for (const auto& row : { product.x - identity.x, product.y - identity.y, product.z - identity.z, product.w - identity.w }) {
+		assert(lengthSquared(row) < 1e-10);
+	}
+}
+
+//error of a float result in units of the last place of the exact result
+double ulpError(float actual, double exact) {
+	float rounded = static_cast<float>(exact);
+	double ulp = std::nextafter(rounded, INFINITY) - rounded;
+	return std::abs(actual - exact) / ulp;
+}
+
+template<math3d::Precision P>
+void rsqrtErrorTest(double maxUlp, double maxRelative) {
+	//every 97th float over the whole normal range
+	double worstUlp = 0;
+	double worstRelative = 0;
+	for (uint32_t bits = 0x00800000u; bits < 0x7f000000u; bits += 97) {
+		float x;
+		std::memcpy(&x, &bits, sizeof(x));
+		double exact = 1 / std::sqrt(static_cast<double>(x));
+		float r = rsqrt<P>(x);
+		worstUlp = std::max(worstUlp, ulpError(r, exact));
+		worstRelative = std::max(worstRelative, std::abs(r - exact) / exact);
+	}
+	assert(worstUlp <= maxUlp);
+	assert(worstRelative <= maxRelative);
+
+	//double starts from the float estimate, so it is float accurate unless Full
+	for (double x : { 1e-30, 0.001, 0.5, 1.0, 2.0, 3.0, 12345.678, 1e30 }) {
+		double exact = 1 / std::sqrt(x);
+		double relative = std::abs(rsqrt<P>(x) - exact) / exact;
+		assert(relative <= (P == math3d::Precision::Full ? 1e-15 : maxRelative));
+	}
+}
+
+template<math3d::Precision P, size_t Dim, class T>
+void unitFastTest(double maxRelative) {
+	using Vec = math3d::Vec<Dim, T>;
+	for (int i = 1; i < 200; ++i) {
+		Vec v{};
+		v.x = static_cast<T>(i % 13 - 6);
+		v.y = static_cast<T>(i);
+		if constexpr (Dim > 2) {
+			v.z = static_cast<T>(7 - i % 5);
+		}
+		if constexpr (Dim > 3) {
+			v.w = static_cast<T>(i % 3);
+		}
+		auto fast = unitFast<P>(v);
+		auto exact = unit(math3d::Vec<Dim, double>{} + v);
+		static_assert(std::is_same_v<decltype(fast), math3d::Vec<Dim, RootType<T>>>);
+		//each component is v times the same scale, so the direction is exact and only the length is off
+		assert(std::abs(length(fast) - 1) <= maxRelative + 1e-6);
+		assert(lengthSquared(exact - fast) <= (maxRelative + 1e-6) * (maxRelative + 1e-6));
+	}
+}
+
+void outerProductTest() {
+	constexpr Vec3i a{ 1, 2, 3 };
+	constexpr math3d::Vec<2, int> b{ 4, -5 };
+	static_assert(outerProduct(a, b) == math3d::Matrix<3, 2, int>{ { 4, -5 }, { 8, -10 }, { 12, -15 } });
+	//(a b^T) c = a (b . c) and (a b^T)^T = b a^T
+	constexpr math3d::Vec<2, int> c{ 7, 1 };
+	static_assert(outerProduct(a, b) * c == a * (b * c));
+	static_assert(transpose(outerProduct(a, b)) == outerProduct(b, a));
+	//mixed types follow the scalar product, a 1 vector gives a Vec
+	static_assert(std::is_same_v<decltype(outerProduct(Vec3f{}, a)), math3d::Matrix<3, 3, float>>);
+	static_assert(outerProduct(a, math3d::Vec<1, int>{ 2 }) == Vec3i{ 2, 4, 6 });
+	static_assert(outerProduct(math3d::Vec<6, int>{ 1, 2, 3, 4, 5, 6 }, math3d::Vec<5, int>{ 1, 2, 3, 4, 5 })[5][4] == 30);
+	Vec3f u{ 0.5f, -1, 2 };
+	math3d::Vec<4, float> v{ 1, 2, 3, 4 };
+	auto m = outerProduct(u, v);
+	for (size_t i = 0; i < 3; ++i) {
+		for (size_t j = 0; j < 4; ++j) {
+			assert(m[i][j] == u[i] * v[j]);
+		}
+	}
+}
+
+int main() {
+	//These expressions must compile
+	constexprTests<float>();
+	constexprTests<int>();
+	constexprTests<double>();
+	constexprTests<short>();
+
+	//scalar product defined with same numeric type
+	scalarProductCompileTest<Vec2f, float>();
+	scalarProductCompileTest<Vec2i, int>();
+
+	//scalar product defined with differing numeric types
+	//scalar product conserves Vec type
+	scalarProductCompileTest<Vec2f, int>();
+	scalarProductCompileTest<Vec2i, float>();
+
+	//sum commutes with same result type
+	sumCompilesTest<Vec2i, Vec2i, Vec2i>();
+	sumCompilesTest<Vec2f, Vec2f, Vec2f>();
+	sumCompilesTest<Vec2f, Vec2i, Vec2f>();
+	sumCompilesTest<Vec3f, Vec3f, Vec3f>();
+	sumCompilesTest<Vec3i, Vec3i, Vec3i>();
+	sumCompilesTest<Vec3f, Vec3i, Vec3f>();
+
+	//dot product is defined
+	dotProductCompilesTest<Vec2i, Vec2i, int>();
+	dotProductCompilesTest<Vec3i, Vec3i, int>();
+	dotProductCompilesTest<Vec2f, Vec2f, float>();
+	dotProductCompilesTest<Vec3f, Vec3f, float>();
+	dotProductCompilesTest<Vec3i, Vec3f, float>();
+
+	pythagoreanTests();
+
+	{
+		//cross product defined for 2-Vec
+		Vec2f v{}, u{};
+		auto x = crossProduct(v, u);
+		float f = v.cross(u);
+
+		Vec2i iv{}, iu{};
+		int i = iv.cross(iu);
+	}
+	{
+		constexpr Vec2f v{};
+		constexpr Vec2f normal = v.normal();
+		static_assert(dotProduct(v, normal) == 0);
+	}
+
+	{
+		constexpr Vec3f v{1, 0, 0}, u{0, 1, 0};
+		constexpr Vec3f product = v.cross(u);
+		static_assert(dotProduct(v, product) == 0);
+		static_assert(dotProduct(u, product) == 0);
+		static_assert(lengthSquared(v) * lengthSquared(u) == lengthSquared(product));
+	}
+
+	{
+		constexpr Vec3f v{ 0, 1, 2 };
+		constexpr Vec3f u{ 3, 4, 5 };
+		constexpr Vec3f sum = v + u;
+		static_assert(sum.x == 3);
+		static_assert(sum.y == 5);
+		static_assert(sum.z == 7);
+
+	}
+
+	//operator== and operator!= defined, need tests
+	equalsTest<2, float>();
+	equalsTest<3, float>();
+	equalsTest<4, float>();
+	equalsTest<2, int>();
+	equalsTest<3, int>();
+	equalsTest<4, int>();
+	equalsTest<2, short>();
+	equalsTest<3, short>();
+	equalsTest<4, short>();
+	equalsTest<2, double>();
+	equalsTest<3, double>();
+	equalsTest<4, double>();
+	equalsTest<6, float>();
+	equalsTest<9, int>();
+	equalsTest<6, short>();
+	equalsTest<9, double>();
+	
+	//arithmetic identity tests: a + {0}, a - {0}, 1 * a, a * 1, a / 1, {0} + a
+	additiveIdentityTest<2, float>();
+	additiveIdentityTest<3, float>();
+	additiveIdentityTest<4, float>();
+	additiveIdentityTest<2, int>();
+	additiveIdentityTest<3, int>();
+	additiveIdentityTest<4, int>();
+	additiveIdentityTest<2, double>();
+	additiveIdentityTest<3, double>();
+	additiveIdentityTest<4, double>();
+	additiveIdentityTest<2, short>();
+	additiveIdentityTest<3, short>();
+	additiveIdentityTest<4, short>();
+	additiveIdentityTest<6, float>();
+	additiveIdentityTest<9, double>();
+
+	scalarMultIdentityTest<2, float>();
+	scalarMultIdentityTest<3, float>();
+	scalarMultIdentityTest<4, float>();
+	scalarMultIdentityTest<2, int>();
+	scalarMultIdentityTest<3, int>();
+	scalarMultIdentityTest<4, int>();
+	scalarMultIdentityTest<2, double>();
+	scalarMultIdentityTest<3, double>();
+	scalarMultIdentityTest<4, double>();
+	scalarMultIdentityTest<2, short>();
+	scalarMultIdentityTest<3, short>();
+	scalarMultIdentityTest<4, short>();
+	scalarMultIdentityTest<6, float>();
+	scalarMultIdentityTest<9, int>();
+
+	matrix2x2AdditionTest<int, int, int>();
+	matrix2x2AdditionTest<float, float, float>();
+	matrix2x2AdditionTest<int, float, float>();
+	matrix2x2AdditionTest<double, float, double>();
+
+	matrixProductTest();
+	matrix4x4ProductTest<float>();
+	matrix4x4ProductTest<double>();
+	matrix4x4ProductTest<int>();
+	transposeTest();
+	indexTest();
+	genericMatrixTest<float>();
+	genericMatrixTest<double>();
+	genericMatrixTest<int>();
+	largeDimensionTest();
+	determinantTest();
+	inverseTest<float>();
+	inverseTest<double>();
+
+	//documented error bounds of the rsqrt tiers, see math3d::Precision
+	rsqrtErrorTest<math3d::Precision::Estimate>(6144, 1.5 / 4096);
+	rsqrtErrorTest<math3d::Precision::Refined>(4, 5e-7);
+	rsqrtErrorTest<math3d::Precision::Full>(1.5, 2e-7);
+	unitFastTest<math3d::Precision::Estimate, 2, float>(1.5 / 4096);
+	unitFastTest<math3d::Precision::Estimate, 3, float>(1.5 / 4096);
+	unitFastTest<math3d::Precision::Refined, 3, float>(5e-7);
+	unitFastTest<math3d::Precision::Refined, 4, float>(5e-7);
+	unitFastTest<math3d::Precision::Full, 3, float>(2e-7);
+	unitFastTest<math3d::Precision::Refined, 3, double>(5e-7);
+	unitFastTest<math3d::Precision::Full, 4, double>(0);
+	unitFastTest<math3d::Precision::Refined, 3, int>(5e-7);
+
+	//arithmetic correctness tests: a + b, a - b, scalar * v, v * scalar, v / scalar
+	//dot product, cross product
+	//lengthSquared
+	//length
+	//unit(v)
+
+	outerProductTest();
+	return 0;
+}
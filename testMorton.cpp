@@ -0,0 +1,165 @@
+#include "morton.h"
+#include "testing.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <vector>
+
+using Vec3f = math3d::Vec<3, float>;
+using math3d::Aabb;
+using testing::Random;
+
+//Interleaves bit by bit
+uint64_t reference(uint64_t x, uint64_t y, uint64_t z, int bits) {
+	uint64_t code = 0;
+	for (int b = 0; b < bits; ++b) {
+		code |= (x >> b & 1) << (3 * b) | (y >> b & 1) << (3 * b + 1) | (z >> b & 1) << (3 * b + 2);
+	}
+	return code;
+}
+
+void codeTest() {
+	using math3d::mortonKernels::spread10;
+	using math3d::mortonKernels::spread21;
+	static_assert(spread10(0x3ff) == 0x09249249);
+	static_assert(spread21(0x1fffff) == 0x1249249249249249ull);
+	Random random{ 1 };
+	for (int i = 0; i < 10000; ++i) {
+		const uint64_t x = random.next() & 0x1fffff, y = random.next() & 0x1fffff, z = random.next() & 0x1fffff;
+		assert(spread10(static_cast<uint32_t>(x)) == reference(x & 0x3ff, 0, 0, 10));
+		assert(spread21(x) == reference(x, 0, 0, 21));
+		assert((spread21(x) | spread21(y) << 1 | spread21(z) << 2) == reference(x, y, z, 21));
+	}
+
+	//cells of the 1024 grid are the integer parts of x, y / 2 and z / 4, the upper bound in the last cell
+	const Aabb<float> grid{ { 0, 0, 0 }, { 1024, 2048, 4096 } };
+	assert(morton30(Vec3f{ 0, 0, 0 }, grid) == 0);
+	assert(morton30(Vec3f{ 1024, 2048, 4096 }, grid) == 0x3fffffff);
+	assert(morton63(Vec3f{ 1024, 2048, 4096 }, grid) == 0x7fffffffffffffffull);
+	assert(morton30(Vec3f{ 5.5f, 2 * 7.25f, 4 * 1000.9f }, grid) == reference(5, 7, 1000, 10));
+	assert(morton63(Vec3f{ 5.5f, 2 * 7.25f, 4 * 1000.9f }, grid) == reference(5 * 2048 + 1024, 7 * 2048 + 512, 1000 * 2048 + 1843, 21));
+
+	//outside is clamped, NaN goes to cell 0, a flat axis is all cell 0
+	assert(morton30(Vec3f{ -5, 3000, 1e30f }, grid) == reference(0, 1023, 1023, 10));
+	assert(morton30(Vec3f{ std::nanf(""), 2048, 0 }, grid) == reference(0, 1023, 0, 10));
+	const Aabb<float> flat{ { 0, 1, 0 }, { 1024, 1, 1024 } };
+	assert(morton30(Vec3f{ 1023, 1, 1023 }, flat) == reference(1023, 0, 1023, 10));
+	const Aabb<double> box{ { -1, -1, -1 }, { 1, 1, 1 } };
+	assert(morton63(math3d::Vec<3, double>{ 0, 0, 0 }, box) == reference(1 << 20, 1 << 20, 1 << 20, 21));
+
+	//batched codes are the single codes, for spans, VecArray and on any number of threads
+	std::vector<Vec3f> points(5000);
+	for (auto& p : points) {
+		p = { random.uniform(-3, 7), random.uniform(-3, 7), random.uniform(-3, 7) };
+	}
+	const std::span<const Vec3f> view(points);
+	const math3d::VecArray<3, float> soa(view);
+	const Aabb<float> all = bounds(view);
+	std::vector<uint32_t> codes30(points.size()), soa30(points.size());
+	std::vector<uint64_t> codes63(points.size()), soa63(points.size());
+	morton30(view, all, std::span<uint32_t>(codes30));
+	morton63(view, all, std::span<uint64_t>(codes63));
+	morton30(soa, all, std::span<uint32_t>(soa30));
+	morton63(soa, all, std::span<uint64_t>(soa63));
+	for (size_t i = 0; i < points.size(); ++i) {
+		assert(codes30[i] == morton30(points[i], all) && soa30[i] == codes30[i]);
+		assert(codes63[i] == morton63(points[i], all) && soa63[i] == codes63[i]);
+		assert(codes63[i] >> 33 == codes30[i]);
+	}
+	math3d::ThreadPool pool(3);
+	std::vector<uint64_t> parallel63(points.size());
+	morton63(pool, view, all, std::span<uint64_t>(parallel63));
+	assert(parallel63 == codes63);
+}
+
+template<class Key>
+void sortTest(size_t n, Key mask, uint64_t seed) {
+	Random random{ seed };
+	std::vector<Key> keys(n);
+	for (auto& k : keys) {
+		k = static_cast<Key>(random.next() * 0x9e3779b97f4a7c15ull) & mask;
+	}
+	std::vector<uint32_t> values(n);
+	std::iota(values.begin(), values.end(), uint32_t(0));
+
+	//stable, so equal keys keep their values in order
+	std::vector<std::pair<Key, uint32_t>> expected(n);
+	for (size_t i = 0; i < n; ++i) {
+		expected[i] = { keys[i], values[i] };
+	}
+	std::stable_sort(expected.begin(), expected.end(), [](const auto& a, const auto& b) {
+		return a.first < b.first;
+	});
+
+	std::vector<Key> sortedKeys = keys;
+	std::vector<uint32_t> sortedValues = values;
+	radixSort(std::span<Key>(sortedKeys), std::span<uint32_t>(sortedValues));
+	for (size_t i = 0; i < n; ++i) {
+		assert(sortedKeys[i] == expected[i].first && sortedValues[i] == expected[i].second);
+	}
+	for (size_t threads : { 1, 2, 4 }) {
+		math3d::ThreadPool pool(threads);
+		std::vector<Key> parallelKeys = keys;
+		std::vector<uint32_t> parallelValues = values;
+		radixSort(pool, std::span<Key>(parallelKeys), std::span<uint32_t>(parallelValues));
+		assert(parallelKeys == sortedKeys && parallelValues == sortedValues);
+	}
+}
+
+void permuteTest() {
+	Random random{ 5 };
+	std::vector<Vec3f> points(3000);
+	for (auto& p : points) {
+		p = { std::floor(random.uniform(0, 8)), std::floor(random.uniform(0, 8)), std::floor(random.uniform(0, 8)) };
+	}
+	const std::span<const Vec3f> view(points);
+	const std::vector<uint32_t> order = mortonOrder(view);
+
+	//a permutation along which the codes never decrease, points of the same cell in their original order
+	std::vector<uint32_t> check = order;
+	std::sort(check.begin(), check.end());
+	for (size_t i = 0; i < check.size(); ++i) {
+		assert(check[i] == i);
+	}
+	const Aabb<float> all = bounds(view);
+	for (size_t i = 1; i < order.size(); ++i) {
+		const uint64_t a = morton63(points[order[i - 1]], all);
+		const uint64_t b = morton63(points[order[i]], all);
+		assert(a < b || (a == b && order[i - 1] < order[i]));
+	}
+
+	std::vector<Vec3f> reordered(points.size());
+	permute(std::span<const uint32_t>(order), view, std::span<Vec3f>(reordered));
+	const math3d::VecArray<3, float> soa(view);
+	math3d::VecArray<3, float> soaReordered;
+	permute(std::span<const uint32_t>(order), soa, soaReordered);
+	math3d::ThreadPool pool(2);
+	std::vector<Vec3f> parallel(points.size());
+	permute(pool, std::span<const uint32_t>(order), view, std::span<Vec3f>(parallel));
+	assert(soaReordered.size() == points.size() && mortonOrder(pool, soa) == order);
+	for (size_t i = 0; i < points.size(); ++i) {
+		const Vec3f p = points[order[i]];
+		assert(reordered[i] == p && parallel[i] == p && soaReordered.get(i) == p);
+	}
+
+	//nothing to order
+	assert(mortonOrder(std::span<const Vec3f>()).empty());
+}
+
+int main() {
+	codeTest();
+	for (size_t n : { 0, 1, 2, 100, 70000, 300000 }) {
+		sortTest<uint32_t>(n, 0x3fffffff, n);
+		sortTest<uint64_t>(n, ~uint64_t(0), n + 1);
+	}
+	//few distinct keys, keys that only differ in their high digits, all keys equal
+	sortTest<uint32_t>(100000, 0x7, 2);
+	sortTest<uint64_t>(100000, 0xff00000000000000ull, 3);
+	sortTest<uint16_t>(100000, 0, 4);
+	sortTest<uint8_t>(1000, 0xff, 5);
+	permuteTest();
+	return 0;
+}
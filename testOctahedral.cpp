@@ -0,0 +1,131 @@
+#include "octahedral.h"
+#include <cassert>
+#include <cmath>
+#include <span>
+#include <vector>
+
+using math3d::oct16;
+using math3d::oct32;
+using Vec3f = math3d::Vec<3, float>;
+
+//Unit vectors spread evenly over the sphere, plus the axes, the diagonals and the folds
+std::vector<Vec3f> testNormals(size_t n) {
+	std::vector<Vec3f> normals;
+	const double golden = 3.14159265358979323846 * (3 - std::sqrt(5.0));
+	for (size_t i = 0; i < n; ++i) {
+		double z = 1 - 2 * (i + 0.5) / n;
+		double r = std::sqrt(1 - z * z);
+		double phi = golden * i;
+		normals.push_back(unit(Vec3f{ static_cast<float>(r * std::cos(phi)), static_cast<float>(r * std::sin(phi)), static_cast<float>(z) }));
+	}
+	for (float a : { -1.0f, 0.0f, 1.0f }) {
+		for (float b : { -1.0f, 0.0f, 1.0f }) {
+			for (float c : { -1.0f, -0.0f, 0.0f, 1.0f }) {
+				if (a != 0 || b != 0 || c != 0) {
+					normals.push_back(unit(Vec3f{ a, b, c }));
+				}
+			}
+		}
+	}
+	normals.push_back(unit(Vec3f{ 1e-30f, -1e-30f, -1 }));
+	normals.push_back(unit(Vec3f{ 0.5f, 0.5f, -1e-7f }));
+	return normals;
+}
+
+double angleDegrees(const Vec3f& a, const Vec3f& b) {
+	double dot = 0;
+	double cross[3] = {
+		static_cast<double>(a.y) * b.z - static_cast<double>(a.z) * b.y,
+		static_cast<double>(a.z) * b.x - static_cast<double>(a.x) * b.z,
+		static_cast<double>(a.x) * b.y - static_cast<double>(a.y) * b.x
+	};
+	for (int i = 0; i < 3; ++i) {
+		dot += static_cast<double>(a[i]) * b[i];
+	}
+	double sine = std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+	return std::atan2(sine, dot) * 180 / 3.14159265358979323846;
+}
+
+template<class Oct>
+void errorTest(const std::vector<Vec3f>& normals, double maxDegrees) {
+	double worst = 0;
+	for (const Vec3f& n : normals) {
+		Oct encoded(n);
+		Vec3f decoded = static_cast<Vec3f>(encoded);
+		assert(std::abs(lengthSquared(decoded) - 1) < 4e-7f);
+		double error = angleDegrees(n, decoded);
+		worst = error > worst ? error : worst;
+		//encoding the decoded normal again gives the same direction, though not always
+		//the same bits: on the edges of the square (u, 1) and (-u, 1) are the same point
+		assert(angleDegrees(static_cast<Vec3f>(Oct(decoded)), decoded) < 1e-5);
+	}
+	assert(worst <= maxDegrees);
+}
+
+void encodingTest() {
+	//the poles and the equator are on the corners, edges and center of the square
+	static_assert(oct32(Vec3f{ 0, 0, 1 }) == oct32(0, 0));
+	static_assert(oct32(Vec3f{ 1, 0, 0 }) == oct32(32767, 0));
+	static_assert(oct32(Vec3f{ 0, -1, 0 }) == oct32(0, -32767));
+	static_assert(oct16(Vec3f{ 0.6f, 0.8f, 0 }) == oct16(54, 73));
+	static_assert(oct32(Vec3f{ 0, 0, -1 }) == oct32(32767, 32767));
+	static_assert(oct32(Vec3f{ -1e-30f, -1e-30f, -1 }) == oct32(-32767, -32767));
+	static_assert(oct16(Vec3f{ 0, 0, -1 }) == oct16(127, 127));
+	assert(static_cast<Vec3f>(oct32(0, 0)) == (Vec3f{ 0, 0, 1 }));
+	assert(static_cast<Vec3f>(oct32(-32767, 0)) == (Vec3f{ -1, 0, 0 }));
+	assert(static_cast<Vec3f>(oct16(-127, -127)) == (Vec3f{ 0, 0, -1 }));
+	//the lowest integer decodes like lowest + 1
+	assert(static_cast<Vec3f>(oct16(-128, 5)) == static_cast<Vec3f>(oct16(-127, 5)));
+	assert(static_cast<Vec3f>(oct32(-32768, 5)) == static_cast<Vec3f>(oct32(-32767, 5)));
+	//only the direction matters
+	assert(oct32(Vec3f{ 3, -4, 12 }) == oct32(unit(Vec3f{ 3, -4, 12 })));
+}
+
+template<class Oct>
+void bulkTest(const std::vector<Vec3f>& normals) {
+	const size_t n = normals.size();
+	std::vector<Oct> packed(n);
+	pack(std::span<const Vec3f>(normals), std::span<Oct>(packed));
+	std::vector<Vec3f> unpacked(n);
+	unpack(std::span<const Oct>(packed), std::span<Vec3f>(unpacked));
+	for (size_t i = 0; i < n; ++i) {
+		assert(packed[i] == Oct(normals[i]));
+		//bit identical unless the compiler contracts the scalar length into an FMA
+		assert(lengthSquared(unpacked[i] - static_cast<Vec3f>(packed[i])) <= 1e-12f);
+	}
+
+	const math3d::VecArray<3, float> soa{ std::span<const Vec3f>(normals) };
+	std::vector<Oct> soaPacked(n);
+	pack(soa, std::span<Oct>(soaPacked));
+	math3d::VecArray<3, float> soaUnpacked;
+	unpack(std::span<const Oct>(soaPacked), soaUnpacked);
+	assert(soaUnpacked.size() == n);
+	for (size_t i = 0; i < n; ++i) {
+		assert(soaPacked[i] == packed[i]);
+		assert(soaUnpacked.get(i) == unpacked[i]);
+	}
+
+	//every length around the 8 wide kernels, and unaligned starts
+	for (size_t count = 0; count < 20; ++count) {
+		for (size_t offset = 0; offset < 3; ++offset) {
+			std::vector<Oct> out(count);
+			std::vector<Vec3f> back(count);
+			pack(std::span<const Vec3f>(normals).subspan(offset, count), std::span<Oct>(out));
+			unpack(std::span<const Oct>(out), std::span<Vec3f>(back));
+			for (size_t i = 0; i < count; ++i) {
+				assert(out[i] == packed[offset + i]);
+				assert(back[i] == unpacked[offset + i]);
+			}
+		}
+	}
+}
+
+int main() {
+	encodingTest();
+	const auto normals = testNormals(200000);
+	errorTest<oct32>(normals, 0.0037);
+	errorTest<oct16>(normals, 0.94);
+	bulkTest<oct32>(normals);
+	bulkTest<oct16>(normals);
+	return 0;
+}
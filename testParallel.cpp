@@ -0,0 +1,248 @@
+#include "parallel.h"
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+using Vec3f = math3d::Vec<3, float>;
+using Vec4f = math3d::Vec<4, float>;
+using Mat4f = math3d::Matrix<4, 4, float>;
+
+template<size_t Dim, class T>
+std::vector<math3d::Vec<Dim, T>> makeVecs(size_t n, int seed) {
+	std::vector<math3d::Vec<Dim, T>> v(n);
+	for (size_t i = 0; i < n; ++i) {
+		for (size_t c = 0; c < Dim; ++c) {
+			v[i][c] = static_cast<T>(std::sin(static_cast<double>(i * Dim + c + seed)) * 100);
+		}
+	}
+	return v;
+}
+
+//the math3d operators are global, so std::vector::operator== cannot find them
+template<size_t Dim, class T>
+bool same(const std::vector<math3d::Vec<Dim, T>>& a, const std::vector<math3d::Vec<Dim, T>>& b) {
+	if (a.size() != b.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < a.size(); ++i) {
+		if (a[i] != b[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+template<size_t Dim, class T>
+bool same(const math3d::VecArray<Dim, T>& a, const math3d::VecArray<Dim, T>& b) {
+	if (a.size() != b.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < a.size(); ++i) {
+		if (a.get(i) != b.get(i)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void parallelForTest(math3d::ThreadPool& pool) {
+	for (size_t count : { 0, 1, 63, 64, 65, 1000, 100000 }) {
+		for (size_t grain : { 1, 7, 64, 4096 }) {
+			std::vector<std::atomic<int>> visits(count);
+			math3d::parallelFor(pool, count, grain, [&](size_t begin, size_t end) {
+				assert(begin < end && end <= count && end - begin <= grain);
+				for (size_t i = begin; i < end; ++i) {
+					visits[i].fetch_add(1);
+				}
+			});
+			for (auto& v : visits) {
+				assert(v.load() == 1);
+			}
+		}
+	}
+
+	//a job started from inside another one
+	std::atomic<size_t> total{ 0 };
+	math3d::parallelFor(pool, 16, 1, [&](size_t, size_t) {
+		math3d::parallelFor(pool, 1000, 10, [&](size_t begin, size_t end) {
+			total.fetch_add(end - begin);
+		});
+	});
+	assert(total.load() == 16000);
+
+	//the first exception reaches the caller, after every chunk has finished
+	std::atomic<size_t> finished{ 0 };
+	bool caught = false;
+	try {
+		math3d::parallelFor(pool, 100, 1, [&](size_t begin, size_t) {
+			if (begin == 37) {
+				throw std::runtime_error("chunk 37");
+			}
+			finished.fetch_add(1);
+		});
+	}
+	catch (const std::runtime_error&) {
+		caught = true;
+	}
+	assert(caught);
+	assert(finished.load() == 99);
+}
+
+void parallelReduceTest() {
+	//a sum that rounds differently in every order
+	const size_t n = 1000003;
+	std::vector<float> values(n);
+	for (size_t i = 0; i < n; ++i) {
+		values[i] = static_cast<float>(std::sin(static_cast<double>(i))) * (i % 2 ? 1e4f : 1e-3f);
+	}
+	auto sum = [&](math3d::ThreadPool& pool) {
+		return math3d::parallelReduce(pool, n, 4096, 0.0f, [&](size_t begin, size_t end) {
+			float s = 0;
+			for (size_t i = begin; i < end; ++i) {
+				s += values[i];
+			}
+			return s;
+		}, [](float a, float b) { return a + b; });
+	};
+	math3d::ThreadPool one(1);
+	const float expected = sum(one);
+	for (size_t threads : { 2, 3, 8 }) {
+		math3d::ThreadPool pool(threads);
+		for (int repeat = 0; repeat < 5; ++repeat) {
+			float s = sum(pool);
+			assert(std::memcmp(&s, &expected, sizeof(float)) == 0);
+		}
+	}
+	//the same chunks and tree on the calling thread
+	const float sequential = math3d::sequentialReduce(n, 4096, 0.0f, [&](size_t begin, size_t end) {
+		float s = 0;
+		for (size_t i = begin; i < end; ++i) {
+			s += values[i];
+		}
+		return s;
+	}, [](float a, float b) { return a + b; });
+	assert(std::memcmp(&sequential, &expected, sizeof(float)) == 0);
+	double exact = 0;
+	for (float v : values) {
+		exact += v;
+	}
+	assert(std::abs(expected - exact) <= 1e-5 * std::abs(exact) + 1);
+
+	//empty range
+	assert(math3d::parallelReduce(one, 0, 64, 42, [](size_t, size_t) { return 0; }, [](int a, int b) { return a + b; }) == 42);
+}
+
+void batchedTest(math3d::ThreadPool& pool, size_t n) {
+	const auto va = makeVecs<3, float>(n, 0);
+	const auto vb = makeVecs<3, float>(n, 5);
+	const math3d::VecArray<3, float> a{ std::span<const Vec3f>(va) };
+	const math3d::VecArray<3, float> b{ std::span<const Vec3f>(vb) };
+
+	math3d::VecArray<3, float> out;
+	add(pool, a, b, out);
+	assert(same(out, a + b));
+	subtract(pool, a, b, out);
+	assert(same(out, a - b));
+	scale(pool, a, 2.5f, out);
+	assert(same(out, a * 2.5f));
+	scale(pool, out, 0.5f, out);
+	assert(same(out, a * 2.5f * 0.5f));
+
+	//out may be either input
+	math3d::VecArray<3, float> inPlace = a;
+	add(pool, inPlace, b, inPlace);
+	assert(same(inPlace, a + b));
+	subtract(pool, a, inPlace, inPlace);
+	assert(same(inPlace, a - (a + b)));
+	add(pool, inPlace, inPlace, inPlace);
+	assert(same(inPlace, (a - (a + b)) + (a - (a + b))));
+
+	std::vector<float> dots(n);
+	std::vector<float> expected(n);
+	dotProduct(pool, a, b, std::span<float>(dots));
+	dotProduct(a, b, std::span<float>(expected));
+	assert(dots == expected);
+
+	math3d::VecArray<3, float> axpyOut = b;
+	math3d::VecArray<3, float> axpyExpected = b;
+	axpy(pool, -1.5f, a, axpyOut);
+	axpy(-1.5f, a, axpyExpected);
+	assert(same(axpyOut, axpyExpected));
+	std::vector<Vec3f> axpyAoS = vb;
+	std::vector<Vec3f> axpyAoSExpected = vb;
+	axpy(pool, 0.25, std::span<const Vec3f>(va), std::span<Vec3f>(axpyAoS));
+	axpy(0.25, std::span<const Vec3f>(va), std::span<Vec3f>(axpyAoSExpected));
+	assert(same(axpyAoS, axpyAoSExpected));
+
+	math3d::VecArray<3, float> unitOut;
+	math3d::VecArray<3, float> unitExpected;
+	unit(pool, a, unitOut);
+	unit(a, unitExpected);
+	assert(same(unitOut, unitExpected));
+
+	const Mat4f m{ { 0.36f, 0.48f, -0.8f, 10 }, { -0.8f, 0.6f, 0, -20 }, { 0.48f, 0.64f, 0.6f, 30.5f }, { 0, 0, 0, 1 } };
+	std::vector<Vec3f> points(n);
+	std::vector<Vec3f> pointsExpected(n);
+	for (auto mode : { math3d::StoreMode::Cached, math3d::StoreMode::Streaming }) {
+		transformPoints(pool, m, std::span<const Vec3f>(va), std::span<Vec3f>(points), mode);
+		transformPoints(m, std::span<const Vec3f>(va), std::span<Vec3f>(pointsExpected), mode);
+		assert(same(points, pointsExpected));
+		transformDirections(pool, m, std::span<const Vec3f>(va), std::span<Vec3f>(points), mode);
+		transformDirections(m, std::span<const Vec3f>(va), std::span<Vec3f>(pointsExpected), mode);
+		assert(same(points, pointsExpected));
+
+		math3d::VecArray<3, float> soa;
+		math3d::VecArray<3, float> soaExpected;
+		transformPoints(pool, m, a, soa, mode);
+		transformPoints(m, a, soaExpected, mode);
+		assert(same(soa, soaExpected));
+		transformDirections(pool, m, a, soa, mode);
+		transformDirections(m, a, soaExpected, mode);
+		assert(same(soa, soaExpected));
+	}
+
+	const auto v4 = makeVecs<4, float>(n, 2);
+	std::vector<Vec4f> out4(n);
+	std::vector<Vec4f> expected4(n);
+	transformPoints(pool, m, std::span<const Vec4f>(v4), std::span<Vec4f>(out4));
+	transformPoints(m, std::span<const Vec4f>(v4), std::span<Vec4f>(expected4));
+	assert(same(out4, expected4));
+
+	//double goes through the single functions
+	const auto vd = makeVecs<3, double>(n, 1);
+	const math3d::VecArray<3, double> ad{ std::span<const math3d::Vec<3, double>>(vd) };
+	math3d::VecArray<3, double> outd;
+	math3d::VecArray<3, double> expectedd;
+	transformPoints(pool, math3d::Matrix<4, 4, double>{ { 1, 0, 0, 1 }, { 0, 2, 0, 2 }, { 0, 0, 3, 3 }, { 0, 0, 0, 1 } }, ad, outd);
+	transformPoints(math3d::Matrix<4, 4, double>{ { 1, 0, 0, 1 }, { 0, 2, 0, 2 }, { 0, 0, 3, 3 }, { 0, 0, 0, 1 } }, ad, expectedd);
+	assert(same(outd, expectedd));
+}
+
+int main() {
+	for (size_t threads : { 1, 2, 4, 7 }) {
+		math3d::ThreadPool pool(threads);
+		assert(pool.concurrency() == threads);
+		parallelForTest(pool);
+		//sizes around the chunk sizes and the SIMD widths
+		for (size_t n : { 0, 1, 7, 63, 5440, 5441, 50000 }) {
+			batchedTest(pool, n);
+		}
+	}
+	parallelReduceTest();
+	batchedTest(math3d::ThreadPool::global(), 20000);
+
+	//parallelTransform with any batched span function
+	std::vector<float> in(30000, 4.0f);
+	std::vector<float> out(in.size());
+	math3d::parallelTransform(std::span<const float>(in), std::span<float>(out), [](auto i, auto o) {
+		rsqrt<math3d::Precision::Full>(i, o);
+	});
+	for (float f : out) {
+		assert(f == 0.5f);
+	}
+	return 0;
+}
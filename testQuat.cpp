@@ -0,0 +1,186 @@
+#include "quat.h"
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+using Quatf = math3d::Quat<float>;
+using Quatd = math3d::Quat<double>;
+using Vec3f = math3d::Vec<3, float>;
+using Mat3f = math3d::Matrix<3, 3, float>;
+
+template<class T>
+T runtime(const T& t) {
+	//keeps the optimizer from folding the operation into a constant
+	volatile bool pass = true;
+	return pass ? t : T{};
+}
+
+template<size_t Dim, class T>
+bool near(const math3d::Vec<Dim, T>& a, const math3d::Vec<Dim, T>& b, double tolerance = 1e-5) {
+	return lengthSquared(a - b) <= tolerance * tolerance;
+}
+
+template<class T>
+bool near(const math3d::Quat<T>& a, const math3d::Quat<T>& b, double tolerance = 1e-5) {
+	return near(a.xyzw, b.xyzw, tolerance);
+}
+
+//q and -q are the same rotation
+template<class T>
+bool sameRotation(const math3d::Quat<T>& a, const math3d::Quat<T>& b, double tolerance = 1e-5) {
+	return near(a, b, tolerance) || near(a.xyzw, b.xyzw * T{ -1 }, tolerance);
+}
+
+bool near(const Mat3f& a, const Mat3f& b) {
+	return near(a.x, b.x) && near(a.y, b.y) && near(a.z, b.z);
+}
+
+std::vector<Quatf> makeRotations(size_t n) {
+	std::vector<Quatf> q(n);
+	for (size_t i = 0; i < n; ++i) {
+		float f = static_cast<float>(i);
+		Vec3f axis = unit(Vec3f{ std::sin(f), std::cos(f * 0.7f), 0.5f - std::sin(f * 1.3f) });
+		q[i] = Quatf::axisAngle(axis, f * 0.37f - 3);
+	}
+	return q;
+}
+
+void exactTest() {
+	//a third of a turn about (1, 1, 1) cycles the axes, every component is exact
+	constexpr Quatf identity{};
+	constexpr Quatf q{ { 0.5f, 0.5f, 0.5f, 0.5f } };
+	static_assert(identity * q == q);
+	static_assert(q * identity == q);
+	static_assert(conjugate(q) * q == identity);
+	static_assert(q * q * q == Quatf{ { 0, 0, 0, -1 } });
+	static_assert(rotate(q, Vec3f{ 1, 0, 0 }) == Vec3f{ 0, 1, 0 });
+	static_assert(rotate(q, Vec3f{ 0, 1, 0 }) == Vec3f{ 0, 0, 1 });
+	static_assert(toMatrix3x3(q) == Mat3f{ { 0, 0, 1 }, { 1, 0, 0 }, { 0, 1, 0 } });
+	static_assert(toMatrix3x3(q) * Vec3f{ 2, 3, 4 } == rotate(q, Vec3f{ 2, 3, 4 }));
+	static_assert(toMatrix4x4(q).w == math3d::Vec<4, float>{ 0, 0, 0, 1 });
+	static_assert(sizeof(Quatf) == sizeof(math3d::Vec<4, float>));
+	static_assert(alignof(Quatf) == 16);
+
+	//the runtime (possibly SIMD) product
+	assert(runtime(q) * runtime(q) * runtime(q) == (Quatf{ { 0, 0, 0, -1 } }));
+	assert(conjugate(runtime(q)) * runtime(q) == identity);
+	assert(toQuat(toMatrix3x3(runtime(q))) == q);
+}
+
+void rotationTest() {
+	auto rotations = makeRotations(200);
+	constexpr Vec3f v{ 1.5f, -2, 0.25f };
+	for (size_t i = 0; i + 1 < rotations.size(); ++i) {
+		const Quatf& a = rotations[i];
+		const Quatf& b = rotations[i + 1];
+		//matches the matrix and composes like it
+		assert(near(rotate(a, v), toMatrix3x3(a) * v));
+		assert(near(toMatrix3x3(a * b), toMatrix3x3(a) * toMatrix3x3(b)));
+		assert(near(rotate(a * b, v), rotate(a, rotate(b, v))));
+		assert(near(rotate(conjugate(a), rotate(a, v)), v));
+		//round trips through every branch of toQuat
+		assert(sameRotation(toQuat(toMatrix3x3(a)), a));
+		assert(sameRotation(toQuat(toMatrix4x4(a)), a));
+	}
+	//half turns, where the trace is -1
+	for (Vec3f axis : { Vec3f{ 1, 0, 0 }, Vec3f{ 0, 1, 0 }, Vec3f{ 0, 0, 1 }, unit(Vec3f{ 1, -2, 3 }) }) {
+		Quatf q = Quatf::axisAngle(axis, 3.14159265f);
+		assert(sameRotation(toQuat(toMatrix3x3(q)), q));
+	}
+	//double
+	Quatd d = Quatd::axisAngle({ 0, 0, 1 }, 0.5);
+	assert(near(rotate(d, math3d::Vec<3, double>{ 1, 0, 0 }), math3d::Vec<3, double>{ std::cos(0.5), std::sin(0.5), 0 }, 1e-12));
+}
+
+void interpolationTest() {
+	Quatf a = Quatf::axisAngle({ 0, 0, 1 }, 0.25f);
+	Quatf b = Quatf::axisAngle({ 0, 0, 1 }, 1.75f);
+	//slerp moves at constant speed
+	assert(near(slerp(a, b, 0.5f), Quatf::axisAngle({ 0, 0, 1 }, 1.0f)));
+	assert(near(slerp(a, b, 0.25f), Quatf::axisAngle({ 0, 0, 1 }, 0.625f)));
+	assert(near(slerp(a, b, 0.0f), a));
+	assert(near(slerp(a, b, 1.0f), b));
+	//nlerp is exact at the ends and the midpoint
+	assert(near(nlerp(a, b, 0.5f), Quatf::axisAngle({ 0, 0, 1 }, 1.0f)));
+	assert(near(nlerp(a, b, 1.0f), b));
+	//the shorter arc is taken through -b
+	Quatf negated{ b.xyzw * -1.0f };
+	assert(sameRotation(slerp(a, negated, 0.5f), Quatf::axisAngle({ 0, 0, 1 }, 1.0f)));
+	assert(sameRotation(nlerp(a, negated, 0.5f), Quatf::axisAngle({ 0, 0, 1 }, 1.0f)));
+	//nearly equal rotations
+	assert(near(slerp(a, a, 0.3f), a));
+}
+
+void batchedTest(size_t n) {
+	auto a = makeRotations(n);
+	auto b = makeRotations(n + 7);
+	b.erase(b.begin(), b.begin() + 7);
+	std::vector<float> t(n);
+	for (size_t i = 0; i < n; ++i) {
+		t[i] = static_cast<float>(i % 11) / 10;
+	}
+	std::span<const Quatf> sa(a);
+	std::span<const Quatf> sb(b);
+	std::vector<Quatf> out(n);
+
+	nlerp(sa, sb, 0.3f, std::span<Quatf>(out));
+	for (size_t i = 0; i < n; ++i) {
+		assert(near(out[i], nlerp(a[i], b[i], 0.3f)));
+	}
+	nlerp(sa, sb, std::span<const float>(t), std::span<Quatf>(out));
+	for (size_t i = 0; i < n; ++i) {
+		assert(near(out[i], nlerp(a[i], b[i], t[i])));
+	}
+	//the batched slerp replaces acos and sin by a polynomial
+	slerp(sa, sb, 0.3f, std::span<Quatf>(out));
+	for (size_t i = 0; i < n; ++i) {
+		assert(near(out[i], slerp(a[i], b[i], 0.3f), 2e-6));
+	}
+	slerp(sa, sb, std::span<const float>(t), std::span<Quatf>(out));
+	for (size_t i = 0; i < n; ++i) {
+		assert(near(out[i], slerp(a[i], b[i], t[i]), 2e-6));
+	}
+	//in place
+	std::vector<Quatf> inPlace = a;
+	slerp(std::span<const Quatf>(inPlace), sb, std::span<const float>(t), std::span<Quatf>(inPlace));
+	for (size_t i = 0; i < n; ++i) {
+		assert(inPlace[i] == out[i]);
+	}
+
+	//double uses the single functions
+	std::vector<Quatd> da(n, Quatd::axisAngle({ 1, 0, 0 }, 0.5));
+	std::vector<Quatd> db(n, Quatd::axisAngle({ 1, 0, 0 }, 1.5));
+	std::vector<Quatd> dout(n);
+	slerp(std::span<const Quatd>(da), std::span<const Quatd>(db), 0.5, std::span<Quatd>(dout));
+	for (auto& q : dout) {
+		assert(near(q, Quatd::axisAngle({ 1, 0, 0 }, 1.0), 1e-12));
+	}
+
+	//many vectors by one rotation
+	std::vector<Vec3f> vecs(n);
+	for (size_t i = 0; i < n; ++i) {
+		vecs[i] = { static_cast<float>(i), 1, -0.5f * static_cast<float>(i) };
+	}
+	std::vector<Vec3f> rotated(n);
+	rotate(a.empty() ? Quatf{} : a[0], std::span<const Vec3f>(vecs), std::span<Vec3f>(rotated));
+	math3d::VecArray<3, float> soa{ std::span<const Vec3f>(vecs) };
+	math3d::VecArray<3, float> soaRotated;
+	rotate(a.empty() ? Quatf{} : a[0], soa, soaRotated);
+	for (size_t i = 0; i < n; ++i) {
+		Vec3f expected = rotate(a[0], vecs[i]);
+		double tolerance = 1e-5 * (1 + length(vecs[i]));
+		assert(near(rotated[i], expected, tolerance));
+		assert(near(soaRotated.get(i), expected, tolerance));
+	}
+}
+
+int main() {
+	exactTest();
+	rotationTest();
+	interpolationTest();
+	//sizes around the 4 wide kernel and its tail
+	for (size_t n : { 0, 1, 3, 4, 5, 8, 17, 100 }) {
+		batchedTest(n);
+	}
+	return 0;
+}
@@ -0,0 +1,243 @@
+#include "reduce.h"
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <span>
+#include <vector>
+
+using Vec3f = math3d::Vec<3, float>;
+using Vec3d = math3d::Vec<3, double>;
+
+//A correlated, elongated cloud far from the origin, like a scan in world coordinates
+template<class T>
+std::vector<math3d::Vec<3, T>> makeCloud(size_t n) {
+	std::vector<math3d::Vec<3, T>> points(n);
+	for (size_t i = 0; i < n; ++i) {
+		const double a = std::sin(i * 0.7071 + 0.3);
+		const double b = std::sin(i * 1.3137 + 1.1);
+		const double c = std::sin(i * 2.2361 + 0.7);
+		points[i] = { static_cast<T>(4000 + 20 * a + 3 * b), static_cast<T>(-12000 + 5 * b - 2 * a), static_cast<T>(300 + c + 0.5 * a) };
+	}
+	return points;
+}
+
+template<class T>
+bool sameBits(const T& a, const T& b) {
+	return std::memcmp(&a, &b, sizeof(T)) == 0;
+}
+
+//Two passes in double over the whole set
+template<class T>
+void reference(const std::vector<math3d::Vec<3, T>>& points, math3d::Aabb<T>& box, Vec3d& mean, double (&cov)[3][3]) {
+	box = {};
+	mean = {};
+	for (const auto& p : points) {
+		box.grow(p);
+		for (size_t k = 0; k < 3; ++k) {
+			mean[k] += p[k];
+		}
+	}
+	for (size_t k = 0; k < 3; ++k) {
+		mean[k] /= points.size();
+	}
+	for (size_t r = 0; r < 3; ++r) {
+		for (size_t c = 0; c < 3; ++c) {
+			cov[r][c] = 0;
+			for (const auto& p : points) {
+				cov[r][c] += (p[r] - mean[r]) * (p[c] - mean[c]);
+			}
+			cov[r][c] /= points.size();
+		}
+	}
+}
+
+template<class T>
+void accuracyTest(size_t n, double tolerance) {
+	const auto points = makeCloud<T>(n);
+	const std::span<const math3d::Vec<3, T>> view(points);
+	math3d::Aabb<T> box;
+	Vec3d mean;
+	double cov[3][3];
+	reference(points, box, mean, cov);
+
+	assert(bounds(view) == box);
+	const auto total = sum(view);
+	const auto center = centroid(view);
+	const auto c = covariance(view);
+	for (size_t r = 0; r < 3; ++r) {
+		assert(std::abs(total[r] / n - mean[r]) <= tolerance * std::abs(mean[r]));
+		assert(std::abs(center[r] - mean[r]) <= tolerance * std::abs(mean[r]));
+		for (size_t k = 0; k < 3; ++k) {
+			//relative to the spread, the offset of the cloud does not matter
+			assert(std::abs(c[r][k] - cov[r][k]) <= tolerance * std::sqrt(cov[r][r] * cov[k][k]));
+		}
+	}
+	assert(c[0][1] == c[1][0] && c[0][2] == c[2][0] && c[1][2] == c[2][1]);
+
+	const auto all = statistics(view);
+	assert(all.count == n);
+	assert(all.bounds == box);
+	for (size_t r = 0; r < 3; ++r) {
+		assert(std::abs(all.centroid[r] - mean[r]) <= tolerance * std::abs(mean[r]));
+		for (size_t k = 0; k < 3; ++k) {
+			assert(sameBits(all.covariance[r][k], c[r][k]));
+		}
+	}
+}
+
+//Every thread count, and SoA or AoS, gives the same bits as the single threaded functions
+void determinismTest(size_t n) {
+	const auto points = makeCloud<float>(n);
+	const std::span<const Vec3f> view(points);
+	const math3d::VecArray<3, float> soa{ view };
+	const auto box = bounds(view);
+	const auto total = sum(view);
+	const auto mean = centroid(view);
+	const auto cov = covariance(view);
+	const auto all = statistics(view);
+
+	assert(bounds(soa) == box);
+	assert(sameBits(sum(soa), total));
+	assert(sameBits(centroid(soa), mean));
+	assert(sameBits(covariance(soa), cov));
+	for (size_t threads : { 1, 2, 3, 4, 7 }) {
+		math3d::ThreadPool pool(threads);
+		for (int repeat = 0; repeat < 3; ++repeat) {
+			assert(bounds(pool, view) == box);
+			assert(bounds(pool, soa) == box);
+			assert(sameBits(sum(pool, view), total));
+			assert(sameBits(sum(pool, soa), total));
+			assert(sameBits(centroid(pool, view), mean));
+			assert(sameBits(centroid(pool, soa), mean));
+			assert(sameBits(covariance(pool, view), cov));
+			assert(sameBits(covariance(pool, soa), cov));
+			const auto parallel = statistics(pool, soa);
+			assert(parallel.count == all.count && parallel.bounds == all.bounds);
+			assert(sameBits(parallel.centroid, all.centroid) && sameBits(parallel.covariance, all.covariance));
+		}
+	}
+}
+
+void smallTest() {
+	//empty
+	const std::span<const Vec3f> none;
+	assert(bounds(none).empty());
+	assert(sum(none) == (Vec3d{ 0, 0, 0 }));
+	assert(centroid(none) == (Vec3f{ 0, 0, 0 }));
+	assert(covariance(none) == (math3d::Matrix<3, 3, float>{}));
+	assert(statistics(none).count == 0 && statistics(none).bounds.empty());
+
+	//a single point
+	const Vec3f one[] = { { 1, -2, 3 } };
+	const auto box = bounds(std::span<const Vec3f>(one));
+	assert(!box.empty() && box.lower == one[0] && box.upper == one[0]);
+	assert(centroid(std::span<const Vec3f>(one)) == one[0]);
+	assert(covariance(std::span<const Vec3f>(one)) == (math3d::Matrix<3, 3, float>{}));
+
+	//every length around the 8 wide kernels, from unaligned starts
+	const auto points = makeCloud<float>(64);
+	for (size_t count = 1; count < 40; ++count) {
+		for (size_t offset = 0; offset < 3; ++offset) {
+			const auto part = std::span<const Vec3f>(points).subspan(offset, count);
+			math3d::Aabb<float> expected;
+			for (const Vec3f& p : part) {
+				expected.grow(p);
+			}
+			assert(bounds(part) == expected);
+			const math3d::VecArray<3, float> soa{ part };
+			assert(bounds(soa) == expected);
+			assert(sameBits(covariance(soa), covariance(part)));
+		}
+	}
+
+	math3d::Aabb<float> a;
+	a.grow(Vec3f{ 1, 2, 3 }).grow(Vec3f{ -1, 4, 0 });
+	assert(a.center() == (Vec3f{ 0, 3, 1.5f }));
+	assert(a.extent() == (Vec3f{ 2, 2, 3 }));
+}
+
+//Normal equations of a least squares fit, and every thread count giving the same bits
+void outerProductTest(size_t n) {
+	using Vec4f = math3d::Vec<4, float>;
+	const auto cloud = makeCloud<float>(n);
+	std::vector<Vec4f> rows(n);
+	for (size_t i = 0; i < n; ++i) {
+		rows[i] = { (cloud[i].x - 4000) / 20, (cloud[i].y + 12000) / 5, cloud[i].z - 300, 1 };
+	}
+	const std::span<const Vec3f> a(cloud);
+	const std::span<const Vec4f> b(rows);
+	double expected[3][4] = {};
+	double normA[3] = {};
+	double normB[4] = {};
+	for (size_t i = 0; i < n; ++i) {
+		for (size_t r = 0; r < 3; ++r) {
+			normA[r] += static_cast<double>(a[i][r]) * a[i][r];
+			for (size_t c = 0; c < 4; ++c) {
+				expected[r][c] += static_cast<double>(a[i][r]) * b[i][c];
+			}
+		}
+		for (size_t c = 0; c < 4; ++c) {
+			normB[c] += static_cast<double>(b[i][c]) * b[i][c];
+		}
+	}
+	const math3d::VecArray<3, float> sa{ a };
+	const math3d::VecArray<4, float> sb{ b };
+	//m is accumulated into
+	math3d::Matrix<3, 4, double> aos{ { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 } };
+	math3d::Matrix<3, 4, double> soa;
+	addOuterProducts(a, b, aos);
+	addOuterProducts(sa, sb, soa);
+	for (size_t r = 0; r < 3; ++r) {
+		for (size_t c = 0; c < 4; ++c) {
+			//relative to |a_r| |b_c|, the largest the sum can be
+			const double scale = std::sqrt(normA[r] * normB[c]);
+			assert(std::abs(aos[r][c] - (r == c) - expected[r][c]) <= 1e-6 * scale);
+			assert(std::abs(soa[r][c] - expected[r][c]) <= 1e-6 * scale);
+		}
+	}
+	for (size_t threads : { 1, 2, 3, 7 }) {
+		math3d::ThreadPool pool(threads);
+		math3d::Matrix<3, 4, double> parallelAoS{ { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 } };
+		math3d::Matrix<3, 4, double> parallelSoA;
+		addOuterProducts(pool, a, b, parallelAoS);
+		addOuterProducts(pool, sa, sb, parallelSoA);
+		assert(sameBits(parallelAoS, aos));
+		assert(sameBits(parallelSoA, soa));
+	}
+
+	//a float matrix, a Vec2 and double vectors go through the other kernels
+	math3d::Matrix<3, 3, float> inertia;
+	addOuterProducts(a, a, inertia);
+	const auto c = covariance(a);
+	const auto mean = centroid(a);
+	for (size_t r = 0; r < 3; ++r) {
+		for (size_t k = 0; k < 3; ++k) {
+			//sum p p^T = n (C + mean mean^T)
+			const double fromMoments = n * (static_cast<double>(c[r][k]) + static_cast<double>(mean[r]) * mean[k]);
+			assert(std::abs(inertia[r][k] - fromMoments) <= 1e-5 * std::abs(fromMoments));
+		}
+	}
+	const auto small = makeCloud<double>(37);
+	std::vector<math3d::Vec<2, int>> ints(37);
+	for (size_t i = 0; i < ints.size(); ++i) {
+		ints[i] = { static_cast<int>(i), -2 };
+	}
+	math3d::Matrix<3, 2, double> mixed;
+	addOuterProducts(std::span<const Vec3d>(small), std::span<const math3d::Vec<2, int>>(ints), mixed);
+	math3d::Matrix<3, 2, double> direct;
+	for (size_t i = 0; i < small.size(); ++i) {
+		direct = direct + outerProduct(small[i], ints[i]);
+	}
+	assert(mixed == direct);
+}
+
+int main() {
+	smallTest();
+	accuracyTest<float>(100003, 2e-6);
+	accuracyTest<double>(100003, 1e-12);
+	determinismTest(100003);
+	determinismTest(5000);
+	outerProductTest(100003);
+	outerProductTest(13);
+	return 0;
+}
@@ -0,0 +1,207 @@
+#include "math3d.h"
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+using Vec3f = math3d::Vec<3, float>;
+using Vec4f = math3d::Vec<4, float>;
+using Mat4f = math3d::Matrix<4, 4, float>;
+
+//The SIMD paths are skipped during constant evaluation, so comparing a runtime result
+//against a constexpr result compares the SIMD path against the scalar one
+
+template<class T>
+T runtime(const T& t) {
+	//keeps the optimizer from folding the operation into a constant
+	volatile bool pass = true;
+	return pass ? t : T{};
+}
+
+bool near(float a, float b) {
+	return std::abs(a - b) <= 1e-6f * (1 + std::abs(a) + std::abs(b));
+}
+
+void layoutTest() {
+	static_assert(sizeof(Vec4f) == 4 * sizeof(float));
+	static_assert(alignof(Vec4f) == 16);
+	static_assert(sizeof(Vec3f) == 3 * sizeof(float));
+	static_assert(sizeof(Mat4f) == 16 * sizeof(float));
+	static_assert(alignof(Mat4f) == 16);
+}
+
+void vec4Test() {
+	constexpr Vec4f a{ 1.5f, -2.25f, 3.0f, 0.125f };
+	constexpr Vec4f b{ -7.0f, 0.5f, 2.75f, 10.0f };
+	constexpr Vec4f sum = a + b;
+	constexpr Vec4f diff = a - b;
+	constexpr Vec4f scaled = a * 3.0f;
+	constexpr Vec4f scaledInt = 3 * a;
+	constexpr Vec4f divided = a / 4.0f;
+	constexpr float dot = dotProduct(a, b);
+
+	Vec4f ra = runtime(a);
+	Vec4f rb = runtime(b);
+	assert(ra + rb == sum);
+	assert(ra - rb == diff);
+	assert(ra * 3.0f == scaled);
+	assert(3 * ra == scaledInt);
+	assert(ra / 4.0f == divided);
+	assert(near(dotProduct(ra, rb), dot));
+	assert(ra == a);
+	assert(!(ra != a));
+	assert(ra != b);
+	assert(!(ra == b));
+
+	//a single differing lane must be detected
+	Vec4f lastLane = runtime(a);
+	lastLane.w = 0;
+	assert(lastLane != a);
+}
+
+void vec3Test() {
+	constexpr Vec3f a{ 1.5f, -2.25f, 3.0f };
+	constexpr Vec3f b{ -7.0f, 0.5f, 2.75f };
+	constexpr Vec3f sum = a + b;
+	constexpr Vec3f diff = a - b;
+	constexpr Vec3f scaled = a * 3.0f;
+	constexpr Vec3f divided = a / 4.0f;
+	constexpr Vec3f cross = crossProduct(a, b);
+	constexpr float dot = dotProduct(a, b);
+
+	Vec3f ra = runtime(a);
+	Vec3f rb = runtime(b);
+	assert(ra + rb == sum);
+	assert(ra - rb == diff);
+	assert(ra * 3.0f == scaled);
+	assert(ra / 4.0f == divided);
+	assert(crossProduct(ra, rb) == cross);
+	assert(ra.cross(rb) == cross);
+	assert(near(dotProduct(ra, rb), dot));
+	assert(ra != rb);
+
+	//Vec3 loads and stores must not touch the neighbouring element
+	Vec3f packed[3] = { a, b, a };
+	packed[1] = packed[0] + packed[2];
+	assert(packed[0] == a);
+	assert(packed[2] == a);
+	assert(packed[1] == sum - b + a);
+}
+
+void matrix4Test() {
+	constexpr Mat4f a{ { 1, 2, 3, 4 }, { 5, 6, 7, 8 }, { 9, 10, 11, 12 }, { 13, 14, 15, 16 } };
+	constexpr Mat4f b{ { 16, 15, 14, 13 }, { 12, 11, 10, 9 }, { 8, 7, 6, 5 }, { 4, 3, 2, 1 } };
+	constexpr Mat4f sum = a + b;
+	constexpr Mat4f scaled = a * 0.5f;
+	Mat4f rsum = runtime(a) + runtime(b);
+	Mat4f rscaled = runtime(a) * 0.5f;
+	assert(rsum == sum);
+	assert(rscaled == scaled);
+	assert(rsum.z == (Vec4f{ 17, 17, 17, 17 }));
+
+	//small integers keep every product and sum exact, so the results must match bit for bit
+	constexpr Mat4f product = a * b;
+	constexpr Vec4f column = a * Vec4f{ 1, -2, 3, -4 };
+	constexpr Vec4f row = Vec4f{ 1, -2, 3, -4 } * a;
+	assert(runtime(a) * runtime(b) == product);
+	assert(runtime(a) * runtime(Vec4f{ 1, -2, 3, -4 }) == column);
+	assert(runtime(Vec4f{ 1, -2, 3, -4 }) * runtime(a) == row);
+	assert(transpose(runtime(a)) == transpose(a));
+	assert(transpose(runtime(a)) * runtime(Vec4f{ 1, -2, 3, -4 }) == row);
+}
+
+void inverse4Test() {
+	//determinant 1 with integer entries, every step of both paths is exact
+	constexpr Mat4f a{ { 1, 2, 0, 0 }, { 0, 1, 3, 0 }, { 0, 0, 1, 4 }, { 0, 0, 0, 1 } };
+	constexpr Mat4f b{ { 2, 0, 0, 1 }, { 1, 1, 0, 0 }, { 0, 3, 1, 0 }, { 0, 0, 2, 1 } };
+	assert(inverse(runtime(a)) == inverse(a));
+	assert(inverse(runtime(a * b)) == inverse(a * b));
+	assert(inverse(runtime(b)) * b == (Mat4f{ { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, 0, 1 } }));
+
+	//general entries agree up to rounding
+	constexpr Mat4f m{ { 2, -1, 0.5f, 3 }, { 0.25f, 4, -2, 1 }, { 1, 1, 5, -0.5f }, { -3, 0.5f, 1, 6 } };
+	constexpr Mat4f expected = inverse(m);
+	Mat4f diff = inverse(runtime(m)) - expected;
+	for (const Vec4f& row : { diff.x, diff.y, diff.z, diff.w }) {
+		assert(lengthSquared(row) < 1e-10f);
+	}
+}
+
+void mixedTypesTest() {
+	//mixed element and scalar types keep using the scalar operators
+	math3d::Vec<4, double> d{ 1, 2, 3, 4 };
+	Vec4f f = runtime(Vec4f{ 1, 2, 3, 4 });
+	assert(f == d);
+	math3d::Vec<4, double> sum = f + d;
+	assert(sum == (math3d::Vec<4, double>{ 2, 4, 6, 8 }));
+	assert(f * 2.0 == (Vec4f{ 2, 4, 6, 8 }));
+}
+
+//Against std::atan2 in double, single values and 8 lanes, over the whole circle
+template<math3d::Precision P>
+void atan2Test(double maxError) {
+	auto check = [&](float y, float x) {
+		const double exact = std::atan2(static_cast<double>(y), static_cast<double>(x));
+		const float single = atan2Fast<P>(y, x);
+		assert(std::abs(single - exact) <= maxError);
+		const float ys[8] = { y, -y, x, -x, y, -y, x, -x };
+		const float xs[8] = { x, x, y, y, -x, -x, -y, -y };
+		float lanes[8];
+		math3d::simd::storeu(lanes, math3d::simd::atan2<P>(math3d::simd::loadu8(ys), math3d::simd::loadu8(xs)));
+		for (int i = 0; i < 8; ++i) {
+			assert(std::abs(lanes[i] - std::atan2(static_cast<double>(ys[i]), static_cast<double>(xs[i]))) <= maxError);
+		}
+	};
+	for (int i = 0; i <= 100000; ++i) {
+		const double a = 3.14159265358979 * i / 100000;
+		check(static_cast<float>(std::sin(a)), static_cast<float>(std::cos(a)));
+		//magnitudes far from 1
+		check(static_cast<float>(std::sin(a) * 1e-30), static_cast<float>(std::cos(a) * 1e-30));
+		check(static_cast<float>(std::sin(a) * 1e30), static_cast<float>(std::cos(a) * 1e30));
+	}
+
+	//zeros keep their signs, as with std::atan2
+	const float inf = std::numeric_limits<float>::infinity();
+	for (float y : { 0.0f, -0.0f, 1.0f, -1.0f, inf, -inf }) {
+		for (float x : { 0.0f, -0.0f, 2.0f, -2.0f }) {
+			const float r = atan2Fast<P>(runtime(y), runtime(x));
+			const float exact = std::atan2(y, x);
+			assert(std::abs(r - exact) <= maxError && std::signbit(r) == std::signbit(exact));
+		}
+	}
+	assert(std::abs(atan2Fast<P>(1.0f, inf)) == 0 && std::abs(atan2Fast<P>(1.0f, -inf) - 3.14159265f) <= maxError);
+}
+
+//Comparison masks, lane i in bit i, with NaN unordered as in the scalar comparisons
+void maskTest() {
+	using namespace math3d::simd;
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+	const float a[8] = { 1, 2, 3, nan, -0.0f, 5, 1, nan };
+	const float b[8] = { 1, 1, 4, 0, 0.0f, nan, 2, nan };
+	const f32x8 x = loadu8(a);
+	const f32x8 y = loadu8(b);
+	int lessEqualBits = 0;
+	int notEqualBits = 0;
+	for (int i = 0; i < 8; ++i) {
+		lessEqualBits |= (a[i] <= b[i]) << i;
+		notEqualBits |= (a[i] != b[i]) << i;
+	}
+	assert(signMask(lessEqual(x, y)) == lessEqualBits);
+	assert(signMask(notEqual(x, y)) == notEqualBits);
+	assert(signMask(bitAnd(lessEqual(x, y), notEqual(x, y))) == (lessEqualBits & notEqualBits));
+	assert(signMask(loadu8(b)) == 0 && signMask(splat8(-1)) == 0xff);
+	assert(signMask(lessEqual(splat(1), splat(2))) == 0xf);
+}
+
+int main() {
+	layoutTest();
+	vec4Test();
+	vec3Test();
+	matrix4Test();
+	inverse4Test();
+	mixedTypesTest();
+	maskTest();
+	atan2Test<math3d::Precision::Estimate>(1e-4);
+	atan2Test<math3d::Precision::Refined>(4e-7);
+	atan2Test<math3d::Precision::Full>(2.5e-7);
+	return 0;
+}
@@ -0,0 +1,202 @@
+#include "storage.h"
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <vector>
+
+using math3d::half;
+using math3d::snorm16;
+using math3d::unorm16;
+using Vec3f = math3d::Vec<3, float>;
+
+bool sameBits(float a, float b) {
+	return std::memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+void halfTest() {
+	static_assert(half(1.0f).bits == 0x3c00);
+	static_assert(half(-2.0f).bits == 0xc000);
+	static_assert(half(0.1f).bits == 0x2e66);
+	static_assert(half(-0.0f).bits == 0x8000);
+	//largest finite, and the first value that rounds to infinity
+	static_assert(half(65504.0f).bits == 0x7bff);
+	static_assert(half(65519.0f).bits == 0x7bff);
+	static_assert(half(65520.0f).bits == 0x7c00);
+	static_assert(half(std::numeric_limits<float>::infinity()).bits == 0x7c00);
+	//subnormals, 2^-24 is the smallest, 2^-25 is halfway to zero and rounds to even
+	static_assert(half(0x1p-24f).bits == 0x0001);
+	static_assert(half(0x1p-25f).bits == 0x0000);
+	static_assert(half(0x1.8p-24f).bits == 0x0002);
+	static_assert(half(0x1p-14f).bits == 0x0400);
+	//ties to even: 1 + 2^-11 is halfway between 1 and the next half
+	static_assert(half(1.0f + 0x1p-11f).bits == 0x3c00);
+	static_assert(half(1.0f + 0x3p-11f).bits == 0x3c02);
+	static_assert(float(half::fromBits(0x3555)) == 0x1.554p-2f);
+	static_assert(float(half::fromBits(0x0001)) == 0x1p-24f);
+	assert(std::isnan(float(half(std::numeric_limits<float>::quiet_NaN()))));
+
+	//every half survives the round trip through float
+	for (uint32_t bits = 0; bits <= 0xffff; ++bits) {
+		half h = half::fromBits(static_cast<uint16_t>(bits));
+		float f = h;
+		if (std::isnan(f)) {
+			assert((half(f).bits & 0x7c00) == 0x7c00 && (half(f).bits & 0x3ff) != 0);
+		}
+		else {
+			assert(half(f).bits == bits);
+		}
+	}
+
+	//half of an ulp of relative error in the normal range
+	for (float f = 0x1p-14f; f < 65504; f *= 1.0137f) {
+		assert(std::abs(float(half(f)) - f) <= f * 0x1p-11f);
+	}
+}
+
+void normalizedTest() {
+	static_assert(snorm16(1.0f).bits == 32767);
+	static_assert(snorm16(-1.0f).bits == -32767);
+	static_assert(snorm16(3.0f).bits == 32767);
+	static_assert(snorm16(-3.0f).bits == -32767);
+	static_assert(snorm16(0.0f).bits == 0);
+	//16383.5 rounds to the even 16384
+	static_assert(snorm16(16383.5f / 32767).bits == 16384);
+	static_assert(float(snorm16::fromBits(-32768)) == -1.0f);
+	static_assert(float(snorm16::fromBits(32767)) == 1.0f);
+	static_assert(unorm16(1.0f).bits == 65535);
+	static_assert(unorm16(-0.5f).bits == 0);
+	static_assert(unorm16(2.0f).bits == 65535);
+	static_assert(float(unorm16::fromBits(65535)) == 1.0f);
+	static_assert(float(unorm16::fromBits(0)) == 0.0f);
+	assert(snorm16(std::numeric_limits<float>::quiet_NaN()).bits == -32767);
+	assert(unorm16(std::numeric_limits<float>::quiet_NaN()).bits == 0);
+
+	//every step survives the round trip through float
+	for (int32_t bits = -32767; bits <= 32767; ++bits) {
+		assert(snorm16(float(snorm16::fromBits(static_cast<int16_t>(bits)))).bits == bits);
+	}
+	for (uint32_t bits = 0; bits <= 65535; ++bits) {
+		assert(unorm16(float(unorm16::fromBits(static_cast<uint16_t>(bits)))).bits == bits);
+	}
+}
+
+void vecTest() {
+	using Vec3h = math3d::Vec<3, half>;
+	using Vec4s = math3d::Vec<4, snorm16>;
+	static_assert(sizeof(Vec3h) == 6);
+	static_assert(sizeof(Vec4s) == 8);
+	static_assert(sizeof(math3d::Matrix<4, 4, half>) == 32);
+
+	//arithmetic is done in float
+	constexpr Vec3h a{ 1, 2.5f, -3 };
+	static_assert(std::is_same_v<decltype(a + a), Vec3f>);
+	static_assert(a + a == Vec3f{ 2, 5, -6 });
+	static_assert(dotProduct(a, a) == 16.25f);
+	static_assert(static_cast<Vec3f>(a) == Vec3f{ 1, 2.5f, -3 });
+	//scalar products keep the element type, as for every Vec
+	static_assert(std::is_same_v<decltype(a * 2), Vec3h>);
+	static_assert(a * 2 == Vec3f{ 2, 5, -6 });
+	constexpr Vec4s n{ 0.5f, -0.25f, 1, -1 };
+	static_assert(n.w.bits == -32767);
+	static_assert(static_cast<math3d::Vec<4, float>>(n) == math3d::Vec<4, float>{ 16384 / 32767.0f, -8192 / 32767.0f, 1, -1 });
+}
+
+std::vector<float> testValues() {
+	std::vector<float> values;
+	//a sweep over all exponents and many mantissas, both signs
+	for (uint64_t bits = 0; bits <= 0xffffffffu; bits += 65521) {
+		values.push_back(std::bit_cast<float>(static_cast<uint32_t>(bits)));
+	}
+	for (float f : { 0.0f, -0.0f, 1.0f, -1.0f, 0.5f, 65504.0f, 65520.0f, 0x1p-25f, 0x1.8p-24f, 2.0f, -2.0f }) {
+		values.push_back(f);
+	}
+	for (int i = -70000; i <= 70000; ++i) {
+		values.push_back(static_cast<float>(i) / 65535);
+		values.push_back(static_cast<float>(i) / 32767 + 0.5f / 32767);
+	}
+	return values;
+}
+
+template<class T>
+bool sameStorage(T a, T b) {
+	return a.bits == b.bits;
+}
+
+template<class T>
+void bulkTest(const std::vector<float>& values) {
+	const size_t n = values.size();
+	std::vector<T> packed(n);
+	pack(std::span<const float>(values), std::span<T>(packed));
+	for (size_t i = 0; i < n; ++i) {
+		//NaNs may differ in payload, but not in being NaN
+		if (std::isnan(values[i]) && std::is_same_v<T, half>) {
+			assert(std::isnan(float(packed[i])));
+		}
+		else {
+			assert(sameStorage(packed[i], T(values[i])));
+		}
+	}
+	std::vector<float> unpacked(n);
+	unpack(std::span<const T>(packed), std::span<float>(unpacked));
+	for (size_t i = 0; i < n; ++i) {
+		float expected = packed[i];
+		assert(sameBits(unpacked[i], expected) || (std::isnan(expected) && std::isnan(unpacked[i])));
+	}
+
+	//every length around the 8 wide kernels, and unaligned starts
+	for (size_t count = 0; count < 20; ++count) {
+		for (size_t offset = 0; offset < 3; ++offset) {
+			std::vector<T> out(count);
+			pack(std::span<const float>(values).subspan(offset + 1000, count), std::span<T>(out));
+			for (size_t i = 0; i < count; ++i) {
+				assert(sameStorage(out[i], packed[offset + 1000 + i]));
+			}
+		}
+	}
+}
+
+template<class T>
+void vecBulkTest() {
+	const size_t n = 1003;
+	std::vector<Vec3f> vecs(n);
+	for (size_t i = 0; i < n; ++i) {
+		float f = static_cast<float>(i) / n;
+		vecs[i] = { f, -f, std::sin(f * 10) };
+	}
+	std::vector<math3d::Vec<3, T>> packed(n);
+	pack(std::span<const Vec3f>(vecs), std::span<math3d::Vec<3, T>>(packed));
+	std::vector<Vec3f> unpacked(n);
+	unpack(std::span<const math3d::Vec<3, T>>(packed), std::span<Vec3f>(unpacked));
+	for (size_t i = 0; i < n; ++i) {
+		assert((packed[i] == static_cast<math3d::Vec<3, T>>(vecs[i])));
+		assert(unpacked[i] == static_cast<Vec3f>(packed[i]));
+	}
+
+	const math3d::VecArray<3, float> soa{ std::span<const Vec3f>(vecs) };
+	math3d::VecArray<3, T> soaPacked;
+	math3d::VecArray<3, float> soaUnpacked;
+	pack(soa, soaPacked);
+	unpack(soaPacked, soaUnpacked);
+	assert(soaPacked.size() == n && soaUnpacked.size() == n);
+	for (size_t i = 0; i < n; ++i) {
+		assert(soaPacked.get(i) == packed[i]);
+		assert(soaUnpacked.get(i) == unpacked[i]);
+	}
+}
+
+int main() {
+	halfTest();
+	normalizedTest();
+	vecTest();
+	const auto values = testValues();
+	bulkTest<half>(values);
+	bulkTest<snorm16>(values);
+	bulkTest<unorm16>(values);
+	vecBulkTest<half>();
+	vecBulkTest<snorm16>();
+	vecBulkTest<unorm16>();
+	return 0;
+}
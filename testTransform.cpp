@@ -0,0 +1,205 @@
+#include "transform.h"
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+using Vec3f = math3d::Vec<3, float>;
+using Vec4f = math3d::Vec<4, float>;
+using Mat4f = math3d::Matrix<4, 4, float>;
+
+constexpr Mat4f affine{
+	{ 0.36f, 0.48f, -0.8f, 10.0f },
+	{ -0.8f, 0.6f, 0.0f, -20.0f },
+	{ 0.48f, 0.64f, 0.6f, 30.5f },
+	{ 0.0f, 0.0f, 0.0f, 1.0f }
+};
+
+constexpr math3d::StoreMode modes[] = { math3d::StoreMode::Cached, math3d::StoreMode::Streaming, math3d::StoreMode::Automatic };
+
+bool near(float a, float b) {
+	return std::abs(a - b) <= 1e-5f * (1 + std::abs(a) + std::abs(b));
+}
+
+template<size_t Dim>
+bool near(const math3d::Vec<Dim, float>& a, const math3d::Vec<Dim, float>& b) {
+	return lengthSquared(a - b) <= 1e-10f * (1 + lengthSquared(a) + lengthSquared(b));
+}
+
+std::vector<Vec3f> makePoints(size_t n) {
+	std::vector<Vec3f> points(n);
+	for (size_t i = 0; i < n; ++i) {
+		float f = static_cast<float>(i);
+		points[i] = { f * 0.5f - 3, 7 - f * 0.25f, f * f * 0.01f };
+	}
+	return points;
+}
+
+void singleTest() {
+	constexpr Mat4f translate{ {1, 0, 0, 1}, {0, 1, 0, 2}, {0, 0, 1, 3}, {0, 0, 0, 1} };
+	static_assert(transformPoint(translate, Vec3f{ 1, 1, 1 }) == Vec3f{ 2, 3, 4 });
+	static_assert(transformDirection(translate, Vec3f{ 1, 1, 1 }) == Vec3f{ 1, 1, 1 });
+
+	//same as the 4x4 product on homogeneous coordinates
+	constexpr Vec3f p{ 1, -2, 3 };
+	constexpr Vec4f hp = affine * Vec4f{ p.x, p.y, p.z, 1 };
+	constexpr Vec4f hd = affine * Vec4f{ p.x, p.y, p.z, 0 };
+	static_assert(transformPoint(affine, p) == Vec3f{ hp.x, hp.y, hp.z });
+	static_assert(transformDirection(affine, p) == Vec3f{ hd.x, hd.y, hd.z });
+}
+
+void vec3Test(size_t n, size_t offset) {
+	auto storage = makePoints(n + offset);
+	std::span<const Vec3f> in = std::span<const Vec3f>(storage).subspan(offset);
+	for (auto mode : modes) {
+		std::vector<Vec3f> outStorage(n + offset);
+		std::span<Vec3f> out = std::span<Vec3f>(outStorage).subspan(offset);
+		transformPoints(affine, in, out, mode);
+		for (size_t i = 0; i < n; ++i) {
+			assert(near(out[i], transformPoint(affine, in[i])));
+		}
+		transformDirections(affine, in, out, mode);
+		for (size_t i = 0; i < n; ++i) {
+			assert(near(out[i], transformDirection(affine, in[i])));
+		}
+		//no writes past the end
+		for (size_t i = 0; i < offset; ++i) {
+			assert(outStorage[i] == Vec3f{});
+		}
+
+		//in place
+		std::vector<Vec3f> inPlace(in.begin(), in.end());
+		transformPoints(affine, std::span<const Vec3f>(inPlace), std::span<Vec3f>(inPlace), mode);
+		for (size_t i = 0; i < n; ++i) {
+			assert(near(inPlace[i], transformPoint(affine, in[i])));
+		}
+	}
+}
+
+void vec4Test(size_t n) {
+	auto points = makePoints(n);
+	std::vector<Vec4f> in(n);
+	for (size_t i = 0; i < n; ++i) {
+		in[i] = { points[i].x, points[i].y, points[i].z, i % 2 ? 1.0f : 0.5f };
+	}
+	constexpr Mat4f projective{ {1, 0, 0, 0}, {0, 2, 0, 0}, {0, 0, 1, -1}, {0, 0, -1, 0} };
+	for (auto mode : modes) {
+		std::vector<Vec4f> out(n);
+		transformPoints(projective, std::span<const Vec4f>(in), std::span<Vec4f>(out), mode);
+		for (size_t i = 0; i < n; ++i) {
+			assert(near(out[i], projective * in[i]));
+		}
+		transformDirections(affine, std::span<const Vec4f>(in), std::span<Vec4f>(out), mode);
+		for (size_t i = 0; i < n; ++i) {
+			assert(near(out[i], affine * Vec4f{ in[i].x, in[i].y, in[i].z, 0 }));
+		}
+	}
+}
+
+void soaTest(size_t n) {
+	auto points = makePoints(n);
+	math3d::VecArray<3, float> in{ std::span<const Vec3f>(points) };
+	for (auto mode : modes) {
+		math3d::VecArray<3, float> out;
+		transformPoints(affine, in, out, mode);
+		assert(out.size() == n);
+		for (size_t i = 0; i < n; ++i) {
+			assert(near(out.get(i), transformPoint(affine, points[i])));
+		}
+		transformDirections(affine, in, out, mode);
+		for (size_t i = 0; i < n; ++i) {
+			assert(near(out.get(i), transformDirection(affine, points[i])));
+		}
+	}
+}
+
+void doubleTest(size_t n) {
+	//other element types use the scalar loop
+	using Vec3d = math3d::Vec<3, double>;
+	math3d::Matrix<4, 4, double> m{ {1, 0, 0, 5}, {0, 1, 0, 6}, {0, 0, 1, 7}, {0, 0, 0, 1} };
+	std::vector<Vec3d> in(n, Vec3d{ 1, 2, 3 });
+	std::vector<Vec3d> out(n);
+	transformPoints(m, std::span<const Vec3d>(in), std::span<Vec3d>(out));
+	for (auto& p : out) {
+		assert(p == (Vec3d{ 6, 8, 10 }));
+	}
+}
+
+bool near(const Mat4f& a, const Mat4f& b) {
+	return near(a.x, b.x) && near(a.y, b.y) && near(a.z, b.z) && near(a.w, b.w);
+}
+
+void inverseTest() {
+	//affine is a rotation (rows are orthonormal) plus a translation
+	constexpr Mat4f scaled = affine * Mat4f{ {2, 0, 0, 0}, {0, 0.5f, 0, 0}, {0, 0, 4, 0}, {0, 0, 0, 1} };
+	constexpr Mat4f identity{ {1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1} };
+	constexpr Mat4f rigid = rigidInverse(affine);
+	constexpr Mat4f rigidAsAffine = affineInverse(affine);
+	constexpr Mat4f scaledInverse = affineInverse(scaled);
+	assert(near(affine * rigid, identity));
+	assert(near(rigidAsAffine, rigid));
+	assert(near(scaled * scaledInverse, identity));
+	assert(near(scaledInverse, inverse(scaled)));
+
+	//the runtime (possibly SIMD) path
+	Mat4f rAffine = affine;
+	Mat4f rScaled = scaled;
+	assert(near(rigidInverse(rAffine), rigid));
+	assert(near(affineInverse(rAffine), rigidAsAffine));
+	assert(near(affineInverse(rScaled), scaledInverse));
+	assert(near(inverse(rScaled), scaledInverse));
+	assert(rigidInverse(rAffine).w == (Vec4f{ 0, 0, 0, 1 }));
+	assert(affineInverse(rScaled).w == (Vec4f{ 0, 0, 0, 1 }));
+
+	//a point goes back where it came from
+	constexpr Vec3f p{ 1, -2, 3 };
+	assert(near(transformPoint(rigidInverse(rAffine), transformPoint(rAffine, p)), p));
+	assert(near(transformPoint(affineInverse(rScaled), transformPoint(rScaled, p)), p));
+}
+
+void batchedInverseTest(size_t n) {
+	std::vector<Mat4f> in(n);
+	for (size_t i = 0; i < n; ++i) {
+		float f = static_cast<float>(i);
+		Mat4f translate{ {1, 0, 0, f}, {0, 1, 0, -f}, {0, 0, 1, f * 0.5f}, {0, 0, 0, 1} };
+		in[i] = translate * affine;
+	}
+	std::vector<Mat4f> out(n);
+	inverse(std::span<const Mat4f>(in), std::span<Mat4f>(out));
+	for (size_t i = 0; i < n; ++i) {
+		assert(near(out[i], inverse(in[i])));
+	}
+	affineInverse(std::span<const Mat4f>(in), std::span<Mat4f>(out));
+	for (size_t i = 0; i < n; ++i) {
+		assert(near(out[i], affineInverse(in[i])));
+	}
+	//in place
+	std::vector<Mat4f> inPlace = in;
+	rigidInverse(std::span<const Mat4f>(inPlace), std::span<Mat4f>(inPlace));
+	for (size_t i = 0; i < n; ++i) {
+		assert(near(inPlace[i], rigidInverse(in[i])));
+	}
+
+	//other sizes and element types
+	using Mat3d = math3d::Matrix<3, 3, double>;
+	std::vector<Mat3d> m3(n, Mat3d{ {1, 2, 3}, {0, 1, 4}, {5, 6, 0} });
+	inverse(std::span<const Mat3d>(m3), std::span<Mat3d>(m3));
+	for (auto& m : m3) {
+		assert(m == (Mat3d{ {-24, 18, 5}, {20, -15, -4}, {-5, 4, 1} }));
+	}
+}
+
+int main() {
+	singleTest();
+	inverseTest();
+	//sizes around the 8 wide kernel and its tail
+	for (size_t n : { 0, 1, 3, 7, 8, 9, 15, 16, 17, 31, 100, 1001 }) {
+		for (size_t offset = 0; offset < 4; ++offset) {
+			vec3Test(n, offset);
+		}
+		vec4Test(n);
+		soaTest(n);
+		doubleTest(n);
+		batchedInverseTest(n);
+	}
+	return 0;
+}
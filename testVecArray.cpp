@@ -0,0 +1,312 @@
+#include "vecArray.h"
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+using Vec3i = math3d::Vec<3, int>;
+
+template<size_t Dim, class T>
+std::vector<math3d::Vec<Dim, T>> makeVecs(size_t n) {
+	//deterministic, non-trivial values with mixed signs
+	math3d::VecArray<Dim, T> soa(n);
+	for (size_t c = 0; c < Dim; ++c) {
+		for (size_t i = 0; i < n; ++i) {
+			soa.component(c)[i] = static_cast<T>((int)((i * 7 + c * 13) % 23) - 11);
+		}
+	}
+	std::vector<math3d::Vec<Dim, T>> vecs(n);
+	soa.toAoS(vecs);
+	return vecs;
+}
+
+bool near(double a, double b) {
+	return std::abs(a - b) <= 1e-5 * (1 + std::abs(a) + std::abs(b));
+}
+
+template<size_t Dim, class T>
+void roundTripTest(size_t n) {
+	auto vecs = makeVecs<Dim, T>(n);
+	math3d::VecArray<Dim, T> soa{ std::span<const math3d::Vec<Dim, T>>(vecs) };
+	assert(soa.size() == n);
+	assert(soa.paddedSize() >= n);
+	for (size_t c = 0; c < Dim; ++c) {
+		assert(reinterpret_cast<std::uintptr_t>(soa.component(c)) % soa.Alignment == 0);
+	}
+	for (size_t i = 0; i < n; ++i) {
+		assert(soa.get(i) == vecs[i]);
+	}
+
+	std::vector<math3d::Vec<Dim, T>> back(n);
+	soa.toAoS(back);
+	for (size_t i = 0; i < n; ++i) {
+		assert(back[i] == vecs[i]);
+	}
+
+	math3d::VecArray<Dim, T> copy = soa;
+	for (size_t i = 0; i < n; ++i) {
+		assert(copy.get(i) == vecs[i]);
+	}
+}
+
+//resize keeps the vectors it can, whether or not the streams move, and zeroes the new ones
+template<size_t Dim, class T>
+void resizeTest(size_t n) {
+	const auto vecs = makeVecs<Dim, T>(n);
+	for (size_t m : { size_t(0), size_t(1), n / 10, n - n / 3, n, n + 1, n + 3, 2 * n + 70 }) {
+		math3d::VecArray<Dim, T> soa{ std::span<const math3d::Vec<Dim, T>>(vecs) };
+		soa.resize(m);
+		assert(soa.size() == m);
+		for (size_t i = 0; i < m; ++i) {
+			assert(soa.get(i) == (i < n ? vecs[i] : math3d::Vec<Dim, T>{}));
+		}
+		//growing back does not bring back the vectors dropped by shrinking
+		soa.resize(n);
+		for (size_t i = 0; i < n; ++i) {
+			assert(soa.get(i) == (i < m ? vecs[i] : math3d::Vec<Dim, T>{}));
+		}
+	}
+}
+
+template<size_t Dim, class T>
+void arithmeticMatchesScalarTest(size_t n) {
+	auto a = makeVecs<Dim, T>(n);
+	auto b = makeVecs<Dim, T>(n + 5);
+	b.erase(b.begin(), b.begin() + 5);
+	math3d::VecArray<Dim, T> sa{ std::span<const math3d::Vec<Dim, T>>(a) };
+	math3d::VecArray<Dim, T> sb{ std::span<const math3d::Vec<Dim, T>>(b) };
+
+	auto sum = sa + sb;
+	auto diff = sa - sb;
+	auto scaled = 3 * sa;
+	auto halved = sa / 2;
+	std::vector<T> dots(n);
+	dotProduct(sa, sb, std::span<T>(dots));
+	for (size_t i = 0; i < n; ++i) {
+		assert(sum.get(i) == a[i] + b[i]);
+		assert(diff.get(i) == a[i] - b[i]);
+		assert(scaled.get(i) == 3 * a[i]);
+		assert(halved.get(i) == a[i] / 2);
+		assert(dots[i] == dotProduct(a[i], b[i]));
+	}
+
+	sa += sb;
+	sa -= sb;
+	sa *= 2;
+	for (size_t i = 0; i < n; ++i) {
+		assert(sa.get(i) == a[i] * 2);
+	}
+
+	//the same array on both sides
+	sa += sa;
+	for (size_t i = 0; i < n; ++i) {
+		assert(sa.get(i) == a[i] * 2 + a[i] * 2);
+	}
+	sa -= sa;
+	const math3d::Vec<Dim, T> zero{};
+	for (size_t i = 0; i < n; ++i) {
+		assert(sa.get(i) == zero);
+	}
+}
+
+void crossProductTest(size_t n) {
+	auto a = makeVecs<3, int>(n);
+	auto b = makeVecs<3, int>(n + 3);
+	b.erase(b.begin(), b.begin() + 3);
+	math3d::VecArray<3, int> sa{ std::span<const Vec3i>(a) };
+	math3d::VecArray<3, int> sb{ std::span<const Vec3i>(b) };
+	math3d::VecArray<3, int> cross;
+	crossProduct(sa, sb, cross);
+	assert(cross.size() == n);
+	for (size_t i = 0; i < n; ++i) {
+		assert(cross.get(i) == crossProduct(a[i], b[i]));
+	}
+}
+
+template<size_t Dim>
+void lengthAndUnitTest(size_t n) {
+	using Vec = math3d::Vec<Dim, float>;
+	auto a = makeVecs<Dim, float>(n);
+	for (auto& v : a) {
+		if (lengthSquared(v) == 0) {
+			v = v + Vec{ 1 };
+		}
+	}
+	math3d::VecArray<Dim, float> sa{ std::span<const Vec>(a) };
+
+	std::vector<float> lengths(n);
+	std::vector<float> squares(n);
+	length(sa, std::span<float>(lengths));
+	lengthSquared(sa, std::span<float>(squares));
+
+	math3d::VecArray<Dim, float> units;
+	unit(sa, units);
+	for (size_t i = 0; i < n; ++i) {
+		assert(squares[i] == lengthSquared(a[i]));
+		assert(near(lengths[i], length(a[i])));
+		Vec expected = unit(a[i]);
+		Vec actual = units.get(i);
+		assert(lengthSquared(actual - expected) < 1e-12f);
+		assert(near(lengthSquared(actual), 1.0));
+	}
+
+	//in place
+	unit(sa, sa);
+	for (size_t i = 0; i < n; ++i) {
+		assert(sa.get(i) == units.get(i));
+	}
+}
+
+template<size_t Dim, math3d::Precision P>
+void unitFastTest(size_t n, float maxRelative) {
+	using Vec = math3d::Vec<Dim, float>;
+	auto a = makeVecs<Dim, float>(n);
+	for (auto& v : a) {
+		if (lengthSquared(v) == 0) {
+			v = v + Vec{ 1 };
+		}
+	}
+	math3d::VecArray<Dim, float> sa{ std::span<const Vec>(a) };
+
+	//the 8 wide kernel and the scalar tail meet the same bound as the single functions
+	std::vector<float> squares(n);
+	std::vector<float> inverse(n);
+	lengthSquared(sa, std::span<float>(squares));
+	rsqrt<P>(std::span<const float>(squares), std::span<float>(inverse));
+	for (size_t i = 0; i < n; ++i) {
+		double exact = 1 / std::sqrt(static_cast<double>(squares[i]));
+		assert(std::abs(inverse[i] - exact) <= maxRelative * exact);
+	}
+
+	math3d::VecArray<Dim, float> units;
+	unitFast<P>(sa, units);
+	assert(units.size() == n);
+	for (size_t i = 0; i < n; ++i) {
+		Vec expected = unit(a[i]);
+		Vec actual = units.get(i);
+		assert(lengthSquared(actual - expected) <= 4 * maxRelative * maxRelative + 1e-12f);
+		assert(lengthSquared(actual - unitFast<P>(a[i])) <= 4 * maxRelative * maxRelative + 1e-12f);
+	}
+	//padding past size() stays zero
+	for (size_t i = n; i < units.paddedSize(); ++i) {
+		assert(units.x()[i] == 0);
+	}
+
+	//in place
+	unitFast<P>(sa, sa);
+	for (size_t i = 0; i < n; ++i) {
+		assert(sa.get(i) == units.get(i));
+	}
+}
+
+template<size_t Dim, math3d::Precision P>
+void angleFastTest(size_t n, double maxError) {
+	using Vec = math3d::Vec<Dim, float>;
+	const auto a = makeVecs<Dim, float>(n);
+	auto b = makeVecs<Dim, float>(n + 5);
+	b.erase(b.begin(), b.begin() + 5);
+	const math3d::VecArray<Dim, float> sa{ std::span<const Vec>(a) };
+	const math3d::VecArray<Dim, float> sb{ std::span<const Vec>(b) };
+
+	std::vector<float> soa(n);
+	std::vector<float> aos(n);
+	angleFast<P>(sa, sb, std::span<float>(soa));
+	angleFast<P>(std::span<const Vec>(a), std::span<const Vec>(b), std::span<float>(aos));
+	for (size_t i = 0; i < n; ++i) {
+		//the cross and dot products of these small integers are exact
+		const double exact = angle(math3d::Vec<Dim, double>(a[i]), math3d::Vec<Dim, double>(b[i]));
+		const float single = angleFast<P>(a[i], b[i]);
+		assert(std::abs(single - exact) <= maxError);
+		assert(std::abs(soa[i] - single) <= 1e-6f && std::abs(aos[i] - single) <= 1e-6f);
+	}
+
+	//batched atan2 straight from spans, with the 8 wide kernel and the scalar tail
+	std::vector<float> y(n);
+	std::vector<float> x(n);
+	for (size_t i = 0; i < n; ++i) {
+		y[i] = static_cast<float>(std::sin(0.01 * i));
+		x[i] = static_cast<float>(std::cos(0.01 * i)) * (i % 3 ? 1 : -2);
+	}
+	std::vector<float> r(n);
+	atan2Fast<P>(std::span<const float>(y), std::span<const float>(x), std::span<float>(r));
+	for (size_t i = 0; i < n; ++i) {
+		assert(std::abs(r[i] - std::atan2(static_cast<double>(y[i]), static_cast<double>(x[i]))) <= maxError);
+	}
+}
+
+template<size_t Dim, class T>
+void axpyTest(size_t n) {
+	const auto x = makeVecs<Dim, T>(n);
+	const auto y = makeVecs<Dim, T>(n + 5);
+	const math3d::VecArray<Dim, T> sx{ std::span<const math3d::Vec<Dim, T>>(x) };
+	math3d::VecArray<Dim, T> sy{ std::span<const math3d::Vec<Dim, T>>(y).first(n) };
+	std::vector<math3d::Vec<Dim, T>> ay(y.begin(), y.begin() + n);
+	axpy(3, sx, sy);
+	axpy(3, std::span<const math3d::Vec<Dim, T>>(x), std::span<math3d::Vec<Dim, T>>(ay));
+	for (size_t i = 0; i < n; ++i) {
+		//small integers, exact even with FMA
+		assert(sy.get(i) == y[i] + x[i] * T{ 3 });
+		assert(ay[i] == y[i] + x[i] * T{ 3 });
+	}
+	//the element past the end is untouched
+	std::vector<T> flat(n + 1, T{ 1 });
+	std::vector<T> xs(n + 1, T{ 2 });
+	axpy(0.5, std::span<const T>(xs).first(n), std::span<T>(flat).first(n));
+	for (size_t i = 0; i < n; ++i) {
+		assert(flat[i] == static_cast<T>(T{ 1 } + static_cast<T>(0.5) * T{ 2 }));
+	}
+	assert(flat[n] == T{ 1 });
+}
+
+int main() {
+	//sizes below, at and past the stream padding
+	for (size_t n : { 0, 1, 15, 16, 17, 100, 1000 }) {
+		roundTripTest<2, float>(n);
+		roundTripTest<3, float>(n);
+		roundTripTest<4, float>(n);
+		roundTripTest<3, double>(n);
+		roundTripTest<3, short>(n);
+		roundTripTest<4, int>(n);
+		resizeTest<3, float>(n);
+		resizeTest<2, double>(n);
+		resizeTest<4, short>(n);
+
+		arithmeticMatchesScalarTest<2, int>(n);
+		arithmeticMatchesScalarTest<3, int>(n);
+		arithmeticMatchesScalarTest<4, int>(n);
+		arithmeticMatchesScalarTest<3, float>(n);
+		arithmeticMatchesScalarTest<3, double>(n);
+
+		crossProductTest(n);
+
+		axpyTest<3, float>(n);
+		axpyTest<4, float>(n);
+		axpyTest<3, double>(n);
+		axpyTest<2, int>(n);
+
+		lengthAndUnitTest<2>(n);
+		lengthAndUnitTest<3>(n);
+		lengthAndUnitTest<4>(n);
+
+		unitFastTest<3, math3d::Precision::Estimate>(n, 1.5f / 4096);
+		unitFastTest<3, math3d::Precision::Refined>(n, 5e-7f);
+		unitFastTest<4, math3d::Precision::Refined>(n, 5e-7f);
+		unitFastTest<2, math3d::Precision::Full>(n, 2e-7f);
+
+		angleFastTest<2, math3d::Precision::Estimate>(n, 1e-4);
+		angleFastTest<3, math3d::Precision::Estimate>(n, 1e-4);
+		angleFastTest<2, math3d::Precision::Refined>(n, 5e-7);
+		angleFastTest<3, math3d::Precision::Refined>(n, 5e-7);
+		angleFastTest<3, math3d::Precision::Full>(n, 5e-7);
+	}
+
+	{
+		//mixed element types follow the scalar operators
+		math3d::VecArray<3, int> i(4);
+		math3d::VecArray<3, float> f(4);
+		math3d::VecArray<3, float> sum = i + f;
+		assert(sum.size() == 4);
+	}
+
+	return 0;
+}
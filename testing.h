@@ -0,0 +1,65 @@
+#pragma once
+
+#include "math3d.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+/*
+* Test Helpers
+* Random is a small deterministic generator, a 64 bit linear congruential generator
+* seeded by the test, so every run tests the same cases on every platform, which
+* std::uniform_real_distribution does not promise.
+*
+* With FMA contraction (-mfma, -march=native on most CPUs, /fp:contract) the compiler
+* may fuse a multiply and an add in one function but not in another, so batched and
+* single versions of a function only agree up to rounding. Tests that compare bits
+* relax to a tolerance when Contracted is true.
+*/
+namespace testing {
+
+struct Random {
+	uint64_t state;
+
+	//53 random bits
+	uint64_t next() {
+		state = state * 6364136223846793005ull + 1442695040888963407ull;
+		return state >> 11;
+	}
+
+	//Uniform in [lo, hi), from 53 bits
+	double operator()(double lo, double hi) {
+		return lo + (hi - lo) * static_cast<double>(next()) / static_cast<double>(1ull << 53);
+	}
+
+	//Uniform in [lo, hi), from 24 bits, so every value is exact in a float
+	float uniform(float lo, float hi) {
+		return lo + (hi - lo) * static_cast<float>(next() >> 29) / static_cast<float>(1ull << 24);
+	}
+
+	math3d::Vec<3, float> vec(float lo, float hi) {
+		math3d::Vec<3, float> v;
+		v.x = uniform(lo, hi);
+		v.y = uniform(lo, hi);
+		v.z = uniform(lo, hi);
+		return v;
+	}
+
+	//Integer coordinates in [lo, hi], so that many cases fall exactly on edges, faces and planes
+	math3d::Vec<3, float> grid(int lo, int hi) {
+		math3d::Vec<3, float> v;
+		for (size_t k = 0; k < 3; ++k) {
+			v[k] = std::floor(uniform(static_cast<float>(lo), static_cast<float>(hi + 1)));
+		}
+		return v;
+	}
+};
+
+#ifdef __FP_FAST_FMAF
+inline constexpr bool Contracted = true;
+#else
+inline constexpr bool Contracted = false;
+#endif
+
+}
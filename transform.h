@@ -0,0 +1,397 @@
+#pragma once
+
+#include "math3d.h"
+#include "vecArray.h"
+
+#include <cstdint>
+#include <span>
+#include <type_traits>
+
+namespace math3d {
+
+/*
+* How batched kernels write their output
+* Streaming uses non-temporal stores, which bypass the cache. That is faster when the
+* output will not be read again soon and is too big to stay in cache anyway, and much
+* slower otherwise. Automatic streams when the output is larger than StreamingThreshold.
+*/
+enum class StoreMode {
+	Cached,
+	Streaming,
+	Automatic
+};
+
+inline constexpr size_t StreamingThreshold = 8 * 1024 * 1024;
+
+inline bool useStreaming(StoreMode mode, size_t outputBytes) {
+	return mode == StoreMode::Streaming || (mode == StoreMode::Automatic && outputBytes > StreamingThreshold);
+}
+
+/*
+* Batched transform kernels for float
+* The matrix is splatted into registers once, then 8 Vec3 (or 4 Vec4) are transformed
+* per iteration. Vec3 input is deinterleaved into one register per component, so
+* the 12 matrix entries are applied with 9 multiply-adds per 8 points, then the
+* results are interleaved again.
+* Every component is summed in the same order as transformPoint, so results match
+* the single Vec functions unless FMA contraction is enabled.
+*/
+namespace transformKernels {
+	using namespace simd;
+
+	template<bool Translate>
+	struct Affine8 {
+		f32x8 m[3][4];
+
+		explicit Affine8(const Matrix<4, 4, float>& mat) {
+			const Vec<4, float> rows[3] = { mat.x, mat.y, mat.z };
+			for (int r = 0; r < 3; ++r) {
+				m[r][0] = splat8(rows[r].x);
+				m[r][1] = splat8(rows[r].y);
+				m[r][2] = splat8(rows[r].z);
+				m[r][3] = splat8(rows[r].w);
+			}
+		}
+
+		f32x8 row(int r, f32x8 x, f32x8 y, f32x8 z) const {
+			f32x8 sum = madd(z, m[r][2], madd(y, m[r][1], mul(x, m[r][0])));
+			if constexpr (Translate) {
+				sum = add(sum, m[r][3]);
+			}
+			return sum;
+		}
+
+		//src and dst point at 8 packed Vec3, dst may equal src
+		template<bool Stream>
+		void apply(const float* src, float* dst) const {
+			f32x4 x0, y0, z0, x1, y1, z1;
+			deinterleave3(loadu(src), loadu(src + 4), loadu(src + 8), x0, y0, z0);
+			deinterleave3(loadu(src + 12), loadu(src + 16), loadu(src + 20), x1, y1, z1);
+			f32x8 x = combine(x0, x1);
+			f32x8 y = combine(y0, y1);
+			f32x8 z = combine(z0, z1);
+			f32x8 rx = row(0, x, y, z);
+			f32x8 ry = row(1, x, y, z);
+			f32x8 rz = row(2, x, y, z);
+			f32x4 out[6];
+			interleave3(low(rx), low(ry), low(rz), out[0], out[1], out[2]);
+			interleave3(high(rx), high(ry), high(rz), out[3], out[4], out[5]);
+			for (int i = 0; i < 6; ++i) {
+				if constexpr (Stream) {
+					stream(dst + 4 * i, out[i]);
+				}
+				else {
+					storeu(dst + 4 * i, out[i]);
+				}
+			}
+		}
+	};
+
+	template<bool Translate, class Scalar>
+	void transformVec3(const Matrix<4, 4, float>& m, const Vec<3, float>* in, Vec<3, float>* out, size_t n, bool streaming, Scalar scalar) {
+		Affine8<Translate> kernel(m);
+		size_t i = 0;
+		if (streaming) {
+			//non-temporal stores must be 16 byte aligned, 12 byte Vec3 reach that within 3 steps
+			for (; i < n && reinterpret_cast<std::uintptr_t>(&out[i]) % 16 != 0; ++i) {
+				out[i] = scalar(m, in[i]);
+			}
+			for (; i + 8 <= n; i += 8) {
+				kernel.template apply<true>(&in[i].x, &out[i].x);
+			}
+			streamFence();
+		}
+		for (; i + 8 <= n; i += 8) {
+			kernel.template apply<false>(&in[i].x, &out[i].x);
+		}
+		for (; i < n; ++i) {
+			out[i] = scalar(m, in[i]);
+		}
+	}
+
+	template<bool Translate>
+	void transformVec4(const Matrix<4, 4, float>& m, const Vec<4, float>* in, Vec<4, float>* out, size_t n, bool streaming) {
+		//columns of m, so each result is a combination of them weighted by the input
+		f32x4 c0 = load(m.x);
+		f32x4 c1 = load(m.y);
+		f32x4 c2 = load(m.z);
+		f32x4 c3 = load(m.w);
+		transpose4(c0, c1, c2, c3);
+		if constexpr (!Translate) {
+			c3 = splat(0);
+		}
+		auto one = [&](size_t i) {
+			f32x4 v = load(&in[i].x);
+			f32x4 r = linearCombination(v, c0, c1, c2, c3);
+			if (streaming) {
+				stream(&out[i].x, r);
+			}
+			else {
+				store(&out[i].x, r);
+			}
+		};
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4) {
+			one(i);
+			one(i + 1);
+			one(i + 2);
+			one(i + 3);
+		}
+		for (; i < n; ++i) {
+			one(i);
+		}
+		if (streaming) {
+			streamFence();
+		}
+	}
+
+	//begin and end must be multiples of 8, end may be in.paddedSize()
+	template<bool Translate>
+	void transformSoA(const Matrix<4, 4, float>& m, const VecArray<3, float>& in, VecArray<3, float>& out, size_t begin, size_t end, bool streaming) {
+		Affine8<Translate> kernel(m);
+		const float* x = in.x();
+		const float* y = in.y();
+		const float* z = in.z();
+		float* ox = out.x();
+		float* oy = out.y();
+		float* oz = out.z();
+		//streams are cache line aligned and padded to a multiple of 16 floats, so there is no tail
+		for (size_t i = begin; i < end; i += 8) {
+			f32x8 vx = load8(x + i);
+			f32x8 vy = load8(y + i);
+			f32x8 vz = load8(z + i);
+			f32x8 rx = kernel.row(0, vx, vy, vz);
+			f32x8 ry = kernel.row(1, vx, vy, vz);
+			f32x8 rz = kernel.row(2, vx, vy, vz);
+			if (streaming) {
+				stream(ox + i, rx);
+				stream(oy + i, ry);
+				stream(oz + i, rz);
+			}
+			else {
+				store(ox + i, rx);
+				store(oy + i, ry);
+				store(oz + i, rz);
+			}
+		}
+		if (streaming) {
+			streamFence();
+		}
+	}
+
+	/*
+	* Affine inverse
+	* The inverse of [A t; 0 1] is [A^-1 -A^-1 t; 0 1]. The columns of A^-1 are
+	* computed as rows, scaled by the translation and summed into -A^-1 t as a fourth
+	* row, and one transpose puts everything in place. A rigid A is its own
+	* transposed inverse, so its rows are used directly, otherwise they are the cross
+	* products of the rows of A over its determinant.
+	*/
+	template<bool Rigid>
+	Matrix<4, 4, float> affineInverse(const Matrix<4, 4, float>& m) {
+		f32x4 r0 = load(m.x);
+		f32x4 r1 = load(m.y);
+		f32x4 r2 = load(m.z);
+		const f32x4 zero = splat(0);
+		//(r.x, r.y, r.z, 0)
+		auto linear = [&](f32x4 r) {
+			return shuffle<0, 1, 0, 2>(r, shuffle<2, 2, 0, 0>(r, zero));
+		};
+		f32x4 c0, c1, c2;
+		if constexpr (Rigid) {
+			c0 = linear(r0);
+			c1 = linear(r1);
+			c2 = linear(r2);
+		}
+		else {
+			f32x4 a0 = linear(r0);
+			f32x4 a1 = linear(r1);
+			f32x4 a2 = linear(r2);
+			f32x4 a12 = cross3(a1, a2);
+			f32x4 scale = splat(1 / dot4(a0, a12));
+			c0 = mul(a12, scale);
+			c1 = mul(cross3(a2, a0), scale);
+			c2 = mul(cross3(a0, a1), scale);
+		}
+		f32x4 translation = sub(set(0, 0, 0, 1), linearCombination(set(m.x.w, m.y.w, m.z.w, 0), c0, c1, c2, zero));
+		transpose4(c0, c1, c2, translation);
+		return { toVec<4>(c0), toVec<4>(c1), toVec<4>(c2), toVec<4>(translation) };
+	}
+}
+
+}
+
+/*
+* Single point and direction transforms
+* A point is transformed as (x, y, z, 1), so it picks up the translation in the last
+* column of m, a direction as (x, y, z, 0), so it doesn't. The bottom row of m is
+* ignored, so these are only exact for affine m. Use m * Vec<4, T> for projections.
+*/
+template<class T>
+constexpr math3d::Vec<3, T> transformPoint(const math3d::Matrix<4, 4, T>& m, const math3d::Vec<3, T>& p) {
+	return {
+		((m.x.x * p.x + m.x.y * p.y) + m.x.z * p.z) + m.x.w,
+		((m.y.x * p.x + m.y.y * p.y) + m.y.z * p.z) + m.y.w,
+		((m.z.x * p.x + m.z.y * p.y) + m.z.z * p.z) + m.z.w
+	};
+}
+
+template<class T>
+constexpr math3d::Vec<3, T> transformDirection(const math3d::Matrix<4, 4, T>& m, const math3d::Vec<3, T>& d) {
+	return {
+		(m.x.x * d.x + m.x.y * d.y) + m.x.z * d.z,
+		(m.y.x * d.x + m.y.y * d.y) + m.y.z * d.z,
+		(m.z.x * d.x + m.z.y * d.y) + m.z.z * d.z
+	};
+}
+
+/*
+* Affine and Rigid Inverses
+* For m with a bottom row of (0, 0, 0, 1), which these assume without checking.
+* affineInverse inverts the upper 3x3 by its adjugate, rigidInverse assumes it is a
+* rotation and only transposes it. Both are much cheaper than the full inverse.
+*/
+template<class T>
+constexpr math3d::Matrix<4, 4, T> affineInverse(const math3d::Matrix<4, 4, T>& m) {
+	static_assert(std::is_floating_point_v<T>, "inverse needs a floating point element type");
+	if constexpr (math3d::simd::AcceleratedProduct<4, 4, 4, T, T>) {
+		if (!std::is_constant_evaluated()) {
+			return math3d::transformKernels::affineInverse<false>(m);
+		}
+	}
+	const math3d::Matrix<3, 3, T> a = inverse(math3d::Matrix<3, 3, T>{ { m.x.x, m.x.y, m.x.z }, { m.y.x, m.y.y, m.y.z }, { m.z.x, m.z.y, m.z.z } });
+	const math3d::Vec<3, T> t = a * math3d::Vec<3, T>{ m.x.w, m.y.w, m.z.w };
+	return { { a.x.x, a.x.y, a.x.z, -t.x }, { a.y.x, a.y.y, a.y.z, -t.y }, { a.z.x, a.z.y, a.z.z, -t.z }, { 0, 0, 0, 1 } };
+}
+
+template<class T>
+constexpr math3d::Matrix<4, 4, T> rigidInverse(const math3d::Matrix<4, 4, T>& m) {
+	static_assert(std::is_floating_point_v<T>, "inverse needs a floating point element type");
+	if constexpr (math3d::simd::AcceleratedProduct<4, 4, 4, T, T>) {
+		if (!std::is_constant_evaluated()) {
+			return math3d::transformKernels::affineInverse<true>(m);
+		}
+	}
+	const math3d::Matrix<3, 3, T> a{ { m.x.x, m.y.x, m.z.x }, { m.x.y, m.y.y, m.z.y }, { m.x.z, m.y.z, m.z.z } };
+	const math3d::Vec<3, T> t = a * math3d::Vec<3, T>{ m.x.w, m.y.w, m.z.w };
+	return { { a.x.x, a.x.y, a.x.z, -t.x }, { a.y.x, a.y.y, a.y.z, -t.y }, { a.z.x, a.z.y, a.z.z, -t.z }, { 0, 0, 0, 1 } };
+}
+
+/*
+* Batched Transforms
+* out must hold at least in.size() elements and may be the same array as in.
+* Vec<4, T> points are transformed by the full matrix, m * v, Vec<4, T> directions as
+* m * (x, y, z, 0).
+*/
+template<class T>
+void transformPoints(const math3d::Matrix<4, 4, T>& m, std::span<const math3d::Vec<3, std::type_identity_t<T>>> in,
+	std::span<math3d::Vec<3, std::type_identity_t<T>>> out, math3d::StoreMode mode = math3d::StoreMode::Automatic) {
+	if constexpr (std::is_same_v<T, float>) {
+		bool streaming = math3d::useStreaming(mode, in.size() * sizeof(math3d::Vec<3, T>));
+		math3d::transformKernels::transformVec3<true>(m, in.data(), out.data(), in.size(), streaming, transformPoint<float>);
+	}
+	else {
+		for (size_t i = 0; i < in.size(); ++i) {
+			out[i] = transformPoint(m, in[i]);
+		}
+	}
+}
+
+template<class T>
+void transformDirections(const math3d::Matrix<4, 4, T>& m, std::span<const math3d::Vec<3, std::type_identity_t<T>>> in,
+	std::span<math3d::Vec<3, std::type_identity_t<T>>> out, math3d::StoreMode mode = math3d::StoreMode::Automatic) {
+	if constexpr (std::is_same_v<T, float>) {
+		bool streaming = math3d::useStreaming(mode, in.size() * sizeof(math3d::Vec<3, T>));
+		math3d::transformKernels::transformVec3<false>(m, in.data(), out.data(), in.size(), streaming, transformDirection<float>);
+	}
+	else {
+		for (size_t i = 0; i < in.size(); ++i) {
+			out[i] = transformDirection(m, in[i]);
+		}
+	}
+}
+
+template<class T>
+void transformPoints(const math3d::Matrix<4, 4, T>& m, std::span<const math3d::Vec<4, std::type_identity_t<T>>> in,
+	std::span<math3d::Vec<4, std::type_identity_t<T>>> out, math3d::StoreMode mode = math3d::StoreMode::Automatic) {
+	if constexpr (std::is_same_v<T, float>) {
+		bool streaming = math3d::useStreaming(mode, in.size() * sizeof(math3d::Vec<4, T>));
+		math3d::transformKernels::transformVec4<true>(m, in.data(), out.data(), in.size(), streaming);
+	}
+	else {
+		for (size_t i = 0; i < in.size(); ++i) {
+			out[i] = m * in[i];
+		}
+	}
+}
+
+template<class T>
+void transformDirections(const math3d::Matrix<4, 4, T>& m, std::span<const math3d::Vec<4, std::type_identity_t<T>>> in,
+	std::span<math3d::Vec<4, std::type_identity_t<T>>> out, math3d::StoreMode mode = math3d::StoreMode::Automatic) {
+	if constexpr (std::is_same_v<T, float>) {
+		bool streaming = math3d::useStreaming(mode, in.size() * sizeof(math3d::Vec<4, T>));
+		math3d::transformKernels::transformVec4<false>(m, in.data(), out.data(), in.size(), streaming);
+	}
+	else {
+		for (size_t i = 0; i < in.size(); ++i) {
+			out[i] = m * math3d::Vec<4, T>{ in[i].x, in[i].y, in[i].z, 0 };
+		}
+	}
+}
+
+//out is resized to in.size(), and may be the same array as in
+template<class T>
+void transformPoints(const math3d::Matrix<4, 4, T>& m, const math3d::VecArray<3, T>& in, math3d::VecArray<3, T>& out,
+	math3d::StoreMode mode = math3d::StoreMode::Automatic) {
+	out.resize(in.size());
+	if constexpr (std::is_same_v<T, float>) {
+		bool streaming = math3d::useStreaming(mode, 3 * in.paddedSize() * sizeof(T));
+		math3d::transformKernels::transformSoA<true>(m, in, out, 0, in.paddedSize(), streaming);
+	}
+	else {
+		for (size_t i = 0; i < in.size(); ++i) {
+			out.set(i, transformPoint(m, in.get(i)));
+		}
+	}
+}
+
+template<class T>
+void transformDirections(const math3d::Matrix<4, 4, T>& m, const math3d::VecArray<3, T>& in, math3d::VecArray<3, T>& out,
+	math3d::StoreMode mode = math3d::StoreMode::Automatic) {
+	out.resize(in.size());
+	if constexpr (std::is_same_v<T, float>) {
+		bool streaming = math3d::useStreaming(mode, 3 * in.paddedSize() * sizeof(T));
+		math3d::transformKernels::transformSoA<false>(m, in, out, 0, in.paddedSize(), streaming);
+	}
+	else {
+		for (size_t i = 0; i < in.size(); ++i) {
+			out.set(i, transformDirection(m, in.get(i)));
+		}
+	}
+}
+
+/*
+* Batched Inverses
+* out must hold at least in.size() matrices and may be the same array as in.
+* Each matrix is inverted on its own, in SIMD registers for float with MATH3D_SIMD.
+*/
+template<size_t Dim, class T>
+void inverse(std::span<const math3d::Matrix<Dim, Dim, T>> in, std::span<math3d::Matrix<Dim, Dim, T>> out) {
+	for (size_t i = 0; i < in.size(); ++i) {
+		out[i] = inverse(in[i]);
+	}
+}
+
+template<class T>
+void affineInverse(std::span<const math3d::Matrix<4, 4, T>> in, std::span<math3d::Matrix<4, 4, T>> out) {
+	for (size_t i = 0; i < in.size(); ++i) {
+		out[i] = affineInverse(in[i]);
+	}
+}
+
+template<class T>
+void rigidInverse(std::span<const math3d::Matrix<4, 4, T>> in, std::span<math3d::Matrix<4, 4, T>> out) {
+	for (size_t i = 0; i < in.size(); ++i) {
+		out[i] = rigidInverse(in[i]);
+	}
+}
@@ -0,0 +1,625 @@
+#pragma once
+
+#include "math3d.h"
+
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <span>
+#include <utility>
+
+namespace math3d {
+
+/*
+* Structure of Arrays storage for Vec<Dim, T>
+* A VecArray of n vectors keeps Dim separate streams: all of the x components are
+* contiguous, then all of the y components, and so on. Every stream starts on a
+* cache line boundary and is padded to a whole number of cache lines, so kernels
+* that walk the streams in lock step can use aligned loads, and kernels over a
+* single array can run over the padding instead of a separate scalar tail.
+*
+* The batched functions below (dotProduct, crossProduct, length, unit, ...) are
+* plain loops over the streams with no cross-iteration dependencies, which is the
+* shape the compiler auto-vectorizes. Note that sqrt only vectorizes when errno
+* does not need to be set (-fno-math-errno on gcc/clang, /fp:fast on msvc).
+*/
+template<size_t Dim, class T>
+class VecArray {
+public:
+	static constexpr size_t Alignment = 64;
+	static constexpr size_t StreamPadding = Alignment / sizeof(T) > 0 ? Alignment / sizeof(T) : 1;
+
+	using value_type = Vec<Dim, T>;
+	using component_type = T;
+
+	VecArray() = default;
+
+	explicit VecArray(size_t count) {
+		resize(count);
+	}
+
+	//AoS to SoA conversion
+	explicit VecArray(std::span<const Vec<Dim, T>> vecs) {
+		resize(vecs.size());
+		scatter(vecs, std::make_index_sequence<Dim>{});
+	}
+
+	VecArray(const VecArray& other) {
+		resize(other.count);
+		std::copy_n(other.storage.get(), Dim * stride, storage.get());
+	}
+
+	VecArray(VecArray&& other) noexcept
+		: storage(std::move(other.storage)), count(std::exchange(other.count, 0)), stride(std::exchange(other.stride, 0)) {
+	}
+
+	VecArray& operator=(const VecArray& other) {
+		if (this != &other) {
+			resize(other.count);
+			std::copy_n(other.storage.get(), Dim * stride, storage.get());
+		}
+		return *this;
+	}
+
+	VecArray& operator=(VecArray&& other) noexcept {
+		storage = std::move(other.storage);
+		count = std::exchange(other.count, 0);
+		stride = std::exchange(other.stride, 0);
+		return *this;
+	}
+
+	size_t size() const {
+		return count;
+	}
+
+	bool empty() const {
+		return count == 0;
+	}
+
+	//Keeps the first min(size(), newCount) vectors, the vectors past them are zero
+	void resize(size_t newCount) {
+		size_t newStride = (newCount + StreamPadding - 1) / StreamPadding * StreamPadding;
+		const size_t kept = std::min(count, newCount);
+		if (newStride != stride || stride == 0) {
+			std::unique_ptr<T[], AlignedDelete> old = std::exchange(storage, std::unique_ptr<T[], AlignedDelete>(newStride == 0 ? nullptr : allocate(Dim * newStride)));
+			std::fill_n(storage.get(), Dim * newStride, T{});
+			for (size_t c = 0; c < Dim && kept > 0; ++c) {
+				std::copy_n(old.get() + c * stride, kept, storage.get() + c * newStride);
+			}
+			stride = newStride;
+		}
+		else {
+			//zero the vectors between the old and the new size, growing clears them and
+			//shrinking keeps the padding zero, as a fresh allocation has it
+			const size_t changed = std::max(count, newCount) - kept;
+			for (size_t c = 0; c < Dim && changed > 0; ++c) {
+				std::fill_n(storage.get() + c * stride + kept, changed, T{});
+			}
+		}
+		count = newCount;
+	}
+
+	/*
+	* Component streams
+	* component(i) is the stream of the ith vector component, x(), y(), z() and w()
+	* are named shorthands for components 0 through 3
+	*/
+	T* component(size_t i) {
+		return std::assume_aligned<Alignment>(storage.get() + i * stride);
+	}
+
+	const T* component(size_t i) const {
+		return std::assume_aligned<Alignment>(storage.get() + i * stride);
+	}
+
+	T* x() { static_assert(Dim > 0); return component(0); }
+	T* y() { static_assert(Dim > 1); return component(1); }
+	T* z() { static_assert(Dim > 2); return component(2); }
+	T* w() { static_assert(Dim > 3); return component(3); }
+	const T* x() const { static_assert(Dim > 0); return component(0); }
+	const T* y() const { static_assert(Dim > 1); return component(1); }
+	const T* z() const { static_assert(Dim > 2); return component(2); }
+	const T* w() const { static_assert(Dim > 3); return component(3); }
+
+	/*
+	* Element access
+	* These gather/scatter a single vector across the streams, so prefer the batched
+	* functions in hot loops
+	*/
+	Vec<Dim, T> get(size_t i) const {
+		return gatherOne(i, std::make_index_sequence<Dim>{});
+	}
+
+	void set(size_t i, const Vec<Dim, T>& v) {
+		scatterOne(i, v, std::make_index_sequence<Dim>{});
+	}
+
+	//SoA to AoS conversion, out must hold at least size() vectors
+	void toAoS(std::span<Vec<Dim, T>> out) const {
+		gather(out, std::make_index_sequence<Dim>{});
+	}
+
+	/*
+	* In place arithmetic, these never allocate
+	*/
+	template<class U>
+	VecArray& operator+=(const VecArray<Dim, U>& other) {
+		//a += a, x + x is exactly x * 2
+		if (static_cast<const void*>(&other) == this) {
+			return *this *= 2;
+		}
+		for (size_t c = 0; c < Dim; ++c) {
+			T* __restrict dst = component(c);
+			const U* __restrict src = other.component(c);
+			for (size_t i = 0; i < count; ++i) {
+				dst[i] = static_cast<T>(dst[i] + src[i]);
+			}
+		}
+		return *this;
+	}
+
+	template<class U>
+	VecArray& operator-=(const VecArray<Dim, U>& other) {
+		//a -= a, through one pointer so that infinities and NaNs still give NaN
+		if (static_cast<const void*>(&other) == this) {
+			T* dst = storage.get();
+			for (size_t i = 0; i < Dim * stride; ++i) {
+				dst[i] = static_cast<T>(dst[i] - dst[i]);
+			}
+			return *this;
+		}
+		for (size_t c = 0; c < Dim; ++c) {
+			T* __restrict dst = component(c);
+			const U* __restrict src = other.component(c);
+			for (size_t i = 0; i < count; ++i) {
+				dst[i] = static_cast<T>(dst[i] - src[i]);
+			}
+		}
+		return *this;
+	}
+
+	template<class ScalarType>
+	VecArray& operator*=(ScalarType s) {
+		T* __restrict dst = storage.get();
+		for (size_t i = 0; i < Dim * stride; ++i) {
+			dst[i] = static_cast<T>(dst[i] * s);
+		}
+		return *this;
+	}
+
+	template<class ScalarType>
+	VecArray& operator/=(ScalarType s) {
+		T* __restrict dst = storage.get();
+		for (size_t i = 0; i < Dim * stride; ++i) {
+			dst[i] = static_cast<T>(dst[i] / s);
+		}
+		return *this;
+	}
+
+	//Number of elements in each stream including the padding, which is zero
+	//filled on allocation. Kernels over a single array may run to paddedSize()
+	size_t paddedSize() const {
+		return stride;
+	}
+
+private:
+	struct AlignedDelete {
+		void operator()(T* p) const {
+			::operator delete[](p, std::align_val_t{ Alignment });
+		}
+	};
+
+	static T* allocate(size_t n) {
+		return static_cast<T*>(::operator new[](n * sizeof(T), std::align_val_t{ Alignment }));
+	}
+
+	template<size_t... I>
+	Vec<Dim, T> gatherOne(size_t i, std::index_sequence<I...>) const {
+		return { component(I)[i]... };
+	}
+
+	template<size_t... I>
+	void scatterOne(size_t i, const Vec<Dim, T>& v, std::index_sequence<I...>) {
+		((component(I)[i] = v.template get<I>()), ...);
+	}
+
+	template<size_t... I>
+	void scatter(std::span<const Vec<Dim, T>> vecs, std::index_sequence<I...>) {
+		T* streams[] = { component(I)... };
+		for (size_t i = 0; i < vecs.size(); ++i) {
+			((streams[I][i] = vecs[i].template get<I>()), ...);
+		}
+	}
+
+	template<size_t... I>
+	void gather(std::span<Vec<Dim, T>> out, std::index_sequence<I...>) const {
+		const T* streams[] = { component(I)... };
+		for (size_t i = 0; i < count; ++i) {
+			out[i] = { streams[I][i]... };
+		}
+	}
+
+	std::unique_ptr<T[], AlignedDelete> storage;
+	size_t count = 0;
+	size_t stride = 0;
+};
+
+}
+
+namespace math3d {
+	/*
+	* Range kernels
+	* The batched functions below apply these to the whole array, parallel.h applies
+	* them to chunks of it. Each one covers the vectors begin to end of every stream,
+	* and out must already have the size of the inputs.
+	*/
+	//out = op(a, b) componentwise, out may be a or b
+	template<size_t Dim, class T, class U, class R, class Op>
+	void combineStreams(const VecArray<Dim, T>& a, const VecArray<Dim, U>& b, VecArray<Dim, R>& out, size_t begin, size_t end, Op op) {
+		const bool inPlace = static_cast<const void*>(&out) == &a || static_cast<const void*>(&out) == &b;
+		for (size_t c = 0; c < Dim; ++c) {
+			if (inPlace) {
+				const T* pa = a.component(c);
+				const U* pb = b.component(c);
+				R* pr = out.component(c);
+				for (size_t i = begin; i < end; ++i) {
+					pr[i] = static_cast<R>(op(pa[i], pb[i]));
+				}
+			}
+			else {
+				const T* __restrict pa = a.component(c);
+				const U* __restrict pb = b.component(c);
+				R* __restrict pr = out.component(c);
+				for (size_t i = begin; i < end; ++i) {
+					pr[i] = static_cast<R>(op(pa[i], pb[i]));
+				}
+			}
+		}
+	}
+
+	//out = op(a) componentwise, out may be a
+	template<size_t Dim, class T, class R, class Op>
+	void mapStreams(const VecArray<Dim, T>& a, VecArray<Dim, R>& out, size_t begin, size_t end, Op op) {
+		const bool inPlace = static_cast<const void*>(&out) == &a;
+		for (size_t c = 0; c < Dim; ++c) {
+			if (inPlace) {
+				const T* pa = a.component(c);
+				R* pr = out.component(c);
+				for (size_t i = begin; i < end; ++i) {
+					pr[i] = static_cast<R>(op(pa[i]));
+				}
+			}
+			else {
+				const T* __restrict pa = a.component(c);
+				R* __restrict pr = out.component(c);
+				for (size_t i = begin; i < end; ++i) {
+					pr[i] = static_cast<R>(op(pa[i]));
+				}
+			}
+		}
+	}
+
+	//out[i] is the dot product of a[i] and b[i]
+	template<size_t Dim, class T, class U, class R>
+	void dotProducts(const VecArray<Dim, T>& a, const VecArray<Dim, U>& b, R* out, size_t begin, size_t end) {
+		R* __restrict pr = out;
+		{
+			const T* __restrict pa = a.component(0);
+			const U* __restrict pb = b.component(0);
+			for (size_t i = begin; i < end; ++i) {
+				pr[i] = pa[i] * pb[i];
+			}
+		}
+		for (size_t c = 1; c < Dim; ++c) {
+			const T* __restrict pa = a.component(c);
+			const U* __restrict pb = b.component(c);
+			for (size_t i = begin; i < end; ++i) {
+				pr[i] += pa[i] * pb[i];
+			}
+		}
+	}
+}
+
+/*
+* Batched Arithmetic
+* Operands must have the same size(), the result has that size too.
+* These follow the element types of the single Vec operators.
+*/
+template<size_t Dim, class T, class U, class R = decltype(T{} + U{}) >
+math3d::VecArray<Dim, R> operator+(const math3d::VecArray<Dim, T>& a, const math3d::VecArray<Dim, U>& b) {
+	math3d::VecArray<Dim, R> result(a.size());
+	math3d::combineStreams(a, b, result, 0, a.size(), [](T x, U y) { return x + y; });
+	return result;
+}
+
+template<size_t Dim, class T, class U, class R = decltype(T{} - U{}) >
+math3d::VecArray<Dim, R> operator-(const math3d::VecArray<Dim, T>& a, const math3d::VecArray<Dim, U>& b) {
+	math3d::VecArray<Dim, R> result(a.size());
+	math3d::combineStreams(a, b, result, 0, a.size(), [](T x, U y) { return x - y; });
+	return result;
+}
+
+//Scalar multiplication keeps the element type of the array, as for Vec
+template<size_t Dim, class T, class ScalarType>
+math3d::VecArray<Dim, T> operator*(ScalarType s, const math3d::VecArray<Dim, T>& a) {
+	math3d::VecArray<Dim, T> result(a);
+	result *= s;
+	return result;
+}
+
+template<size_t Dim, class T, class ScalarType>
+math3d::VecArray<Dim, T> operator*(const math3d::VecArray<Dim, T>& a, ScalarType s) {
+	return operator*(s, a);
+}
+
+template<size_t Dim, class T, class ScalarType>
+math3d::VecArray<Dim, T> operator/(const math3d::VecArray<Dim, T>& a, ScalarType s) {
+	math3d::VecArray<Dim, T> result(a);
+	result /= s;
+	return result;
+}
+
+/*
+* Batched Products
+* out must hold at least a.size() elements
+*/
+template<size_t Dim, class T, class U, class R>
+void dotProduct(const math3d::VecArray<Dim, T>& a, const math3d::VecArray<Dim, U>& b, std::span<R> out) {
+	math3d::dotProducts(a, b, out.data(), 0, a.size());
+}
+
+template<class T, class U, class R = decltype(T{} *U{}) >
+void crossProduct(const math3d::VecArray<3, T>& a, const math3d::VecArray<3, U>& b, math3d::VecArray<3, R>& out) {
+	out.resize(a.size());
+	const T* __restrict ax = a.x();
+	const T* __restrict ay = a.y();
+	const T* __restrict az = a.z();
+	const U* __restrict bx = b.x();
+	const U* __restrict by = b.y();
+	const U* __restrict bz = b.z();
+	R* __restrict rx = out.x();
+	R* __restrict ry = out.y();
+	R* __restrict rz = out.z();
+	for (size_t i = 0; i < out.size(); ++i) {
+		rx[i] = ay[i] * bz[i] - az[i] * by[i];
+		ry[i] = az[i] * bx[i] - ax[i] * bz[i];
+		rz[i] = ax[i] * by[i] - ay[i] * bx[i];
+	}
+}
+
+template<size_t Dim, class T, class R>
+void lengthSquared(const math3d::VecArray<Dim, T>& v, std::span<R> out) {
+	dotProduct(v, v, out);
+}
+
+template<size_t Dim, class T, class R>
+void length(const math3d::VecArray<Dim, T>& v, std::span<R> out) {
+	lengthSquared(v, out);
+	R* __restrict pr = out.data();
+	for (size_t i = 0; i < v.size(); ++i) {
+		pr[i] = static_cast<R>(std::sqrt(pr[i]));
+	}
+}
+
+namespace math3d {
+	//y[i] += alpha x[i] for i in [begin, end), the float kernel runs 8 lanes at a time
+	template<class T>
+	void addScaled(T alpha, const T* x, T* y, size_t begin, size_t end) {
+		size_t i = begin;
+		if constexpr (std::is_same_v<T, float>) {
+			const simd::f32x8 a = simd::splat8(alpha);
+			for (; i + 8 <= end; i += 8) {
+				simd::storeu(y + i, simd::madd(a, simd::loadu8(x + i), simd::loadu8(y + i)));
+			}
+		}
+		const T* __restrict px = x;
+		T* __restrict py = y;
+		for (; i < end; ++i) {
+			py[i] = static_cast<T>(py[i] + alpha * px[i]);
+		}
+	}
+
+	template<size_t Dim, class T>
+	void addScaled(T alpha, const VecArray<Dim, T>& x, VecArray<Dim, T>& y, size_t begin, size_t end) {
+		for (size_t c = 0; c < Dim; ++c) {
+			addScaled(alpha, x.component(c), y.component(c), begin, end);
+		}
+	}
+}
+
+/*
+* AXPY
+* y += alpha x in a single pass, with alpha converted to the element type of y as
+* for the scalar operator*. y must have the size of x, it is updated in place. Vec
+* spans are updated as one flat array of components. Results match y + alpha * x
+* element by element unless FMA is enabled, when the float kernel rounds once.
+*/
+template<class T, class ScalarType>
+void axpy(ScalarType alpha, std::span<const T> x, std::span<T> y) {
+	math3d::addScaled(static_cast<T>(alpha), x.data(), y.data(), 0, x.size());
+}
+
+template<size_t Dim, class T, class ScalarType>
+void axpy(ScalarType alpha, std::span<const math3d::Vec<Dim, T>> x, std::span<math3d::Vec<Dim, T>> y) {
+	static_assert(sizeof(math3d::Vec<Dim, T>) == Dim * sizeof(T));
+	math3d::addScaled(static_cast<T>(alpha), reinterpret_cast<const T*>(x.data()), reinterpret_cast<T*>(y.data()), 0, Dim * x.size());
+}
+
+template<size_t Dim, class T, class ScalarType>
+void axpy(ScalarType alpha, const math3d::VecArray<Dim, T>& x, math3d::VecArray<Dim, T>& y) {
+	math3d::addScaled(static_cast<T>(alpha), x, y, 0, x.size());
+}
+
+namespace math3d {
+	//Scales the vectors begin to end by their reciprocal lengths, which are computed
+	//by invert(squaredLengths, count). out must already have the size of v
+	template<size_t Dim, class T, class R, class Invert>
+	void normalize(const VecArray<Dim, T>& v, VecArray<Dim, R>& out, size_t begin, size_t end, Invert invert) {
+		//lengths are computed into a small block on the stack so the whole pass stays in L1
+		constexpr size_t Block = 256;
+		alignas(64) R inverseLength[Block];
+		for (size_t blockBegin = begin; blockBegin < end; blockBegin += Block) {
+			const size_t count = std::min(Block, end - blockBegin);
+			for (size_t i = 0; i < count; ++i) {
+				inverseLength[i] = 0;
+			}
+			for (size_t c = 0; c < Dim; ++c) {
+				const T* __restrict pv = v.component(c) + blockBegin;
+				for (size_t i = 0; i < count; ++i) {
+					inverseLength[i] += static_cast<R>(pv[i]) * static_cast<R>(pv[i]);
+				}
+			}
+			invert(inverseLength, count);
+			for (size_t c = 0; c < Dim; ++c) {
+				const T* pv = v.component(c) + blockBegin;
+				R* pr = out.component(c) + blockBegin;
+				for (size_t i = 0; i < count; ++i) {
+					pr[i] = static_cast<R>(pv[i]) * inverseLength[i];
+				}
+			}
+		}
+	}
+
+	template<size_t Dim, class T, class R, class Invert>
+	void normalize(const VecArray<Dim, T>& v, VecArray<Dim, R>& out, Invert invert) {
+		if (static_cast<const void*>(&out) != static_cast<const void*>(&v)) {
+			out.resize(v.size());
+		}
+		normalize(v, out, 0, v.size(), invert);
+	}
+
+	template<class R>
+	void inverseSqrt(R* values, size_t n) {
+		for (size_t i = 0; i < n; ++i) {
+			values[i] = R{ 1 } / std::sqrt(values[i]);
+		}
+	}
+}
+
+//Scales each vector by its reciprocal length, out may alias v
+template<size_t Dim, class T, class R = RootType<T>>
+void unit(const math3d::VecArray<Dim, T>& v, math3d::VecArray<Dim, R>& out) {
+	math3d::normalize(v, out, math3d::inverseSqrt<R>);
+}
+
+/*
+* Batched Fast Normalization
+* Same tiers and error bounds as the single rsqrt and unitFast. Float runs 8 lanes at
+* a time with the same estimate instruction and Newton step, so results match the
+* single functions unless FMA contraction is enabled. out may alias in (or v).
+*/
+template<math3d::Precision P = math3d::Precision::Refined, class T, class R>
+void rsqrt(std::span<const T> in, std::span<R> out) {
+	size_t i = 0;
+	if constexpr (std::is_same_v<T, float> && std::is_same_v<R, float>) {
+		for (; i + 8 <= in.size(); i += 8) {
+			math3d::simd::storeu(&out[i], math3d::simd::rsqrt<P>(math3d::simd::loadu8(&in[i])));
+		}
+	}
+	for (; i < in.size(); ++i) {
+		out[i] = static_cast<R>(rsqrt<P>(in[i]));
+	}
+}
+
+template<math3d::Precision P = math3d::Precision::Refined, size_t Dim, class T, class R = RootType<T>>
+void unitFast(const math3d::VecArray<Dim, T>& v, math3d::VecArray<Dim, R>& out) {
+	math3d::normalize(v, out, [](R* values, size_t n) {
+		rsqrt<P>(std::span<const R>(values, n), std::span<R>(values, n));
+	});
+}
+
+/*
+* Batched Fast Angles
+* Same tiers and error bounds as the single atan2Fast and angleFast. The arctangent
+* of float runs 8 lanes at a time with the same polynomial, so results match the
+* single functions unless FMA contraction is enabled. out must hold at least as many
+* elements as the inputs.
+*/
+template<math3d::Precision P = math3d::Precision::Refined, class T, class R>
+void atan2Fast(std::span<const T> y, std::span<const T> x, std::span<R> out) {
+	size_t i = 0;
+	if constexpr (std::is_same_v<T, float> && std::is_same_v<R, float>) {
+		for (; i + 8 <= y.size(); i += 8) {
+			math3d::simd::storeu(&out[i], math3d::simd::atan2<P>(math3d::simd::loadu8(&y[i]), math3d::simd::loadu8(&x[i])));
+		}
+	}
+	for (; i < y.size(); ++i) {
+		out[i] = static_cast<R>(atan2Fast<P>(y[i], x[i]));
+	}
+}
+
+namespace math3d {
+	//Angles of the pairs begin to end, from sine(i) and cosine(i) scaled by the same
+	//positive factor (the cross and dot products). With SquaredSine, sine(i) gives the
+	//square of the sine, so the square roots are taken 8 at a time too
+	template<Precision P, bool SquaredSine, class R, class Sine, class Cosine>
+	void angles(R* out, size_t begin, size_t end, Sine sine, Cosine cosine) {
+		//both are computed into small blocks on the stack so the whole pass stays in L1
+		constexpr size_t Block = 256;
+		alignas(64) R y[Block];
+		alignas(64) R x[Block];
+		for (size_t blockBegin = begin; blockBegin < end; blockBegin += Block) {
+			const size_t count = std::min(Block, end - blockBegin);
+			for (size_t i = 0; i < count; ++i) {
+				y[i] = static_cast<R>(sine(blockBegin + i));
+				x[i] = static_cast<R>(cosine(blockBegin + i));
+			}
+			if constexpr (SquaredSine) {
+				size_t i = 0;
+				if constexpr (std::is_same_v<R, float>) {
+					for (; i + 8 <= count; i += 8) {
+						simd::store(y + i, simd::sqrt(simd::load8(y + i)));
+					}
+				}
+				for (; i < count; ++i) {
+					y[i] = std::sqrt(y[i]);
+				}
+			}
+			atan2Fast<P>(std::span<const R>(y, count), std::span<const R>(x, count), std::span<R>(out + blockBegin, count));
+		}
+	}
+}
+
+template<math3d::Precision P = math3d::Precision::Refined, class T, class U, class R>
+void angleFast(const math3d::VecArray<2, T>& a, const math3d::VecArray<2, U>& b, std::span<R> out) {
+	const T* ax = a.x();
+	const T* ay = a.y();
+	const U* bx = b.x();
+	const U* by = b.y();
+	math3d::angles<P, false>(out.data(), 0, a.size(),
+		[&](size_t i) { return ax[i] * by[i] - ay[i] * bx[i]; },
+		[&](size_t i) { return ax[i] * bx[i] + ay[i] * by[i]; });
+}
+
+template<math3d::Precision P = math3d::Precision::Refined, class T, class U, class R>
+void angleFast(const math3d::VecArray<3, T>& a, const math3d::VecArray<3, U>& b, std::span<R> out) {
+	const T* ax = a.x();
+	const T* ay = a.y();
+	const T* az = a.z();
+	const U* bx = b.x();
+	const U* by = b.y();
+	const U* bz = b.z();
+	math3d::angles<P, true>(out.data(), 0, a.size(),
+		[&](size_t i) {
+			auto cx = ay[i] * bz[i] - az[i] * by[i];
+			auto cy = az[i] * bx[i] - ax[i] * bz[i];
+			auto cz = ax[i] * by[i] - ay[i] * bx[i];
+			return cx * cx + cy * cy + cz * cz;
+		},
+		[&](size_t i) { return ax[i] * bx[i] + ay[i] * by[i] + az[i] * bz[i]; });
+}
+
+//Arrays of Vec pairs, a[i] and b[i]
+template<math3d::Precision P = math3d::Precision::Refined, size_t Dim, class T, class U, class R> requires (Dim == 2 || Dim == 3)
+void angleFast(std::span<const math3d::Vec<Dim, T>> a, std::span<const math3d::Vec<Dim, U>> b, std::span<R> out) {
+	math3d::angles<P, Dim == 3>(out.data(), 0, a.size(),
+		[&](size_t i) {
+			if constexpr (Dim == 2) {
+				return crossProduct(a[i], b[i]);
+			}
+			else {
+				return lengthSquared(crossProduct(a[i], b[i]));
+			}
+		},
+		[&](size_t i) { return dotProduct(a[i], b[i]); });
+}